@@ -0,0 +1,134 @@
+/*
+Read scaling benchmark for ConcurrentArchive.
+
+For 1, 2, 4, ... up to the thread count given on the command line (default: the number of online CPUs) it runs
+that many reader threads doing random concurrentFindMaterial calls for one second while a single writer thread
+keeps updating and re-adding materials. It prints the total and per-thread read throughput and the writes
+completed meanwhile. Readers never wait for the writer, so the per-thread figure should stay roughly flat until
+the readers run out of cores.
+
+Build and run:
+    gcc -O2 -Isrc bench/bench_concurrent.c src/concurrent.c src/store.c src/titleindex.c src/metrics.c src/personindex.c src/slotbitmap.c src/columns.c src/titlesearch.c src/smallstring.c src/fuzzy.c src/numberindex.c -pthread -o bench_concurrent
+    ./bench_concurrent 32
+*/
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "concurrent.h"
+
+#define ITEMS 100000
+
+struct ReaderArgs
+{
+    struct ConcurrentArchive *archive;
+    uint64_t seed;
+    size_t reads;
+    size_t hits;
+};
+
+static volatile int running;
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t nextRandom(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void *reader(void *argument)
+{
+    struct ReaderArgs *args = (struct ReaderArgs *)argument;
+    struct Material material;
+    char title[50];
+    while (__atomic_load_n(&running, __ATOMIC_RELAXED))
+    {
+        snprintf(title, sizeof(title), "Collected Works Volume %llu", (unsigned long long)(nextRandom(&args->seed) % ITEMS));
+        args->hits += concurrentFindMaterial(args->archive, title, &material) == 0;
+        args->reads++;
+    }
+    return NULL;
+}
+
+static void *writer(void *argument)
+{
+    struct ConcurrentArchive *archive = (struct ConcurrentArchive *)argument;
+    size_t *writes = (size_t *)malloc(sizeof(size_t));
+    union MaterialDetails details;
+    memset(&details, 0, sizeof(details));
+    strcpy(details.book.author, "Reviser");
+    *writes = 0;
+    for (int i = 0; __atomic_load_n(&running, __ATOMIC_RELAXED); i = (i + 1) % ITEMS)
+    {
+        char title[50];
+        snprintf(title, sizeof(title), "Collected Works Volume %d", i);
+        details.book.pages = i;
+        concurrentUpdateMaterial(archive, title, details);
+        (*writes)++;
+    }
+    return writes;
+}
+
+int main(int argc, char **argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t limit = argc > 1 ? strtoull(argv[1], NULL, 10) : (size_t)(cpus > 0 ? cpus : 1);
+
+    struct ConcurrentArchive archive;
+    concurrentInit(&archive, NULL);
+    struct Material *items = (struct Material *)calloc(ITEMS, sizeof(struct Material));
+    for (size_t i = 0; i < ITEMS; i++)
+    {
+        items[i].type = BOOK;
+        strcpy(items[i].details.book.author, "Author");
+        items[i].details.book.pages = (int)i;
+        snprintf(items[i].title, sizeof(items[i].title), "Collected Works Volume %zu", i);
+    }
+    concurrentAddMaterials(&archive, items, ITEMS, NULL);
+    free(items);
+
+    printf("%8s %16s %16s %12s\n", "readers", "reads/s", "reads/s/thread", "writes/s");
+    for (size_t threads = 1; threads <= limit; threads *= 2)
+    {
+        pthread_t *readers = (pthread_t *)malloc(threads * sizeof(pthread_t));
+        struct ReaderArgs *args = (struct ReaderArgs *)calloc(threads, sizeof(struct ReaderArgs));
+        pthread_t writing;
+        void *writes;
+
+        running = 1;
+        double start = nowSeconds();
+        for (size_t t = 0; t < threads; t++)
+        {
+            args[t].archive = &archive;
+            args[t].seed = 88172645463325252ULL + t;
+            pthread_create(&readers[t], NULL, reader, &args[t]);
+        }
+        pthread_create(&writing, NULL, writer, &archive);
+        sleep(1);
+        __atomic_store_n(&running, 0, __ATOMIC_RELAXED);
+        size_t reads = 0;
+        for (size_t t = 0; t < threads; t++)
+        {
+            pthread_join(readers[t], NULL);
+            reads += args[t].reads;
+        }
+        pthread_join(writing, &writes);
+        double elapsed = nowSeconds() - start;
+
+        printf("%8zu %16.0f %16.0f %12.0f\n", threads, reads / elapsed, reads / elapsed / threads, *(size_t *)writes / elapsed);
+        free(writes);
+        free(readers);
+        free(args);
+    }
+    concurrentFree(&archive);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+Throughput benchmark for the catalog importer.
+
+It writes ROWS generated CSV rows (default 2,000,000, or the first argument) to a temporary file, then for 1, 2,
+4, ... up to the thread count given as the second argument (default: the number of online CPUs) imports the file
+into an empty store with importFile and prints the rows and megabytes per second and the speed-up over one
+thread. The same input is then imported as JSON Lines with all threads. Every run starts from a cold store, so
+the figures include storing and indexing, not only parsing.
+
+Build and run:
+    gcc -O2 -Isrc bench/bench_import.c src/importer.c src/threadpool.c src/store.c src/titleindex.c src/metrics.c src/personindex.c src/slotbitmap.c src/columns.c src/titlesearch.c src/smallstring.c src/fuzzy.c src/numberindex.c -pthread -o bench_import
+    ./bench_import 2000000 8
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "importer.h"
+
+static const char *types[] = {"BOOK", "JOURNAL", "NEWSPAPER"};
+static const char *subtypes[3][3] = {{"NOVEL", "BIOGRAPHY", "HISTORY"}, {"SCIENCE", "LITERATURE", "ART"}, {"DAILY", "WEEKLY", "MONTHLY"}};
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void writeInput(const char *path, size_t rows, int json)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+    if (!json)
+    {
+        fputs("type,title,number,contributor,subtype\n", file);
+    }
+    for (size_t i = 0; i < rows; i++)
+    {
+        int type = (int)(i % 3);
+        if (json)
+        {
+            fprintf(file, "{\"type\":\"%s\",\"title\":\"Catalog Entry %zu\",\"number\":%zu,\"contributor\":\"Contributor %zu\",\"subtype\":\"%s\"}\n",
+                    types[type], i, i % 1000, i % 5000, subtypes[type][(i / 3) % 3]);
+        }
+        else
+        {
+            fprintf(file, "%s,Catalog Entry %zu,%zu,Contributor %zu,%s\n", types[type], i, i % 1000, i % 5000, subtypes[type][(i / 3) % 3]);
+        }
+    }
+    fclose(file);
+}
+
+static double run(const char *path, size_t threads, size_t *bytes, size_t *added)
+{
+    struct ArchiveStore store;
+    struct ImportOptions options;
+    struct ImportResult result;
+    storeInit(&store, NULL);
+    importDefaultOptions(&options);
+    options.threads = threads;
+    double start = nowSeconds();
+    if (importFile(&store, path, &options, &result) != 0)
+    {
+        fprintf(stderr, "import failed\n");
+        exit(1);
+    }
+    double elapsed = nowSeconds() - start;
+    *bytes = result.bytes;
+    *added = result.added;
+    storeFree(&store);
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    size_t rows = argc > 1 ? strtoull(argv[1], NULL, 10) : 2000000;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t maxThreads = argc > 2 ? strtoull(argv[2], NULL, 10) : (size_t)(cpus < 1 ? 1 : cpus);
+    char path[] = "/tmp/bench_importXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    writeInput(path, rows, 0);
+    printf("%-8s %10s %12s %10s %8s\n", "threads", "seconds", "rows/s", "MB/s", "speedup");
+    double base = 0;
+    size_t bytes = 0;
+    size_t added = 0;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        double elapsed = run(path, threads, &bytes, &added);
+        base = threads == 1 ? elapsed : base;
+        printf("%-8zu %10.3f %12.0f %10.1f %7.2fx\n", threads, elapsed, added / elapsed, bytes / elapsed / 1e6, base / elapsed);
+    }
+
+    writeInput(path, rows, 1);
+    double elapsed = run(path, maxThreads, &bytes, &added);
+    printf("json     %10.3f %12.0f %10.1f\n", elapsed, added / elapsed, bytes / elapsed / 1e6);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+Lookup latency benchmark for the title index of ArchiveStore.
+
+For each archive size from 1e3 up to the limit given on the command line (default 1e7) it fills a store
+with unique titles and then times random storeFindMaterial calls, half of them hits and half misses.
+With the hash index the per-lookup time should stay roughly flat as the archive grows; the remaining
+growth comes from cache misses once the records no longer fit in cache.
+
+Build and run:
+    gcc -O2 -Isrc bench/bench_lookup.c src/store.c src/titleindex.c src/metrics.c src/personindex.c src/slotbitmap.c src/columns.c src/titlesearch.c src/smallstring.c src/fuzzy.c src/numberindex.c -pthread -o bench_lookup
+    ./bench_lookup 10000000
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "store.h"
+
+#define LOOKUPS 1000000
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t nextRandom(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int main(int argc, char **argv)
+{
+    size_t limit = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    uint64_t seed = 88172645463325252ULL;
+
+    printf("%12s %14s %14s\n", "items", "ns/lookup", "hits");
+    for (size_t n = 1000; n <= limit; n *= 10)
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        storeReserve(&store, n);
+
+        struct Material material;
+        memset(&material, 0, sizeof(material));
+        material.type = BOOK;
+        strcpy(material.details.book.author, "Author");
+        for (size_t i = 0; i < n; i++)
+        {
+            snprintf(material.title, sizeof(material.title), "Collected Works Volume %zu", i);
+            material.details.book.pages = (int)i;
+            storeAddMaterial(&store, &material);
+        }
+
+        // build the query titles up front so that only the lookups are timed
+        char(*titles)[50] = (char(*)[50])malloc(LOOKUPS * sizeof(*titles));
+        for (size_t i = 0; i < LOOKUPS; i++)
+        {
+            // even draws fall inside the archive, odd draws are guaranteed misses
+            uint64_t r = nextRandom(&seed);
+            snprintf(titles[i], sizeof(titles[i]), "Collected Works Volume %llu", (unsigned long long)(r % n + (r & 1) * n));
+        }
+
+        size_t hits = 0;
+        double start = nowSeconds();
+        for (size_t i = 0; i < LOOKUPS; i++)
+        {
+            if (storeFindMaterial(&store, titles[i]) != NULL)
+            {
+                hits++;
+            }
+        }
+        double elapsed = nowSeconds() - start;
+
+        printf("%12zu %14.1f %14zu\n", n, elapsed * 1e9 / LOOKUPS, hits);
+        free(titles);
+        storeFree(&store);
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+Latency benchmark for title search.
+
+It builds a TitleSearch over N generated titles (default 10,000,000; pass a smaller N as the first argument on
+machines with less than about 8 GB of memory, since every suffix costs 8 bytes), reporting the build time,
+then runs QUERIES random prefix queries, as typed one keystroke at a time into a search box, and QUERIES random
+substring queries, each fetching the first page of PAGE results. It prints the median, p99 and maximum latency
+of each kind, and the same for a linear strstr scan over a sample of the titles for comparison.
+
+Build and run:
+    gcc -O2 -Isrc bench/bench_search.c src/titlesearch.c src/smallstring.c -o bench_search
+    ./bench_search 1000000
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "titlesearch.h"
+
+#define QUERIES 20000
+#define PAGE 20
+#define SCAN_QUERIES 20
+
+static const char *words[] = {"History", "Science", "Journal", "Review", "Letters", "Annals", "Studies", "Quarterly",
+                              "Modern", "Ancient", "Applied", "Theory", "Practice", "Art", "Music", "Physics"};
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t nextRandom(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int makeTitle(char *title, size_t size, uint64_t i)
+{
+    return snprintf(title, size, "%s %s of %s %llu", words[i % 16], words[(i / 16) % 16], words[(i / 256) % 16], (unsigned long long)i);
+}
+
+static int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(const char *name, double *latencies, size_t n)
+{
+    qsort(latencies, n, sizeof(double), compareDoubles);
+    printf("%-22s %12.2f %12.2f %12.2f\n", name, latencies[n / 2] * 1e6, latencies[n * 99 / 100] * 1e6, latencies[n - 1] * 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    struct TitleSearch search;
+    titleSearchInit(&search);
+    char title[64];
+
+    double start = nowSeconds();
+    for (size_t i = 0; i < n; i++)
+    {
+        int length = makeTitle(title, sizeof(title), i);
+        if (titleSearchAdd(&search, title, (size_t)length, (uint32_t)i) != 0)
+        {
+            fprintf(stderr, "out of memory after %zu titles\n", i);
+            return 1;
+        }
+    }
+    printf("built %zu titles in %.2f s, %zu segments\n", n, nowSeconds() - start, search.segmentCount);
+
+    double *latencies = (double *)malloc(QUERIES * sizeof(double));
+    uint32_t slots[PAGE];
+    uint64_t seed = 88172645463325252ULL;
+    size_t found = 0;
+    printf("%-22s %12s %12s %12s\n", "query (us)", "median", "p99", "max");
+
+    for (size_t q = 0; q < QUERIES; q++)
+    {
+        int length = makeTitle(title, sizeof(title), nextRandom(&seed) % n);
+        // a prefix of 1 to 12 characters, like a partially typed query
+        size_t prefix = 1 + nextRandom(&seed) % (length < 12 ? (size_t)length : 12);
+        start = nowSeconds();
+        found += titleSearchPrefix(&search, title, prefix, 0, slots, PAGE);
+        latencies[q] = nowSeconds() - start;
+    }
+    report("prefix", latencies, QUERIES);
+
+    for (size_t q = 0; q < QUERIES; q++)
+    {
+        int length = makeTitle(title, sizeof(title), nextRandom(&seed) % n);
+        // 3 to 8 characters from anywhere in a title
+        size_t size = 3 + nextRandom(&seed) % 6;
+        size_t from = nextRandom(&seed) % ((size_t)length - size + 1);
+        start = nowSeconds();
+        found += titleSearchSubstring(&search, title + from, size, 0, slots, PAGE);
+        latencies[q] = nowSeconds() - start;
+    }
+    report("substring", latencies, QUERIES);
+
+    for (size_t q = 0; q < SCAN_QUERIES; q++)
+    {
+        int length = makeTitle(title, sizeof(title), nextRandom(&seed) % n);
+        char pattern[16];
+        size_t from = nextRandom(&seed) % ((size_t)length - 5);
+        memcpy(pattern, title + from, 5);
+        pattern[5] = '\0';
+        size_t hits = 0;
+        start = nowSeconds();
+        for (size_t i = 0; i < n && hits < PAGE; i++)
+        {
+            makeTitle(title, sizeof(title), i);
+            hits += strstr(title, pattern) != NULL;
+        }
+        latencies[q] = nowSeconds() - start;
+    }
+    report("strstr scan (sample)", latencies, SCAN_QUERIES);
+
+    printf("(%zu results)\n", found);
+    free(latencies);
+    titleSearchFree(&search);
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+Scan scaling benchmark for ShardedArchive.
+
+It fills an archive of 16 shards with ITEMS materials, then for 1, 2, 4, ... up to the thread count given on the
+command line (default: the number of online CPUs) it builds a pool of that many workers and times shardedScan
+with a page-range predicate, and shardedFilterMaterials for books, over several rounds. It prints the records
+scanned per second and the speed-up over one thread, which should grow with the threads until they run out of
+cores or memory bandwidth.
+
+Build and run:
+    gcc -O2 -Isrc bench/bench_sharded.c src/sharded.c src/threadpool.c src/store.c src/titleindex.c src/metrics.c src/personindex.c src/slotbitmap.c src/columns.c src/titlesearch.c src/smallstring.c src/fuzzy.c src/numberindex.c -pthread -o bench_sharded
+    ./bench_sharded 32
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sharded.h"
+
+#define ITEMS 2000000
+#define SHARDS 16
+#define ROUNDS 5
+
+struct PageRange
+{
+    int low;
+    int high;
+};
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool inPageRange(const struct Material *material, void *context)
+{
+    const struct PageRange *range = (const struct PageRange *)context;
+    return material->type == BOOK && material->details.book.pages >= range->low && material->details.book.pages <= range->high;
+}
+
+int main(int argc, char **argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t limit = argc > 1 ? strtoull(argv[1], NULL, 10) : (size_t)(cpus > 0 ? cpus : 1);
+    struct Material *results = (struct Material *)malloc(1000 * sizeof(struct Material));
+    struct PageRange range = {100, 199};
+    double baseline = 0;
+
+    printf("%8s %16s %10s %16s\n", "threads", "scanned/s", "speed-up", "filter ms");
+    for (size_t threads = 1; threads <= limit; threads *= 2)
+    {
+        struct ShardedArchive archive;
+        if (shardedInit(&archive, SHARDS, threads, NULL) != 0)
+        {
+            fprintf(stderr, "cannot start %zu threads\n", threads);
+            return 1;
+        }
+        for (size_t i = 0; i < ITEMS; i++)
+        {
+            struct Material material;
+            memset(&material, 0, sizeof(material));
+            material.type = i % 4 == 0 ? NEWSPAPER : BOOK;
+            material.details.book.pages = (int)(i % 1000);
+            snprintf(material.details.book.author, sizeof(material.details.book.author), "Author %zu", i % 5000);
+            snprintf(material.title, sizeof(material.title), "Collected Works Volume %zu", i);
+            shardedAddMaterial(&archive, &material);
+        }
+
+        size_t matches = 0;
+        double start = nowSeconds();
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            matches += shardedScan(&archive, inPageRange, &range, results, 1000);
+        }
+        double scan = (nowSeconds() - start) / ROUNDS;
+        start = nowSeconds();
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            matches += shardedFilterMaterials(&archive, BOOK, results, 1000);
+        }
+        double filter = (nowSeconds() - start) / ROUNDS;
+        if (threads == 1)
+        {
+            baseline = scan;
+        }
+
+        printf("%8zu %16.0f %10.2f %16.3f\n", threads, ITEMS / scan, baseline / scan, filter * 1e3);
+        if (matches == 0)
+        {
+            fprintf(stderr, "no matches\n");
+        }
+        shardedFree(&archive);
+    }
+    free(results);
+    return 0;
+}
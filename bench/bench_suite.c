@@ -0,0 +1,307 @@
+/*
+Micro-benchmark suite for the archive operations of ArchiveStore.
+
+For each archive size from 1e2 up to the limit given with --max (default 1e7), growing tenfold, it fills an
+empty store with a synthetic catalog from datagen.c and then times storeAddMaterial, storeFindMaterial (90%
+hits), storeFilterMaterialsView, storeUpdateMaterial, storeFilterMaterialsByAuthorView and storeRemoveMaterial.
+Contributors are drawn with Zipf popularity, so filtering by author sees the same mix of a few long and many
+short postings lists as a real catalog. Every operation is timed on its own; the report gives the throughput over
+the timed calls alone and their median, 99th percentile and worst latency. Per-operation timing costs a clock read of
+some tens of nanoseconds, which is included in every figure and matters only for the fastest operations.
+
+The legacy Archive functions have no implementation in this tree and are not measured.
+
+Options:
+    --max N          largest archive size (default 10000000)
+    --format F       text (default), csv or json (one object per line)
+    --seed S         generator seed, so runs of different builds see the same catalog
+    --indexed        enable the columnar, searchable and ordered indexes, to measure their upkeep
+    --metrics        turn on the operation metrics of metrics.c, to measure what they cost
+
+Build and run:
+    gcc -O2 -Isrc -Ibench bench/bench_suite.c bench/datagen.c src/store.c src/titleindex.c src/metrics.c src/personindex.c src/slotbitmap.c src/columns.c src/titlesearch.c src/smallstring.c src/fuzzy.c src/numberindex.c -pthread -lm -o bench_suite
+    ./bench_suite --max 1000000 --format csv > before.csv
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "metrics.h"
+#include "store.h"
+#include "datagen.h"
+
+#define POINT_OPS 200000
+#define SCAN_WORK 20000000
+#define SCAN_OPS_MIN 10
+
+enum OutputFormat
+{
+    OUTPUT_TEXT,
+    OUTPUT_CSV,
+    OUTPUT_JSON
+};
+
+struct Result
+{
+    const char *operation;
+    size_t items;
+    size_t ops;
+    double seconds;
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t max;
+};
+
+static enum OutputFormat format = OUTPUT_TEXT;
+static uint64_t seed = 88172645463325252ULL;
+static bool indexed = false;
+
+static uint64_t nowNanoseconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int compareLatency(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *operation, size_t items, size_t ops, uint32_t *latencies)
+{
+    // only the timed calls count, not generating their arguments
+    uint64_t elapsed = 0;
+    for (size_t i = 0; i < ops; i++)
+    {
+        elapsed += latencies[i];
+    }
+    struct Result result = {operation, items, ops, elapsed / 1e9, 0, 0, 0};
+    if (ops > 0)
+    {
+        qsort(latencies, ops, sizeof(uint32_t), compareLatency);
+        result.p50 = latencies[ops / 2];
+        result.p99 = latencies[(size_t)(ops * 0.99)];
+        result.max = latencies[ops - 1];
+    }
+    double rate = result.seconds > 0 ? ops / result.seconds : 0;
+    switch (format)
+    {
+    case OUTPUT_CSV:
+        printf("%s,%zu,%zu,%.6f,%.0f,%u,%u,%u\n", result.operation, result.items, result.ops, result.seconds, rate, result.p50, result.p99, result.max);
+        break;
+    case OUTPUT_JSON:
+        printf("{\"operation\":\"%s\",\"items\":%zu,\"ops\":%zu,\"seconds\":%.6f,\"ops_per_sec\":%.0f,\"p50_ns\":%u,\"p99_ns\":%u,\"max_ns\":%u,\"indexed\":%s,\"seed\":%llu}\n",
+               result.operation, result.items, result.ops, result.seconds, rate, result.p50, result.p99, result.max, indexed ? "true" : "false", (unsigned long long)seed);
+        break;
+    default:
+        printf("%-16s %10zu %10zu %14.0f %10u %10u %12u\n", result.operation, result.items, result.ops, rate, result.p50, result.p99, result.max);
+        break;
+    }
+    fflush(stdout);
+}
+
+static size_t scanOps(size_t items)
+{
+    size_t ops = SCAN_WORK / items;
+    return ops < SCAN_OPS_MIN ? SCAN_OPS_MIN : ops;
+}
+
+/*
+Returns a step that is coprime with n, so that (i * step) % n visits every serial below n exactly once in an
+order that jumps around the store.
+*/
+static size_t permutationStep(size_t n)
+{
+    size_t step = (size_t)(0.6180339887 * n) | 1;
+    for (;;)
+    {
+        size_t a = step;
+        size_t b = n;
+        while (b != 0)
+        {
+            size_t t = a % b;
+            a = b;
+            b = t;
+        }
+        if (a == 1)
+        {
+            return step;
+        }
+        step += 2;
+    }
+}
+
+static int runSize(size_t items, uint32_t *latencies, const struct Material **results)
+{
+    struct StoreConfig config;
+    storeDefaultConfig(&config);
+    config.columnar = indexed;
+    config.searchable = indexed;
+    config.ordered = indexed;
+    struct ArchiveStore store;
+    struct DataGen gen;
+    if (storeInit(&store, &config) != 0 || dataGenInit(&gen, items, seed ^ items) != 0)
+    {
+        return -1;
+    }
+
+    struct Material material;
+    for (size_t i = 0; i < items; i++)
+    {
+        dataGenMaterial(&gen, i, &material);
+        uint64_t t = nowNanoseconds();
+        if (storeAddMaterial(&store, &material) != 0)
+        {
+            fprintf(stderr, "storeAddMaterial failed at %zu\n", i);
+            return -1;
+        }
+        latencies[i] = (uint32_t)(nowNanoseconds() - t);
+    }
+    report("add", items, items, latencies);
+
+    char title[50];
+    size_t ops = POINT_OPS;
+    size_t hits = 0;
+    for (size_t i = 0; i < ops; i++)
+    {
+        uint64_t r = dataGenNext(&gen);
+        // one lookup in ten asks for a serial that was never added
+        size_t serial = r % 10 == 0 ? items + r % items : (r >> 8) % items;
+        dataGenTitle(serial, title, sizeof(title));
+        uint64_t t = nowNanoseconds();
+        hits += storeFindMaterial(&store, title) != NULL;
+        latencies[i] = (uint32_t)(nowNanoseconds() - t);
+    }
+    report("find", items, ops, latencies);
+
+    ops = scanOps(items);
+    for (size_t i = 0; i < ops; i++)
+    {
+        uint64_t t = nowNanoseconds();
+        hits += storeFilterMaterialsView(&store, (enum MaterialType)(i % 3), results, items);
+        latencies[i] = (uint32_t)(nowNanoseconds() - t);
+    }
+    report("filter", items, ops, latencies);
+
+    ops = POINT_OPS;
+    char author[50];
+    for (size_t i = 0; i < ops; i++)
+    {
+        dataGenContributorName(dataGenContributor(&gen), author, sizeof(author));
+        uint64_t t = nowNanoseconds();
+        hits += storeFilterMaterialsByAuthorView(&store, author, results, items);
+        latencies[i] = (uint32_t)(nowNanoseconds() - t);
+    }
+    report("filterByAuthor", items, ops, latencies);
+
+    ops = POINT_OPS < items ? POINT_OPS : items;
+    for (size_t i = 0; i < ops; i++)
+    {
+        size_t serial = dataGenNext(&gen) % items;
+        dataGenTitle(serial, title, sizeof(title));
+        // a fresh material of the same serial has a new contributor; keep the stored type so the update is valid
+        dataGenMaterial(&gen, serial, &material);
+        const struct Material *current = storeFindMaterial(&store, title);
+        while (material.type != current->type)
+        {
+            dataGenMaterial(&gen, serial, &material);
+        }
+        uint64_t t = nowNanoseconds();
+        if (storeUpdateMaterial(&store, title, material.details) != 0)
+        {
+            fprintf(stderr, "storeUpdateMaterial failed for %s\n", title);
+            return -1;
+        }
+        latencies[i] = (uint32_t)(nowNanoseconds() - t);
+    }
+    report("update", items, ops, latencies);
+
+    // remove half the store, or POINT_OPS materials, in scattered order
+    ops = items / 2 < POINT_OPS ? items / 2 : POINT_OPS;
+    size_t step = permutationStep(items);
+    for (size_t i = 0; i < ops; i++)
+    {
+        dataGenTitle((i * step) % items, title, sizeof(title));
+        uint64_t t = nowNanoseconds();
+        storeRemoveMaterial(&store, title);
+        latencies[i] = (uint32_t)(nowNanoseconds() - t);
+    }
+    report("remove", items, ops, latencies);
+
+    if (hits == 0)
+    {
+        fprintf(stderr, "no operation found anything\n");
+    }
+    dataGenFree(&gen);
+    storeFree(&store);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    size_t limit = 10000000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+        {
+            limit = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            i++;
+            format = strcmp(argv[i], "csv") == 0 ? OUTPUT_CSV : strcmp(argv[i], "json") == 0 ? OUTPUT_JSON : OUTPUT_TEXT;
+        }
+        else if (strcmp(argv[i], "--indexed") == 0)
+        {
+            indexed = true;
+        }
+        else if (strcmp(argv[i], "--metrics") == 0)
+        {
+            metricsEnable(true);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--max N] [--format text|csv|json] [--seed S] [--indexed] [--metrics]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (limit < 100)
+    {
+        limit = 100;
+    }
+
+    size_t capacity = limit > POINT_OPS ? limit : POINT_OPS;
+    uint32_t *latencies = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    const struct Material **results = (const struct Material **)malloc(limit * sizeof(*results));
+    if (latencies == NULL || results == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    if (format == OUTPUT_CSV)
+    {
+        printf("operation,items,ops,seconds,ops_per_sec,p50_ns,p99_ns,max_ns\n");
+    }
+    else if (format == OUTPUT_TEXT)
+    {
+        printf("%-16s %10s %10s %14s %10s %10s %12s\n", "operation", "items", "ops", "ops/s", "p50 ns", "p99 ns", "max ns");
+    }
+    for (size_t items = 100; items <= limit; items *= 10)
+    {
+        if (runSize(items, latencies, results) != 0)
+        {
+            return 1;
+        }
+    }
+    free(results);
+    free(latencies);
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include <math.h>
+#include "datagen.h"
+
+static const char *datagenWords[] = {
+    "History", "Science", "Journal", "Review", "Letters", "Annals", "Studies", "Quarterly", "Modern", "Ancient",
+    "Applied", "Theory", "Practice", "Art", "Music", "Physics", "Garden", "Ocean", "Winter", "Journey", "Silence",
+    "Harbour", "River", "Empire", "Kingdom", "Shadow", "Light", "Stone", "Glass", "Iron", "Silver", "Golden",
+    "Northern", "Southern", "Eastern", "Western", "Lost", "Hidden", "Secret", "Last"};
+static const char *datagenFirstNames[] = {"Anna", "Ben", "Chloe", "David", "Elena", "Farid", "Grace", "Hiro", "Ines", "Jonas",
+                                          "Kasia", "Liam", "Maya", "Noah", "Olga", "Pedro", "Quinn", "Rosa", "Sven", "Tara"};
+static const char *datagenLastNames[] = {"Abbott", "Berger", "Castro", "Dubois", "Eriksen", "Fischer", "Garcia", "Hughes",
+                                         "Ivanova", "Jensen", "Kowalski", "Larsen", "Moreau", "Nakamura", "Okafor", "Petrov",
+                                         "Quintero", "Rossi", "Schmidt", "Tanaka", "Usman", "Varga", "Weber", "Xu", "Yilmaz"};
+
+#define DATAGEN_WORDS (sizeof(datagenWords) / sizeof(datagenWords[0]))
+#define DATAGEN_FIRST (sizeof(datagenFirstNames) / sizeof(datagenFirstNames[0]))
+#define DATAGEN_LAST (sizeof(datagenLastNames) / sizeof(datagenLastNames[0]))
+
+/*
+This function prepares a generator for a catalog of about items materials, with one contributor for every
+DATAGEN_ITEMS_PER_CONTRIBUTOR materials. The same seed always yields the same catalog. It returns 0 on success
+and -1 if memory could not be allocated.
+*/
+int dataGenInit(struct DataGen *gen, size_t items, uint64_t seed)
+{
+    gen->state = seed == 0 ? 88172645463325252ULL : seed;
+    gen->contributors = items / DATAGEN_ITEMS_PER_CONTRIBUTOR + 10;
+    gen->cdf = (double *)malloc(gen->contributors * sizeof(double));
+    if (gen->cdf == NULL)
+    {
+        return -1;
+    }
+    double total = 0;
+    for (size_t i = 0; i < gen->contributors; i++)
+    {
+        total += 1.0 / pow((double)(i + 1), DATAGEN_ZIPF_EXPONENT);
+        gen->cdf[i] = total;
+    }
+    for (size_t i = 0; i < gen->contributors; i++)
+    {
+        gen->cdf[i] /= total;
+    }
+    return 0;
+}
+
+/*
+This function releases the generator.
+*/
+void dataGenFree(struct DataGen *gen)
+{
+    free(gen->cdf);
+    gen->cdf = NULL;
+}
+
+/*
+This function returns the next 64-bit pseudo-random number, from a xorshift64* sequence.
+*/
+uint64_t dataGenNext(struct DataGen *gen)
+{
+    gen->state ^= gen->state >> 12;
+    gen->state ^= gen->state << 25;
+    gen->state ^= gen->state >> 27;
+    return gen->state * 2685821657736338717ULL;
+}
+
+/*
+This function returns a uniform number in [0, 1).
+*/
+static double dataGenUniform(struct DataGen *gen)
+{
+    return (double)(dataGenNext(gen) >> 11) / 9007199254740992.0;
+}
+
+/*
+This function draws a contributor by popularity: contributor 0 is the most prolific and contributor i is about
+i^1.1 times rarer.
+*/
+size_t dataGenContributor(struct DataGen *gen)
+{
+    double u = dataGenUniform(gen);
+    size_t low = 0;
+    size_t high = gen->contributors - 1;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (gen->cdf[middle] < u)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/*
+This function writes the name of a contributor, a first and last name with a number once the name pairs run
+out.
+*/
+void dataGenContributorName(size_t contributor, char *name, size_t size)
+{
+    size_t pairs = DATAGEN_FIRST * DATAGEN_LAST;
+    const char *first = datagenFirstNames[contributor % DATAGEN_FIRST];
+    const char *last = datagenLastNames[(contributor / DATAGEN_FIRST) % DATAGEN_LAST];
+    if (contributor < pairs)
+    {
+        snprintf(name, size, "%s %s", first, last);
+    }
+    else
+    {
+        snprintf(name, size, "%s %s %zu", first, last, contributor / pairs);
+    }
+}
+
+/*
+This function writes the title of the material with the given serial number. Titles are a function of the
+serial alone, so a benchmark can look up material i without keeping its title. Two to four words are picked by
+a hash of the serial, skewed towards the start of the word list.
+*/
+void dataGenTitle(size_t serial, char *title, size_t size)
+{
+    uint64_t h = (uint64_t)serial * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 29;
+    size_t words = 2 + h % 3;
+    size_t length = 0;
+    for (size_t i = 0; i < words && length < size; i++)
+    {
+        h = h * 6364136223846793005ULL + 1442695040888963407ULL;
+        // the lower of two uniform picks favours low indexes, with a linearly falling chance
+        size_t a = (h >> 33) % DATAGEN_WORDS;
+        size_t b = (h >> 17) % DATAGEN_WORDS;
+        length += (size_t)snprintf(title + length, size - length, "%s%s", i == 0 ? "" : " ", datagenWords[a < b ? a : b]);
+    }
+    if (length < size)
+    {
+        snprintf(title + length, size - length, " %zu", serial);
+    }
+}
+
+/*
+This function fills material with the synthetic material of the given serial number: 60% books, 30% journals
+and 10% newspapers, with uniform subtypes, page counts spread around 300 and issues up to 500.
+*/
+void dataGenMaterial(struct DataGen *gen, size_t serial, struct Material *material)
+{
+    memset(material, 0, sizeof(*material));
+    dataGenTitle(serial, material->title, sizeof(material->title));
+    uint64_t r = dataGenNext(gen);
+    char name[50];
+    dataGenContributorName(dataGenContributor(gen), name, sizeof(name));
+    unsigned kind = (unsigned)(r % 10);
+    if (kind < 6)
+    {
+        material->type = BOOK;
+        // the sum of three uniforms gives a bell-shaped spread of page counts
+        material->details.book.pages = 20 + (int)((r >> 8) % 200 + (r >> 16) % 200 + (r >> 24) % 200);
+        material->details.book.type = (enum BookType)((r >> 32) % 3);
+        strcpy(material->details.book.author, name);
+    }
+    else if (kind < 9)
+    {
+        material->type = JOURNAL;
+        material->details.journal.issue = 1 + (int)((r >> 8) % 500);
+        material->details.journal.type = (enum JournalType)((r >> 32) % 3);
+        strcpy(material->details.journal.publisher, name);
+    }
+    else
+    {
+        material->type = NEWSPAPER;
+        material->details.newspaper.type = (enum NewspaperType)((r >> 32) % 3);
+        strcpy(material->details.newspaper.editor, name);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef DATAGEN_H
+#define DATAGEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bitmap.h"
+
+// Tuning
+#define DATAGEN_ZIPF_EXPONENT 1.1
+#define DATAGEN_ITEMS_PER_CONTRIBUTOR 20
+
+// Structs
+
+/*
+A deterministic generator of synthetic catalogs. Titles are built from a word list, each word the lower of two
+uniform picks, so the chance of a word falls linearly from the start of the list to its end, and a serial number
+keeps them unique. Contributors are first and last name pairs whose popularity is Zipf distributed, so a few
+prolific authors own many materials and most own one or two. cdf holds the cumulative contributor popularity.
+*/
+struct DataGen
+{
+    uint64_t state;
+    size_t contributors;
+    double *cdf;
+};
+
+// Functions
+
+int dataGenInit(struct DataGen *gen, size_t items, uint64_t seed);
+
+void dataGenFree(struct DataGen *gen);
+
+uint64_t dataGenNext(struct DataGen *gen);
+
+size_t dataGenContributor(struct DataGen *gen);
+
+void dataGenContributorName(size_t contributor, char *name, size_t size);
+
+void dataGenMaterial(struct DataGen *gen, size_t serial, struct Material *material);
+
+void dataGenTitle(size_t serial, char *title, size_t size);
+
+#endif
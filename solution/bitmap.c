@@ -60,52 +60,13 @@ struct Material *findMaterial(struct Archive *archive, char *title)
 }
 
 /*
-This function filters materials of a specified type from an Archive struct and stores them in a new Archive struct.
-It loops through each material in the original archive and checks if it matches the specified type.
-If a match is found, it copies the material to the filtered archive, including type-specific details and common fields.
-If no materials of the specified type are found, it returns early. The filteredArchive struct is initialized with a
-count of 0 and its materials array is updated as materials are added to it.
+This function filters materials of a specified type from an Archive struct. It used to copy every match into a
+stack-local Archive that was then discarded; it is now a thin wrapper over filterMaterialsView that only counts
+the matches, so no records are copied. Use filterMaterialsView to get at the matching materials.
 */
 void filterMaterials(struct Archive *archive, enum MaterialType type)
 {
-    // Initialize a new Archive struct to store the filtered materials
-    struct Archive filteredArchive;
-    filteredArchive.count = 0;
-
-    // Loop through each material in the original archive
-    for (int i = 0; i < archive->count; i++)
-    {
-        struct Material material = archive->materials[i];
-
-        // If the material matches the specified type, add it to the filtered archive
-        if (material.type == type)
-        {
-            // Check the type-specific details to determine which struct fields to copy
-            switch (type)
-            {
-            case BOOK:
-                filteredArchive.materials[filteredArchive.count].details.book = material.details.book;
-                break;
-            case JOURNAL:
-                filteredArchive.materials[filteredArchive.count].details.journal = material.details.journal;
-                break;
-            case NEWSPAPER:
-                filteredArchive.materials[filteredArchive.count].details.newspaper = material.details.newspaper;
-                break;
-            }
-
-            // Copy over the common fields and increase the count of the filtered archive
-            strcpy(filteredArchive.materials[filteredArchive.count].title, material.title);
-            filteredArchive.materials[filteredArchive.count].type = material.type;
-            filteredArchive.count++;
-        }
-    }
-
-    // If no materials of the specified type were found, return early
-    if (filteredArchive.count == 0)
-    {
-        return;
-    }
+    filterMaterialsView(archive, type, NULL, 0);
 }
 
 /*
@@ -201,52 +162,94 @@ void removeMaterial(struct Archive *archive, char *title)
 
 /*
 This function filters materials (books, journals, and newspapers) stored in an archive by the provided author name.
-It returns an array of pointers to the materials that match the author name. If the archive or author name is NULL,
-or the author name is an empty string, the function returns NULL. The matching materials are stored in a temporary
-array of structs, which is then copied into a newly allocated array of structs before being returned.
+It returns a newly allocated array holding copies of the materials that match the author name, which the caller must free.
+If the archive or author name is NULL, the author name is an empty string or nothing matches, the function returns NULL.
+It is a thin wrapper over filterMaterialsByAuthorView: the matches are collected as pointers into the archive and copied
+exactly once, into the returned array.
 */
 struct Material *filterMaterialsByAuthor(struct Archive *archive, char *author)
 {
-    if (archive == NULL || author == NULL)
+    const struct Material *matchingMaterials[100];
+    int matchingCount = filterMaterialsByAuthorView(archive, author, matchingMaterials, 100);
+
+    if (matchingCount <= 0)
     {
-        // Error: archive or author is NULL
         return NULL;
     }
 
-    if (strlen(author) == 0)
+    struct Material *matchingMaterialsPtr = (struct Material *)malloc(sizeof(struct Material) * matchingCount);
+    if (matchingMaterialsPtr == NULL)
     {
-        // Error: author string is empty
         return NULL;
     }
-    struct Material matchingMaterials[100];
-    int matchingCount = 0;
 
+    for (int i = 0; i < matchingCount; i++)
+    {
+        matchingMaterialsPtr[i] = *matchingMaterials[i];
+    }
+
+    return matchingMaterialsPtr;
+}
+
+/*
+This function finds the materials of a specified type without copying them. Pointers to the matching materials are
+written, in archive order, into the caller-supplied results array until capacity entries have been written; results
+may be NULL with a capacity of 0 to only count the matches. It returns the total number of matches, which can be larger
+than capacity, or -1 if the archive is NULL. The pointers stay valid until the archive is modified.
+*/
+int filterMaterialsView(const struct Archive *archive, enum MaterialType type, const struct Material **results, int capacity)
+{
+    if (archive == NULL)
+    {
+        return -1;
+    }
+
+    int matchingCount = 0;
     for (int i = 0; i < archive->count; i++)
     {
-        struct Material *currentMaterial = &archive->materials[i];
-        if (currentMaterial->type == BOOK && strcmp(currentMaterial->details.book.author, author) == 0)
-        {
-            matchingMaterials[matchingCount++] = *currentMaterial;
-        }
-        else if (currentMaterial->type == JOURNAL && strcmp(currentMaterial->details.journal.publisher, author) == 0)
+        if (archive->materials[i].type == type)
         {
-            matchingMaterials[matchingCount++] = *currentMaterial;
-        }
-        else if (currentMaterial->type == NEWSPAPER && strcmp(currentMaterial->details.newspaper.editor, author) == 0)
-        {
-            matchingMaterials[matchingCount++] = *currentMaterial;
+            if (matchingCount < capacity)
+            {
+                results[matchingCount] = &archive->materials[i];
+            }
+            matchingCount++;
         }
     }
+    return matchingCount;
+}
 
-    if (matchingCount == 0)
+/*
+This function finds the materials whose author (books), publisher (journals) or editor (newspapers) equals the provided
+name, without copying them. It fills the caller-supplied results array the same way filterMaterialsView does and returns
+the total number of matches. It returns -1 if the archive or author name is NULL and 0 if the author name is empty.
+*/
+int filterMaterialsByAuthorView(const struct Archive *archive, const char *author, const struct Material **results, int capacity)
+{
+    if (archive == NULL || author == NULL)
     {
-        return NULL;
+        return -1;
+    }
+    if (author[0] == '\0')
+    {
+        return 0;
     }
 
-    struct Material *matchingMaterialsPtr = (struct Material *)malloc(sizeof(struct Material) * matchingCount);
-
-    // struct Material *matchingMaterialsPtr = malloc(sizeof(struct Material) * matchingCount);
-    memcpy(matchingMaterialsPtr, matchingMaterials, sizeof(struct Material) * matchingCount);
-
-    return matchingMaterialsPtr;
+    int matchingCount = 0;
+    for (int i = 0; i < archive->count; i++)
+    {
+        const struct Material *currentMaterial = &archive->materials[i];
+        bool matches = (currentMaterial->type == BOOK && strcmp(currentMaterial->details.book.author, author) == 0) ||
+                       (currentMaterial->type == JOURNAL && strcmp(currentMaterial->details.journal.publisher, author) == 0) ||
+                       (currentMaterial->type == NEWSPAPER && strcmp(currentMaterial->details.newspaper.editor, author) == 0);
+        if (matches)
+        {
+            if (matchingCount < capacity)
+            {
+                results[matchingCount] = currentMaterial;
+            }
+            matchingCount++;
+        }
+    }
+    return matchingCount;
 }
@@ -22,11 +22,9 @@ struct Material *findMaterial(struct Archive *archive, char *title)
 }
 
 /*
-This function filters materials of a specified type from an Archive struct and stores them in a new Archive struct. 
-It loops through each material in the original archive and checks if it matches the specified type. 
-If a match is found, it copies the material to the filtered archive, including type-specific details and common fields. 
-If no materials of the specified type are found, it returns early. The filteredArchive struct is initialized with a 
-count of 0 and its materials array is updated as materials are added to it.
+This function filters materials of a specified type from an Archive struct. It is a thin wrapper over
+filterMaterialsView that only counts the matches, so no records are copied. Use filterMaterialsView to get at
+the matching materials.
 */
 void filterMaterials(struct Archive *archive, enum MaterialType type)
 {
@@ -53,10 +51,30 @@ void removeMaterial(struct Archive *archive, char *title)
 
 /*
 This function filters materials (books, journals, and newspapers) stored in an archive by the provided author name. 
-It returns an array of pointers to the materials that match the author name. If the archive or author name is NULL, 
-or the author name is an empty string, the function returns NULL. The matching materials are stored in a temporary 
-array of structs, which is then copied into a newly allocated array of structs before being returned.
+It returns a newly allocated array holding copies of the materials that match the author name, which the caller must free. 
+If the archive or author name is NULL, the author name is an empty string or nothing matches, the function returns NULL. 
+It is a thin wrapper over filterMaterialsByAuthorView: the matches are collected as pointers into the archive and copied 
+exactly once, into the returned array.
 */
 struct Material *filterMaterialsByAuthor(struct Archive *archive, char *author)
 {
 }
+
+/*
+This function finds the materials of a specified type without copying them. Pointers to the matching materials are 
+written, in archive order, into the caller-supplied results array until capacity entries have been written; results 
+may be NULL with a capacity of 0 to only count the matches. It returns the total number of matches, which can be larger 
+than capacity, or -1 if the archive is NULL. The pointers stay valid until the archive is modified.
+*/
+int filterMaterialsView(const struct Archive *archive, enum MaterialType type, const struct Material **results, int capacity)
+{
+}
+
+/*
+This function finds the materials whose author (books), publisher (journals) or editor (newspapers) equals the provided 
+name, without copying them. It fills the caller-supplied results array the same way filterMaterialsView does and returns 
+the total number of matches. It returns -1 if the archive or author name is NULL and 0 if the author name is empty.
+*/
+int filterMaterialsByAuthorView(const struct Archive *archive, const char *author, const struct Material **results, int capacity)
+{
+}
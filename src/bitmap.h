@@ -1,3 +1,6 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -78,4 +81,10 @@ int updateMaterial(struct Archive *archive, char *title, union MaterialDetails d
 
 void removeMaterial(struct Archive *archive, char *title);
 
-struct Material *filterMaterialsByAuthor(struct Archive *archive, char *author);
\ No newline at end of file
+struct Material *filterMaterialsByAuthor(struct Archive *archive, char *author);
+
+int filterMaterialsView(const struct Archive *archive, enum MaterialType type, const struct Material **results, int capacity);
+
+int filterMaterialsByAuthorView(const struct Archive *archive, const char *author, const struct Material **results, int capacity);
+
+#endif
@@ -0,0 +1,348 @@
+#include <stdlib.h>
+#include <string.h>
+#include "columns.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define COLUMNS_X86 1
+#endif
+
+/*
+This function grows every column to hold at least capacity entries. New entries are marked COLUMN_NONE so that
+slots never written by columnsSet do not match any predicate. It returns 0 on success and -1 if an allocation
+fails.
+*/
+static int columnsReserve(struct ColumnStore *columns, size_t capacity)
+{
+    if (capacity <= columns->capacity)
+    {
+        return 0;
+    }
+
+    size_t newCapacity = columns->capacity == 0 ? 1024 : columns->capacity;
+    while (newCapacity < capacity)
+    {
+        newCapacity *= 2;
+    }
+
+    uint8_t *types = (uint8_t *)realloc(columns->types, newCapacity);
+    if (types == NULL)
+    {
+        return -1;
+    }
+    columns->types = types;
+    uint8_t *subtypes = (uint8_t *)realloc(columns->subtypes, newCapacity);
+    if (subtypes == NULL)
+    {
+        return -1;
+    }
+    columns->subtypes = subtypes;
+    int32_t *numbers = (int32_t *)realloc(columns->numbers, newCapacity * sizeof(int32_t));
+    if (numbers == NULL)
+    {
+        return -1;
+    }
+    columns->numbers = numbers;
+
+    size_t added = newCapacity - columns->capacity;
+    memset(&columns->types[columns->capacity], COLUMN_NONE, added);
+    memset(&columns->subtypes[columns->capacity], COLUMN_NONE, added);
+    memset(&columns->numbers[columns->capacity], 0, added * sizeof(int32_t));
+    columns->capacity = newCapacity;
+    return 0;
+}
+
+/*
+This function initializes empty columns. Nothing is allocated until the first slot is set.
+*/
+void columnsInit(struct ColumnStore *columns)
+{
+    memset(columns, 0, sizeof(*columns));
+}
+
+/*
+This function releases the columns and leaves them empty.
+*/
+void columnsFree(struct ColumnStore *columns)
+{
+    free(columns->types);
+    free(columns->subtypes);
+    free(columns->numbers);
+    columnsInit(columns);
+}
+
+/*
+This function writes the predicate fields of a material into the columns at slot, growing them if needed. It
+returns 0 on success and -1 on allocation failure.
+*/
+int columnsSet(struct ColumnStore *columns, size_t slot, const struct Material *material)
+{
+    if (columnsReserve(columns, slot + 1) != 0)
+    {
+        return -1;
+    }
+
+    uint8_t type = COLUMN_NONE;
+    int subtype = -1;
+    int32_t number = 0;
+    switch (material->type)
+    {
+    case BOOK:
+        type = BOOK;
+        subtype = material->details.book.type;
+        number = material->details.book.pages;
+        break;
+    case JOURNAL:
+        type = JOURNAL;
+        subtype = material->details.journal.type;
+        number = material->details.journal.issue;
+        break;
+    case NEWSPAPER:
+        type = NEWSPAPER;
+        subtype = material->details.newspaper.type;
+        break;
+    default:
+        break;
+    }
+
+    columns->types[slot] = type;
+    columns->subtypes[slot] = subtype >= 0 && subtype < COLUMN_NONE ? (uint8_t)subtype : COLUMN_NONE;
+    columns->numbers[slot] = number;
+    if (slot >= columns->size)
+    {
+        columns->size = slot + 1;
+    }
+    return 0;
+}
+
+/*
+This function marks slot as dead so that it matches no type or subtype predicate.
+*/
+void columnsClear(struct ColumnStore *columns, size_t slot)
+{
+    if (slot < columns->size)
+    {
+        columns->types[slot] = COLUMN_NONE;
+        columns->subtypes[slot] = COLUMN_NONE;
+        columns->numbers[slot] = 0;
+    }
+}
+
+/*
+This function copies the entry at from to to and clears from, mirroring a record move in the store.
+*/
+void columnsMove(struct ColumnStore *columns, size_t from, size_t to)
+{
+    columns->types[to] = columns->types[from];
+    columns->subtypes[to] = columns->subtypes[from];
+    columns->numbers[to] = columns->numbers[from];
+    columnsClear(columns, from);
+}
+
+/*
+These are the portable kernels. Each fills one 64-bit word of the result per 64 entries; they handle whole
+columns on targets without SIMD and the partial last word everywhere else.
+*/
+static size_t scanEqualU8Scalar(const uint8_t *column, size_t begin, size_t n, uint8_t value, uint64_t *bits)
+{
+    size_t count = 0;
+    for (size_t base = begin; base < n; base += 64)
+    {
+        size_t end = n - base < 64 ? n : base + 64;
+        uint64_t word = 0;
+        for (size_t i = base; i < end; i++)
+        {
+            word |= (uint64_t)(column[i] == value) << (i - base);
+        }
+        bits[base / 64] = word;
+        count += (size_t)__builtin_popcountll(word);
+    }
+    return count;
+}
+
+static size_t scanRangeI32Scalar(const int32_t *column, size_t begin, size_t n, int32_t low, int32_t high, uint64_t *bits)
+{
+    size_t count = 0;
+    for (size_t base = begin; base < n; base += 64)
+    {
+        size_t end = n - base < 64 ? n : base + 64;
+        uint64_t word = 0;
+        for (size_t i = base; i < end; i++)
+        {
+            word |= (uint64_t)(column[i] >= low && column[i] <= high) << (i - base);
+        }
+        bits[base / 64] = word;
+        count += (size_t)__builtin_popcountll(word);
+    }
+    return count;
+}
+
+#ifdef COLUMNS_X86
+
+/*
+These are the AVX2 kernels. They are compiled for AVX2 regardless of the build flags and only called after
+a CPU check, so one binary runs everywhere and uses the wide kernels where it can. A compare produces all-ones
+lanes for matches, and movemask packs one bit per lane into the result word.
+*/
+__attribute__((target("avx2"))) static size_t scanEqualU8Avx2(const uint8_t *column, size_t n, uint8_t value, uint64_t *bits)
+{
+    __m256i needle = _mm256_set1_epi8((char)value);
+    size_t whole = n & ~(size_t)63;
+    size_t count = 0;
+    for (size_t base = 0; base < whole; base += 64)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)&column[base]);
+        __m256i b = _mm256_loadu_si256((const __m256i *)&column[base + 32]);
+        uint64_t low = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, needle));
+        uint64_t high = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, needle));
+        uint64_t word = low | (high << 32);
+        bits[base / 64] = word;
+        count += (size_t)__builtin_popcountll(word);
+    }
+    return count + scanEqualU8Scalar(column, whole, n, value, bits);
+}
+
+__attribute__((target("avx2"))) static size_t scanRangeI32Avx2(const int32_t *column, size_t n, int32_t low, int32_t high, uint64_t *bits)
+{
+    __m256i below = _mm256_set1_epi32(low);
+    __m256i above = _mm256_set1_epi32(high);
+    size_t whole = n & ~(size_t)63;
+    size_t count = 0;
+    for (size_t base = 0; base < whole; base += 64)
+    {
+        uint64_t word = 0;
+        for (size_t lane = 0; lane < 64; lane += 8)
+        {
+            __m256i x = _mm256_loadu_si256((const __m256i *)&column[base + lane]);
+            __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(below, x), _mm256_cmpgt_epi32(x, above));
+            uint64_t mask = (uint64_t)(~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xff);
+            word |= mask << lane;
+        }
+        bits[base / 64] = word;
+        count += (size_t)__builtin_popcountll(word);
+    }
+    return count + scanRangeI32Scalar(column, whole, n, low, high, bits);
+}
+
+#endif
+
+#ifdef __SSE2__
+
+/*
+These are the SSE2 kernels, the baseline on x86-64, used when the CPU lacks AVX2.
+*/
+static size_t scanEqualU8Sse2(const uint8_t *column, size_t n, uint8_t value, uint64_t *bits)
+{
+    __m128i needle = _mm_set1_epi8((char)value);
+    size_t whole = n & ~(size_t)63;
+    size_t count = 0;
+    for (size_t base = 0; base < whole; base += 64)
+    {
+        uint64_t word = 0;
+        for (size_t lane = 0; lane < 64; lane += 16)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i *)&column[base + lane]);
+            word |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, needle)) << lane;
+        }
+        bits[base / 64] = word;
+        count += (size_t)__builtin_popcountll(word);
+    }
+    return count + scanEqualU8Scalar(column, whole, n, value, bits);
+}
+
+static size_t scanRangeI32Sse2(const int32_t *column, size_t n, int32_t low, int32_t high, uint64_t *bits)
+{
+    __m128i below = _mm_set1_epi32(low);
+    __m128i above = _mm_set1_epi32(high);
+    size_t whole = n & ~(size_t)63;
+    size_t count = 0;
+    for (size_t base = 0; base < whole; base += 64)
+    {
+        uint64_t word = 0;
+        for (size_t lane = 0; lane < 64; lane += 4)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i *)&column[base + lane]);
+            __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(below, x), _mm_cmpgt_epi32(x, above));
+            word |= (uint64_t)(~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xf) << lane;
+        }
+        bits[base / 64] = word;
+        count += (size_t)__builtin_popcountll(word);
+    }
+    return count + scanRangeI32Scalar(column, whole, n, low, high, bits);
+}
+
+#endif
+
+/*
+This function reports whether the AVX2 kernels may be used. The CPU is queried once; concurrent first calls
+all compute the same answer, so the unsynchronised cache is harmless.
+*/
+static bool columnsUseAvx2(void)
+{
+#ifdef COLUMNS_X86
+    static int supported = -1;
+    int cached = __atomic_load_n(&supported, __ATOMIC_RELAXED);
+    if (cached < 0)
+    {
+        cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&supported, cached, __ATOMIC_RELAXED);
+    }
+    return cached == 1;
+#else
+    return false;
+#endif
+}
+
+/*
+This function sets bit i of bits, which must hold columnWords(n) words, for every entry i of the first n
+entries of column equal to value, clearing all other bits. It returns the number of matches. It picks the
+widest kernel the CPU supports.
+*/
+size_t columnScanEqualU8(const uint8_t *column, size_t n, uint8_t value, uint64_t *bits)
+{
+#ifdef COLUMNS_X86
+    if (columnsUseAvx2())
+    {
+        return scanEqualU8Avx2(column, n, value, bits);
+    }
+#endif
+#ifdef __SSE2__
+    return scanEqualU8Sse2(column, n, value, bits);
+#else
+    return scanEqualU8Scalar(column, 0, n, value, bits);
+#endif
+}
+
+/*
+This function sets the bits of the entries of column in the inclusive range [low, high] in the same way as
+columnScanEqualU8 and returns the number of matches.
+*/
+size_t columnScanRangeI32(const int32_t *column, size_t n, int32_t low, int32_t high, uint64_t *bits)
+{
+#ifdef COLUMNS_X86
+    if (columnsUseAvx2())
+    {
+        return scanRangeI32Avx2(column, n, low, high, bits);
+    }
+#endif
+#ifdef __SSE2__
+    return scanRangeI32Sse2(column, n, low, high, bits);
+#else
+    return scanRangeI32Scalar(column, 0, n, low, high, bits);
+#endif
+}
+
+/*
+This function intersects two scan results in place, leaving the bits set in both in bits, and returns the
+number of bits still set.
+*/
+size_t columnBitsAnd(uint64_t *bits, const uint64_t *other, size_t words)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < words; i++)
+    {
+        bits[i] &= other[i];
+        count += (size_t)__builtin_popcountll(bits[i]);
+    }
+    return count;
+}
@@ -0,0 +1,51 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bitmap.h"
+
+// Column values
+#define COLUMN_NONE 0xff
+
+// Structs
+
+/*
+A struct-of-arrays copy of the fields that predicates test, one entry per store slot. types holds the
+MaterialType (COLUMN_NONE for a dead slot), subtypes the BookType, JournalType or NewspaperType (COLUMN_NONE
+if invalid) and numbers the page count of a book or the issue of a journal (0 for newspapers). Scanning a
+one-byte type column touches 1/112th of the memory a scan of the records does.
+*/
+struct ColumnStore
+{
+    uint8_t *types;
+    uint8_t *subtypes;
+    int32_t *numbers;
+    size_t size;
+    size_t capacity;
+};
+
+// Functions
+
+void columnsInit(struct ColumnStore *columns);
+
+void columnsFree(struct ColumnStore *columns);
+
+int columnsSet(struct ColumnStore *columns, size_t slot, const struct Material *material);
+
+void columnsClear(struct ColumnStore *columns, size_t slot);
+
+void columnsMove(struct ColumnStore *columns, size_t from, size_t to);
+
+static inline size_t columnWords(size_t n)
+{
+    return (n + 63) / 64;
+}
+
+size_t columnScanEqualU8(const uint8_t *column, size_t n, uint8_t value, uint64_t *bits);
+
+size_t columnScanRangeI32(const int32_t *column, size_t n, int32_t low, int32_t high, uint64_t *bits);
+
+size_t columnBitsAnd(uint64_t *bits, const uint64_t *other, size_t words);
+
+#endif
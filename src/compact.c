@@ -0,0 +1,294 @@
+#include "compact.h"
+#include "store.h"
+
+/*
+This function returns the index of the live record with the given title, or -1 if there is none. A title that
+was never interned cannot belong to any material, so a miss costs one pool probe.
+*/
+static long compactLookup(const struct CompactArchive *archive, const char *title)
+{
+    uint32_t id = stringPoolFind(&archive->titles, title);
+    if (id == STRING_POOL_NONE || id >= archive->slotCapacity || archive->slots[id] == 0)
+    {
+        return -1;
+    }
+    return (long)archive->slots[id] - 1;
+}
+
+/*
+This function packs the details of a material of the given type into record, interning the contributor. It
+returns 0 on success, -1 if the type or subtype is out of range and -2 if the name could not be interned.
+*/
+static int compactPack(struct CompactArchive *archive, enum MaterialType type, const union MaterialDetails *details, struct CompactRecord *record)
+{
+    struct Material material;
+    material.type = type;
+    material.details = *details;
+    int subtype = materialSubtype(&material);
+    if (subtype < 0)
+    {
+        return -1;
+    }
+    uint32_t contributor = stringPoolIntern(&archive->names, materialContributor(&material));
+    if (contributor == STRING_POOL_NONE)
+    {
+        return -2;
+    }
+    record->contributor = contributor;
+    record->number = type == BOOK ? details->book.pages : type == JOURNAL ? details->journal.issue : 0;
+    record->type = (uint8_t)type;
+    record->subtype = (uint8_t)subtype;
+    record->reserved = 0;
+    return 0;
+}
+
+/*
+This function initializes an empty archive.
+*/
+void compactInit(struct CompactArchive *archive)
+{
+    memset(archive, 0, sizeof(*archive));
+    stringPoolInit(&archive->titles);
+    stringPoolInit(&archive->names);
+}
+
+/*
+This function releases the records and both string pools.
+*/
+void compactFree(struct CompactArchive *archive)
+{
+    if (archive == NULL)
+    {
+        return;
+    }
+    stringPoolFree(&archive->titles);
+    stringPoolFree(&archive->names);
+    free(archive->records);
+    free(archive->slots);
+    compactInit(archive);
+}
+
+/*
+This function adds a material. The error codes follow storeAddMaterial: -1 for a NULL argument or a title that
+is already present, -2 if memory could not be allocated. It also returns -1 for a type or subtype out of range,
+which a CompactRecord cannot hold. It returns 0 on success.
+*/
+int compactAddMaterial(struct CompactArchive *archive, const struct Material *material)
+{
+    if (archive == NULL || material == NULL || compactLookup(archive, material->title) >= 0)
+    {
+        return -1;
+    }
+
+    struct CompactRecord record;
+    int status = compactPack(archive, material->type, &material->details, &record);
+    if (status != 0)
+    {
+        return status;
+    }
+    if (archive->count == archive->capacity)
+    {
+        size_t capacity = archive->capacity == 0 ? 64 : archive->capacity * 2;
+        struct CompactRecord *records = (struct CompactRecord *)realloc(archive->records, capacity * sizeof(struct CompactRecord));
+        if (records == NULL)
+        {
+            return -2;
+        }
+        archive->records = records;
+        archive->capacity = capacity;
+    }
+    record.title = stringPoolIntern(&archive->titles, material->title);
+    if (record.title == STRING_POOL_NONE)
+    {
+        return -2;
+    }
+    if (record.title >= archive->slotCapacity)
+    {
+        size_t capacity = archive->slotCapacity == 0 ? 64 : archive->slotCapacity * 2;
+        uint32_t *slots = (uint32_t *)realloc(archive->slots, capacity * sizeof(uint32_t));
+        if (slots == NULL)
+        {
+            return -2;
+        }
+        memset(slots + archive->slotCapacity, 0, (capacity - archive->slotCapacity) * sizeof(uint32_t));
+        archive->slots = slots;
+        archive->slotCapacity = capacity;
+    }
+
+    archive->records[archive->count] = record;
+    archive->slots[record.title] = (uint32_t)++archive->count;
+    return 0;
+}
+
+/*
+This function writes the material at index of the records as a struct Material into material.
+*/
+void compactExpand(const struct CompactArchive *archive, size_t index, struct Material *material)
+{
+    const struct CompactRecord *record = &archive->records[index];
+    memset(material, 0, sizeof(*material));
+    strncpy(material->title, stringPoolGet(&archive->titles, record->title), sizeof(material->title) - 1);
+    material->type = (enum MaterialType)record->type;
+    const char *contributor = stringPoolGet(&archive->names, record->contributor);
+    switch (material->type)
+    {
+    case BOOK:
+        material->details.book.pages = record->number;
+        strncpy(material->details.book.author, contributor, sizeof(material->details.book.author) - 1);
+        material->details.book.type = (enum BookType)record->subtype;
+        break;
+    case JOURNAL:
+        material->details.journal.issue = record->number;
+        strncpy(material->details.journal.publisher, contributor, sizeof(material->details.journal.publisher) - 1);
+        material->details.journal.type = (enum JournalType)record->subtype;
+        break;
+    default:
+        strncpy(material->details.newspaper.editor, contributor, sizeof(material->details.newspaper.editor) - 1);
+        material->details.newspaper.type = (enum NewspaperType)record->subtype;
+        break;
+    }
+}
+
+/*
+This function writes the material with the given title into material. It returns 0 if the title was found and
+-1 otherwise.
+*/
+int compactFindMaterial(const struct CompactArchive *archive, const char *title, struct Material *material)
+{
+    if (archive == NULL || title == NULL)
+    {
+        return -1;
+    }
+    long index = compactLookup(archive, title);
+    if (index < 0)
+    {
+        return -1;
+    }
+    compactExpand(archive, (size_t)index, material);
+    return 0;
+}
+
+/*
+This function replaces the details of the material with the given title. The error codes match
+storeUpdateMaterial: -1 for a NULL argument, -2 if the title is not found, -3, -4 and -5 for an invalid book,
+journal or newspaper subtype and -7 if the new contributor could not be interned. It returns 0 on success.
+*/
+int compactUpdateMaterial(struct CompactArchive *archive, const char *title, union MaterialDetails details)
+{
+    if (archive == NULL || title == NULL)
+    {
+        return -1;
+    }
+    long index = compactLookup(archive, title);
+    if (index < 0)
+    {
+        return -2;
+    }
+
+    struct CompactRecord *record = &archive->records[index];
+    struct CompactRecord updated = *record;
+    int status = compactPack(archive, (enum MaterialType)record->type, &details, &updated);
+    if (status == -1)
+    {
+        return -3 - record->type;
+    }
+    if (status != 0)
+    {
+        return -7;
+    }
+    *record = updated;
+    return 0;
+}
+
+/*
+This function removes the material with the given title, moving the last record into its place. Its title and
+contributor stay interned for when they are used again. It returns 0 on success and -1 if the title is not
+found.
+*/
+int compactRemoveMaterial(struct CompactArchive *archive, const char *title)
+{
+    if (archive == NULL || title == NULL)
+    {
+        return -1;
+    }
+    long index = compactLookup(archive, title);
+    if (index < 0)
+    {
+        return -1;
+    }
+
+    archive->slots[archive->records[index].title] = 0;
+    archive->count--;
+    if ((size_t)index != archive->count)
+    {
+        archive->records[index] = archive->records[archive->count];
+        archive->slots[archive->records[index].title] = (uint32_t)index + 1;
+    }
+    return 0;
+}
+
+/*
+This function writes up to capacity materials of the given type into results, in record order. results may
+be NULL with a capacity of 0 to only count. It returns the total number of matches.
+*/
+size_t compactFilterMaterials(const struct CompactArchive *archive, enum MaterialType type, struct Material *results, size_t capacity)
+{
+    if (archive == NULL)
+    {
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < archive->count; i++)
+    {
+        if (archive->records[i].type == (uint8_t)type)
+        {
+            if (total < capacity)
+            {
+                compactExpand(archive, i, &results[total]);
+            }
+            total++;
+        }
+    }
+    return total;
+}
+
+/*
+This function writes up to capacity materials whose contributor is author into results, in record order. The
+name is looked up once and every record is then matched by comparing contributor ids, without touching any
+string; an author that was never interned matches nothing without a scan. It returns the total number of
+matches.
+*/
+size_t compactFilterMaterialsByAuthor(const struct CompactArchive *archive, const char *author, struct Material *results, size_t capacity)
+{
+    if (archive == NULL || author == NULL)
+    {
+        return 0;
+    }
+    uint32_t id = stringPoolFind(&archive->names, author);
+    if (id == STRING_POOL_NONE)
+    {
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < archive->count; i++)
+    {
+        if (archive->records[i].contributor == id)
+        {
+            if (total < capacity)
+            {
+                compactExpand(archive, i, &results[total]);
+            }
+            total++;
+        }
+    }
+    return total;
+}
+
+/*
+This function returns the bytes allocated by the archive, records, title map and both pools included.
+*/
+size_t compactMemory(const struct CompactArchive *archive)
+{
+    return archive->capacity * sizeof(struct CompactRecord) + archive->slotCapacity * sizeof(uint32_t) +
+           stringPoolMemory(&archive->titles) + stringPoolMemory(&archive->names);
+}
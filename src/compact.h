@@ -0,0 +1,64 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include "bitmap.h"
+#include "stringpool.h"
+
+// Structs
+
+/*
+A material in 16 bytes. title and contributor are ids in the archive's title and name pools, number is the
+page count of a book or the issue of a journal (0 for a newspaper) and subtype its BookType, JournalType or
+NewspaperType.
+*/
+struct CompactRecord
+{
+    uint32_t title;
+    uint32_t contributor;
+    int32_t number;
+    uint8_t type;
+    uint8_t subtype;
+    uint16_t reserved;
+};
+
+/*
+An archive that keeps its materials as CompactRecords instead of 112-byte struct Materials. Titles and
+contributor names are interned, so a name shared by thousands of issues is stored once and comparing two
+contributors is comparing two ids. slots maps a title id to the position of its record plus one, or 0 when no
+live material has that title; it doubles as the title index. Records are kept dense: removing one moves the
+last record into its place, so the order of materials changes on removal.
+*/
+struct CompactArchive
+{
+    struct StringPool titles;
+    struct StringPool names;
+    struct CompactRecord *records;
+    size_t count;
+    size_t capacity;
+    uint32_t *slots;
+    size_t slotCapacity;
+};
+
+// Functions
+
+void compactInit(struct CompactArchive *archive);
+
+void compactFree(struct CompactArchive *archive);
+
+int compactAddMaterial(struct CompactArchive *archive, const struct Material *material);
+
+int compactFindMaterial(const struct CompactArchive *archive, const char *title, struct Material *material);
+
+int compactUpdateMaterial(struct CompactArchive *archive, const char *title, union MaterialDetails details);
+
+int compactRemoveMaterial(struct CompactArchive *archive, const char *title);
+
+void compactExpand(const struct CompactArchive *archive, size_t index, struct Material *material);
+
+size_t compactFilterMaterials(const struct CompactArchive *archive, enum MaterialType type, struct Material *results, size_t capacity);
+
+size_t compactFilterMaterialsByAuthor(const struct CompactArchive *archive, const char *author, struct Material *results, size_t capacity);
+
+size_t compactMemory(const struct CompactArchive *archive);
+
+#endif
@@ -0,0 +1,326 @@
+#include <sched.h>
+#include "concurrent.h"
+
+/*
+A change applied by a writer to each of the two stores in turn. It returns 0 if it changed the store and
+otherwise the error code to report, in which case the other store is left alone.
+*/
+typedef int (*ConcurrentWriteFn)(struct ArchiveStore *store, void *argument);
+
+/*
+This function returns the reader stripe of the calling thread. Threads are given stripes round-robin on their
+first read, so up to CONCURRENT_READ_STRIPES readers never touch the same counter.
+*/
+static unsigned concurrentStripe(void)
+{
+    static unsigned next = 0;
+    static __thread unsigned stripe = CONCURRENT_READ_STRIPES;
+    if (stripe == CONCURRENT_READ_STRIPES)
+    {
+        stripe = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED) % CONCURRENT_READ_STRIPES;
+    }
+    return stripe;
+}
+
+/*
+This function waits until no reader is announced on any stripe of the given version.
+*/
+static void concurrentWaitForReaders(struct ConcurrentArchive *archive, unsigned version)
+{
+    for (size_t stripe = 0; stripe < CONCURRENT_READ_STRIPES; stripe++)
+    {
+        while (__atomic_load_n(&archive->indicators[version][stripe].readers, __ATOMIC_ACQUIRE) != 0)
+        {
+            sched_yield();
+        }
+    }
+}
+
+/*
+This function applies a change to both stores with the left-right protocol. The change is made to the store
+readers are not using and published by switching leftRight. The version index is then toggled in two steps,
+each waiting for the readers announced on one version, which guarantees that no reader can still be on the old
+store when the change is repeated there. If the second application does not give the same result as the first
+the copies have diverged, which only running out of memory can cause, and every later write returns failure.
+*/
+static int concurrentWrite(struct ConcurrentArchive *archive, ConcurrentWriteFn write, void *argument, int failure)
+{
+    pthread_mutex_lock(&archive->writeLock);
+    if (archive->diverged)
+    {
+        pthread_mutex_unlock(&archive->writeLock);
+        return failure;
+    }
+
+    unsigned left = __atomic_load_n(&archive->leftRight, __ATOMIC_RELAXED);
+    int status = write(&archive->stores[!left], argument);
+    if (status != 0)
+    {
+        pthread_mutex_unlock(&archive->writeLock);
+        return status;
+    }
+    __atomic_store_n(&archive->leftRight, !left, __ATOMIC_SEQ_CST);
+
+    unsigned previous = __atomic_load_n(&archive->versionIndex, __ATOMIC_RELAXED);
+    concurrentWaitForReaders(archive, !previous);
+    __atomic_store_n(&archive->versionIndex, !previous, __ATOMIC_SEQ_CST);
+    concurrentWaitForReaders(archive, previous);
+
+    if (write(&archive->stores[left], argument) != 0)
+    {
+        archive->diverged = true;
+    }
+    pthread_mutex_unlock(&archive->writeLock);
+    return 0;
+}
+
+/*
+This function initializes both stores with config, or the defaults if it is NULL. It returns 0 on success and
+-1 if archive is NULL.
+*/
+int concurrentInit(struct ConcurrentArchive *archive, const struct StoreConfig *config)
+{
+    if (archive == NULL)
+    {
+        return -1;
+    }
+    memset(archive, 0, sizeof(*archive));
+    storeInit(&archive->stores[0], config);
+    storeInit(&archive->stores[1], config);
+    pthread_mutex_init(&archive->writeLock, NULL);
+    return 0;
+}
+
+/*
+This function releases both stores. No thread may be reading or writing.
+*/
+void concurrentFree(struct ConcurrentArchive *archive)
+{
+    if (archive == NULL)
+    {
+        return;
+    }
+    storeFree(&archive->stores[0]);
+    storeFree(&archive->stores[1]);
+    pthread_mutex_destroy(&archive->writeLock);
+}
+
+/*
+This function starts a read and returns the store to read from. It never blocks: it announces the reader on its
+stripe of the current version and picks the store a writer is not modifying. Any store function that does not
+mutate may be called on the result, and the pointers it returns stay valid until concurrentReadEnd is called
+with token, after which a writer may change the store. Reads should be short, since a writer waits for them.
+*/
+const struct ArchiveStore *concurrentReadBegin(struct ConcurrentArchive *archive, struct ConcurrentReadToken *token)
+{
+    token->stripe = concurrentStripe();
+    token->version = __atomic_load_n(&archive->versionIndex, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&archive->indicators[token->version][token->stripe].readers, 1, __ATOMIC_SEQ_CST);
+    return &archive->stores[__atomic_load_n(&archive->leftRight, __ATOMIC_SEQ_CST)];
+}
+
+/*
+This function ends a read started by concurrentReadBegin.
+*/
+void concurrentReadEnd(struct ConcurrentArchive *archive, struct ConcurrentReadToken token)
+{
+    __atomic_fetch_sub(&archive->indicators[token.version][token.stripe].readers, 1, __ATOMIC_RELEASE);
+}
+
+/*
+This function copies the material with the given title into material without blocking on writers. It returns 0
+if the title was found and -1 otherwise.
+*/
+int concurrentFindMaterial(struct ConcurrentArchive *archive, const char *title, struct Material *material)
+{
+    struct ConcurrentReadToken token;
+    const struct ArchiveStore *store = concurrentReadBegin(archive, &token);
+    const struct Material *found = storeFindMaterial(store, title);
+    if (found != NULL)
+    {
+        *material = *found;
+    }
+    concurrentReadEnd(archive, token);
+    return found == NULL ? -1 : 0;
+}
+
+/*
+This function copies up to capacity materials of the given type into results, in slot order, without blocking
+on writers. It returns the total number of matches, which can exceed capacity, or 0 for an invalid type.
+*/
+size_t concurrentFilterMaterials(struct ConcurrentArchive *archive, enum MaterialType type, struct Material *results, size_t capacity)
+{
+    struct ConcurrentReadToken token;
+    const struct ArchiveStore *store = concurrentReadBegin(archive, &token);
+    const struct SlotBitmap *slots = storeFilterMaterials(store, type);
+    size_t total = 0;
+    if (slots != NULL)
+    {
+        struct SlotBitmapIterator iterator;
+        uint32_t slot;
+        size_t n = 0;
+        slotBitmapIterate(slots, &iterator);
+        while (n < capacity && slotBitmapNext(&iterator, &slot))
+        {
+            results[n++] = *storeAt(store, slot);
+        }
+        total = slotBitmapCardinality(slots);
+    }
+    concurrentReadEnd(archive, token);
+    return total;
+}
+
+/*
+This function copies up to capacity materials whose contributor is author into results, in slot order, without
+blocking on writers. It returns the total number of matches.
+*/
+size_t concurrentFilterMaterialsByAuthor(struct ConcurrentArchive *archive, const char *author, struct Material *results, size_t capacity)
+{
+    struct ConcurrentReadToken token;
+    const struct ArchiveStore *store = concurrentReadBegin(archive, &token);
+    size_t total = 0;
+    const uint32_t *slots = storeContributorSlots(store, author, &total);
+    for (size_t i = 0; i < total && i < capacity; i++)
+    {
+        results[i] = *storeAt(store, slots[i]);
+    }
+    concurrentReadEnd(archive, token);
+    return total;
+}
+
+/*
+This function copies the aggregate counts into stats without blocking on writers. The counts always describe
+one store between two writes, never a write half applied.
+*/
+void concurrentStats(struct ConcurrentArchive *archive, struct StoreStats *stats)
+{
+    struct ConcurrentReadToken token;
+    storeStats(concurrentReadBegin(archive, &token), stats);
+    concurrentReadEnd(archive, token);
+}
+
+/*
+This function returns the number of materials of contributor without blocking on writers.
+*/
+size_t concurrentContributorCount(struct ConcurrentArchive *archive, const char *contributor)
+{
+    struct ConcurrentReadToken token;
+    size_t count = storeContributorCount(concurrentReadBegin(archive, &token), contributor);
+    concurrentReadEnd(archive, token);
+    return count;
+}
+
+/*
+The arguments of a batch add, which has to report codes and a count on top of its status.
+*/
+struct ConcurrentBatch
+{
+    const struct Material *items;
+    size_t n;
+    int *codes;
+    size_t added;
+};
+
+/*
+The arguments of an update.
+*/
+struct ConcurrentUpdate
+{
+    const char *title;
+    union MaterialDetails details;
+};
+
+/*
+These functions are the ConcurrentWriteFn of each write. Each is applied to one store and then, if it
+succeeded, to the other.
+*/
+static int concurrentAddOne(struct ArchiveStore *store, void *argument)
+{
+    return storeAddMaterial(store, (const struct Material *)argument);
+}
+
+static int concurrentAddBatch(struct ArchiveStore *store, void *argument)
+{
+    struct ConcurrentBatch *batch = (struct ConcurrentBatch *)argument;
+    size_t added = storeAddMaterials(store, batch->items, batch->n, STORE_BULK_DEFAULT, batch->codes);
+    if (added == 0)
+    {
+        return 1;
+    }
+    // the second store must accept exactly what the first did
+    if (batch->added != 0 && added != batch->added)
+    {
+        return -1;
+    }
+    batch->added = added;
+    return 0;
+}
+
+static int concurrentUpdateOne(struct ArchiveStore *store, void *argument)
+{
+    const struct ConcurrentUpdate *update = (const struct ConcurrentUpdate *)argument;
+    return storeUpdateMaterial(store, update->title, update->details);
+}
+
+static int concurrentRemoveOne(struct ArchiveStore *store, void *argument)
+{
+    const char *title = (const char *)argument;
+    if (storeFindMaterial(store, title) == NULL)
+    {
+        return -1;
+    }
+    storeRemoveMaterial(store, title);
+    return 0;
+}
+
+/*
+This function adds a material. Readers keep running while it does; they see the material once the call
+returns. It returns the result of storeAddMaterial, or -2 if the two copies have diverged.
+*/
+int concurrentAddMaterial(struct ConcurrentArchive *archive, const struct Material *material)
+{
+    if (material == NULL)
+    {
+        return -1;
+    }
+    return concurrentWrite(archive, concurrentAddOne, (void *)material, -2);
+}
+
+/*
+This function adds a batch of materials with storeAddMaterials and publishes them to readers at once, so an
+ingest of many materials makes readers switch stores twice instead of twice per material. codes receives the
+per-item results of storeAddMaterials if it is not NULL. It returns the number of materials added.
+*/
+size_t concurrentAddMaterials(struct ConcurrentArchive *archive, const struct Material *items, size_t n, int *codes)
+{
+    struct ConcurrentBatch batch = {items, n, codes, 0};
+    concurrentWrite(archive, concurrentAddBatch, &batch, 1);
+    return batch.added;
+}
+
+/*
+This function updates the details of a material while readers keep running. It returns the result of
+storeUpdateMaterial, or -7 if the two copies have diverged.
+*/
+int concurrentUpdateMaterial(struct ConcurrentArchive *archive, const char *title, union MaterialDetails details)
+{
+    struct ConcurrentUpdate update = {title, details};
+    if (title == NULL)
+    {
+        return -1;
+    }
+    return concurrentWrite(archive, concurrentUpdateOne, &update, -7);
+}
+
+/*
+This function removes a material while readers keep running. It returns 0 on success, -1 if no material has
+that title and -2 if the two copies have diverged.
+*/
+int concurrentRemoveMaterial(struct ConcurrentArchive *archive, const char *title)
+{
+    if (title == NULL)
+    {
+        return -1;
+    }
+    return concurrentWrite(archive, concurrentRemoveOne, (void *)title, -2);
+}
@@ -0,0 +1,77 @@
+#ifndef CONCURRENT_H
+#define CONCURRENT_H
+
+#include <pthread.h>
+#include "store.h"
+
+// Tuning
+#define CONCURRENT_READ_STRIPES 64
+#define CONCURRENT_CACHE_LINE 64
+
+// Structs
+
+/*
+One reader counter, padded to a cache line so that readers on different stripes never share a line.
+*/
+struct ConcurrentStripe
+{
+    uint64_t readers;
+    char padding[CONCURRENT_CACHE_LINE - sizeof(uint64_t)];
+};
+
+/*
+An archive that many threads can read while one thread at a time writes, using the left-right technique. Two
+identical stores are kept. Readers announce themselves on a striped counter of the current version, read the
+store that leftRight names and leave; they never wait, retry or take a lock. A writer applies its change to the
+store no reader is using, switches leftRight, waits until the readers still on the old store have left and
+then applies the same change to it. Writers are serialised by writeLock. The price is twice the memory of one
+store and doing every write twice.
+*/
+struct ConcurrentArchive
+{
+    struct ArchiveStore stores[2];
+    struct ConcurrentStripe indicators[2][CONCURRENT_READ_STRIPES];
+    unsigned leftRight;
+    unsigned versionIndex;
+    pthread_mutex_t writeLock;
+    bool diverged;
+};
+
+/*
+Returned by concurrentReadBegin and passed back to concurrentReadEnd.
+*/
+struct ConcurrentReadToken
+{
+    unsigned version;
+    unsigned stripe;
+};
+
+// Functions
+
+int concurrentInit(struct ConcurrentArchive *archive, const struct StoreConfig *config);
+
+void concurrentFree(struct ConcurrentArchive *archive);
+
+const struct ArchiveStore *concurrentReadBegin(struct ConcurrentArchive *archive, struct ConcurrentReadToken *token);
+
+void concurrentReadEnd(struct ConcurrentArchive *archive, struct ConcurrentReadToken token);
+
+int concurrentFindMaterial(struct ConcurrentArchive *archive, const char *title, struct Material *material);
+
+size_t concurrentFilterMaterials(struct ConcurrentArchive *archive, enum MaterialType type, struct Material *results, size_t capacity);
+
+size_t concurrentFilterMaterialsByAuthor(struct ConcurrentArchive *archive, const char *author, struct Material *results, size_t capacity);
+
+void concurrentStats(struct ConcurrentArchive *archive, struct StoreStats *stats);
+
+size_t concurrentContributorCount(struct ConcurrentArchive *archive, const char *contributor);
+
+int concurrentAddMaterial(struct ConcurrentArchive *archive, const struct Material *material);
+
+size_t concurrentAddMaterials(struct ConcurrentArchive *archive, const struct Material *items, size_t n, int *codes);
+
+int concurrentUpdateMaterial(struct ConcurrentArchive *archive, const char *title, union MaterialDetails details);
+
+int concurrentRemoveMaterial(struct ConcurrentArchive *archive, const char *title);
+
+#endif
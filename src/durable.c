@@ -0,0 +1,347 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include "durable.h"
+#include "snapshot.h"
+
+/*
+This function returns a newly allocated path for the file name inside directory, or NULL if memory runs out.
+*/
+static char *durablePath(const char *directory, const char *name)
+{
+    size_t length = strlen(directory) + strlen(name) + 2;
+    char *path = (char *)malloc(length);
+    if (path != NULL)
+    {
+        snprintf(path, length, "%s/%s", directory, name);
+    }
+    return path;
+}
+
+/*
+This function fsyncs directory, so that the entries created or renamed in it survive a power loss. It returns 0
+on success and -1 on failure.
+*/
+static int durableSyncDirectory(const char *directory)
+{
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    int status = fsync(fd) == 0 ? 0 : -1;
+    close(fd);
+    return status;
+}
+
+/*
+This function applies one replayed log record to the store. Records are only logged after the mutation
+succeeded, so replaying them in order rebuilds the same state; payloads are copied out because the replay
+buffer is not aligned for a struct Material.
+*/
+static int durableApply(void *context, enum WalOp op, const void *payload, size_t length)
+{
+    struct ArchiveStore *store = (struct ArchiveStore *)context;
+    switch (op)
+    {
+    case WAL_ADD:
+    {
+        struct Material material;
+        if (length != sizeof(material))
+        {
+            return -1;
+        }
+        memcpy(&material, payload, sizeof(material));
+        return storeAddMaterial(store, &material);
+    }
+    case WAL_UPDATE:
+    {
+        struct WalUpdate update;
+        if (length != sizeof(update))
+        {
+            return -1;
+        }
+        memcpy(&update, payload, sizeof(update));
+        update.title[sizeof(update.title) - 1] = '\0';
+        return storeUpdateMaterial(store, update.title, update.details);
+    }
+    case WAL_REMOVE:
+    {
+        char title[50];
+        if (length != sizeof(title))
+        {
+            return -1;
+        }
+        memcpy(title, payload, sizeof(title));
+        title[sizeof(title) - 1] = '\0';
+        storeRemoveMaterial(store, title);
+        return 0;
+    }
+    default:
+        return -1;
+    }
+}
+
+/*
+This function writes the store to the snapshot and then empties the log. The archive lock must be held. The
+order matters: the rename that installs the new snapshot is only durable once the directory is synced, and if
+the log were truncated before that, a power loss could bring back the old snapshot with an empty log and lose
+every mutation since the previous checkpoint. So the directory is synced between the two steps, and a failure
+there leaves the log intact. It returns 0 on success, -1 if the snapshot could not be written or its rename
+synced and -2 if the log could not be emptied.
+*/
+static int durableWriteCheckpoint(struct DurableArchive *archive)
+{
+    if (snapshotWriteSequence(&archive->store, archive->snapshotPath, archive->wal.lastSequence) != 0 ||
+        durableSyncDirectory(archive->directory) != 0)
+    {
+        return -1;
+    }
+    return walReset(&archive->wal) == 0 ? 0 : -2;
+}
+
+/*
+This function writes a checkpoint if automatic checkpoints are enabled and the log has outgrown them. The
+archive lock must be held. A failed checkpoint leaves the log intact and is retried after the next mutation.
+*/
+static void durableMaybeCheckpoint(struct DurableArchive *archive)
+{
+    if (archive->checkpointBytes != 0 && archive->wal.size >= archive->checkpointBytes)
+    {
+        durableWriteCheckpoint(archive);
+    }
+}
+
+/*
+This function opens the archive kept in directory, which must exist. It loads the checkpoint snapshot if there
+is one, verifying it in full, and replays the log records written after it; a record torn by a crash ends the
+replay and is discarded. config configures the in-memory store as for storeInit. It returns 0 on success, -1
+if an argument is NULL or memory runs out, -2 if the log cannot be opened or read, -3 if the snapshot is
+damaged and -4 if a logged mutation could not be applied again, for instance because memory ran out. The log is
+left as it was after -4, so opening can be retried without losing the record.
+*/
+int durableOpen(struct DurableArchive *archive, const char *directory, const struct StoreConfig *config, size_t checkpointBytes)
+{
+    if (archive == NULL || directory == NULL)
+    {
+        return -1;
+    }
+    memset(archive, 0, sizeof(*archive));
+    archive->checkpointBytes = checkpointBytes;
+    archive->directory = strdup(directory);
+    archive->snapshotPath = durablePath(directory, "archive.snapshot");
+    char *walPath = durablePath(directory, "archive.wal");
+    if (archive->directory == NULL || archive->snapshotPath == NULL || walPath == NULL)
+    {
+        free(archive->directory);
+        free(archive->snapshotPath);
+        free(walPath);
+        archive->directory = NULL;
+        archive->snapshotPath = NULL;
+        return -1;
+    }
+    storeInit(&archive->store, config);
+
+    int status = 0;
+    uint64_t sequence = 0;
+    if (access(archive->snapshotPath, F_OK) == 0)
+    {
+        struct Snapshot snapshot;
+        if (snapshotOpen(&snapshot, archive->snapshotPath, SNAPSHOT_VERIFY) != 0)
+        {
+            status = -3;
+        }
+        else
+        {
+            sequence = snapshot.header->sequence;
+            if (snapshotLoadStore(&snapshot, &archive->store) != snapshot.count)
+            {
+                status = -3;
+            }
+            snapshotClose(&snapshot);
+        }
+    }
+    if (status == 0 && walOpen(&archive->wal, walPath) != 0)
+    {
+        status = -2;
+    }
+    // the log may have just been created, and its entry must be durable before any commit relies on it
+    else if (status == 0 && durableSyncDirectory(directory) != 0)
+    {
+        walClose(&archive->wal);
+        status = -2;
+    }
+    else if (status == 0)
+    {
+        int replayed = walReplay(&archive->wal, sequence, durableApply, &archive->store);
+        if (replayed < 0)
+        {
+            walClose(&archive->wal);
+            status = replayed == -2 ? -4 : -2;
+        }
+    }
+    free(walPath);
+
+    if (status != 0)
+    {
+        storeFree(&archive->store);
+        free(archive->directory);
+        free(archive->snapshotPath);
+        archive->directory = NULL;
+        archive->snapshotPath = NULL;
+        return status;
+    }
+    pthread_mutex_init(&archive->lock, NULL);
+    return 0;
+}
+
+/*
+This function makes every logged mutation durable and releases the archive. It does not checkpoint; the next
+open replays the log.
+*/
+void durableClose(struct DurableArchive *archive)
+{
+    if (archive == NULL || archive->snapshotPath == NULL)
+    {
+        return;
+    }
+    walClose(&archive->wal);
+    storeFree(&archive->store);
+    free(archive->directory);
+    free(archive->snapshotPath);
+    archive->directory = NULL;
+    archive->snapshotPath = NULL;
+    pthread_mutex_destroy(&archive->lock);
+}
+
+/*
+This function adds a material and returns once the addition is on disk. It returns the result of
+storeAddMaterial, or DURABLE_LOG_FAILED if the log could not be written or synced. After a log failure the
+change may be visible in memory but will not survive a restart, and every later mutation fails.
+*/
+int durableAddMaterial(struct DurableArchive *archive, const struct Material *material)
+{
+    uint64_t sequence = 0;
+    pthread_mutex_lock(&archive->lock);
+    int status = storeAddMaterial(&archive->store, material);
+    if (status == 0 && walAppend(&archive->wal, WAL_ADD, material, sizeof(*material), &sequence) != 0)
+    {
+        status = DURABLE_LOG_FAILED;
+    }
+    if (status == 0)
+    {
+        durableMaybeCheckpoint(archive);
+    }
+    pthread_mutex_unlock(&archive->lock);
+
+    if (status == 0 && walCommit(&archive->wal, sequence) != 0)
+    {
+        status = DURABLE_LOG_FAILED;
+    }
+    return status;
+}
+
+/*
+This function updates the details of a material and returns once the update is on disk. It returns the result
+of storeUpdateMaterial, or DURABLE_LOG_FAILED if the log could not be written or synced, with the same
+consequences as for durableAddMaterial.
+*/
+int durableUpdateMaterial(struct DurableArchive *archive, const char *title, union MaterialDetails details)
+{
+    struct WalUpdate update;
+    uint64_t sequence = 0;
+    if (title == NULL)
+    {
+        return -1;
+    }
+    memset(&update, 0, sizeof(update));
+    strncpy(update.title, title, sizeof(update.title) - 1);
+    update.details = details;
+
+    pthread_mutex_lock(&archive->lock);
+    int status = storeUpdateMaterial(&archive->store, title, details);
+    if (status == 0 && walAppend(&archive->wal, WAL_UPDATE, &update, sizeof(update), &sequence) != 0)
+    {
+        status = DURABLE_LOG_FAILED;
+    }
+    if (status == 0)
+    {
+        durableMaybeCheckpoint(archive);
+    }
+    pthread_mutex_unlock(&archive->lock);
+
+    if (status == 0 && walCommit(&archive->wal, sequence) != 0)
+    {
+        status = DURABLE_LOG_FAILED;
+    }
+    return status;
+}
+
+/*
+This function removes a material and returns once the removal is on disk. It returns 0 on success, -1 if no
+material has that title and DURABLE_LOG_FAILED if the log could not be written or synced, with the same
+consequences as for durableAddMaterial.
+*/
+int durableRemoveMaterial(struct DurableArchive *archive, const char *title)
+{
+    char logged[50];
+    uint64_t sequence = 0;
+    if (title == NULL)
+    {
+        return -1;
+    }
+    memset(logged, 0, sizeof(logged));
+    strncpy(logged, title, sizeof(logged) - 1);
+
+    pthread_mutex_lock(&archive->lock);
+    int status = storeFindMaterial(&archive->store, title) == NULL ? -1 : 0;
+    if (status == 0)
+    {
+        storeRemoveMaterial(&archive->store, title);
+        if (walAppend(&archive->wal, WAL_REMOVE, logged, sizeof(logged), &sequence) != 0)
+        {
+            status = DURABLE_LOG_FAILED;
+        }
+    }
+    if (status == 0)
+    {
+        durableMaybeCheckpoint(archive);
+    }
+    pthread_mutex_unlock(&archive->lock);
+
+    if (status == 0 && walCommit(&archive->wal, sequence) != 0)
+    {
+        status = DURABLE_LOG_FAILED;
+    }
+    return status;
+}
+
+/*
+This function copies the material with the given title into material. The copy is taken under the archive
+lock, so it is consistent even while other threads mutate the archive. It returns 0 if the title was found and
+-1 otherwise.
+*/
+int durableFindMaterial(struct DurableArchive *archive, const char *title, struct Material *material)
+{
+    pthread_mutex_lock(&archive->lock);
+    const struct Material *found = storeFindMaterial(&archive->store, title);
+    if (found != NULL)
+    {
+        *material = *found;
+    }
+    pthread_mutex_unlock(&archive->lock);
+    return found == NULL ? -1 : 0;
+}
+
+/*
+This function writes the whole archive to the snapshot, recording the last log sequence number, syncs the
+directory so the new snapshot is in place for good, and then empties the log. A crash between the steps is
+harmless because replay skips the records the snapshot already includes. It returns 0 on success, -1 if the
+snapshot could not be written and -2 if the log could not be emptied.
+*/
+int durableCheckpoint(struct DurableArchive *archive)
+{
+    pthread_mutex_lock(&archive->lock);
+    int status = durableWriteCheckpoint(archive);
+    pthread_mutex_unlock(&archive->lock);
+    return status;
+}
@@ -0,0 +1,49 @@
+#ifndef DURABLE_H
+#define DURABLE_H
+
+#include <pthread.h>
+#include "store.h"
+#include "wal.h"
+
+// Defaults
+#define DURABLE_DEFAULT_CHECKPOINT_BYTES (64u << 20)
+
+// Errors
+// returned by every mutator when the log cannot be written or synced; below every ArchiveStore error code
+#define DURABLE_LOG_FAILED -100
+
+// Structs
+
+/*
+An ArchiveStore kept in a directory as a checkpoint snapshot plus a write-ahead log of every mutation since.
+Opening loads the snapshot and replays the log. Each mutation is applied in memory, appended to the log under
+lock and then committed outside the lock, so concurrent writers share fdatasync calls. Once the log grows past
+checkpointBytes the next mutation writes a new snapshot and empties the log; 0 disables automatic checkpoints.
+*/
+struct DurableArchive
+{
+    struct ArchiveStore store;
+    struct Wal wal;
+    pthread_mutex_t lock;
+    char *directory;
+    char *snapshotPath;
+    size_t checkpointBytes;
+};
+
+// Functions
+
+int durableOpen(struct DurableArchive *archive, const char *directory, const struct StoreConfig *config, size_t checkpointBytes);
+
+void durableClose(struct DurableArchive *archive);
+
+int durableAddMaterial(struct DurableArchive *archive, const struct Material *material);
+
+int durableUpdateMaterial(struct DurableArchive *archive, const char *title, union MaterialDetails details);
+
+int durableRemoveMaterial(struct DurableArchive *archive, const char *title);
+
+int durableFindMaterial(struct DurableArchive *archive, const char *title, struct Material *material);
+
+int durableCheckpoint(struct DurableArchive *archive);
+
+#endif
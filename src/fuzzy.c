@@ -0,0 +1,291 @@
+#include <string.h>
+#include "fuzzy.h"
+
+// U+00C0 to U+00DF and U+00E0 to U+00FF: the base letter, '.' to keep the lowercase letter, ' ' for a separator
+static const char latin1Upper[] = "aaaaaa.ceeeeiiii.nooooo ouuuuy..";
+static const char latin1Lower[] = "aaaaaa.ceeeeiiii.nooooo ouuuuy.y";
+
+#define FUZZY_SEPARATOR 0x20
+
+/*
+This function decodes one UTF-8 sequence at text into codepoint and returns its length in bytes. A byte that
+does not start a valid sequence decodes to itself, as if the text were Latin-1, so every input has a key.
+*/
+static size_t fuzzyDecode(const unsigned char *text, uint32_t *codepoint)
+{
+    unsigned char lead = text[0];
+    size_t length = lead < 0x80 ? 1 : (lead & 0xe0) == 0xc0 ? 2 : (lead & 0xf0) == 0xe0 ? 3 : (lead & 0xf8) == 0xf0 ? 4 : 0;
+    if (length == 0)
+    {
+        *codepoint = lead;
+        return 1;
+    }
+    uint32_t value = length == 1 ? lead : lead & (0x7f >> length);
+    for (size_t i = 1; i < length; i++)
+    {
+        if ((text[i] & 0xc0) != 0x80)
+        {
+            *codepoint = lead;
+            return 1;
+        }
+        value = (value << 6) | (text[i] & 0x3f);
+    }
+    *codepoint = value;
+    return length;
+}
+
+/*
+This function writes codepoint as UTF-8 to out and returns the number of bytes written.
+*/
+static size_t fuzzyEncode(uint32_t codepoint, char *out)
+{
+    if (codepoint < 0x80)
+    {
+        out[0] = (char)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800)
+    {
+        out[0] = (char)(0xc0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3f));
+        return 2;
+    }
+    if (codepoint < 0x10000)
+    {
+        out[0] = (char)(0xe0 | (codepoint >> 12));
+        out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (codepoint & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (codepoint >> 18));
+    out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (codepoint & 0x3f));
+    return 4;
+}
+
+/*
+This function maps a code point to its folded form: lowercase, with the accents of Latin-1 letters removed so
+that "Café" and "cafe" agree. It covers ASCII, Latin-1, Latin Extended-A, Greek and Cyrillic, which is where
+the catalogue's titles come from; other code points are returned unchanged. Punctuation, symbols and spaces
+become FUZZY_SEPARATOR.
+*/
+uint32_t fuzzyFold(uint32_t codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        if (codepoint >= 'A' && codepoint <= 'Z')
+        {
+            return codepoint + 0x20;
+        }
+        bool alphanumeric = (codepoint >= 'a' && codepoint <= 'z') || (codepoint >= '0' && codepoint <= '9');
+        return alphanumeric ? codepoint : FUZZY_SEPARATOR;
+    }
+    if (codepoint < 0xc0)
+    {
+        // Latin-1 punctuation and symbols, apart from the ordinal indicators and the micro sign
+        return codepoint == 0xaa || codepoint == 0xb5 || codepoint == 0xba ? codepoint : FUZZY_SEPARATOR;
+    }
+    if (codepoint < 0x100)
+    {
+        char base = codepoint < 0xe0 ? latin1Upper[codepoint - 0xc0] : latin1Lower[codepoint - 0xe0];
+        if (base == ' ')
+        {
+            return FUZZY_SEPARATOR;
+        }
+        if (base == '.')
+        {
+            return codepoint < 0xdf ? codepoint + 0x20 : codepoint;
+        }
+        return (uint32_t)base;
+    }
+    if (codepoint == 0x130 || codepoint == 0x131)
+    {
+        return 'i';
+    }
+    if (codepoint == 0x178)
+    {
+        return 'y';
+    }
+    if ((codepoint <= 0x137) || (codepoint >= 0x14a && codepoint <= 0x177))
+    {
+        return codepoint | 1;
+    }
+    if ((codepoint >= 0x139 && codepoint <= 0x148) || (codepoint >= 0x179 && codepoint <= 0x17e))
+    {
+        return (codepoint & 1) ? codepoint + 1 : codepoint;
+    }
+    if ((codepoint >= 0x391 && codepoint <= 0x3a9 && codepoint != 0x3a2) || (codepoint >= 0x410 && codepoint <= 0x42f))
+    {
+        return codepoint + 0x20;
+    }
+    if (codepoint == 0x3c2)
+    {
+        // final sigma
+        return 0x3c3;
+    }
+    if (codepoint >= 0x400 && codepoint <= 0x40f)
+    {
+        return codepoint + 0x50;
+    }
+    if ((codepoint >= 0x2000 && codepoint <= 0x206f) || codepoint == 0x3000)
+    {
+        // general punctuation and the ideographic space
+        return FUZZY_SEPARATOR;
+    }
+    return codepoint;
+}
+
+/*
+This function turns NUL-terminated UTF-8 text into its lookup key: folded code points with every run of
+separators collapsed into one space and none at either end, so "The Cat-Sat!" and "the cat sat" share a key.
+At most capacity code points are written; the rest of a longer text is ignored. It returns the key length.
+*/
+size_t fuzzyNormalize(const char *text, uint32_t *key, size_t capacity)
+{
+    const unsigned char *p = (const unsigned char *)text;
+    size_t length = 0;
+    bool separator = false;
+    while (*p != '\0' && length < capacity)
+    {
+        uint32_t codepoint;
+        p += fuzzyDecode(p, &codepoint);
+        codepoint = fuzzyFold(codepoint);
+        if (codepoint == FUZZY_SEPARATOR)
+        {
+            separator = length > 0;
+            continue;
+        }
+        if (separator)
+        {
+            key[length++] = FUZZY_SEPARATOR;
+            separator = false;
+            if (length == capacity)
+            {
+                break;
+            }
+        }
+        key[length++] = codepoint;
+    }
+    return length;
+}
+
+/*
+This function writes the distinct trigrams of a key, padded with two spaces in front and one behind so that
+the start of the key weighs more than its middle, as NUL-terminated UTF-8 strings. A key of n code points has
+n + 1 trigrams, fewer once duplicates are dropped; an empty key has none. It returns the number written, at
+most capacity.
+*/
+size_t fuzzyTrigrams(const uint32_t *key, size_t length, char (*trigrams)[FUZZY_TRIGRAM_BYTES], size_t capacity)
+{
+    if (length == 0)
+    {
+        return 0;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i <= length && count < capacity; i++)
+    {
+        // position i covers padded code points i, i + 1 and i + 2, of which the first two are spaces
+        char trigram[FUZZY_TRIGRAM_BYTES];
+        size_t bytes = 0;
+        for (size_t j = i; j < i + 3; j++)
+        {
+            uint32_t codepoint = j < 2 || j - 2 >= length ? FUZZY_SEPARATOR : key[j - 2];
+            bytes += fuzzyEncode(codepoint, trigram + bytes);
+        }
+        trigram[bytes] = '\0';
+
+        bool seen = false;
+        for (size_t k = 0; k < count && !seen; k++)
+        {
+            seen = strcmp(trigrams[k], trigram) == 0;
+        }
+        if (!seen)
+        {
+            memcpy(trigrams[count++], trigram, bytes + 1);
+        }
+    }
+    return count;
+}
+
+/*
+This function returns the Levenshtein distance between two keys if it is at most limit, and limit + 1
+otherwise; limit must be below INT_MAX. Only the diagonal band of width 2 * limit + 1 is computed, with the
+cell just outside each end of a row set to limit + 1 for the next row to read, and the computation stops as soon
+as a whole row exceeds limit, so each code point costs O(limit).
+*/
+int fuzzyDistance(const uint32_t *a, size_t aLength, const uint32_t *b, size_t bLength, int limit)
+{
+    if (limit < 0)
+    {
+        return 0;
+    }
+    size_t band = (size_t)limit;
+    if ((aLength > bLength ? aLength - bLength : bLength - aLength) > band)
+    {
+        return limit + 1;
+    }
+    if (aLength > FUZZY_KEY_MAX || bLength > FUZZY_KEY_MAX)
+    {
+        return limit + 1;
+    }
+
+    int rows[2][FUZZY_KEY_MAX + 1];
+    int outside = limit + 1;
+    size_t first = band < bLength ? band : bLength;
+    for (size_t j = 0; j <= first; j++)
+    {
+        rows[0][j] = (int)j;
+    }
+    if (first < bLength)
+    {
+        rows[0][first + 1] = outside;
+    }
+    for (size_t i = 1; i <= aLength; i++)
+    {
+        int *previous = rows[(i - 1) & 1];
+        int *current = rows[i & 1];
+        size_t from = i > band ? i - band : 0;
+        size_t to = i + band < bLength ? i + band : bLength;
+        // the band moves right by at most one cell per row, so the next row reads at most these two cells beyond it
+        if (from > 0)
+        {
+            current[from - 1] = outside;
+        }
+        if (to < bLength)
+        {
+            current[to + 1] = outside;
+        }
+        int best = outside;
+        for (size_t j = from; j <= to; j++)
+        {
+            int cost;
+            if (j == 0)
+            {
+                cost = (int)i;
+            }
+            else
+            {
+                cost = previous[j - 1] + (a[i - 1] != b[j - 1]);
+                if (previous[j] + 1 < cost)
+                {
+                    cost = previous[j] + 1;
+                }
+                if (current[j - 1] + 1 < cost)
+                {
+                    cost = current[j - 1] + 1;
+                }
+            }
+            current[j] = cost > outside ? outside : cost;
+            if (current[j] < best)
+            {
+                best = current[j];
+            }
+        }
+        if (best > limit)
+        {
+            return limit + 1;
+        }
+    }
+    return rows[aLength & 1][bLength] > limit ? limit + 1 : rows[aLength & 1][bLength];
+}
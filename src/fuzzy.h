@@ -0,0 +1,23 @@
+#ifndef FUZZY_H
+#define FUZZY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Limits
+#define FUZZY_KEY_MAX 128
+#define FUZZY_TRIGRAMS_MAX (FUZZY_KEY_MAX + 1)
+#define FUZZY_TRIGRAM_BYTES 13
+
+// Functions
+
+uint32_t fuzzyFold(uint32_t codepoint);
+
+size_t fuzzyNormalize(const char *text, uint32_t *key, size_t capacity);
+
+size_t fuzzyTrigrams(const uint32_t *key, size_t length, char (*trigrams)[FUZZY_TRIGRAM_BYTES], size_t capacity);
+
+int fuzzyDistance(const uint32_t *a, size_t aLength, const uint32_t *b, size_t bLength, int limit);
+
+#endif
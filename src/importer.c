@@ -0,0 +1,1007 @@
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "importer.h"
+#include "threadpool.h"
+
+static const char *importTypeNames[] = {"BOOK", "JOURNAL", "NEWSPAPER"};
+static const char *importSubtypeNames[STORE_TYPES][STORE_SUBTYPES] = {
+    {"NOVEL", "BIOGRAPHY", "HISTORY"}, {"SCIENCE", "LITERATURE", "ART"}, {"DAILY", "WEEKLY", "MONTHLY"}};
+
+/*
+A field of a row, pointing into the input. escaped is set when the bytes hold CSV doubled quotes or JSON escape
+sequences that have to be decoded on the way into a material; other fields are copied as they are.
+*/
+struct ImportSlice
+{
+    const char *data;
+    size_t length;
+    bool escaped;
+};
+
+/*
+The fields of one row that a material is built from. A slice with NULL data was not given.
+*/
+struct ImportRow
+{
+    struct ImportSlice type;
+    struct ImportSlice title;
+    struct ImportSlice number;
+    struct ImportSlice contributor;
+    struct ImportSlice subtype;
+};
+
+/*
+A failed row: its line within the chunk and its ImportRowError code.
+*/
+struct ImportFailure
+{
+    size_t line;
+    int code;
+};
+
+/*
+A piece of the input ending at a line boundary and what parsing it produced: the valid materials with the line
+each came from, the rows that failed and the number of lines, so that the lines of later chunks can be
+numbered. status is -1 if parsing ran out of memory.
+*/
+struct ImportChunk
+{
+    const char *begin;
+    const char *end;
+    bool first;
+    struct Material *items;
+    size_t *itemLines;
+    size_t count;
+    size_t capacity;
+    struct ImportFailure *failures;
+    size_t failureCount;
+    size_t failureCapacity;
+    size_t lines;
+    size_t rows;
+    int status;
+};
+
+/*
+The state shared by the parsing tasks of one window of chunks.
+*/
+struct ImportJob
+{
+    struct ImportChunk *chunks;
+    enum ImportFormat format;
+};
+
+/*
+This function fills an ImportOptions with the defaults: format detection, one thread per CPU, chunks of
+IMPORT_CHUNK_SIZE bytes and no error callback.
+*/
+void importDefaultOptions(struct ImportOptions *options)
+{
+    options->format = IMPORT_AUTO;
+    options->threads = 0;
+    options->chunkSize = IMPORT_CHUNK_SIZE;
+    options->onError = NULL;
+    options->context = NULL;
+}
+
+/*
+This function returns a short description of an ImportRowError code.
+*/
+const char *importErrorName(int code)
+{
+    switch (code)
+    {
+    case IMPORT_ROW_REJECTED:
+        return "duplicate title or archive full";
+    case IMPORT_ROW_NO_MEMORY:
+        return "out of memory";
+    case IMPORT_ROW_BAD_BOOK_TYPE:
+        return "invalid book type";
+    case IMPORT_ROW_BAD_JOURNAL_TYPE:
+        return "invalid journal type";
+    case IMPORT_ROW_BAD_NEWSPAPER_TYPE:
+        return "invalid newspaper type";
+    case IMPORT_ROW_BAD_TYPE:
+        return "invalid material type";
+    case IMPORT_ROW_SYNTAX:
+        return "syntax error";
+    case IMPORT_ROW_BAD_NUMBER:
+        return "invalid pages or issue";
+    case IMPORT_ROW_TOO_LONG:
+        return "field too long";
+    case IMPORT_ROW_MISSING:
+        return "missing field";
+    default:
+        return "unknown error";
+    }
+}
+
+/*
+This function compares a slice with an upper-case name, ignoring the case of the slice.
+*/
+static bool importSliceIs(struct ImportSlice slice, const char *name)
+{
+    size_t i = 0;
+    for (; i < slice.length && name[i] != '\0'; i++)
+    {
+        char c = slice.data[i];
+        if ((c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c) != name[i])
+        {
+            return false;
+        }
+    }
+    return i == slice.length && name[i] == '\0';
+}
+
+/*
+This function parses a decimal integer that fills the whole slice. It returns false if the slice is empty,
+holds anything else or overflows an int.
+*/
+static bool importParseInt(struct ImportSlice slice, int *value)
+{
+    size_t i = 0;
+    bool negative = false;
+    if (slice.data == NULL || slice.length == 0)
+    {
+        return false;
+    }
+    if (slice.data[0] == '-' || slice.data[0] == '+')
+    {
+        negative = slice.data[0] == '-';
+        i++;
+    }
+    if (i == slice.length)
+    {
+        return false;
+    }
+    long long result = 0;
+    for (; i < slice.length; i++)
+    {
+        if (slice.data[i] < '0' || slice.data[i] > '9')
+        {
+            return false;
+        }
+        result = result * 10 + (slice.data[i] - '0');
+        if (result > (long long)INT32_MAX + 1)
+        {
+            return false;
+        }
+    }
+    result = negative ? -result : result;
+    if (result > INT32_MAX || result < INT32_MIN)
+    {
+        return false;
+    }
+    *value = (int)result;
+    return true;
+}
+
+/*
+This function appends the UTF-8 encoding of a codepoint to out, which has room for size bytes of which *length
+are used. It returns false if the encoding does not fit.
+*/
+static bool importPutCodepoint(char *out, size_t size, size_t *length, uint32_t codepoint)
+{
+    char bytes[4];
+    size_t n;
+    if (codepoint < 0x80)
+    {
+        bytes[0] = (char)codepoint;
+        n = 1;
+    }
+    else if (codepoint < 0x800)
+    {
+        bytes[0] = (char)(0xc0 | (codepoint >> 6));
+        bytes[1] = (char)(0x80 | (codepoint & 0x3f));
+        n = 2;
+    }
+    else if (codepoint < 0x10000)
+    {
+        bytes[0] = (char)(0xe0 | (codepoint >> 12));
+        bytes[1] = (char)(0x80 | ((codepoint >> 6) & 0x3f));
+        bytes[2] = (char)(0x80 | (codepoint & 0x3f));
+        n = 3;
+    }
+    else
+    {
+        bytes[0] = (char)(0xf0 | (codepoint >> 18));
+        bytes[1] = (char)(0x80 | ((codepoint >> 12) & 0x3f));
+        bytes[2] = (char)(0x80 | ((codepoint >> 6) & 0x3f));
+        bytes[3] = (char)(0x80 | (codepoint & 0x3f));
+        n = 4;
+    }
+    if (*length + n >= size)
+    {
+        return false;
+    }
+    memcpy(out + *length, bytes, n);
+    *length += n;
+    return true;
+}
+
+/*
+This function reads the four hex digits of a JSON \u escape. It returns false if they are not hex digits.
+*/
+static bool importParseHex(const char *data, uint32_t *value)
+{
+    *value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        char c = data[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (digit < 0)
+        {
+            return false;
+        }
+        *value = *value * 16 + (uint32_t)digit;
+    }
+    return true;
+}
+
+/*
+This function decodes the JSON escapes of a string slice into out, which has room for size bytes including the
+terminator. It returns 0 on success, IMPORT_ROW_TOO_LONG or IMPORT_ROW_SYNTAX.
+*/
+static int importDecodeJson(struct ImportSlice slice, char *out, size_t size)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < slice.length; i++)
+    {
+        char c = slice.data[i];
+        if (c != '\\')
+        {
+            if (length + 1 >= size)
+            {
+                return IMPORT_ROW_TOO_LONG;
+            }
+            out[length++] = c;
+            continue;
+        }
+        if (++i == slice.length)
+        {
+            return IMPORT_ROW_SYNTAX;
+        }
+        uint32_t codepoint;
+        switch (slice.data[i])
+        {
+        case '"':
+        case '\\':
+        case '/':
+            codepoint = (uint32_t)slice.data[i];
+            break;
+        case 'b':
+            codepoint = '\b';
+            break;
+        case 'f':
+            codepoint = '\f';
+            break;
+        case 'n':
+            codepoint = '\n';
+            break;
+        case 'r':
+            codepoint = '\r';
+            break;
+        case 't':
+            codepoint = '\t';
+            break;
+        case 'u':
+            if (slice.length - i < 5 || !importParseHex(&slice.data[i + 1], &codepoint))
+            {
+                return IMPORT_ROW_SYNTAX;
+            }
+            i += 4;
+            // a high surrogate must be followed by the escaped low surrogate of the pair
+            if (codepoint >= 0xd800 && codepoint < 0xdc00)
+            {
+                uint32_t low;
+                if (slice.length - i < 7 || slice.data[i + 1] != '\\' || slice.data[i + 2] != 'u' ||
+                    !importParseHex(&slice.data[i + 3], &low) || low < 0xdc00 || low >= 0xe000)
+                {
+                    return IMPORT_ROW_SYNTAX;
+                }
+                codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low - 0xdc00);
+                i += 6;
+            }
+            break;
+        default:
+            return IMPORT_ROW_SYNTAX;
+        }
+        if (codepoint == 0)
+        {
+            return IMPORT_ROW_SYNTAX;
+        }
+        if (!importPutCodepoint(out, size, &length, codepoint))
+        {
+            return IMPORT_ROW_TOO_LONG;
+        }
+    }
+    out[length] = '\0';
+    return 0;
+}
+
+/*
+This function copies a text field into out, which has room for size bytes including the terminator, undoing
+CSV quote doubling or JSON escapes. It returns 0 on success, IMPORT_ROW_TOO_LONG or IMPORT_ROW_SYNTAX.
+*/
+static int importCopyText(struct ImportSlice slice, bool json, char *out, size_t size)
+{
+    if (slice.escaped && json)
+    {
+        return importDecodeJson(slice, out, size);
+    }
+    if (!slice.escaped)
+    {
+        if (slice.length >= size)
+        {
+            return IMPORT_ROW_TOO_LONG;
+        }
+        if (memchr(slice.data, '\0', slice.length) != NULL)
+        {
+            return IMPORT_ROW_SYNTAX;
+        }
+        memcpy(out, slice.data, slice.length);
+        out[slice.length] = '\0';
+        return 0;
+    }
+
+    size_t length = 0;
+    for (size_t i = 0; i < slice.length; i++)
+    {
+        if (length + 1 >= size)
+        {
+            return IMPORT_ROW_TOO_LONG;
+        }
+        out[length++] = slice.data[i];
+        // a doubled quote inside a quoted CSV field stands for one quote
+        if (slice.data[i] == '"')
+        {
+            i++;
+        }
+    }
+    out[length] = '\0';
+    return 0;
+}
+
+/*
+This function parses a type or subtype given either by name or by its number among count names.
+*/
+static bool importParseEnum(struct ImportSlice slice, const char *const *names, int count, int *value)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (importSliceIs(slice, names[i]))
+        {
+            *value = i;
+            return true;
+        }
+    }
+    return importParseInt(slice, value) && *value >= 0 && *value < count;
+}
+
+/*
+This function builds a material from the fields of a row, validating the type, the subtype of its union arm,
+the number and the lengths of the text fields. It returns 0 or an ImportRowError code.
+*/
+static int importBuild(const struct ImportRow *row, bool json, struct Material *material)
+{
+    static const int subtypeErrors[STORE_TYPES] = {IMPORT_ROW_BAD_BOOK_TYPE, IMPORT_ROW_BAD_JOURNAL_TYPE, IMPORT_ROW_BAD_NEWSPAPER_TYPE};
+    memset(material, 0, sizeof(*material));
+    if (row->type.data == NULL || row->title.data == NULL || row->title.length == 0 || row->subtype.data == NULL)
+    {
+        return IMPORT_ROW_MISSING;
+    }
+    int type;
+    if (!importParseEnum(row->type, importTypeNames, STORE_TYPES, &type))
+    {
+        return IMPORT_ROW_BAD_TYPE;
+    }
+    int subtype;
+    if (!importParseEnum(row->subtype, importSubtypeNames[type], STORE_SUBTYPES, &subtype))
+    {
+        return subtypeErrors[type];
+    }
+    int number = 0;
+    if (type != NEWSPAPER && !importParseInt(row->number, &number))
+    {
+        return IMPORT_ROW_BAD_NUMBER;
+    }
+    int result = importCopyText(row->title, json, material->title, sizeof(material->title));
+    if (result != 0)
+    {
+        return result;
+    }
+
+    material->type = (enum MaterialType)type;
+    struct ImportSlice contributor = row->contributor;
+    if (contributor.data == NULL)
+    {
+        contributor.data = "";
+        contributor.length = 0;
+    }
+    switch (type)
+    {
+    case BOOK:
+        material->details.book.pages = number;
+        material->details.book.type = (enum BookType)subtype;
+        return importCopyText(contributor, json, material->details.book.author, sizeof(material->details.book.author));
+    case JOURNAL:
+        material->details.journal.issue = number;
+        material->details.journal.type = (enum JournalType)subtype;
+        return importCopyText(contributor, json, material->details.journal.publisher, sizeof(material->details.journal.publisher));
+    default:
+        material->details.newspaper.type = (enum NewspaperType)subtype;
+        return importCopyText(contributor, json, material->details.newspaper.editor, sizeof(material->details.newspaper.editor));
+    }
+}
+
+/*
+This function splits a CSV line into the fields type, title, number, contributor and subtype, in that order.
+A field may be quoted, with a quote inside it written twice; quoted fields cannot span lines. It returns 0 or
+IMPORT_ROW_SYNTAX.
+*/
+static int importSplitCsv(const char *line, const char *end, struct ImportRow *row)
+{
+    struct ImportSlice *fields[] = {&row->type, &row->title, &row->number, &row->contributor, &row->subtype};
+    const char *p = line;
+    for (int field = 0; field < 5; field++)
+    {
+        struct ImportSlice *slice = fields[field];
+        slice->escaped = false;
+        if (p < end && *p == '"')
+        {
+            const char *start = ++p;
+            for (;;)
+            {
+                const char *quote = (const char *)memchr(p, '"', (size_t)(end - p));
+                if (quote == NULL)
+                {
+                    return IMPORT_ROW_SYNTAX;
+                }
+                if (quote + 1 < end && quote[1] == '"')
+                {
+                    slice->escaped = true;
+                    p = quote + 2;
+                    continue;
+                }
+                slice->data = start;
+                slice->length = (size_t)(quote - start);
+                p = quote + 1;
+                break;
+            }
+        }
+        else
+        {
+            const char *comma = (const char *)memchr(p, ',', (size_t)(end - p));
+            const char *stop = comma == NULL ? end : comma;
+            if (memchr(p, '"', (size_t)(stop - p)) != NULL)
+            {
+                return IMPORT_ROW_SYNTAX;
+            }
+            slice->data = p;
+            slice->length = (size_t)(stop - p);
+            p = stop;
+        }
+
+        if (field < 4)
+        {
+            if (p == end || *p != ',')
+            {
+                return IMPORT_ROW_SYNTAX;
+            }
+            p++;
+        }
+    }
+    return p == end ? 0 : IMPORT_ROW_SYNTAX;
+}
+
+/*
+This function skips JSON whitespace.
+*/
+static const char *importSkipSpace(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    {
+        p++;
+    }
+    return p;
+}
+
+/*
+This function scans the JSON string that p points into, just past its opening quote, into slice. It returns the
+position after the closing quote, or NULL if the string is not terminated on this line.
+*/
+static const char *importScanString(const char *p, const char *end, struct ImportSlice *slice)
+{
+    slice->data = p;
+    slice->escaped = false;
+    while (p < end && *p != '"')
+    {
+        if (*p == '\\')
+        {
+            slice->escaped = true;
+            p++;
+        }
+        p++;
+    }
+    if (p >= end)
+    {
+        return NULL;
+    }
+    slice->length = (size_t)(p - slice->data);
+    return p + 1;
+}
+
+/*
+This function scans one JSON value into slice: the contents of a string, or the text of a number, literal,
+object or array. It returns the position after the value, or NULL if it is malformed.
+*/
+static const char *importScanValue(const char *p, const char *end, struct ImportSlice *slice)
+{
+    if (p == end)
+    {
+        return NULL;
+    }
+    if (*p == '"')
+    {
+        return importScanString(p + 1, end, slice);
+    }
+
+    slice->data = p;
+    slice->escaped = false;
+    if (*p == '{' || *p == '[')
+    {
+        int depth = 0;
+        while (p < end)
+        {
+            if (*p == '"')
+            {
+                struct ImportSlice ignored;
+                p = importScanString(p + 1, end, &ignored);
+                if (p == NULL)
+                {
+                    return NULL;
+                }
+                continue;
+            }
+            depth += (*p == '{' || *p == '[') - (*p == '}' || *p == ']');
+            p++;
+            if (depth == 0)
+            {
+                slice->length = (size_t)(p - slice->data);
+                return p;
+            }
+        }
+        return NULL;
+    }
+    while (p < end && ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'z') || *p == '-' || *p == '+' || *p == '.' || *p == 'E'))
+    {
+        p++;
+    }
+    slice->length = (size_t)(p - slice->data);
+    return slice->length == 0 ? NULL : p;
+}
+
+/*
+This function reads a JSON Lines record, one flat object per line, into the fields of a row. The keys are type,
+title, subtype, pages, issue or number, and author, publisher, editor or contributor; others are ignored. It
+returns 0 or IMPORT_ROW_SYNTAX.
+*/
+static int importSplitJson(const char *line, const char *end, struct ImportRow *row)
+{
+    const char *p = importSkipSpace(line, end);
+    if (p == end || *p != '{')
+    {
+        return IMPORT_ROW_SYNTAX;
+    }
+    p = importSkipSpace(p + 1, end);
+    if (p < end && *p == '}')
+    {
+        p++;
+    }
+    else
+    {
+        for (;;)
+        {
+            struct ImportSlice key;
+            struct ImportSlice value;
+            if (p == end || *p != '"' || (p = importScanString(p + 1, end, &key)) == NULL)
+            {
+                return IMPORT_ROW_SYNTAX;
+            }
+            p = importSkipSpace(p, end);
+            if (p == end || *p != ':')
+            {
+                return IMPORT_ROW_SYNTAX;
+            }
+            p = importScanValue(importSkipSpace(p + 1, end), end, &value);
+            if (p == NULL)
+            {
+                return IMPORT_ROW_SYNTAX;
+            }
+
+            struct ImportSlice *field = NULL;
+            if (importSliceIs(key, "TYPE"))
+            {
+                field = &row->type;
+            }
+            else if (importSliceIs(key, "TITLE"))
+            {
+                field = &row->title;
+            }
+            else if (importSliceIs(key, "SUBTYPE"))
+            {
+                field = &row->subtype;
+            }
+            else if (importSliceIs(key, "PAGES") || importSliceIs(key, "ISSUE") || importSliceIs(key, "NUMBER"))
+            {
+                field = &row->number;
+            }
+            else if (importSliceIs(key, "AUTHOR") || importSliceIs(key, "PUBLISHER") || importSliceIs(key, "EDITOR") ||
+                     importSliceIs(key, "CONTRIBUTOR"))
+            {
+                field = &row->contributor;
+            }
+            if (field != NULL)
+            {
+                *field = value;
+            }
+
+            p = importSkipSpace(p, end);
+            if (p < end && *p == ',')
+            {
+                p = importSkipSpace(p + 1, end);
+                continue;
+            }
+            if (p < end && *p == '}')
+            {
+                p++;
+                break;
+            }
+            return IMPORT_ROW_SYNTAX;
+        }
+    }
+    return importSkipSpace(p, end) == end ? 0 : IMPORT_ROW_SYNTAX;
+}
+
+/*
+This function records a failed row of a chunk. It returns false if memory runs out.
+*/
+static bool importFail(struct ImportChunk *chunk, size_t line, int code)
+{
+    if (chunk->failureCount == chunk->failureCapacity)
+    {
+        size_t capacity = chunk->failureCapacity == 0 ? 16 : chunk->failureCapacity * 2;
+        struct ImportFailure *failures = (struct ImportFailure *)realloc(chunk->failures, capacity * sizeof(struct ImportFailure));
+        if (failures == NULL)
+        {
+            return false;
+        }
+        chunk->failures = failures;
+        chunk->failureCapacity = capacity;
+    }
+    chunk->failures[chunk->failureCount].line = line;
+    chunk->failures[chunk->failureCount].code = code;
+    chunk->failureCount++;
+    return true;
+}
+
+/*
+This function makes room for one more material in a chunk. It returns false if memory runs out.
+*/
+static bool importReserve(struct ImportChunk *chunk)
+{
+    if (chunk->count < chunk->capacity)
+    {
+        return true;
+    }
+    // a first guess of one row per 64 bytes saves most of the regrowth
+    size_t capacity = chunk->capacity == 0 ? (size_t)(chunk->end - chunk->begin) / 64 + 16 : chunk->capacity * 2;
+    struct Material *items = (struct Material *)realloc(chunk->items, capacity * sizeof(struct Material));
+    if (items == NULL)
+    {
+        return false;
+    }
+    chunk->items = items;
+    size_t *lines = (size_t *)realloc(chunk->itemLines, capacity * sizeof(size_t));
+    if (lines == NULL)
+    {
+        return false;
+    }
+    chunk->itemLines = lines;
+    chunk->capacity = capacity;
+    return true;
+}
+
+/*
+This function is the ThreadPoolFn that parses one chunk line by line into materials and failures. Blank lines
+are counted but are not rows, and the first line of a CSV input is skipped when it is a header naming the type
+column.
+*/
+static void importParseChunk(void *context, size_t index)
+{
+    struct ImportJob *job = (struct ImportJob *)context;
+    struct ImportChunk *chunk = &job->chunks[index];
+    bool json = job->format == IMPORT_JSON_LINES;
+    const char *p = chunk->begin;
+
+    while (p < chunk->end)
+    {
+        const char *newline = (const char *)memchr(p, '\n', (size_t)(chunk->end - p));
+        const char *next = newline == NULL ? chunk->end : newline + 1;
+        const char *end = newline == NULL ? chunk->end : newline;
+        if (end > p && end[-1] == '\r')
+        {
+            end--;
+        }
+        size_t line = chunk->lines++;
+        const char *start = p;
+        p = next;
+
+        if (importSkipSpace(start, end) == end)
+        {
+            continue;
+        }
+        if (!json && chunk->first && line == 0 && end - start >= 5 && strncasecmp(start, "type,", 5) == 0)
+        {
+            continue;
+        }
+
+        chunk->rows++;
+        struct ImportRow row;
+        memset(&row, 0, sizeof(row));
+        int code = json ? importSplitJson(start, end, &row) : importSplitCsv(start, end, &row);
+        if (code == 0)
+        {
+            if (!importReserve(chunk))
+            {
+                chunk->status = -1;
+                return;
+            }
+            code = importBuild(&row, json, &chunk->items[chunk->count]);
+            if (code == 0)
+            {
+                chunk->itemLines[chunk->count++] = line;
+                continue;
+            }
+        }
+        if (!importFail(chunk, line, code))
+        {
+            chunk->status = -1;
+            return;
+        }
+    }
+}
+
+/*
+This function adds the materials of a parsed chunk to the store as one batch and reports the failed rows, those
+from parsing and those the store rejected, in line order. base is the number of lines before the chunk.
+*/
+static void importCommitChunk(struct ArchiveStore *store, struct ImportChunk *chunk, size_t base, const struct ImportOptions *options,
+                              int *codes, struct ImportResult *result)
+{
+    size_t added = storeAddMaterials(store, chunk->items, chunk->count, STORE_BULK_DEFAULT, codes);
+    result->rows += chunk->rows;
+    result->added += added;
+    result->failed += chunk->rows - added;
+    if (options->onError == NULL)
+    {
+        return;
+    }
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < chunk->failureCount || j < chunk->count)
+    {
+        if (j < chunk->count && codes[j] == 0)
+        {
+            j++;
+            continue;
+        }
+        if (j == chunk->count || (i < chunk->failureCount && chunk->failures[i].line < chunk->itemLines[j]))
+        {
+            options->onError(options->context, base + chunk->failures[i].line + 1, chunk->failures[i].code);
+            i++;
+        }
+        else
+        {
+            options->onError(options->context, base + chunk->itemLines[j] + 1, codes[j]);
+            j++;
+        }
+    }
+}
+
+/*
+This function releases what parsing a chunk allocated.
+*/
+static void importFreeChunk(struct ImportChunk *chunk)
+{
+    free(chunk->items);
+    free(chunk->itemLines);
+    free(chunk->failures);
+    memset(chunk, 0, sizeof(*chunk));
+}
+
+/*
+This function returns the number of parsing threads to use.
+*/
+static size_t importThreads(const struct ImportOptions *options)
+{
+    if (options->threads != 0)
+    {
+        return options->threads;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1)
+    {
+        return 1;
+    }
+    return (size_t)cpus < STORE_BULK_MAX_THREADS ? (size_t)cpus : STORE_BULK_MAX_THREADS;
+}
+
+/*
+This function imports catalog records from size bytes of CSV or JSON Lines into the store. The input is cut into
+chunks of about chunkSize bytes at line boundaries and a window of chunks is parsed in parallel, with every field
+sliced straight out of data rather than copied into an intermediate row; the materials of each chunk are then
+added with storeAddMaterials in input order, so the outcome equals adding every row one by one. Rows that fail
+are reported through onError and counted in result, which may be NULL. It returns 0 when the input was read to
+the end, even if some rows failed, -1 for a NULL store or data and -3 if memory runs out, in which case the rows
+before the failing chunk have been added.
+*/
+int importBuffer(struct ArchiveStore *store, const char *data, size_t size, const struct ImportOptions *options, struct ImportResult *result)
+{
+    struct ImportOptions defaults;
+    struct ImportResult ignored;
+    if (store == NULL || (data == NULL && size > 0))
+    {
+        return -1;
+    }
+    if (options == NULL)
+    {
+        importDefaultOptions(&defaults);
+        options = &defaults;
+    }
+    if (result == NULL)
+    {
+        result = &ignored;
+    }
+    memset(result, 0, sizeof(*result));
+    result->bytes = size;
+
+    struct ImportJob job;
+    job.format = options->format;
+    if (job.format == IMPORT_AUTO)
+    {
+        size_t i = 0;
+        while (i < size && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n'))
+        {
+            i++;
+        }
+        job.format = i < size && data[i] == '{' ? IMPORT_JSON_LINES : IMPORT_CSV;
+    }
+
+    size_t chunkSize = options->chunkSize == 0 ? IMPORT_CHUNK_SIZE : options->chunkSize;
+    size_t threads = importThreads(options);
+    size_t window = threads * IMPORT_WINDOW_PER_THREAD;
+    struct ThreadPool pool;
+    if (threads > 1 && size > chunkSize && threadPoolInit(&pool, threads) != 0)
+    {
+        threads = 1;
+    }
+    bool pooled = threads > 1 && size > chunkSize;
+    job.chunks = (struct ImportChunk *)calloc(window, sizeof(struct ImportChunk));
+    int *codes = NULL;
+    size_t codeCapacity = 0;
+    int status = job.chunks == NULL ? -3 : 0;
+
+    const char *p = data;
+    const char *end = data + size;
+    size_t base = 0;
+    while (status == 0 && p < end)
+    {
+        size_t count = 0;
+        for (; count < window && p < end; count++)
+        {
+            const char *stop = (size_t)(end - p) <= chunkSize ? end : p + chunkSize;
+            if (stop < end)
+            {
+                const char *newline = (const char *)memchr(stop, '\n', (size_t)(end - stop));
+                stop = newline == NULL ? end : newline + 1;
+            }
+            job.chunks[count].begin = p;
+            job.chunks[count].end = stop;
+            job.chunks[count].first = p == data;
+            p = stop;
+        }
+
+        if (pooled)
+        {
+            threadPoolFor(&pool, count, importParseChunk, &job);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                importParseChunk(&job, i);
+            }
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            struct ImportChunk *chunk = &job.chunks[i];
+            if (status == 0 && chunk->status == 0 && chunk->count > codeCapacity)
+            {
+                int *grown = (int *)realloc(codes, chunk->count * sizeof(int));
+                if (grown == NULL)
+                {
+                    chunk->status = -1;
+                }
+                else
+                {
+                    codes = grown;
+                    codeCapacity = chunk->count;
+                }
+            }
+            if (status == 0 && chunk->status != 0)
+            {
+                status = -3;
+            }
+            if (status == 0)
+            {
+                importCommitChunk(store, chunk, base, options, codes, result);
+                base += chunk->lines;
+            }
+            importFreeChunk(chunk);
+        }
+    }
+
+    if (pooled)
+    {
+        threadPoolFree(&pool);
+    }
+    free(job.chunks);
+    free(codes);
+    return status;
+}
+
+/*
+This function imports the catalog file at path with importBuffer, reading it through a private read-only
+mapping so that the parsers slice fields straight out of the page cache. It returns the result of importBuffer,
+-1 for a NULL argument or -2 if the file cannot be opened or mapped.
+*/
+int importFile(struct ArchiveStore *store, const char *path, const struct ImportOptions *options, struct ImportResult *result)
+{
+    if (store == NULL || path == NULL)
+    {
+        return -1;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -2;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return -2;
+    }
+    size_t size = (size_t)info.st_size;
+    if (size == 0)
+    {
+        close(fd);
+        return importBuffer(store, "", 0, options, result);
+    }
+
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return -2;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    int status = importBuffer(store, (const char *)data, size, options, result);
+    munmap(data, size);
+    return status;
+}
@@ -0,0 +1,81 @@
+#ifndef IMPORTER_H
+#define IMPORTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "store.h"
+
+// Tuning
+#define IMPORT_CHUNK_SIZE (4 << 20)
+#define IMPORT_WINDOW_PER_THREAD 4
+
+// Enums
+enum ImportFormat
+{
+    IMPORT_AUTO,
+    IMPORT_CSV,
+    IMPORT_JSON_LINES
+};
+
+/*
+Why a row was not imported. -1 and -2 are the codes of storeAddMaterial, and -3 to -6 those updateMaterial
+gives an invalid book, journal or newspaper subtype and an invalid type.
+*/
+enum ImportRowError
+{
+    IMPORT_ROW_REJECTED = -1,
+    IMPORT_ROW_NO_MEMORY = -2,
+    IMPORT_ROW_BAD_BOOK_TYPE = -3,
+    IMPORT_ROW_BAD_JOURNAL_TYPE = -4,
+    IMPORT_ROW_BAD_NEWSPAPER_TYPE = -5,
+    IMPORT_ROW_BAD_TYPE = -6,
+    IMPORT_ROW_SYNTAX = -7,
+    IMPORT_ROW_BAD_NUMBER = -8,
+    IMPORT_ROW_TOO_LONG = -9,
+    IMPORT_ROW_MISSING = -10
+};
+
+// Structs
+
+/*
+Called once for every row that was not imported, in input order, with its 1-based line number and its
+ImportRowError code.
+*/
+typedef void (*ImportErrorFn)(void *context, size_t line, int code);
+
+/*
+Settings for an import. IMPORT_AUTO treats input whose first non-blank byte is '{' as JSON Lines and anything
+else as CSV. A thread count of 0 uses every online CPU, up to STORE_BULK_MAX_THREADS, and a chunkSize of 0
+selects IMPORT_CHUNK_SIZE. onError may be NULL.
+*/
+struct ImportOptions
+{
+    enum ImportFormat format;
+    size_t threads;
+    size_t chunkSize;
+    ImportErrorFn onError;
+    void *context;
+};
+
+/*
+What an import did: the data rows seen, how many were added and how many failed, and the bytes read.
+*/
+struct ImportResult
+{
+    size_t rows;
+    size_t added;
+    size_t failed;
+    size_t bytes;
+};
+
+// Functions
+
+void importDefaultOptions(struct ImportOptions *options);
+
+const char *importErrorName(int code);
+
+int importBuffer(struct ArchiveStore *store, const char *data, size_t size, const struct ImportOptions *options, struct ImportResult *result);
+
+int importFile(struct ArchiveStore *store, const char *path, const struct ImportOptions *options, struct ImportResult *result);
+
+#endif
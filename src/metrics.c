@@ -0,0 +1,382 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "metrics.h"
+
+/*
+The counters one thread writes. Only the owning thread changes them, with a relaxed load and store instead of
+an atomic add, so counting takes no locked instruction; metricsSnapshot reads them with relaxed loads. A shard
+outlives its thread: at thread exit it is released for the next new thread to adopt, counts and all, so nothing
+counted is ever lost from the totals.
+*/
+struct MetricsShard
+{
+    struct MetricsCounters ops[METRIC_OPS];
+    struct MetricsShard *next;
+    bool inUse;
+};
+
+// the counters of a shard, walked as one flat array
+#define METRICS_WORDS (sizeof(struct MetricsSnapshot) / sizeof(uint64_t))
+
+bool metricsOn = false;
+__thread int metricsCurrent = -1;
+
+static __thread struct MetricsShard *metricsShard = NULL;
+static struct MetricsShard *metricsShards = NULL;
+static pthread_mutex_t metricsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t metricsOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t metricsKey;
+
+static const char *metricsNames[METRIC_OPS] = {"add", "add_batch", "find", "update", "remove", "filter", "filter_by_author", "search", "range", "top", "compact"};
+
+/*
+This function adds n to a counter of the calling thread's shard.
+*/
+static inline void metricsBump(uint64_t *counter, uint64_t n)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static void metricsRelease(void *shard)
+{
+    __atomic_store_n(&((struct MetricsShard *)shard)->inUse, false, __ATOMIC_RELEASE);
+}
+
+static void metricsCreateKey(void)
+{
+    pthread_key_create(&metricsKey, metricsRelease);
+}
+
+/*
+This function returns the shard of the calling thread, adopting a released one or allocating a new one on the
+thread's first operation. It returns NULL if memory could not be allocated; the operation then goes uncounted.
+*/
+static struct MetricsShard *metricsLocal(void)
+{
+    if (metricsShard != NULL)
+    {
+        return metricsShard;
+    }
+    pthread_once(&metricsOnce, metricsCreateKey);
+
+    pthread_mutex_lock(&metricsLock);
+    struct MetricsShard *shard = metricsShards;
+    while (shard != NULL && __atomic_load_n(&shard->inUse, __ATOMIC_ACQUIRE))
+    {
+        shard = shard->next;
+    }
+    if (shard == NULL)
+    {
+        shard = (struct MetricsShard *)calloc(1, sizeof(struct MetricsShard));
+        if (shard != NULL)
+        {
+            shard->next = metricsShards;
+            metricsShards = shard;
+        }
+    }
+    if (shard != NULL)
+    {
+        shard->inUse = true;
+    }
+    pthread_mutex_unlock(&metricsLock);
+
+    if (shard != NULL)
+    {
+        pthread_setspecific(metricsKey, shard);
+    }
+    metricsShard = shard;
+    return shard;
+}
+
+static uint64_t metricsNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+This function turns counting on or off for every thread. Operations already running when it changes are
+recorded according to the setting they started under.
+*/
+void metricsEnable(bool enabled)
+{
+    __atomic_store_n(&metricsOn, enabled, __ATOMIC_RELAXED);
+}
+
+/*
+This function sets every counter of every thread to zero. An operation finishing on another thread while the
+counters are cleared may keep part of its old counts; reset while the store is idle for exact figures.
+*/
+void metricsReset(void)
+{
+    pthread_mutex_lock(&metricsLock);
+    for (struct MetricsShard *shard = metricsShards; shard != NULL; shard = shard->next)
+    {
+        uint64_t *counters = (uint64_t *)shard->ops;
+        for (size_t i = 0; i < METRICS_WORDS; i++)
+        {
+            __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&metricsLock);
+}
+
+/*
+This function sums the counters of every thread into snapshot. It never stops the threads that are counting,
+so the totals of an operation can be a few calls apart from each other, but each counter only ever grows
+between two snapshots unless metricsReset is called.
+*/
+void metricsSnapshot(struct MetricsSnapshot *snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    uint64_t *totals = (uint64_t *)snapshot->ops;
+    pthread_mutex_lock(&metricsLock);
+    for (struct MetricsShard *shard = metricsShards; shard != NULL; shard = shard->next)
+    {
+        const uint64_t *counters = (const uint64_t *)shard->ops;
+        for (size_t i = 0; i < METRICS_WORDS; i++)
+        {
+            totals[i] += __atomic_load_n(&counters[i], __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&metricsLock);
+}
+
+/*
+This function returns the name of op as used by metricsExport, or "unknown".
+*/
+const char *metricsOpName(enum MetricOp op)
+{
+    return op >= 0 && op < METRIC_OPS ? metricsNames[op] : "unknown";
+}
+
+/*
+This function returns the histogram bucket that value falls into.
+*/
+size_t metricsBucket(uint64_t value)
+{
+    if (value < METRICS_SUB_BUCKETS)
+    {
+        return (size_t)value;
+    }
+    size_t exponent = 63 - (size_t)__builtin_clzll(value);
+    if (exponent > METRICS_MAX_EXPONENT)
+    {
+        return METRICS_BUCKETS - 1;
+    }
+    size_t sub = (size_t)(value >> (exponent - METRICS_SUB_BUCKET_BITS)) & (METRICS_SUB_BUCKETS - 1);
+    return (exponent - METRICS_SUB_BUCKET_BITS + 1) * METRICS_SUB_BUCKETS + sub;
+}
+
+/*
+This function returns the smallest value that falls into bucket.
+*/
+uint64_t metricsBucketLow(size_t bucket)
+{
+    if (bucket < 2 * METRICS_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    size_t exponent = bucket / METRICS_SUB_BUCKETS + METRICS_SUB_BUCKET_BITS - 1;
+    uint64_t sub = bucket % METRICS_SUB_BUCKETS;
+    return (METRICS_SUB_BUCKETS + sub) << (exponent - METRICS_SUB_BUCKET_BITS);
+}
+
+/*
+This function returns the largest value that falls into bucket; for the last bucket that is UINT64_MAX.
+*/
+uint64_t metricsBucketHigh(size_t bucket)
+{
+    return bucket + 1 >= METRICS_BUCKETS ? UINT64_MAX : metricsBucketLow(bucket + 1) - 1;
+}
+
+/*
+This function returns the value below which the given fraction of the samples in histogram lie, as the upper
+bound of the bucket holding that sample, so the answer errs high by at most the bucket width. quantile is
+clamped to [0, 1]. It returns 0 for an empty histogram.
+*/
+uint64_t metricsPercentile(const uint64_t *histogram, double quantile)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < METRICS_BUCKETS; i++)
+    {
+        total += histogram[i];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    quantile = quantile < 0 ? 0 : quantile > 1 ? 1 : quantile;
+    uint64_t rank = (uint64_t)(quantile * (double)(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < METRICS_BUCKETS; i++)
+    {
+        seen += histogram[i];
+        if (seen >= rank)
+        {
+            return metricsBucketHigh(i);
+        }
+    }
+    return metricsBucketHigh(METRICS_BUCKETS - 1);
+}
+
+/*
+This function makes op the current operation of the calling thread and notes the time. It is the slow half of
+metricsBegin and only runs while metrics are on.
+*/
+struct MetricsSpan metricsStart(enum MetricOp op)
+{
+    struct MetricsSpan span = {(int)op, metricsCurrent, metricsNow()};
+    metricsCurrent = (int)op;
+    return span;
+}
+
+/*
+This function counts the call span describes in the calling thread's shard and makes the operation it was
+nested in current again. It is the slow half of metricsEnd.
+*/
+void metricsFinish(struct MetricsSpan *span, size_t results, bool failed)
+{
+    uint64_t elapsed = metricsNow() - span->start;
+    metricsCurrent = span->previous;
+    struct MetricsShard *shard = metricsLocal();
+    if (shard == NULL)
+    {
+        return;
+    }
+    struct MetricsCounters *counters = &shard->ops[span->op];
+    metricsBump(&counters->calls, 1);
+    if (failed)
+    {
+        metricsBump(&counters->failures, 1);
+    }
+    metricsBump(&counters->results, results);
+    metricsBump(&counters->latencySum, elapsed);
+    metricsBump(&counters->latency[metricsBucket(elapsed)], 1);
+    metricsBump(&counters->sizes[metricsBucket(results)], 1);
+}
+
+void metricsAddComparisons(uint64_t n)
+{
+    struct MetricsShard *shard = metricsLocal();
+    if (shard != NULL)
+    {
+        metricsBump(&shard->ops[metricsCurrent].comparisons, n);
+    }
+}
+
+void metricsAddMoves(uint64_t n)
+{
+    struct MetricsShard *shard = metricsLocal();
+    if (shard != NULL)
+    {
+        metricsBump(&shard->ops[metricsCurrent].moves, n);
+    }
+}
+
+/*
+This function appends formatted text to buffer at *length. It returns -2 and leaves *length alone if the text
+does not fit.
+*/
+static int metricsPrint(char *buffer, size_t size, size_t *length, const char *format, ...) __attribute__((format(printf, 4, 5)));
+
+static int metricsPrint(char *buffer, size_t size, size_t *length, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer + *length, size - *length, format, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= size - *length)
+    {
+        return -2;
+    }
+    *length += (size_t)n;
+    return 0;
+}
+
+/*
+This function writes one histogram in the Prometheus text format, with a cumulative bucket line for every
+bucket that holds samples, scaled from the recorded unit to the exported one by scale.
+*/
+static int metricsPrintHistogram(char *buffer, size_t size, size_t *length, const char *name, const char *op, const uint64_t *histogram, double scale, uint64_t sum, uint64_t count)
+{
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i + 1 < METRICS_BUCKETS; i++)
+    {
+        if (histogram[i] == 0)
+        {
+            continue;
+        }
+        cumulative += histogram[i];
+        if (metricsPrint(buffer, size, length, "%s_bucket{op=\"%s\",le=\"%.9g\"} %llu\n", name, op, (double)metricsBucketHigh(i) * scale, (unsigned long long)cumulative) != 0)
+        {
+            return -2;
+        }
+    }
+    return metricsPrint(buffer, size, length, "%s_bucket{op=\"%s\",le=\"+Inf\"} %llu\n%s_sum{op=\"%s\"} %.9g\n%s_count{op=\"%s\"} %llu\n", name, op,
+                        (unsigned long long)count, name, op, (double)sum * scale, name, op, (unsigned long long)count);
+}
+
+/*
+This function writes snapshot into buffer in the Prometheus text exposition format, so it can be served from a
+scrape endpoint as is: counters named archive_<counter>_total, a latency histogram in seconds and a result
+size histogram, each labelled with the operation. Operations that were never called are left out. It returns
+0 on success, -1 if an argument is NULL and -2 if the text did not fit in size bytes.
+*/
+int metricsExport(const struct MetricsSnapshot *snapshot, char *buffer, size_t size)
+{
+    if (snapshot == NULL || buffer == NULL || size == 0)
+    {
+        return -1;
+    }
+    buffer[0] = '\0';
+    size_t length = 0;
+    static const char *counters[] = {"calls", "failures", "results", "comparisons", "moves"};
+    for (size_t c = 0; c < sizeof(counters) / sizeof(counters[0]); c++)
+    {
+        if (metricsPrint(buffer, size, &length, "# TYPE archive_%s_total counter\n", counters[c]) != 0)
+        {
+            return -2;
+        }
+        for (int op = 0; op < METRIC_OPS; op++)
+        {
+            const struct MetricsCounters *m = &snapshot->ops[op];
+            const uint64_t values[] = {m->calls, m->failures, m->results, m->comparisons, m->moves};
+            if (m->calls != 0 && metricsPrint(buffer, size, &length, "archive_%s_total{op=\"%s\"} %llu\n", counters[c], metricsNames[op], (unsigned long long)values[c]) != 0)
+            {
+                return -2;
+            }
+        }
+    }
+
+    if (metricsPrint(buffer, size, &length, "# TYPE archive_latency_seconds histogram\n") != 0)
+    {
+        return -2;
+    }
+    for (int op = 0; op < METRIC_OPS; op++)
+    {
+        const struct MetricsCounters *m = &snapshot->ops[op];
+        if (m->calls != 0 && metricsPrintHistogram(buffer, size, &length, "archive_latency_seconds", metricsNames[op], m->latency, 1e-9, m->latencySum, m->calls) != 0)
+        {
+            return -2;
+        }
+    }
+    if (metricsPrint(buffer, size, &length, "# TYPE archive_result_size histogram\n") != 0)
+    {
+        return -2;
+    }
+    for (int op = 0; op < METRIC_OPS; op++)
+    {
+        const struct MetricsCounters *m = &snapshot->ops[op];
+        if (m->calls != 0 && metricsPrintHistogram(buffer, size, &length, "archive_result_size", metricsNames[op], m->sizes, 1, m->results, m->calls) != 0)
+        {
+            return -2;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Tuning
+#define METRICS_SUB_BUCKET_BITS 4
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BUCKET_BITS)
+#define METRICS_MAX_EXPONENT 39
+#define METRICS_BUCKETS (METRICS_SUB_BUCKETS * (METRICS_MAX_EXPONENT - METRICS_SUB_BUCKET_BITS + 2))
+
+// Enums
+
+/*
+The instrumented store operations. Every call of the matching ArchiveStore function counts once, including the
+calls ConcurrentArchive and ShardedArchive make on their stores, so a concurrent write, which is applied to both
+copies, counts twice.
+*/
+enum MetricOp
+{
+    METRIC_ADD,
+    METRIC_ADD_BATCH,
+    METRIC_FIND,
+    METRIC_UPDATE,
+    METRIC_REMOVE,
+    METRIC_FILTER,
+    METRIC_FILTER_BY_AUTHOR,
+    METRIC_SEARCH,
+    METRIC_RANGE,
+    METRIC_TOP,
+    METRIC_COMPACT,
+    METRIC_OPS
+};
+
+// Structs
+
+/*
+What one operation has done. failures counts calls that returned an error or found nothing to act on, results
+the materials returned or added, comparisons the title index entries probed and moves the records relocated by
+swap removal and compaction plus the posting list entries shifted to keep the lists sorted when a slot is
+removed or relocated. latency holds the call durations in nanoseconds and sizes the result counts, both as
+log-linear histograms: values below METRICS_SUB_BUCKETS have a bucket each, and every further power of two is
+split into METRICS_SUB_BUCKETS buckets, so a bucket is never wider than 1/16 of its values. Values from
+2^(METRICS_MAX_EXPONENT + 1) up fall into the last bucket.
+*/
+struct MetricsCounters
+{
+    uint64_t calls;
+    uint64_t failures;
+    uint64_t results;
+    uint64_t comparisons;
+    uint64_t moves;
+    uint64_t latencySum;
+    uint64_t latency[METRICS_BUCKETS];
+    uint64_t sizes[METRICS_BUCKETS];
+};
+
+/*
+The counters of every operation summed over all threads, as taken by metricsSnapshot. It is about 100 KB, so
+callers should not keep it on a small stack.
+*/
+struct MetricsSnapshot
+{
+    struct MetricsCounters ops[METRIC_OPS];
+};
+
+/*
+An operation in progress on this thread, returned by metricsBegin. op is -1 when metrics were off at the start;
+previous is the operation the call is nested in, which becomes current again when this one ends.
+*/
+struct MetricsSpan
+{
+    int op;
+    int previous;
+    uint64_t start;
+};
+
+// Functions
+
+extern bool metricsOn;
+
+extern __thread int metricsCurrent;
+
+void metricsEnable(bool enabled);
+
+void metricsReset(void);
+
+void metricsSnapshot(struct MetricsSnapshot *snapshot);
+
+const char *metricsOpName(enum MetricOp op);
+
+size_t metricsBucket(uint64_t value);
+
+uint64_t metricsBucketLow(size_t bucket);
+
+uint64_t metricsBucketHigh(size_t bucket);
+
+uint64_t metricsPercentile(const uint64_t *histogram, double quantile);
+
+int metricsExport(const struct MetricsSnapshot *snapshot, char *buffer, size_t size);
+
+struct MetricsSpan metricsStart(enum MetricOp op);
+
+void metricsFinish(struct MetricsSpan *span, size_t results, bool failed);
+
+void metricsAddComparisons(uint64_t n);
+
+void metricsAddMoves(uint64_t n);
+
+/*
+This function starts timing op on the calling thread. While metrics are off it costs one load and a predictable
+branch.
+*/
+static inline struct MetricsSpan metricsBegin(enum MetricOp op)
+{
+    if (__builtin_expect(!__atomic_load_n(&metricsOn, __ATOMIC_RELAXED), 1))
+    {
+        struct MetricsSpan span = {-1, -1, 0};
+        return span;
+    }
+    return metricsStart(op);
+}
+
+/*
+This function records the end of the operation span was started for, with the number of results it produced and
+whether it failed.
+*/
+static inline void metricsEnd(struct MetricsSpan *span, size_t results, bool failed)
+{
+    if (span->op >= 0)
+    {
+        metricsFinish(span, results, failed);
+    }
+}
+
+/*
+These functions add to the comparisons and moves of the operation running on the calling thread, if any.
+*/
+static inline void metricsCompare(uint64_t n)
+{
+    if (__builtin_expect(__atomic_load_n(&metricsOn, __ATOMIC_RELAXED), 0) && metricsCurrent >= 0)
+    {
+        metricsAddComparisons(n);
+    }
+}
+
+static inline void metricsMove(uint64_t n)
+{
+    if (__builtin_expect(__atomic_load_n(&metricsOn, __ATOMIC_RELAXED), 0) && metricsCurrent >= 0)
+    {
+        metricsAddMoves(n);
+    }
+}
+
+#endif
@@ -0,0 +1,281 @@
+#include <stdlib.h>
+#include <string.h>
+#include "numberindex.h"
+
+/*
+This function orders two entries by key and then by slot.
+*/
+static int numberCompare(struct NumberEntry a, struct NumberEntry b)
+{
+    if (a.key != b.key)
+    {
+        return a.key < b.key ? -1 : 1;
+    }
+    return a.slot < b.slot ? -1 : a.slot > b.slot;
+}
+
+/*
+This function returns the position of the first of count entries that is not below entry.
+*/
+static size_t numberLowerBound(const struct NumberEntry *entries, size_t count, struct NumberEntry entry)
+{
+    size_t low = 0;
+    size_t high = count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (numberCompare(entries[middle], entry) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static bool numberRunDead(const struct NumberIndex *index, size_t pos)
+{
+    return (index->runDead[pos / 64] >> (pos % 64)) & 1;
+}
+
+/*
+This function merges the live entries of the run with the delta into a new run. It returns 0 on success and -1
+if memory could not be allocated, in which case the index is unchanged.
+*/
+static int numberIndexMerge(struct NumberIndex *index)
+{
+    size_t count = index->runCount - index->runDeadCount + index->deltaCount;
+    struct NumberEntry *run = (struct NumberEntry *)malloc((count == 0 ? 1 : count) * sizeof(struct NumberEntry));
+    uint64_t *dead = (uint64_t *)calloc(count / 64 + 1, sizeof(uint64_t));
+    if (run == NULL || dead == NULL)
+    {
+        free(run);
+        free(dead);
+        return -1;
+    }
+
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    while (i < index->runCount || j < index->deltaCount)
+    {
+        if (i < index->runCount && numberRunDead(index, i))
+        {
+            i++;
+            continue;
+        }
+        if (j == index->deltaCount || (i < index->runCount && numberCompare(index->run[i], index->delta[j]) < 0))
+        {
+            run[n++] = index->run[i++];
+        }
+        else
+        {
+            run[n++] = index->delta[j++];
+        }
+    }
+
+    free(index->run);
+    free(index->runDead);
+    index->run = run;
+    index->runCount = n;
+    index->runDead = dead;
+    index->runDeadCount = 0;
+    index->deltaCount = 0;
+    return 0;
+}
+
+/*
+This function initializes an empty index.
+*/
+void numberIndexInit(struct NumberIndex *index)
+{
+    memset(index, 0, sizeof(*index));
+}
+
+/*
+This function releases the index.
+*/
+void numberIndexFree(struct NumberIndex *index)
+{
+    if (index == NULL)
+    {
+        return;
+    }
+    free(index->run);
+    free(index->runDead);
+    free(index->delta);
+    numberIndexInit(index);
+}
+
+/*
+This function records that the material at slot holds key. It returns 0 on success and -1 if memory could not
+be allocated, in which case the index is unchanged.
+*/
+int numberIndexAdd(struct NumberIndex *index, int32_t key, uint32_t slot)
+{
+    if (index->deltaCount == index->deltaCapacity)
+    {
+        size_t capacity = index->deltaCapacity == 0 ? NUMBER_INDEX_DELTA_MIN : index->deltaCapacity * 2;
+        struct NumberEntry *delta = (struct NumberEntry *)realloc(index->delta, capacity * sizeof(struct NumberEntry));
+        if (delta == NULL)
+        {
+            return -1;
+        }
+        index->delta = delta;
+        index->deltaCapacity = capacity;
+    }
+
+    struct NumberEntry entry = {key, slot};
+    size_t pos = numberLowerBound(index->delta, index->deltaCount, entry);
+    memmove(&index->delta[pos + 1], &index->delta[pos], (index->deltaCount - pos) * sizeof(struct NumberEntry));
+    index->delta[pos] = entry;
+    index->deltaCount++;
+
+    size_t limit = NUMBER_INDEX_DELTA_MIN;
+    while (limit * limit < index->runCount)
+    {
+        limit *= 2;
+    }
+    if (index->deltaCount >= limit)
+    {
+        // on failure the delta just keeps growing until a later merge succeeds
+        numberIndexMerge(index);
+    }
+    return 0;
+}
+
+/*
+This function forgets that the material at slot holds key. It returns 0 on success and -1 if the pair is not
+indexed.
+*/
+int numberIndexRemove(struct NumberIndex *index, int32_t key, uint32_t slot)
+{
+    struct NumberEntry entry = {key, slot};
+    size_t pos = numberLowerBound(index->delta, index->deltaCount, entry);
+    if (pos < index->deltaCount && numberCompare(index->delta[pos], entry) == 0)
+    {
+        memmove(&index->delta[pos], &index->delta[pos + 1], (index->deltaCount - pos - 1) * sizeof(struct NumberEntry));
+        index->deltaCount--;
+        return 0;
+    }
+
+    pos = numberLowerBound(index->run, index->runCount, entry);
+    if (pos == index->runCount || numberCompare(index->run[pos], entry) != 0 || numberRunDead(index, pos))
+    {
+        return -1;
+    }
+    index->runDead[pos / 64] |= (uint64_t)1 << (pos % 64);
+    index->runDeadCount++;
+    if (index->runDeadCount * 4 > index->runCount)
+    {
+        numberIndexMerge(index);
+    }
+    return 0;
+}
+
+/*
+This function returns the number of entries in the index.
+*/
+size_t numberIndexCount(const struct NumberIndex *index)
+{
+    return index->runCount - index->runDeadCount + index->deltaCount;
+}
+
+/*
+This function returns an upper bound on the number of entries with keys from low to high inclusive in O(log n):
+the exact count, plus any dead run entries in the range.
+*/
+size_t numberIndexEstimate(const struct NumberIndex *index, int32_t low, int32_t high)
+{
+    struct NumberCursor cursor;
+    numberIndexSeek(index, low, high, false, &cursor);
+    return (cursor.runEnd - cursor.run) + (cursor.deltaEnd - cursor.delta);
+}
+
+/*
+This function positions cursor for a walk over the entries with keys from low to high inclusive, ascending or
+descending, at the cost of two binary searches in each part.
+*/
+void numberIndexSeek(const struct NumberIndex *index, int32_t low, int32_t high, bool descending, struct NumberCursor *cursor)
+{
+    struct NumberEntry first = {low, 0};
+    size_t runLow = numberLowerBound(index->run, index->runCount, first);
+    size_t deltaLow = numberLowerBound(index->delta, index->deltaCount, first);
+    size_t runHigh = runLow;
+    size_t deltaHigh = deltaLow;
+    if (high >= low)
+    {
+        if (high == INT32_MAX)
+        {
+            runHigh = index->runCount;
+            deltaHigh = index->deltaCount;
+        }
+        else
+        {
+            struct NumberEntry last = {high + 1, 0};
+            runHigh = numberLowerBound(index->run, index->runCount, last);
+            deltaHigh = numberLowerBound(index->delta, index->deltaCount, last);
+        }
+    }
+
+    cursor->index = index;
+    cursor->descending = descending;
+    cursor->run = descending ? runHigh : runLow;
+    cursor->delta = descending ? deltaHigh : deltaLow;
+    cursor->runEnd = descending ? runLow : runHigh;
+    cursor->deltaEnd = descending ? deltaLow : deltaHigh;
+}
+
+/*
+This function stores the next entry of the walk in entry, merging the run and the delta and skipping dead run
+entries. It returns false once the walk is over.
+*/
+bool numberIndexNext(struct NumberCursor *cursor, struct NumberEntry *entry)
+{
+    const struct NumberIndex *index = cursor->index;
+    if (!cursor->descending)
+    {
+        while (cursor->run < cursor->runEnd && numberRunDead(index, cursor->run))
+        {
+            cursor->run++;
+        }
+        bool haveRun = cursor->run < cursor->runEnd;
+        bool haveDelta = cursor->delta < cursor->deltaEnd;
+        if (!haveRun && !haveDelta)
+        {
+            return false;
+        }
+        if (haveRun && (!haveDelta || numberCompare(index->run[cursor->run], index->delta[cursor->delta]) < 0))
+        {
+            *entry = index->run[cursor->run++];
+        }
+        else
+        {
+            *entry = index->delta[cursor->delta++];
+        }
+        return true;
+    }
+
+    while (cursor->run > cursor->runEnd && numberRunDead(index, cursor->run - 1))
+    {
+        cursor->run--;
+    }
+    bool haveRun = cursor->run > cursor->runEnd;
+    bool haveDelta = cursor->delta > cursor->deltaEnd;
+    if (!haveRun && !haveDelta)
+    {
+        return false;
+    }
+    if (haveRun && (!haveDelta || numberCompare(index->run[cursor->run - 1], index->delta[cursor->delta - 1]) > 0))
+    {
+        *entry = index->run[--cursor->run];
+    }
+    else
+    {
+        *entry = index->delta[--cursor->delta];
+    }
+    return true;
+}
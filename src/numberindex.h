@@ -0,0 +1,74 @@
+#ifndef NUMBERINDEX_H
+#define NUMBERINDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Tuning
+#define NUMBER_INDEX_DELTA_MIN 1024
+
+// Structs
+
+/*
+One indexed value: a number and the slot of the material holding it. Entries are ordered by key, then slot.
+*/
+struct NumberEntry
+{
+    int32_t key;
+    uint32_t slot;
+};
+
+/*
+An ordered index from a numeric field to slots, kept as one large sorted run and a small sorted delta. Inserts
+go into the delta; a removal deletes from the delta or sets the run entry's bit in runDead.
+When the delta outgrows the larger of NUMBER_INDEX_DELTA_MIN and the square root of the run, or a quarter of
+the run is dead, the two are merged into a new run. An insert therefore costs O(sqrt n) amortized, and a range
+query a binary search in each part followed by a merge of the two.
+*/
+struct NumberIndex
+{
+    struct NumberEntry *run;
+    size_t runCount;
+    uint64_t *runDead;
+    size_t runDeadCount;
+    struct NumberEntry *delta;
+    size_t deltaCount;
+    size_t deltaCapacity;
+};
+
+/*
+A position in an ordered walk over the entries with keys in [low, high]. An ascending walk moves run and delta up
+from the first entries not below low to runEnd and deltaEnd, just past the last entries not above high; a
+descending walk starts run and delta there and moves them down to runEnd and deltaEnd, the first entries not
+below low. In both directions the next entry of a part is the one at run or delta, or just below it.
+*/
+struct NumberCursor
+{
+    const struct NumberIndex *index;
+    size_t run;
+    size_t delta;
+    size_t runEnd;
+    size_t deltaEnd;
+    bool descending;
+};
+
+// Functions
+
+void numberIndexInit(struct NumberIndex *index);
+
+void numberIndexFree(struct NumberIndex *index);
+
+int numberIndexAdd(struct NumberIndex *index, int32_t key, uint32_t slot);
+
+int numberIndexRemove(struct NumberIndex *index, int32_t key, uint32_t slot);
+
+size_t numberIndexCount(const struct NumberIndex *index);
+
+size_t numberIndexEstimate(const struct NumberIndex *index, int32_t low, int32_t high);
+
+void numberIndexSeek(const struct NumberIndex *index, int32_t low, int32_t high, bool descending, struct NumberCursor *cursor);
+
+bool numberIndexNext(struct NumberCursor *cursor, struct NumberEntry *entry);
+
+#endif
@@ -0,0 +1,419 @@
+#include "partitioned.h"
+
+#define PARTITIONED_SLOT(type, index) (((uint32_t)(type) << PARTITIONED_INDEX_BITS) | (uint32_t)(index))
+#define PARTITIONED_TYPE(slot) ((enum MaterialType)((slot) >> PARTITIONED_INDEX_BITS))
+#define PARTITIONED_INDEX(slot) ((size_t)((slot) & PARTITIONED_MAX_RECORDS))
+
+/*
+This function is the key function handed to the title index: it returns the title of the record at a slot.
+*/
+static const char *partitionedTitleKey(const void *context, uint32_t slot)
+{
+    const struct PartitionedArchive *archive = (const struct PartitionedArchive *)context;
+    size_t index = PARTITIONED_INDEX(slot);
+    switch (PARTITIONED_TYPE(slot))
+    {
+    case BOOK:
+        return archive->books.items[index].title;
+    case JOURNAL:
+        return archive->journals.items[index].title;
+    default:
+        return archive->newspapers.items[index].title;
+    }
+}
+
+/*
+These functions copy the details of one arm of union MaterialDetails into a record, leaving the title alone.
+They return -1 without touching the record if the subtype is out of range and 0 otherwise.
+*/
+static int partitionedBookPack(const union MaterialDetails *details, struct BookRecord *record)
+{
+    if (details->book.type < NOVEL || details->book.type > HISTORY)
+    {
+        return -1;
+    }
+    memcpy(record->author, details->book.author, sizeof(record->author));
+    record->pages = details->book.pages;
+    record->type = details->book.type;
+    return 0;
+}
+
+static int partitionedJournalPack(const union MaterialDetails *details, struct JournalRecord *record)
+{
+    if (details->journal.type < SCIENCE || details->journal.type > ART)
+    {
+        return -1;
+    }
+    memcpy(record->publisher, details->journal.publisher, sizeof(record->publisher));
+    record->issue = details->journal.issue;
+    record->type = details->journal.type;
+    return 0;
+}
+
+static int partitionedNewspaperPack(const union MaterialDetails *details, struct NewspaperRecord *record)
+{
+    if (details->newspaper.type < DAILY || details->newspaper.type > MONTHLY)
+    {
+        return -1;
+    }
+    memcpy(record->editor, details->newspaper.editor, sizeof(record->editor));
+    record->type = details->newspaper.type;
+    return 0;
+}
+
+/*
+These functions write a record back out as a struct Material.
+*/
+static void partitionedBookExpand(const struct BookRecord *record, struct Material *material)
+{
+    memset(material, 0, sizeof(*material));
+    memcpy(material->title, record->title, sizeof(material->title));
+    material->type = BOOK;
+    memcpy(material->details.book.author, record->author, sizeof(record->author));
+    material->details.book.pages = record->pages;
+    material->details.book.type = record->type;
+}
+
+static void partitionedJournalExpand(const struct JournalRecord *record, struct Material *material)
+{
+    memset(material, 0, sizeof(*material));
+    memcpy(material->title, record->title, sizeof(material->title));
+    material->type = JOURNAL;
+    memcpy(material->details.journal.publisher, record->publisher, sizeof(record->publisher));
+    material->details.journal.issue = record->issue;
+    material->details.journal.type = record->type;
+}
+
+static void partitionedNewspaperExpand(const struct NewspaperRecord *record, struct Material *material)
+{
+    memset(material, 0, sizeof(*material));
+    memcpy(material->title, record->title, sizeof(material->title));
+    material->type = NEWSPAPER;
+    memcpy(material->details.newspaper.editor, record->editor, sizeof(record->editor));
+    material->details.newspaper.type = record->type;
+}
+
+/*
+Generates the operations on one partition, given the prefix of its Pack and Expand functions, its record type,
+the member of PartitionedArchive holding it, its MaterialType and the name of its contributor field. Each
+generated function works on records of that one type only, so its loops have no type test:
+
+Add appends a material, returning -1 for a bad subtype or a full partition and -2 if memory ran out.
+Update replaces the details of the record at index, returning -3, -4 or -5 for a bad subtype as
+storeUpdateMaterial does.
+Remove deletes the record at index by moving the last record into its place.
+Filter expands up to capacity records into results and returns the size of the partition.
+ByAuthor expands the records whose contributor is author into results from position total on, and returns the
+new total.
+*/
+#define PARTITIONED_KERNELS(Name, Record, member, TYPE, contributor)                                                                    \
+    static int partitioned##Name##Add(struct PartitionedArchive *archive, const struct Material *material, uint32_t hash)             \
+    {                                                                                                                                   \
+        struct Record##s *array = &archive->member;                                                                                     \
+        struct Record record;                                                                                                           \
+        memset(&record, 0, sizeof(record));                                                                                             \
+        memcpy(record.title, material->title, sizeof(record.title));                                                                    \
+        if (partitioned##Name##Pack(&material->details, &record) != 0 || array->count >= PARTITIONED_MAX_RECORDS)                      \
+        {                                                                                                                               \
+            return -1;                                                                                                                  \
+        }                                                                                                                               \
+        if (array->count == array->capacity)                                                                                            \
+        {                                                                                                                               \
+            size_t capacity = array->capacity == 0 ? 64 : array->capacity * 2;                                                          \
+            struct Record *items = (struct Record *)realloc(array->items, capacity * sizeof(struct Record));                            \
+            if (items == NULL)                                                                                                          \
+            {                                                                                                                           \
+                return -2;                                                                                                              \
+            }                                                                                                                           \
+            array->items = items;                                                                                                       \
+            array->capacity = capacity;                                                                                                 \
+        }                                                                                                                               \
+        if (titleIndexInsert(&archive->titles, hash, PARTITIONED_SLOT(TYPE, array->count)) != 0)                                       \
+        {                                                                                                                               \
+            return -2;                                                                                                                  \
+        }                                                                                                                               \
+        array->items[array->count++] = record;                                                                                          \
+        return 0;                                                                                                                       \
+    }                                                                                                                                   \
+                                                                                                                                        \
+    static int partitioned##Name##Update(struct PartitionedArchive *archive, size_t index, const union MaterialDetails *details)     \
+    {                                                                                                                                   \
+        return partitioned##Name##Pack(details, &archive->member.items[index]) == 0 ? 0 : -3 - (int)(TYPE);                           \
+    }                                                                                                                                   \
+                                                                                                                                        \
+    static void partitioned##Name##Remove(struct PartitionedArchive *archive, size_t index, uint32_t hash)                           \
+    {                                                                                                                                   \
+        struct Record##s *array = &archive->member;                                                                                     \
+        titleIndexRemove(&archive->titles, hash, PARTITIONED_SLOT(TYPE, index));                                                        \
+        size_t last = --array->count;                                                                                                   \
+        if (index != last)                                                                                                              \
+        {                                                                                                                               \
+            titleIndexRelocate(&archive->titles, titleHash(array->items[last].title), PARTITIONED_SLOT(TYPE, last),                     \
+                               PARTITIONED_SLOT(TYPE, index));                                                                          \
+            array->items[index] = array->items[last];                                                                                   \
+        }                                                                                                                               \
+    }                                                                                                                                   \
+                                                                                                                                        \
+    static size_t partitioned##Name##Filter(const struct PartitionedArchive *archive, struct Material *results, size_t capacity)     \
+    {                                                                                                                                   \
+        const struct Record##s *array = &archive->member;                                                                               \
+        for (size_t i = 0; i < array->count && i < capacity; i++)                                                                       \
+        {                                                                                                                               \
+            partitioned##Name##Expand(&array->items[i], &results[i]);                                                                   \
+        }                                                                                                                               \
+        return array->count;                                                                                                            \
+    }                                                                                                                                   \
+                                                                                                                                        \
+    static size_t partitioned##Name##ByAuthor(const struct PartitionedArchive *archive, const char *author, struct Material *results, \
+                                              size_t capacity, size_t total)                                                            \
+    {                                                                                                                                   \
+        const struct Record##s *array = &archive->member;                                                                               \
+        for (size_t i = 0; i < array->count; i++)                                                                                       \
+        {                                                                                                                               \
+            if (strcmp(array->items[i].contributor, author) == 0)                                                                       \
+            {                                                                                                                           \
+                if (total < capacity)                                                                                                   \
+                {                                                                                                                       \
+                    partitioned##Name##Expand(&array->items[i], &results[total]);                                                       \
+                }                                                                                                                       \
+                total++;                                                                                                                \
+            }                                                                                                                           \
+        }                                                                                                                               \
+        return total;                                                                                                                   \
+    }
+
+PARTITIONED_KERNELS(Book, BookRecord, books, BOOK, author)
+PARTITIONED_KERNELS(Journal, JournalRecord, journals, JOURNAL, publisher)
+PARTITIONED_KERNELS(Newspaper, NewspaperRecord, newspapers, NEWSPAPER, editor)
+
+/*
+This function returns the slot of the record with the given title, or TITLE_INDEX_NONE, and stores the hash
+of the title in hash.
+*/
+static uint32_t partitionedLookup(const struct PartitionedArchive *archive, const char *title, uint32_t *hash)
+{
+    *hash = titleHash(title);
+    return titleIndexFind(&archive->titles, *hash, title, partitionedTitleKey, archive);
+}
+
+/*
+This function initializes an empty archive.
+*/
+void partitionedInit(struct PartitionedArchive *archive)
+{
+    memset(archive, 0, sizeof(*archive));
+    titleIndexInit(&archive->titles);
+}
+
+/*
+This function releases the three partitions and the title index.
+*/
+void partitionedFree(struct PartitionedArchive *archive)
+{
+    if (archive == NULL)
+    {
+        return;
+    }
+    free(archive->books.items);
+    free(archive->journals.items);
+    free(archive->newspapers.items);
+    titleIndexFree(&archive->titles);
+    partitionedInit(archive);
+}
+
+/*
+This function appends a material to the partition of its type. The error codes follow compactAddMaterial: -1
+for a NULL argument, a title that is already present or a type or subtype out of range, -2 if memory could not
+be allocated. It returns 0 on success.
+*/
+int partitionedAddMaterial(struct PartitionedArchive *archive, const struct Material *material)
+{
+    uint32_t hash;
+    if (archive == NULL || material == NULL || partitionedLookup(archive, material->title, &hash) != TITLE_INDEX_NONE)
+    {
+        return -1;
+    }
+    switch (material->type)
+    {
+    case BOOK:
+        return partitionedBookAdd(archive, material, hash);
+    case JOURNAL:
+        return partitionedJournalAdd(archive, material, hash);
+    case NEWSPAPER:
+        return partitionedNewspaperAdd(archive, material, hash);
+    default:
+        return -1;
+    }
+}
+
+/*
+This function writes the material with the given title into material. It returns 0 if the title was found and
+-1 otherwise.
+*/
+int partitionedFindMaterial(const struct PartitionedArchive *archive, const char *title, struct Material *material)
+{
+    uint32_t hash;
+    if (archive == NULL || title == NULL)
+    {
+        return -1;
+    }
+    uint32_t slot = partitionedLookup(archive, title, &hash);
+    if (slot == TITLE_INDEX_NONE)
+    {
+        return -1;
+    }
+    size_t index = PARTITIONED_INDEX(slot);
+    switch (PARTITIONED_TYPE(slot))
+    {
+    case BOOK:
+        partitionedBookExpand(&archive->books.items[index], material);
+        break;
+    case JOURNAL:
+        partitionedJournalExpand(&archive->journals.items[index], material);
+        break;
+    default:
+        partitionedNewspaperExpand(&archive->newspapers.items[index], material);
+        break;
+    }
+    return 0;
+}
+
+/*
+This function replaces the details of the material with the given title, reading them from the arm of details
+that matches the stored type. The error codes match storeUpdateMaterial: -1 for a NULL argument, -2 if the
+title is not found and -3, -4 and -5 for an invalid book, journal or newspaper subtype. It returns 0 on success.
+*/
+int partitionedUpdateMaterial(struct PartitionedArchive *archive, const char *title, union MaterialDetails details)
+{
+    uint32_t hash;
+    if (archive == NULL || title == NULL)
+    {
+        return -1;
+    }
+    uint32_t slot = partitionedLookup(archive, title, &hash);
+    if (slot == TITLE_INDEX_NONE)
+    {
+        return -2;
+    }
+    switch (PARTITIONED_TYPE(slot))
+    {
+    case BOOK:
+        return partitionedBookUpdate(archive, PARTITIONED_INDEX(slot), &details);
+    case JOURNAL:
+        return partitionedJournalUpdate(archive, PARTITIONED_INDEX(slot), &details);
+    default:
+        return partitionedNewspaperUpdate(archive, PARTITIONED_INDEX(slot), &details);
+    }
+}
+
+/*
+This function removes the material with the given title, moving the last record of the same type into its
+place. It returns 0 on success and -1 if the title is not found.
+*/
+int partitionedRemoveMaterial(struct PartitionedArchive *archive, const char *title)
+{
+    uint32_t hash;
+    if (archive == NULL || title == NULL)
+    {
+        return -1;
+    }
+    uint32_t slot = partitionedLookup(archive, title, &hash);
+    if (slot == TITLE_INDEX_NONE)
+    {
+        return -1;
+    }
+    switch (PARTITIONED_TYPE(slot))
+    {
+    case BOOK:
+        partitionedBookRemove(archive, PARTITIONED_INDEX(slot), hash);
+        break;
+    case JOURNAL:
+        partitionedJournalRemove(archive, PARTITIONED_INDEX(slot), hash);
+        break;
+    default:
+        partitionedNewspaperRemove(archive, PARTITIONED_INDEX(slot), hash);
+        break;
+    }
+    return 0;
+}
+
+/*
+These functions return the records of one type as a contiguous slice and store its length in count. This is
+the filter by type of this archive: nothing is copied or tested. The slice is valid until the next add or
+remove.
+*/
+const struct BookRecord *partitionedBooks(const struct PartitionedArchive *archive, size_t *count)
+{
+    *count = archive->books.count;
+    return archive->books.items;
+}
+
+const struct JournalRecord *partitionedJournals(const struct PartitionedArchive *archive, size_t *count)
+{
+    *count = archive->journals.count;
+    return archive->journals.items;
+}
+
+const struct NewspaperRecord *partitionedNewspapers(const struct PartitionedArchive *archive, size_t *count)
+{
+    *count = archive->newspapers.count;
+    return archive->newspapers.items;
+}
+
+/*
+This function returns the number of materials in the archive.
+*/
+size_t partitionedCount(const struct PartitionedArchive *archive)
+{
+    return archive->books.count + archive->journals.count + archive->newspapers.count;
+}
+
+/*
+This function writes up to capacity materials of the given type into results, in record order, for callers
+that need struct Materials rather than a slice. results may be NULL with a capacity of 0 to only count. It
+returns the total number of matches, or 0 for an invalid type.
+*/
+size_t partitionedFilterMaterials(const struct PartitionedArchive *archive, enum MaterialType type, struct Material *results, size_t capacity)
+{
+    if (archive == NULL)
+    {
+        return 0;
+    }
+    switch (type)
+    {
+    case BOOK:
+        return partitionedBookFilter(archive, results, capacity);
+    case JOURNAL:
+        return partitionedJournalFilter(archive, results, capacity);
+    case NEWSPAPER:
+        return partitionedNewspaperFilter(archive, results, capacity);
+    default:
+        return 0;
+    }
+}
+
+/*
+This function writes up to capacity materials whose contributor is author into results: the matching books in
+record order, then the journals, then the newspapers. Each partition is scanned by its own loop comparing one
+fixed field. It returns the total number of matches.
+*/
+size_t partitionedFilterMaterialsByAuthor(const struct PartitionedArchive *archive, const char *author, struct Material *results, size_t capacity)
+{
+    if (archive == NULL || author == NULL)
+    {
+        return 0;
+    }
+    size_t total = partitionedBookByAuthor(archive, author, results, capacity, 0);
+    total = partitionedJournalByAuthor(archive, author, results, capacity, total);
+    return partitionedNewspaperByAuthor(archive, author, results, capacity, total);
+}
+
+/*
+This function returns the bytes allocated by the archive, the three partitions and the title index included.
+*/
+size_t partitionedMemory(const struct PartitionedArchive *archive)
+{
+    size_t titles = archive->titles.entries == NULL ? 0 : (archive->titles.mask + 1) * sizeof(struct TitleIndexEntry);
+    return archive->books.capacity * sizeof(struct BookRecord) + archive->journals.capacity * sizeof(struct JournalRecord) +
+           archive->newspapers.capacity * sizeof(struct NewspaperRecord) + titles;
+}
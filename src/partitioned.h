@@ -0,0 +1,100 @@
+#ifndef PARTITIONED_H
+#define PARTITIONED_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bitmap.h"
+#include "titleindex.h"
+
+// Limits
+#define PARTITIONED_INDEX_BITS 30
+#define PARTITIONED_MAX_RECORDS ((1u << PARTITIONED_INDEX_BITS) - 1)
+
+// Structs
+
+/*
+The records of the three partitions hold exactly the fields of their arm of union MaterialDetails next to the
+title, so a newspaper has no page count and no record is padded to the largest arm.
+*/
+struct BookRecord
+{
+    char title[50];
+    char author[50];
+    int pages;
+    enum BookType type;
+};
+
+struct JournalRecord
+{
+    char title[50];
+    char publisher[50];
+    int issue;
+    enum JournalType type;
+};
+
+struct NewspaperRecord
+{
+    char title[50];
+    char editor[50];
+    enum NewspaperType type;
+};
+
+/*
+A dense, growable array of the records of one type.
+*/
+#define PARTITIONED_ARRAY(Record) \
+    struct Record##s              \
+    {                             \
+        struct Record *items;     \
+        size_t count;             \
+        size_t capacity;          \
+    }
+
+PARTITIONED_ARRAY(BookRecord);
+PARTITIONED_ARRAY(JournalRecord);
+PARTITIONED_ARRAY(NewspaperRecord);
+
+/*
+An archive that keeps books, journals and newspapers in separate dense arrays of their own record types, so the
+materials of one type are a contiguous slice and an operation decides on the type once instead of once per
+record. titles maps every title to its record; a slot holds the type in its top two bits and the position in
+the type's array in the other PARTITIONED_INDEX_BITS. Removing a record moves the last one of its type into its
+place, so the order within a type changes on removal.
+*/
+struct PartitionedArchive
+{
+    struct BookRecords books;
+    struct JournalRecords journals;
+    struct NewspaperRecords newspapers;
+    struct TitleIndex titles;
+};
+
+// Functions
+
+void partitionedInit(struct PartitionedArchive *archive);
+
+void partitionedFree(struct PartitionedArchive *archive);
+
+int partitionedAddMaterial(struct PartitionedArchive *archive, const struct Material *material);
+
+int partitionedFindMaterial(const struct PartitionedArchive *archive, const char *title, struct Material *material);
+
+int partitionedUpdateMaterial(struct PartitionedArchive *archive, const char *title, union MaterialDetails details);
+
+int partitionedRemoveMaterial(struct PartitionedArchive *archive, const char *title);
+
+const struct BookRecord *partitionedBooks(const struct PartitionedArchive *archive, size_t *count);
+
+const struct JournalRecord *partitionedJournals(const struct PartitionedArchive *archive, size_t *count);
+
+const struct NewspaperRecord *partitionedNewspapers(const struct PartitionedArchive *archive, size_t *count);
+
+size_t partitionedCount(const struct PartitionedArchive *archive);
+
+size_t partitionedFilterMaterials(const struct PartitionedArchive *archive, enum MaterialType type, struct Material *results, size_t capacity);
+
+size_t partitionedFilterMaterialsByAuthor(const struct PartitionedArchive *archive, const char *author, struct Material *results, size_t capacity);
+
+size_t partitionedMemory(const struct PartitionedArchive *archive);
+
+#endif
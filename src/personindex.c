@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <string.h>
+#include "metrics.h"
+#include "personindex.h"
+#include "titleindex.h"
+
+/*
+This function returns the bucket holding name, or the empty bucket where it would be inserted. The table must
+have at least one empty bucket.
+*/
+static struct PersonPostings *personIndexProbe(const struct PersonIndex *index, const char *name, uint32_t hash)
+{
+    size_t pos = hash & index->mask;
+    while (index->buckets[pos].name != NULL)
+    {
+        struct PersonPostings *postings = &index->buckets[pos];
+        if (postings->hash == hash && strcmp(postings->name, name) == 0)
+        {
+            return postings;
+        }
+        pos = (pos + 1) & index->mask;
+    }
+    return &index->buckets[pos];
+}
+
+/*
+This function doubles the bucket array once it is half full, moving the posting lists without copying them.
+It returns 0 on success and -1 if the allocation fails.
+*/
+static int personIndexGrow(struct PersonIndex *index)
+{
+    size_t buckets = index->buckets == NULL ? 0 : index->mask + 1;
+    if ((index->size + 1) * 2 <= buckets)
+    {
+        return 0;
+    }
+
+    size_t newBuckets = buckets == 0 ? 16 : buckets * 2;
+    struct PersonPostings *table = (struct PersonPostings *)calloc(newBuckets, sizeof(struct PersonPostings));
+    if (table == NULL)
+    {
+        return -1;
+    }
+
+    size_t mask = newBuckets - 1;
+    for (size_t i = 0; i < buckets; i++)
+    {
+        if (index->buckets[i].name == NULL)
+        {
+            continue;
+        }
+        size_t pos = index->buckets[i].hash & mask;
+        while (table[pos].name != NULL)
+        {
+            pos = (pos + 1) & mask;
+        }
+        table[pos] = index->buckets[i];
+    }
+
+    free(index->buckets);
+    index->buckets = table;
+    index->mask = mask;
+    return 0;
+}
+
+/*
+This function binary searches a posting list for slot and returns its position, or the position where it
+would be inserted.
+*/
+static size_t personPostingsSearch(const struct PersonPostings *postings, uint32_t slot)
+{
+    size_t low = 0;
+    size_t high = postings->count;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (postings->slots[mid] < slot)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/*
+This function initializes an empty index. The bucket array is allocated on the first insert.
+*/
+void personIndexInit(struct PersonIndex *index)
+{
+    index->buckets = NULL;
+    index->mask = 0;
+    index->size = 0;
+    index->active = 0;
+}
+
+/*
+This function releases every name, posting list and the bucket array, leaving the index empty.
+*/
+void personIndexFree(struct PersonIndex *index)
+{
+    if (index->buckets != NULL)
+    {
+        for (size_t i = 0; i <= index->mask; i++)
+        {
+            free(index->buckets[i].name);
+            free(index->buckets[i].slots);
+        }
+    }
+    free(index->buckets);
+    personIndexInit(index);
+}
+
+/*
+This function returns the posting list for name, or NULL if no material has ever named that contributor. The
+comparison is case-sensitive. The returned list is owned by the index and valid until the next mutation.
+*/
+const struct PersonPostings *personIndexFind(const struct PersonIndex *index, const char *name)
+{
+    if (index->buckets == NULL)
+    {
+        return NULL;
+    }
+
+    struct PersonPostings *postings = personIndexProbe(index, name, titleHash(name));
+    return postings->name == NULL ? NULL : postings;
+}
+
+/*
+This function adds slot to the posting list of name, creating the list if needed. Slots normally arrive in
+increasing order and are appended; an out-of-order slot is inserted at its sorted position. It returns 0 on
+success and -1 if memory could not be allocated.
+*/
+int personIndexAdd(struct PersonIndex *index, const char *name, uint32_t slot)
+{
+    if (personIndexGrow(index) != 0)
+    {
+        return -1;
+    }
+
+    uint32_t hash = titleHash(name);
+    struct PersonPostings *postings = personIndexProbe(index, name, hash);
+    if (postings->name == NULL)
+    {
+        size_t length = strlen(name) + 1;
+        char *copy = (char *)malloc(length);
+        if (copy == NULL)
+        {
+            return -1;
+        }
+        memcpy(copy, name, length);
+        postings->name = copy;
+        postings->hash = hash;
+        index->size++;
+    }
+
+    if (postings->count == postings->capacity)
+    {
+        size_t capacity = postings->capacity == 0 ? 4 : postings->capacity * 2;
+        uint32_t *slots = (uint32_t *)realloc(postings->slots, capacity * sizeof(uint32_t));
+        if (slots == NULL)
+        {
+            return -1;
+        }
+        postings->slots = slots;
+        postings->capacity = capacity;
+    }
+
+    size_t pos = postings->count;
+    while (pos > 0 && postings->slots[pos - 1] > slot)
+    {
+        postings->slots[pos] = postings->slots[pos - 1];
+        pos--;
+    }
+    postings->slots[pos] = slot;
+    if (postings->count++ == 0)
+    {
+        index->active++;
+    }
+    return 0;
+}
+
+/*
+This function removes slot from the posting list of name using a binary search. The later slots are shifted
+down to keep the list sorted, so it takes time proportional to the length of the list. It returns 0 if the
+slot was removed and -1 if it was not listed under that name.
+*/
+int personIndexRemove(struct PersonIndex *index, const char *name, uint32_t slot)
+{
+    if (index->buckets == NULL)
+    {
+        return -1;
+    }
+
+    struct PersonPostings *postings = personIndexProbe(index, name, titleHash(name));
+    if (postings->name == NULL)
+    {
+        return -1;
+    }
+
+    size_t low = personPostingsSearch(postings, slot);
+    if (low == postings->count || postings->slots[low] != slot)
+    {
+        return -1;
+    }
+
+    size_t shifted = postings->count - low - 1;
+    memmove(&postings->slots[low], &postings->slots[low + 1], shifted * sizeof(uint32_t));
+    metricsMove(shifted);
+    if (--postings->count == 0)
+    {
+        index->active--;
+    }
+    return 0;
+}
+
+/*
+This function records that a material of name has moved from oldSlot to newSlot. The entry is rewritten in
+place and slid to its sorted position, which is where it already is when no other slot of the same contributor
+lies between the two, as during an order-preserving compaction. It returns 0 on success and -1 if oldSlot was
+not listed under that name.
+*/
+int personIndexRelocate(struct PersonIndex *index, const char *name, uint32_t oldSlot, uint32_t newSlot)
+{
+    if (index->buckets == NULL)
+    {
+        return -1;
+    }
+
+    struct PersonPostings *postings = personIndexProbe(index, name, titleHash(name));
+    if (postings->name == NULL)
+    {
+        return -1;
+    }
+
+    size_t pos = personPostingsSearch(postings, oldSlot);
+    if (pos == postings->count || postings->slots[pos] != oldSlot)
+    {
+        return -1;
+    }
+
+    size_t start = pos;
+    while (pos > 0 && postings->slots[pos - 1] > newSlot)
+    {
+        postings->slots[pos] = postings->slots[pos - 1];
+        pos--;
+    }
+    while (pos + 1 < postings->count && postings->slots[pos + 1] < newSlot)
+    {
+        postings->slots[pos] = postings->slots[pos + 1];
+        pos++;
+    }
+    postings->slots[pos] = newSlot;
+    metricsMove(pos > start ? pos - start : start - pos);
+    return 0;
+}
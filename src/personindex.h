@@ -0,0 +1,49 @@
+#ifndef PERSONINDEX_H
+#define PERSONINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Structs
+
+/*
+The posting list of one contributor: the slots of every material naming them, in ascending order.
+*/
+struct PersonPostings
+{
+    char *name;
+    uint32_t hash;
+    uint32_t *slots;
+    size_t count;
+    size_t capacity;
+};
+
+/*
+An inverted index from contributor name (book author, journal publisher or newspaper editor) to the slots
+that name them. Names are hashed into an open-addressing table of posting lists. A contributor whose
+materials have all been removed keeps an empty posting list, so re-adding them does not reallocate. size counts
+every list and active only the non-empty ones.
+*/
+struct PersonIndex
+{
+    struct PersonPostings *buckets;
+    size_t mask;
+    size_t size;
+    size_t active;
+};
+
+// Functions
+
+void personIndexInit(struct PersonIndex *index);
+
+void personIndexFree(struct PersonIndex *index);
+
+const struct PersonPostings *personIndexFind(const struct PersonIndex *index, const char *name);
+
+int personIndexAdd(struct PersonIndex *index, const char *name, uint32_t slot);
+
+int personIndexRemove(struct PersonIndex *index, const char *name, uint32_t slot);
+
+int personIndexRelocate(struct PersonIndex *index, const char *name, uint32_t oldSlot, uint32_t newSlot);
+
+#endif
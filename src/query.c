@@ -0,0 +1,609 @@
+#include "query.h"
+
+static const char *queryPathNames[] = {"bitmap", "postings", "title search", "number index", "column scan",
+                                       "scan", "intersect", "probe", "union", "filter"};
+static const char *queryTypeNames[] = {"BOOK", "JOURNAL", "NEWSPAPER"};
+
+/*
+This function appends a node with the given op and makes it the root. It returns the node, or NULL and marks the
+query invalid if the query is full.
+*/
+static struct QueryNode *queryAppend(struct Query *query, enum QueryOp op)
+{
+    if (query->count == QUERY_MAX_NODES)
+    {
+        query->invalid = true;
+        return NULL;
+    }
+    struct QueryNode *node = &query->nodes[query->count];
+    memset(node, 0, sizeof(*node));
+    node->op = op;
+    node->left = -1;
+    node->right = -1;
+    query->root = query->count++;
+    return node;
+}
+
+/*
+This function marks the query invalid and returns -1, for builders given a bad argument.
+*/
+static int queryReject(struct Query *query)
+{
+    query->invalid = true;
+    return -1;
+}
+
+/*
+This function initializes an empty query. A query must have at least one node before it can be run.
+*/
+void queryInit(struct Query *query)
+{
+    query->count = 0;
+    query->root = -1;
+    query->invalid = false;
+}
+
+/*
+This function adds a predicate matching the materials of the given type.
+*/
+int queryType(struct Query *query, enum MaterialType type)
+{
+    if (type < BOOK || type > NEWSPAPER)
+    {
+        return queryReject(query);
+    }
+    struct QueryNode *node = queryAppend(query, QUERY_TYPE);
+    if (node == NULL)
+    {
+        return -1;
+    }
+    node->type = type;
+    return query->root;
+}
+
+/*
+This function adds a predicate matching the materials of the given type and subtype, for example a BOOK that is
+a NOVEL.
+*/
+int querySubtype(struct Query *query, enum MaterialType type, int subtype)
+{
+    if (type < BOOK || type > NEWSPAPER || subtype < 0 || subtype >= STORE_SUBTYPES)
+    {
+        return queryReject(query);
+    }
+    struct QueryNode *node = queryAppend(query, QUERY_SUBTYPE);
+    if (node == NULL)
+    {
+        return -1;
+    }
+    node->type = type;
+    node->subtype = subtype;
+    return query->root;
+}
+
+/*
+This function adds a predicate matching the materials whose author, publisher or editor is contributor.
+*/
+int queryContributor(struct Query *query, const char *contributor)
+{
+    if (contributor == NULL || strlen(contributor) >= QUERY_TEXT_MAX)
+    {
+        return queryReject(query);
+    }
+    struct QueryNode *node = queryAppend(query, QUERY_CONTRIBUTOR);
+    if (node == NULL)
+    {
+        return -1;
+    }
+    strcpy(node->text, contributor);
+    return query->root;
+}
+
+/*
+This function adds a predicate matching the materials whose title starts with prefix, compared byte by byte.
+*/
+int queryPrefix(struct Query *query, const char *prefix)
+{
+    if (prefix == NULL || strlen(prefix) >= QUERY_TEXT_MAX)
+    {
+        return queryReject(query);
+    }
+    struct QueryNode *node = queryAppend(query, QUERY_PREFIX);
+    if (node == NULL)
+    {
+        return -1;
+    }
+    strcpy(node->text, prefix);
+    return query->root;
+}
+
+/*
+This function adds a predicate matching the books with low to high pages, or the journals with an issue from
+low to high, inclusive.
+*/
+int queryRange(struct Query *query, enum MaterialType type, int32_t low, int32_t high)
+{
+    if (type != BOOK && type != JOURNAL)
+    {
+        return queryReject(query);
+    }
+    struct QueryNode *node = queryAppend(query, QUERY_RANGE);
+    if (node == NULL)
+    {
+        return -1;
+    }
+    node->type = type;
+    node->low = low;
+    node->high = high;
+    return query->root;
+}
+
+/*
+This function adds a connective with the given op over two existing nodes.
+*/
+static int queryConnect(struct Query *query, enum QueryOp op, int left, int right)
+{
+    if (left < 0 || left >= query->count || right < 0 || right >= query->count)
+    {
+        return queryReject(query);
+    }
+    struct QueryNode *node = queryAppend(query, op);
+    if (node == NULL)
+    {
+        return -1;
+    }
+    node->left = left;
+    node->right = right;
+    return query->root;
+}
+
+/*
+This function adds a node matching the materials matched by both left and right.
+*/
+int queryAnd(struct Query *query, int left, int right)
+{
+    return queryConnect(query, QUERY_AND, left, right);
+}
+
+/*
+This function adds a node matching the materials matched by left, right or both.
+*/
+int queryOr(struct Query *query, int left, int right)
+{
+    return queryConnect(query, QUERY_OR, left, right);
+}
+
+/*
+This function returns the pages of a book or the issue of a journal.
+*/
+static int32_t queryNumber(const struct Material *material)
+{
+    return material->type == BOOK ? material->details.book.pages : material->details.journal.issue;
+}
+
+/*
+This function tests the live material at slot against the subtree rooted at node.
+*/
+static bool queryMatches(const struct ArchiveStore *store, const struct Query *query, int node, uint32_t slot)
+{
+    const struct QueryNode *n = &query->nodes[node];
+    const struct Material *material = storeAt(store, slot);
+    const char *contributor;
+    int32_t number;
+    switch (n->op)
+    {
+    case QUERY_TYPE:
+        return material->type == n->type;
+    case QUERY_SUBTYPE:
+        return material->type == n->type && materialSubtype(material) == n->subtype;
+    case QUERY_CONTRIBUTOR:
+        contributor = materialContributor(material);
+        return contributor != NULL && strcmp(contributor, n->text) == 0;
+    case QUERY_PREFIX:
+        return strncmp(material->title, n->text, strlen(n->text)) == 0;
+    case QUERY_RANGE:
+        number = queryNumber(material);
+        return material->type == n->type && number >= n->low && number <= n->high;
+    case QUERY_AND:
+        return queryMatches(store, query, n->left, slot) && queryMatches(store, query, n->right, slot);
+    case QUERY_OR:
+        return queryMatches(store, query, n->left, slot) || queryMatches(store, query, n->right, slot);
+    }
+    return false;
+}
+
+/*
+This function marks every node of a subtree as tested slot by slot.
+*/
+static void queryMarkFilter(struct Query *query, int node)
+{
+    struct QueryNode *n = &query->nodes[node];
+    n->path = QUERY_PATH_FILTER;
+    n->cost = 0;
+    if (n->op == QUERY_AND || n->op == QUERY_OR)
+    {
+        queryMarkFilter(query, n->left);
+        queryMarkFilter(query, n->right);
+    }
+}
+
+/*
+This function chooses the access path of a leaf and estimates its matches. Indexed paths cost about one unit per
+match, bitmaps less because they are combined a word at a time; a row scan costs one unit per slot and a column
+scan a fraction of that. Without a count in the title search, a prefix is assumed to keep one title in
+2^QUERY_PREFIX_SHIFT per byte.
+*/
+static void queryPlanLeaf(const struct ArchiveStore *store, struct QueryNode *n)
+{
+    size_t scan = store->slots + 1;
+    size_t length;
+    size_t count;
+    switch (n->op)
+    {
+    case QUERY_TYPE:
+        n->path = QUERY_PATH_BITMAP;
+        n->estimate = slotBitmapCardinality(&store->typeSlots[n->type]);
+        n->cost = n->estimate / QUERY_BITMAP_DIVISOR + 1;
+        return;
+    case QUERY_SUBTYPE:
+        n->path = QUERY_PATH_BITMAP;
+        n->estimate = slotBitmapCardinality(&store->subtypeSlots[n->type][n->subtype]);
+        n->cost = n->estimate / QUERY_BITMAP_DIVISOR + 1;
+        return;
+    case QUERY_CONTRIBUTOR:
+        storeContributorSlots(store, n->text, &count);
+        n->path = QUERY_PATH_POSTINGS;
+        n->estimate = count;
+        n->cost = count + 1;
+        return;
+    case QUERY_PREFIX:
+        length = strlen(n->text) * QUERY_PREFIX_SHIFT;
+        n->estimate = length >= 8 * sizeof(size_t) ? 1 : (store->count >> length) + 1;
+        n->path = store->searchable ? QUERY_PATH_TITLE_SEARCH : QUERY_PATH_SCAN;
+        n->cost = store->searchable ? n->estimate + 1 : scan;
+        return;
+    case QUERY_RANGE:
+        if (store->ordered)
+        {
+            n->path = QUERY_PATH_NUMBER_INDEX;
+            n->estimate = numberIndexEstimate(&store->numbers[n->type], n->low, n->high);
+            n->cost = n->estimate + 1;
+            return;
+        }
+        n->estimate = n->low <= n->high ? slotBitmapCardinality(&store->typeSlots[n->type]) : 0;
+        n->path = store->columnar ? QUERY_PATH_COLUMN_SCAN : QUERY_PATH_SCAN;
+        n->cost = store->columnar ? scan / QUERY_COLUMN_DIVISOR + 1 : scan;
+        return;
+    default:
+        return;
+    }
+}
+
+/*
+This function plans the subtree rooted at node bottom-up. An AND weighs intersecting both children against
+probing the records of the cheaper child's matches with the other child, and swaps the children so that the one
+evaluated first is on the left. An OR unions its children unless one of them needs a row scan anyway. Either
+falls back to a single row scan testing the whole subtree when nothing cheaper exists.
+*/
+static void queryPlanNode(const struct ArchiveStore *store, struct Query *query, int node)
+{
+    struct QueryNode *n = &query->nodes[node];
+    size_t scan = store->slots + 1;
+    if (n->op != QUERY_AND && n->op != QUERY_OR)
+    {
+        queryPlanLeaf(store, n);
+        return;
+    }
+
+    queryPlanNode(store, query, n->left);
+    queryPlanNode(store, query, n->right);
+    struct QueryNode *left = &query->nodes[n->left];
+    struct QueryNode *right = &query->nodes[n->right];
+
+    if (n->op == QUERY_OR)
+    {
+        n->estimate = left->estimate + right->estimate < store->count ? left->estimate + right->estimate : store->count;
+        if (left->path == QUERY_PATH_SCAN || right->path == QUERY_PATH_SCAN || left->cost + right->cost >= scan)
+        {
+            n->path = QUERY_PATH_SCAN;
+            n->cost = scan;
+            queryMarkFilter(query, n->left);
+            queryMarkFilter(query, n->right);
+        }
+        else
+        {
+            n->path = QUERY_PATH_UNION;
+            n->cost = left->cost + right->cost;
+        }
+        return;
+    }
+
+    n->estimate = left->estimate < right->estimate ? left->estimate : right->estimate;
+    size_t intersect = left->cost + right->cost;
+    size_t probeLeft = left->cost + left->estimate * QUERY_PROBE_COST;
+    size_t probeRight = right->cost + right->estimate * QUERY_PROBE_COST;
+    size_t probe = probeLeft < probeRight ? probeLeft : probeRight;
+    bool scans = left->path == QUERY_PATH_SCAN && right->path == QUERY_PATH_SCAN;
+
+    if (scans || (scan <= intersect && scan <= probe))
+    {
+        n->path = QUERY_PATH_SCAN;
+        n->cost = scan;
+        queryMarkFilter(query, n->left);
+        queryMarkFilter(query, n->right);
+    }
+    else if (intersect <= probe && left->path != QUERY_PATH_SCAN && right->path != QUERY_PATH_SCAN)
+    {
+        n->path = QUERY_PATH_INTERSECT;
+        n->cost = intersect;
+    }
+    else
+    {
+        if (probeRight < probeLeft)
+        {
+            int swap = n->left;
+            n->left = n->right;
+            n->right = swap;
+        }
+        n->path = QUERY_PATH_PROBE;
+        n->cost = probe;
+        queryMarkFilter(query, n->right);
+    }
+}
+
+/*
+This function chooses an access path for every node of the query from the current contents of the store. It
+is called by queryExecute and queryExplain, so it only needs to be called directly to inspect the plan. It
+returns 0 on success and -1 for a NULL argument or an empty or invalid query.
+*/
+int queryPlan(const struct ArchiveStore *store, struct Query *query)
+{
+    if (store == NULL || query == NULL || query->invalid || query->root < 0)
+    {
+        return -1;
+    }
+    queryPlanNode(store, query, query->root);
+    return 0;
+}
+
+/*
+This function evaluates a planned subtree into out, which it clears first. It returns 0 on success and -1 on
+allocation failure.
+*/
+static int queryEvaluate(const struct ArchiveStore *store, const struct Query *query, int node, struct SlotBitmap *out)
+{
+    const struct QueryNode *n = &query->nodes[node];
+    slotBitmapClear(out);
+
+    if (n->path == QUERY_PATH_BITMAP)
+    {
+        return slotBitmapCopy(n->op == QUERY_TYPE ? &store->typeSlots[n->type] : &store->subtypeSlots[n->type][n->subtype], out);
+    }
+    if (n->path == QUERY_PATH_POSTINGS)
+    {
+        size_t count;
+        const uint32_t *slots = storeContributorSlots(store, n->text, &count);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (slotBitmapAdd(out, slots[i]) != 0)
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (n->path == QUERY_PATH_TITLE_SEARCH)
+    {
+        size_t capacity = 256;
+        size_t length = strlen(n->text);
+        uint32_t *slots = NULL;
+        size_t count;
+        do
+        {
+            capacity *= 2;
+            uint32_t *grown = (uint32_t *)realloc(slots, capacity * sizeof(uint32_t));
+            if (grown == NULL)
+            {
+                free(slots);
+                return -1;
+            }
+            slots = grown;
+            count = titleSearchPrefix(&store->search, n->text, length, 0, slots, capacity);
+        } while (count == capacity);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (slotBitmapAdd(out, slots[i]) != 0)
+            {
+                free(slots);
+                return -1;
+            }
+        }
+        free(slots);
+        return 0;
+    }
+    if (n->path == QUERY_PATH_NUMBER_INDEX)
+    {
+        struct NumberCursor cursor;
+        struct NumberEntry entry;
+        numberIndexSeek(&store->numbers[n->type], n->low, n->high, false, &cursor);
+        while (numberIndexNext(&cursor, &entry))
+        {
+            if (slotBitmapAdd(out, entry.slot) != 0)
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (n->path == QUERY_PATH_COLUMN_SCAN)
+    {
+        uint64_t *bits = (uint64_t *)malloc((columnWords(store->slots) + 1) * sizeof(uint64_t));
+        if (bits == NULL)
+        {
+            return -1;
+        }
+        storeScanNumberRange(store, n->type, n->low, n->high, bits);
+        for (size_t word = 0; word < columnWords(store->slots); word++)
+        {
+            for (uint64_t w = bits[word]; w != 0; w &= w - 1)
+            {
+                if (slotBitmapAdd(out, (uint32_t)(word * 64 + __builtin_ctzll(w))) != 0)
+                {
+                    free(bits);
+                    return -1;
+                }
+            }
+        }
+        free(bits);
+        return 0;
+    }
+    if (n->path == QUERY_PATH_SCAN || n->path == QUERY_PATH_FILTER)
+    {
+        // a FILTER node only gets here when it is shared with a parent that tests it slot by slot
+        for (size_t slot = 0; slot < store->slots; slot++)
+        {
+            if (storeIsLive(store, slot) && queryMatches(store, query, node, (uint32_t)slot) && slotBitmapAdd(out, (uint32_t)slot) != 0)
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    struct SlotBitmap left;
+    struct SlotBitmap right;
+    slotBitmapInit(&left);
+    slotBitmapInit(&right);
+    int result = queryEvaluate(store, query, n->left, &left);
+    if (result == 0 && n->path == QUERY_PATH_PROBE)
+    {
+        struct SlotBitmapIterator iterator;
+        uint32_t slot;
+        slotBitmapIterate(&left, &iterator);
+        while (result == 0 && slotBitmapNext(&iterator, &slot))
+        {
+            if (queryMatches(store, query, n->right, slot))
+            {
+                result = slotBitmapAdd(out, slot);
+            }
+        }
+    }
+    else if (result == 0)
+    {
+        result = queryEvaluate(store, query, n->right, &right);
+        if (result == 0)
+        {
+            result = n->path == QUERY_PATH_INTERSECT ? slotBitmapAnd(&left, &right, out) : slotBitmapOr(&left, &right, out);
+        }
+    }
+    slotBitmapFree(&left);
+    slotBitmapFree(&right);
+    return result == 0 ? 0 : -1;
+}
+
+/*
+This function plans the query and stores the slots of the matching live materials in result, which must be
+initialized and is cleared first. It returns 0 on success, -1 for a NULL argument or an empty or invalid query
+and -2 on allocation failure, in which case result holds an unspecified subset of the matches.
+*/
+int queryExecute(const struct ArchiveStore *store, struct Query *query, struct SlotBitmap *result)
+{
+    if (result == NULL || queryPlan(store, query) != 0)
+    {
+        return -1;
+    }
+    return queryEvaluate(store, query, query->root, result) == 0 ? 0 : -2;
+}
+
+/*
+This function runs the query and stores pointers to up to capacity of the matching materials in results, in
+slot order like storeFilterMaterialsView. It returns the total number of matches, which may exceed capacity, or
+0 if the query could not be run.
+*/
+size_t queryMaterials(const struct ArchiveStore *store, struct Query *query, const struct Material **results, size_t capacity)
+{
+    struct SlotBitmap matches;
+    slotBitmapInit(&matches);
+    if (queryExecute(store, query, &matches) != 0)
+    {
+        slotBitmapFree(&matches);
+        return 0;
+    }
+
+    struct SlotBitmapIterator iterator;
+    uint32_t slot;
+    size_t n = 0;
+    slotBitmapIterate(&matches, &iterator);
+    while (n < capacity && slotBitmapNext(&iterator, &slot))
+    {
+        results[n++] = storeAt(store, slot);
+    }
+    size_t total = slotBitmapCardinality(&matches);
+    slotBitmapFree(&matches);
+    return total;
+}
+
+/*
+This function appends one line per node of a planned subtree to buffer, indented two spaces per level.
+*/
+static void queryDescribe(const struct Query *query, int node, int depth, char *buffer, size_t size, size_t *used)
+{
+    const struct QueryNode *n = &query->nodes[node];
+    char predicate[QUERY_TEXT_MAX + 64];
+    switch (n->op)
+    {
+    case QUERY_TYPE:
+        snprintf(predicate, sizeof(predicate), "TYPE %s", queryTypeNames[n->type]);
+        break;
+    case QUERY_SUBTYPE:
+        snprintf(predicate, sizeof(predicate), "SUBTYPE %s %d", queryTypeNames[n->type], n->subtype);
+        break;
+    case QUERY_CONTRIBUTOR:
+        snprintf(predicate, sizeof(predicate), "CONTRIBUTOR \"%s\"", n->text);
+        break;
+    case QUERY_PREFIX:
+        snprintf(predicate, sizeof(predicate), "PREFIX \"%s\"", n->text);
+        break;
+    case QUERY_RANGE:
+        snprintf(predicate, sizeof(predicate), "RANGE %s %d..%d", queryTypeNames[n->type], (int)n->low, (int)n->high);
+        break;
+    case QUERY_AND:
+        snprintf(predicate, sizeof(predicate), "AND");
+        break;
+    case QUERY_OR:
+        snprintf(predicate, sizeof(predicate), "OR");
+        break;
+    }
+
+    int written = snprintf(buffer + *used, *used < size ? size - *used : 0, "%*s%s: %s (estimate %zu, cost %zu)\n",
+                           depth * 2, "", predicate, queryPathNames[n->path], n->estimate, n->cost);
+    *used += written > 0 ? (size_t)written : 0;
+    if (n->op == QUERY_AND || n->op == QUERY_OR)
+    {
+        queryDescribe(query, n->left, depth + 1, buffer, size, used);
+        queryDescribe(query, n->right, depth + 1, buffer, size, used);
+    }
+}
+
+/*
+This function plans the query and writes the plan to buffer, one line per node giving the predicate, its access
+path, its estimated matches and its cost, for example
+
+    AND: probe (estimate 120, cost 601)
+      RANGE BOOK 200..400: number index (estimate 120, cost 121)
+      CONTRIBUTOR "Author": filter (estimate 3000, cost 0)
+
+It returns 0 on success, -1 for a NULL argument or an empty or invalid query and -2 if buffer was too small, in
+which case it holds as much of the plan as fits.
+*/
+int queryExplain(const struct ArchiveStore *store, struct Query *query, char *buffer, size_t size)
+{
+    if (buffer == NULL || size == 0 || queryPlan(store, query) != 0)
+    {
+        return -1;
+    }
+    size_t used = 0;
+    buffer[0] = '\0';
+    queryDescribe(query, query->root, 0, buffer, size, &used);
+    return used < size ? 0 : -2;
+}
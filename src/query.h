@@ -0,0 +1,112 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "store.h"
+
+// Limits
+#define QUERY_MAX_NODES 32
+#define QUERY_TEXT_MAX 50
+
+// Tuning
+#define QUERY_PROBE_COST 4
+#define QUERY_BITMAP_DIVISOR 8
+#define QUERY_COLUMN_DIVISOR 8
+#define QUERY_PREFIX_SHIFT 3
+
+// Enums
+enum QueryOp
+{
+    QUERY_TYPE,
+    QUERY_SUBTYPE,
+    QUERY_CONTRIBUTOR,
+    QUERY_PREFIX,
+    QUERY_RANGE,
+    QUERY_AND,
+    QUERY_OR
+};
+
+/*
+How the planner evaluates a node. The first four read an index, COLUMN_SCAN runs the vectorized range kernels
+over a columnar store and SCAN tests every live slot against the node. INTERSECT and UNION combine the sets of
+both children; PROBE evaluates the left child and tests each of its slots against the right one. FILTER marks a
+node that is never evaluated on its own, only tested slot by slot on behalf of a PROBE or SCAN above it.
+*/
+enum QueryPath
+{
+    QUERY_PATH_BITMAP,
+    QUERY_PATH_POSTINGS,
+    QUERY_PATH_TITLE_SEARCH,
+    QUERY_PATH_NUMBER_INDEX,
+    QUERY_PATH_COLUMN_SCAN,
+    QUERY_PATH_SCAN,
+    QUERY_PATH_INTERSECT,
+    QUERY_PATH_PROBE,
+    QUERY_PATH_UNION,
+    QUERY_PATH_FILTER
+};
+
+// Structs
+
+/*
+One predicate or connective of a query. Leaves use the fields their op needs: type and subtype, text for a
+contributor or title prefix, and low and high for a range of pages or issues. AND and OR nodes combine left and
+right. path, estimate and cost are filled in by the planner: estimate is an upper bound on the matching slots and
+cost the work of the chosen path in units of one sequential slot test.
+*/
+struct QueryNode
+{
+    enum QueryOp op;
+    enum MaterialType type;
+    int subtype;
+    int32_t low;
+    int32_t high;
+    char text[QUERY_TEXT_MAX];
+    int left;
+    int right;
+    enum QueryPath path;
+    size_t estimate;
+    size_t cost;
+};
+
+/*
+A query over an ArchiveStore, built bottom-up: every builder function appends a node, returns its index and
+makes it the root, so the node built last is the one evaluated. A builder given an invalid argument or a
+negative child, or called once QUERY_MAX_NODES nodes exist, returns -1 and marks the query invalid.
+*/
+struct Query
+{
+    struct QueryNode nodes[QUERY_MAX_NODES];
+    int count;
+    int root;
+    bool invalid;
+};
+
+// Functions
+
+void queryInit(struct Query *query);
+
+int queryType(struct Query *query, enum MaterialType type);
+
+int querySubtype(struct Query *query, enum MaterialType type, int subtype);
+
+int queryContributor(struct Query *query, const char *contributor);
+
+int queryPrefix(struct Query *query, const char *prefix);
+
+int queryRange(struct Query *query, enum MaterialType type, int32_t low, int32_t high);
+
+int queryAnd(struct Query *query, int left, int right);
+
+int queryOr(struct Query *query, int left, int right);
+
+int queryPlan(const struct ArchiveStore *store, struct Query *query);
+
+int queryExecute(const struct ArchiveStore *store, struct Query *query, struct SlotBitmap *result);
+
+size_t queryMaterials(const struct ArchiveStore *store, struct Query *query, const struct Material **results, size_t capacity);
+
+int queryExplain(const struct ArchiveStore *store, struct Query *query, char *buffer, size_t size);
+
+#endif
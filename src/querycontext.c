@@ -0,0 +1,228 @@
+#include "querycontext.h"
+
+// the size of a chunk header rounded up to the alignment of the bytes that follow it
+#define QUERY_CONTEXT_HEADER ((sizeof(struct QueryContextChunk) + QUERY_CONTEXT_ALIGN - 1) & ~(size_t)(QUERY_CONTEXT_ALIGN - 1))
+
+/*
+This function initializes an empty context. No memory is allocated until the first allocation.
+*/
+void queryContextInit(struct QueryContext *context)
+{
+    context->chunks = NULL;
+    context->current = NULL;
+    context->used = 0;
+    context->bytes = 0;
+}
+
+/*
+This function releases every chunk of the context, invalidating all spans it returned, and leaves it empty.
+*/
+void queryContextFree(struct QueryContext *context)
+{
+    if (context == NULL)
+    {
+        return;
+    }
+    struct QueryContextChunk *chunk = context->chunks;
+    while (chunk != NULL)
+    {
+        struct QueryContextChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    queryContextInit(context);
+}
+
+/*
+This function makes all the memory of the context available again in constant time. The chunks are kept for the
+next request; spans returned before the reset must no longer be used.
+*/
+void queryContextReset(struct QueryContext *context)
+{
+    context->current = context->chunks;
+    context->used = 0;
+}
+
+/*
+This function returns size bytes aligned to QUERY_CONTEXT_ALIGN, by bumping the fill level of the current chunk.
+When the chunk is full the next chunk kept by an earlier reset is used if it is large enough; otherwise a new
+one is allocated and linked in after the current chunk. It returns NULL if memory runs out.
+*/
+void *queryContextAlloc(struct QueryContext *context, size_t size)
+{
+    size = (size + QUERY_CONTEXT_ALIGN - 1) & ~(size_t)(QUERY_CONTEXT_ALIGN - 1);
+    struct QueryContextChunk *chunk = context->current;
+    if (chunk != NULL && chunk->size - context->used >= size)
+    {
+        void *bytes = (char *)chunk + QUERY_CONTEXT_HEADER + context->used;
+        context->used += size;
+        return bytes;
+    }
+
+    if (chunk != NULL && chunk->next != NULL && chunk->next->size >= size)
+    {
+        chunk = chunk->next;
+    }
+    else
+    {
+        size_t capacity = size > QUERY_CONTEXT_CHUNK ? size : QUERY_CONTEXT_CHUNK;
+        struct QueryContextChunk *fresh = (struct QueryContextChunk *)aligned_alloc(QUERY_CONTEXT_ALIGN, QUERY_CONTEXT_HEADER + capacity);
+        if (fresh == NULL)
+        {
+            return NULL;
+        }
+        fresh->size = capacity;
+        if (chunk == NULL)
+        {
+            fresh->next = context->chunks;
+            context->chunks = fresh;
+        }
+        else
+        {
+            // a chunk too small for this request stays behind the new one for later requests
+            fresh->next = chunk->next;
+            chunk->next = fresh;
+        }
+        context->bytes += QUERY_CONTEXT_HEADER + capacity;
+        chunk = fresh;
+    }
+
+    context->current = chunk;
+    context->used = size;
+    return (char *)chunk + QUERY_CONTEXT_HEADER;
+}
+
+/*
+This function allocates room for count material pointers in the context and points span at it. It returns 0 on
+success and -2 if memory runs out.
+*/
+static int queryContextSpan(struct QueryContext *context, size_t count, struct MaterialSpan *span)
+{
+    span->count = 0;
+    span->items = (const struct Material **)queryContextAlloc(context, count * sizeof(const struct Material *));
+    return span->items == NULL ? -2 : 0;
+}
+
+/*
+This function sets span to the materials of the given type, in slot order. It returns 0 on success, -1 for a
+NULL argument or an invalid type and -2 if memory runs out.
+*/
+int queryContextFilterMaterials(struct QueryContext *context, const struct ArchiveStore *store, enum MaterialType type, struct MaterialSpan *span)
+{
+    if (context == NULL || store == NULL || span == NULL)
+    {
+        return -1;
+    }
+    const struct SlotBitmap *slots = storeFilterMaterials(store, type);
+    if (slots == NULL)
+    {
+        return -1;
+    }
+    if (queryContextSpan(context, slotBitmapCardinality(slots), span) != 0)
+    {
+        return -2;
+    }
+
+    struct SlotBitmapIterator iterator;
+    uint32_t slot;
+    slotBitmapIterate(slots, &iterator);
+    while (slotBitmapNext(&iterator, &slot))
+    {
+        span->items[span->count++] = storeAt(store, slot);
+    }
+    return 0;
+}
+
+/*
+This function sets span to the materials whose author, publisher or editor is author, in slot order. An
+unknown or empty author gives an empty span. It returns 0 on success, -1 for a NULL argument and -2 if memory
+runs out.
+*/
+int queryContextFilterMaterialsByAuthor(struct QueryContext *context, const struct ArchiveStore *store, const char *author, struct MaterialSpan *span)
+{
+    if (context == NULL || store == NULL || author == NULL || span == NULL)
+    {
+        return -1;
+    }
+    size_t count;
+    const uint32_t *slots = storeContributorSlots(store, author, &count);
+    if (queryContextSpan(context, count, span) != 0)
+    {
+        return -2;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        span->items[i] = storeAt(store, slots[i]);
+    }
+    span->count = count;
+    return 0;
+}
+
+/*
+This function sets span to up to limit materials whose title starts with prefix, in title order, as returned by
+storeSearchPrefix. It returns 0 on success, -1 for a NULL argument and -2 if memory runs out.
+*/
+int queryContextSearchPrefix(struct QueryContext *context, const struct ArchiveStore *store, const char *prefix, size_t limit, struct MaterialSpan *span)
+{
+    if (context == NULL || store == NULL || prefix == NULL || span == NULL)
+    {
+        return -1;
+    }
+    if (queryContextSpan(context, limit, span) != 0)
+    {
+        return -2;
+    }
+    span->count = storeSearchPrefix(store, prefix, 0, span->items, limit);
+    return 0;
+}
+
+/*
+This function runs a query and sets span to every match, in slot order. Only the span comes from the context;
+the bitmaps the plan combines are still taken from the heap. It returns 0 on success, -1 for a NULL argument or
+an empty or invalid query and -2 if memory runs out.
+*/
+int queryContextRun(struct QueryContext *context, const struct ArchiveStore *store, struct Query *query, struct MaterialSpan *span)
+{
+    if (context == NULL || span == NULL)
+    {
+        return -1;
+    }
+    struct SlotBitmap matches;
+    slotBitmapInit(&matches);
+    int result = queryExecute(store, query, &matches);
+    if (result == 0 && queryContextSpan(context, slotBitmapCardinality(&matches), span) != 0)
+    {
+        result = -2;
+    }
+    if (result == 0)
+    {
+        struct SlotBitmapIterator iterator;
+        uint32_t slot;
+        slotBitmapIterate(&matches, &iterator);
+        while (slotBitmapNext(&iterator, &slot))
+        {
+            span->items[span->count++] = storeAt(store, slot);
+        }
+    }
+    slotBitmapFree(&matches);
+    return result;
+}
+
+/*
+This function is filterMaterialsByAuthor for a fixed-size Archive with the result in the context instead of a
+fresh heap array, and with its count. It returns 0 on success, -1 for a NULL argument and -2 if memory runs out.
+*/
+int queryContextFilterArchiveByAuthor(struct QueryContext *context, const struct Archive *archive, const char *author, struct MaterialSpan *span)
+{
+    if (context == NULL || archive == NULL || author == NULL || span == NULL)
+    {
+        return -1;
+    }
+    if (queryContextSpan(context, archive->count > 0 ? (size_t)archive->count : 0, span) != 0)
+    {
+        return -2;
+    }
+    int count = filterMaterialsByAuthorView(archive, author, span->items, archive->count);
+    span->count = count > 0 ? (size_t)count : 0;
+    return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef QUERYCONTEXT_H
+#define QUERYCONTEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "store.h"
+#include "query.h"
+
+// Tuning
+#define QUERY_CONTEXT_CHUNK 65536
+#define QUERY_CONTEXT_ALIGN 16
+
+// Structs
+
+/*
+One block of a QueryContext; its bytes start at the first multiple of QUERY_CONTEXT_ALIGN after the header.
+*/
+struct QueryContextChunk
+{
+    struct QueryContextChunk *next;
+    size_t size;
+};
+
+/*
+A bump arena that owns the results of the queries of one request. Allocations are carved out of chunks of at
+least QUERY_CONTEXT_CHUNK bytes kept in a list; current is the chunk being filled and used its fill level.
+queryContextReset rewinds to the first chunk without freeing anything, so a context reused across requests
+stops touching the heap once its chunks cover the largest request. A context belongs to one thread at a time.
+*/
+struct QueryContext
+{
+    struct QueryContextChunk *chunks;
+    struct QueryContextChunk *current;
+    size_t used;
+    size_t bytes;
+};
+
+/*
+A result set: count pointers to materials, in storage owned by a QueryContext. The span is valid until the
+context is reset or freed and the materials until the store is next modified.
+*/
+struct MaterialSpan
+{
+    const struct Material **items;
+    size_t count;
+};
+
+// Functions
+
+void queryContextInit(struct QueryContext *context);
+
+void queryContextFree(struct QueryContext *context);
+
+void queryContextReset(struct QueryContext *context);
+
+void *queryContextAlloc(struct QueryContext *context, size_t size);
+
+int queryContextFilterMaterials(struct QueryContext *context, const struct ArchiveStore *store, enum MaterialType type, struct MaterialSpan *span);
+
+int queryContextFilterMaterialsByAuthor(struct QueryContext *context, const struct ArchiveStore *store, const char *author, struct MaterialSpan *span);
+
+int queryContextSearchPrefix(struct QueryContext *context, const struct ArchiveStore *store, const char *prefix, size_t limit, struct MaterialSpan *span);
+
+int queryContextRun(struct QueryContext *context, const struct ArchiveStore *store, struct Query *query, struct MaterialSpan *span);
+
+int queryContextFilterArchiveByAuthor(struct QueryContext *context, const struct Archive *archive, const char *author, struct MaterialSpan *span);
+
+#endif
@@ -0,0 +1,487 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sharded.h"
+
+/*
+A range of slots of one shard scanned as one task. count is the number of matches found in it and offset the
+position of its first match in the merged results.
+*/
+struct ShardedChunk
+{
+    size_t shard;
+    size_t begin;
+    size_t end;
+    size_t count;
+    size_t offset;
+};
+
+/*
+The state shared by the tasks of one query. A predicate scan gives each chunk SHARDED_SCAN_CHUNK bits of bits
+to mark its matches; type and author queries use the store indexes and have one chunk per shard.
+*/
+struct ShardedQuery
+{
+    struct ShardedArchive *archive;
+    struct ShardedChunk *chunks;
+    uint64_t *bits;
+    MaterialPredicate predicate;
+    void *context;
+    enum MaterialType type;
+    const char *author;
+    struct Material *results;
+    size_t capacity;
+};
+
+/*
+This function takes the read lock of every shard, in shard order so that queries never deadlock with each
+other, giving the query a consistent view of the archive.
+*/
+static void shardedLockAll(struct ShardedArchive *archive)
+{
+    for (size_t i = 0; i < archive->shardCount; i++)
+    {
+        pthread_rwlock_rdlock(&archive->shards[i].lock);
+    }
+}
+
+/*
+This function releases the locks taken by shardedLockAll.
+*/
+static void shardedUnlockAll(struct ShardedArchive *archive)
+{
+    for (size_t i = 0; i < archive->shardCount; i++)
+    {
+        pthread_rwlock_unlock(&archive->shards[i].lock);
+    }
+}
+
+/*
+This function sets the offset of every chunk from the counts, so the merged results are in shard and then slot
+order, and returns the total.
+*/
+static size_t shardedPrefixSum(struct ShardedChunk *chunks, size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        chunks[i].offset = total;
+        total += chunks[i].count;
+    }
+    return total;
+}
+
+/*
+This function is the first task of a predicate scan: it tests every live material of one chunk and marks the
+matches in the chunk's bits.
+*/
+static void shardedMatchChunk(void *context, size_t index)
+{
+    struct ShardedQuery *query = (struct ShardedQuery *)context;
+    struct ShardedChunk *chunk = &query->chunks[index];
+    const struct ArchiveStore *store = &query->archive->shards[chunk->shard].store;
+    uint64_t *bits = &query->bits[index * (SHARDED_SCAN_CHUNK / 64)];
+    size_t count = 0;
+
+    memset(bits, 0, SHARDED_SCAN_CHUNK / 8);
+    for (size_t slot = chunk->begin; slot < chunk->end; slot++)
+    {
+        if (storeIsLive(store, slot) && query->predicate(storeAt(store, slot), query->context))
+        {
+            size_t bit = slot - chunk->begin;
+            bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+            count++;
+        }
+    }
+    chunk->count = count;
+}
+
+/*
+This function is the second task of a predicate scan: it copies the marked materials of one chunk to their
+place in the results, stopping at the capacity.
+*/
+static void shardedCopyChunk(void *context, size_t index)
+{
+    struct ShardedQuery *query = (struct ShardedQuery *)context;
+    struct ShardedChunk *chunk = &query->chunks[index];
+    const struct ArchiveStore *store = &query->archive->shards[chunk->shard].store;
+    const uint64_t *bits = &query->bits[index * (SHARDED_SCAN_CHUNK / 64)];
+    size_t out = chunk->offset;
+
+    for (size_t word = 0; word < SHARDED_SCAN_CHUNK / 64 && out < query->capacity; word++)
+    {
+        uint64_t set = bits[word];
+        while (set != 0 && out < query->capacity)
+        {
+            size_t bit = word * 64 + (size_t)__builtin_ctzll(set);
+            query->results[out++] = *storeAt(store, chunk->begin + bit);
+            set &= set - 1;
+        }
+    }
+}
+
+/*
+This function copies the matches of one shard for a type or author query from the shard's type bitmap or
+contributor posting list to their place in the results.
+*/
+static void shardedCopyIndexed(void *context, size_t index)
+{
+    struct ShardedQuery *query = (struct ShardedQuery *)context;
+    const struct ArchiveStore *store = &query->archive->shards[index].store;
+    size_t out = query->chunks[index].offset;
+
+    if (query->author != NULL)
+    {
+        size_t count;
+        const uint32_t *slots = storeContributorSlots(store, query->author, &count);
+        for (size_t i = 0; i < count && out < query->capacity; i++)
+        {
+            query->results[out++] = *storeAt(store, slots[i]);
+        }
+        return;
+    }
+
+    struct SlotBitmapIterator iterator;
+    uint32_t slot;
+    slotBitmapIterate(storeFilterMaterials(store, query->type), &iterator);
+    while (out < query->capacity && slotBitmapNext(&iterator, &slot))
+    {
+        query->results[out++] = *storeAt(store, slot);
+    }
+}
+
+/*
+This function runs a type or author query: the match counts come from the indexes without touching any record,
+and the copying is fanned out with one task per shard.
+*/
+static size_t shardedQueryIndexed(struct ShardedArchive *archive, struct ShardedQuery *query)
+{
+    struct ShardedChunk *chunks = (struct ShardedChunk *)calloc(archive->shardCount, sizeof(struct ShardedChunk));
+    if (chunks == NULL)
+    {
+        return 0;
+    }
+    query->archive = archive;
+    query->chunks = chunks;
+
+    shardedLockAll(archive);
+    for (size_t i = 0; i < archive->shardCount; i++)
+    {
+        const struct ArchiveStore *store = &archive->shards[i].store;
+        if (query->author != NULL)
+        {
+            storeContributorSlots(store, query->author, &chunks[i].count);
+        }
+        else
+        {
+            chunks[i].count = slotBitmapCardinality(storeFilterMaterials(store, query->type));
+        }
+    }
+    size_t total = shardedPrefixSum(chunks, archive->shardCount);
+    if (query->capacity != 0)
+    {
+        threadPoolFor(&archive->pool, archive->shardCount, shardedCopyIndexed, query);
+    }
+    shardedUnlockAll(archive);
+
+    free(chunks);
+    return total;
+}
+
+/*
+This function creates an archive of shards empty stores configured with config, or the defaults if it is NULL,
+and a pool of threads workers, one per online CPU if threads is 0. It returns 0 on success and -1 if shards is 0
+or memory or threads could not be allocated.
+*/
+int shardedInit(struct ShardedArchive *archive, size_t shards, size_t threads, const struct StoreConfig *config)
+{
+    if (archive == NULL || shards == 0)
+    {
+        return -1;
+    }
+    memset(archive, 0, sizeof(*archive));
+    archive->shards = (struct ArchiveShard *)calloc(shards, sizeof(struct ArchiveShard));
+    if (archive->shards == NULL)
+    {
+        return -1;
+    }
+    if (threadPoolInit(&archive->pool, threads) != 0)
+    {
+        free(archive->shards);
+        archive->shards = NULL;
+        return -1;
+    }
+    for (size_t i = 0; i < shards; i++)
+    {
+        if (storeInit(&archive->shards[i].store, config) != 0)
+        {
+            archive->shardCount = i;
+            shardedFree(archive);
+            return -1;
+        }
+        pthread_rwlock_init(&archive->shards[i].lock, NULL);
+    }
+    archive->shardCount = shards;
+    return 0;
+}
+
+/*
+This function stops the pool and releases every shard. No other thread may be using the archive.
+*/
+void shardedFree(struct ShardedArchive *archive)
+{
+    if (archive == NULL || archive->shards == NULL)
+    {
+        return;
+    }
+    threadPoolFree(&archive->pool);
+    for (size_t i = 0; i < archive->shardCount; i++)
+    {
+        storeFree(&archive->shards[i].store);
+        pthread_rwlock_destroy(&archive->shards[i].lock);
+    }
+    free(archive->shards);
+    archive->shards = NULL;
+    archive->shardCount = 0;
+}
+
+/*
+This function returns the shard a title belongs to. It uses the high bits of the title hash because each
+shard's title index picks buckets with the low bits, which would otherwise be the same for every title of a
+shard.
+*/
+size_t shardedShardOf(const struct ShardedArchive *archive, const char *title)
+{
+    return (size_t)(((uint64_t)titleHash(title) * archive->shardCount) >> 32);
+}
+
+/*
+This function returns the number of materials in the archive.
+*/
+size_t shardedCount(struct ShardedArchive *archive)
+{
+    size_t count = 0;
+    shardedLockAll(archive);
+    for (size_t i = 0; i < archive->shardCount; i++)
+    {
+        count += archive->shards[i].store.count;
+    }
+    shardedUnlockAll(archive);
+    return count;
+}
+
+/*
+This function adds a material to the shard of its title. Since titles are unique within a shard and a title
+always maps to the same shard, they are unique in the archive. It returns the result of storeAddMaterial.
+*/
+int shardedAddMaterial(struct ShardedArchive *archive, const struct Material *material)
+{
+    if (archive == NULL || material == NULL)
+    {
+        return -1;
+    }
+    struct ArchiveShard *shard = &archive->shards[shardedShardOf(archive, material->title)];
+    pthread_rwlock_wrlock(&shard->lock);
+    int status = storeAddMaterial(&shard->store, material);
+    pthread_rwlock_unlock(&shard->lock);
+    return status;
+}
+
+/*
+This function copies the material with the given title into material. It returns 0 if the title was found and
+-1 otherwise.
+*/
+int shardedFindMaterial(struct ShardedArchive *archive, const char *title, struct Material *material)
+{
+    if (archive == NULL || title == NULL)
+    {
+        return -1;
+    }
+    struct ArchiveShard *shard = &archive->shards[shardedShardOf(archive, title)];
+    pthread_rwlock_rdlock(&shard->lock);
+    const struct Material *found = storeFindMaterial(&shard->store, title);
+    if (found != NULL)
+    {
+        *material = *found;
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    return found == NULL ? -1 : 0;
+}
+
+/*
+This function updates the details of the material with the given title in its shard. It returns the result of
+storeUpdateMaterial.
+*/
+int shardedUpdateMaterial(struct ShardedArchive *archive, const char *title, union MaterialDetails details)
+{
+    if (archive == NULL || title == NULL)
+    {
+        return -1;
+    }
+    struct ArchiveShard *shard = &archive->shards[shardedShardOf(archive, title)];
+    pthread_rwlock_wrlock(&shard->lock);
+    int status = storeUpdateMaterial(&shard->store, title, details);
+    pthread_rwlock_unlock(&shard->lock);
+    return status;
+}
+
+/*
+This function removes the material with the given title from its shard. It returns 0 on success and -1 if no
+material has that title.
+*/
+int shardedRemoveMaterial(struct ShardedArchive *archive, const char *title)
+{
+    if (archive == NULL || title == NULL)
+    {
+        return -1;
+    }
+    struct ArchiveShard *shard = &archive->shards[shardedShardOf(archive, title)];
+    pthread_rwlock_wrlock(&shard->lock);
+    int status = storeFindMaterial(&shard->store, title) == NULL ? -1 : 0;
+    if (status == 0)
+    {
+        storeRemoveMaterial(&shard->store, title);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    return status;
+}
+
+/*
+This function sums the aggregate counts of every shard into stats, holding all the read locks so that the sum
+reflects a single point in time. It costs O(shards). A contributor whose materials are spread over several
+shards is counted once in each of them.
+*/
+void shardedStats(struct ShardedArchive *archive, struct StoreStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    shardedLockAll(archive);
+    for (size_t i = 0; i < archive->shardCount; i++)
+    {
+        struct StoreStats shard;
+        storeStats(&archive->shards[i].store, &shard);
+        stats->materials += shard.materials;
+        for (int type = 0; type < STORE_TYPES; type++)
+        {
+            stats->types[type] += shard.types[type];
+            for (int subtype = 0; subtype < STORE_SUBTYPES; subtype++)
+            {
+                stats->subtypes[type][subtype] += shard.subtypes[type][subtype];
+            }
+        }
+        stats->pages += shard.pages;
+        stats->contributors += shard.contributors;
+    }
+    shardedUnlockAll(archive);
+}
+
+/*
+This function returns the number of materials of contributor across all shards.
+*/
+size_t shardedContributorCount(struct ShardedArchive *archive, const char *contributor)
+{
+    size_t count = 0;
+    shardedLockAll(archive);
+    for (size_t i = 0; i < archive->shardCount; i++)
+    {
+        count += storeContributorCount(&archive->shards[i].store, contributor);
+    }
+    shardedUnlockAll(archive);
+    return count;
+}
+
+/*
+This function copies up to capacity materials of the given type into results, shard by shard, with the copying
+spread over the pool. results may be NULL with a capacity of 0 to only count. It returns the total number of
+matches, or 0 for an invalid type or if memory runs out.
+*/
+size_t shardedFilterMaterials(struct ShardedArchive *archive, enum MaterialType type, struct Material *results, size_t capacity)
+{
+    if (archive == NULL || type < BOOK || type > NEWSPAPER)
+    {
+        return 0;
+    }
+    struct ShardedQuery query;
+    memset(&query, 0, sizeof(query));
+    query.type = type;
+    query.results = results;
+    query.capacity = capacity;
+    return shardedQueryIndexed(archive, &query);
+}
+
+/*
+This function copies up to capacity materials whose contributor is author into results in the same way as
+shardedFilterMaterials. It returns the total number of matches, or 0 if author is NULL or memory runs out.
+*/
+size_t shardedFilterMaterialsByAuthor(struct ShardedArchive *archive, const char *author, struct Material *results, size_t capacity)
+{
+    if (archive == NULL || author == NULL)
+    {
+        return 0;
+    }
+    struct ShardedQuery query;
+    memset(&query, 0, sizeof(query));
+    query.author = author;
+    query.results = results;
+    query.capacity = capacity;
+    return shardedQueryIndexed(archive, &query);
+}
+
+/*
+This function runs predicate on every material of the archive in parallel and copies up to capacity matches
+into results, in shard and then slot order. The scan is split into chunks of SHARDED_SCAN_CHUNK slots that the
+pool's workers share by stealing; each chunk marks its matches in a private bitmap, and once the counts are
+summed a second parallel pass copies every chunk's matches straight to their final place. predicate is called
+from several threads at once and must not modify the archive. It returns the total number of matches, or 0 if
+memory for the chunk bitmaps cannot be allocated.
+*/
+size_t shardedScan(struct ShardedArchive *archive, MaterialPredicate predicate, void *context, struct Material *results, size_t capacity)
+{
+    if (archive == NULL || predicate == NULL)
+    {
+        return 0;
+    }
+
+    shardedLockAll(archive);
+    size_t chunkCount = 0;
+    for (size_t i = 0; i < archive->shardCount; i++)
+    {
+        chunkCount += (archive->shards[i].store.slots + SHARDED_SCAN_CHUNK - 1) / SHARDED_SCAN_CHUNK;
+    }
+
+    struct ShardedQuery query;
+    memset(&query, 0, sizeof(query));
+    query.archive = archive;
+    query.predicate = predicate;
+    query.context = context;
+    query.results = results;
+    query.capacity = capacity;
+    query.chunks = (struct ShardedChunk *)calloc(chunkCount, sizeof(struct ShardedChunk));
+    query.bits = (uint64_t *)malloc(chunkCount * (SHARDED_SCAN_CHUNK / 8));
+    size_t total = 0;
+    if (chunkCount != 0 && query.chunks != NULL && query.bits != NULL)
+    {
+        size_t chunk = 0;
+        for (size_t i = 0; i < archive->shardCount; i++)
+        {
+            size_t slots = archive->shards[i].store.slots;
+            for (size_t begin = 0; begin < slots; begin += SHARDED_SCAN_CHUNK)
+            {
+                query.chunks[chunk].shard = i;
+                query.chunks[chunk].begin = begin;
+                query.chunks[chunk].end = slots - begin < SHARDED_SCAN_CHUNK ? slots : begin + SHARDED_SCAN_CHUNK;
+                chunk++;
+            }
+        }
+
+        threadPoolFor(&archive->pool, chunkCount, shardedMatchChunk, &query);
+        total = shardedPrefixSum(query.chunks, chunkCount);
+        if (capacity != 0)
+        {
+            threadPoolFor(&archive->pool, chunkCount, shardedCopyChunk, &query);
+        }
+    }
+    shardedUnlockAll(archive);
+
+    free(query.chunks);
+    free(query.bits);
+    return total;
+}
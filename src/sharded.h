@@ -0,0 +1,66 @@
+#ifndef SHARDED_H
+#define SHARDED_H
+
+#include <pthread.h>
+#include "store.h"
+#include "threadpool.h"
+
+// Tuning
+#define SHARDED_SCAN_CHUNK 65536
+
+// Structs
+
+/*
+One partition of a ShardedArchive: a store and the lock that guards it. Point operations take the lock of one
+shard; queries take every shard's lock for reading.
+*/
+struct ArchiveShard
+{
+    struct ArchiveStore store;
+    pthread_rwlock_t lock;
+};
+
+/*
+An archive hash-partitioned by title over shardCount independent stores. A title always lives in the shard its
+hash selects, so adding, finding, updating and removing touch a single shard and writers to different shards
+run in parallel. Queries fan out over pool, which splits every shard into chunks of SHARDED_SCAN_CHUNK slots so
+that work stealing evens out shards of different sizes, and merge the results in shard order.
+*/
+struct ShardedArchive
+{
+    struct ArchiveShard *shards;
+    size_t shardCount;
+    struct ThreadPool pool;
+};
+
+typedef bool (*MaterialPredicate)(const struct Material *material, void *context);
+
+// Functions
+
+int shardedInit(struct ShardedArchive *archive, size_t shards, size_t threads, const struct StoreConfig *config);
+
+void shardedFree(struct ShardedArchive *archive);
+
+size_t shardedShardOf(const struct ShardedArchive *archive, const char *title);
+
+size_t shardedCount(struct ShardedArchive *archive);
+
+int shardedAddMaterial(struct ShardedArchive *archive, const struct Material *material);
+
+int shardedFindMaterial(struct ShardedArchive *archive, const char *title, struct Material *material);
+
+int shardedUpdateMaterial(struct ShardedArchive *archive, const char *title, union MaterialDetails details);
+
+int shardedRemoveMaterial(struct ShardedArchive *archive, const char *title);
+
+void shardedStats(struct ShardedArchive *archive, struct StoreStats *stats);
+
+size_t shardedContributorCount(struct ShardedArchive *archive, const char *contributor);
+
+size_t shardedFilterMaterials(struct ShardedArchive *archive, enum MaterialType type, struct Material *results, size_t capacity);
+
+size_t shardedFilterMaterialsByAuthor(struct ShardedArchive *archive, const char *author, struct Material *results, size_t capacity);
+
+size_t shardedScan(struct ShardedArchive *archive, MaterialPredicate predicate, void *context, struct Material *results, size_t capacity);
+
+#endif
@@ -0,0 +1,695 @@
+#include <stdlib.h>
+#include <string.h>
+#include "slotbitmap.h"
+
+/*
+This function binary searches the containers for key. It returns true and the container position if the key
+is present, otherwise false and the position where a container with that key would be inserted.
+*/
+static bool slotBitmapFindContainer(const struct SlotBitmap *bitmap, uint16_t key, size_t *position)
+{
+    size_t low = 0;
+    size_t high = bitmap->count;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (bitmap->containers[mid].key < key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    *position = low;
+    return low < bitmap->count && bitmap->containers[low].key == key;
+}
+
+/*
+This function binary searches a sorted array container for value, returning the same kind of result as
+slotBitmapFindContainer.
+*/
+static bool slotArrayFind(const struct SlotContainer *container, uint16_t value, size_t *position)
+{
+    size_t low = 0;
+    size_t high = container->cardinality;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (container->data.values[mid] < value)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    *position = low;
+    return low < container->cardinality && container->data.values[low] == value;
+}
+
+/*
+This function opens a gap at position in the container list and fills it with an empty array container for
+key. It returns a pointer to the new container or NULL if the list could not grow.
+*/
+static struct SlotContainer *slotBitmapInsertContainer(struct SlotBitmap *bitmap, size_t position, uint16_t key)
+{
+    if (bitmap->count == bitmap->capacity)
+    {
+        size_t capacity = bitmap->capacity == 0 ? 4 : bitmap->capacity * 2;
+        struct SlotContainer *containers = (struct SlotContainer *)realloc(bitmap->containers, capacity * sizeof(struct SlotContainer));
+        if (containers == NULL)
+        {
+            return NULL;
+        }
+        bitmap->containers = containers;
+        bitmap->capacity = capacity;
+    }
+
+    memmove(&bitmap->containers[position + 1], &bitmap->containers[position], (bitmap->count - position) * sizeof(struct SlotContainer));
+    bitmap->count++;
+
+    struct SlotContainer *container = &bitmap->containers[position];
+    memset(container, 0, sizeof(*container));
+    container->key = key;
+    container->kind = SLOT_ARRAY;
+    return container;
+}
+
+/*
+This function frees the container at position and closes the gap in the container list.
+*/
+static void slotBitmapRemoveContainer(struct SlotBitmap *bitmap, size_t position)
+{
+    free(bitmap->containers[position].data.values);
+    memmove(&bitmap->containers[position], &bitmap->containers[position + 1], (bitmap->count - position - 1) * sizeof(struct SlotContainer));
+    bitmap->count--;
+}
+
+/*
+This function turns an array container into a bitset container. It returns 0 on success and -1 if the bitset
+could not be allocated, in which case the container is unchanged.
+*/
+static int slotArrayToBitset(struct SlotContainer *container)
+{
+    uint64_t *words = (uint64_t *)calloc(SLOT_BITSET_WORDS, sizeof(uint64_t));
+    if (words == NULL)
+    {
+        return -1;
+    }
+    for (uint32_t i = 0; i < container->cardinality; i++)
+    {
+        uint16_t value = container->data.values[i];
+        words[value >> 6] |= (uint64_t)1 << (value & 63);
+    }
+    free(container->data.values);
+    container->data.words = words;
+    container->kind = SLOT_BITSET;
+    container->capacity = SLOT_BITSET_WORDS;
+    return 0;
+}
+
+/*
+This function turns a bitset container back into a sorted array container. It returns 0 on success and -1 if
+the array could not be allocated, in which case the container is unchanged.
+*/
+static int slotBitsetToArray(struct SlotContainer *container)
+{
+    uint32_t capacity = container->cardinality == 0 ? 1 : container->cardinality;
+    uint16_t *values = (uint16_t *)malloc(capacity * sizeof(uint16_t));
+    if (values == NULL)
+    {
+        return -1;
+    }
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < SLOT_BITSET_WORDS; i++)
+    {
+        uint64_t word = container->data.words[i];
+        while (word != 0)
+        {
+            values[n++] = (uint16_t)(i * 64 + __builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+    free(container->data.words);
+    container->data.values = values;
+    container->kind = SLOT_ARRAY;
+    container->capacity = capacity;
+    return 0;
+}
+
+/*
+This function appends a copy of source to the end of out's container list. The caller guarantees that the key
+is greater than every key already in out. It returns 0 on success and -1 on allocation failure.
+*/
+static int slotBitmapAppendCopy(struct SlotBitmap *out, const struct SlotContainer *source)
+{
+    struct SlotContainer *container = slotBitmapInsertContainer(out, out->count, source->key);
+    if (container == NULL)
+    {
+        return -1;
+    }
+
+    size_t bytes = source->kind == SLOT_BITSET ? SLOT_BITSET_WORDS * sizeof(uint64_t) : source->cardinality * sizeof(uint16_t);
+    void *data = malloc(bytes == 0 ? 1 : bytes);
+    if (data == NULL)
+    {
+        out->count--;
+        return -1;
+    }
+    memcpy(data, source->data.values, bytes);
+    container->data.values = (uint16_t *)data;
+    container->kind = source->kind;
+    container->cardinality = source->cardinality;
+    container->capacity = source->kind == SLOT_BITSET ? SLOT_BITSET_WORDS : source->cardinality;
+    return 0;
+}
+
+/*
+This function initializes an empty bitmap. No memory is allocated until the first slot is added.
+*/
+void slotBitmapInit(struct SlotBitmap *bitmap)
+{
+    bitmap->containers = NULL;
+    bitmap->count = 0;
+    bitmap->capacity = 0;
+}
+
+/*
+This function releases all memory owned by the bitmap and leaves it empty.
+*/
+void slotBitmapFree(struct SlotBitmap *bitmap)
+{
+    slotBitmapClear(bitmap);
+    free(bitmap->containers);
+    slotBitmapInit(bitmap);
+}
+
+/*
+This function removes every slot from the bitmap but keeps the container list allocated for reuse.
+*/
+void slotBitmapClear(struct SlotBitmap *bitmap)
+{
+    for (size_t i = 0; i < bitmap->count; i++)
+    {
+        free(bitmap->containers[i].data.values);
+    }
+    bitmap->count = 0;
+}
+
+/*
+This function adds slot to the bitmap. An array container that would grow past SLOT_ARRAY_MAX values is
+converted to a bitset first. It returns 0 on success, including when the slot was already present, and -1
+if memory could not be allocated.
+*/
+int slotBitmapAdd(struct SlotBitmap *bitmap, uint32_t slot)
+{
+    uint16_t key = (uint16_t)(slot >> 16);
+    uint16_t value = (uint16_t)(slot & 0xffff);
+    size_t position;
+
+    struct SlotContainer *container;
+    if (slotBitmapFindContainer(bitmap, key, &position))
+    {
+        container = &bitmap->containers[position];
+    }
+    else
+    {
+        container = slotBitmapInsertContainer(bitmap, position, key);
+        if (container == NULL)
+        {
+            return -1;
+        }
+    }
+
+    if (container->kind == SLOT_ARRAY)
+    {
+        size_t index;
+        if (slotArrayFind(container, value, &index))
+        {
+            return 0;
+        }
+        if (container->cardinality < SLOT_ARRAY_MAX)
+        {
+            if (container->cardinality == container->capacity)
+            {
+                uint32_t capacity = container->capacity == 0 ? 4 : container->capacity * 2;
+                if (capacity > SLOT_ARRAY_MAX)
+                {
+                    capacity = SLOT_ARRAY_MAX;
+                }
+                uint16_t *values = (uint16_t *)realloc(container->data.values, capacity * sizeof(uint16_t));
+                if (values == NULL)
+                {
+                    return -1;
+                }
+                container->data.values = values;
+                container->capacity = capacity;
+            }
+            memmove(&container->data.values[index + 1], &container->data.values[index], (container->cardinality - index) * sizeof(uint16_t));
+            container->data.values[index] = value;
+            container->cardinality++;
+            return 0;
+        }
+        if (slotArrayToBitset(container) != 0)
+        {
+            return -1;
+        }
+    }
+
+    uint64_t bit = (uint64_t)1 << (value & 63);
+    if ((container->data.words[value >> 6] & bit) == 0)
+    {
+        container->data.words[value >> 6] |= bit;
+        container->cardinality++;
+    }
+    return 0;
+}
+
+/*
+This function removes slot from the bitmap. Empty containers are dropped, and a bitset that falls below half
+of SLOT_ARRAY_MAX is turned back into an array so that repeated adds and removes around the limit do not keep
+converting it. It returns true if the slot was present.
+*/
+bool slotBitmapRemove(struct SlotBitmap *bitmap, uint32_t slot)
+{
+    uint16_t value = (uint16_t)(slot & 0xffff);
+    size_t position;
+    if (!slotBitmapFindContainer(bitmap, (uint16_t)(slot >> 16), &position))
+    {
+        return false;
+    }
+
+    struct SlotContainer *container = &bitmap->containers[position];
+    if (container->kind == SLOT_ARRAY)
+    {
+        size_t index;
+        if (!slotArrayFind(container, value, &index))
+        {
+            return false;
+        }
+        memmove(&container->data.values[index], &container->data.values[index + 1], (container->cardinality - index - 1) * sizeof(uint16_t));
+        container->cardinality--;
+    }
+    else
+    {
+        uint64_t bit = (uint64_t)1 << (value & 63);
+        if ((container->data.words[value >> 6] & bit) == 0)
+        {
+            return false;
+        }
+        container->data.words[value >> 6] &= ~bit;
+        container->cardinality--;
+        if (container->cardinality < SLOT_ARRAY_MAX / 2)
+        {
+            // if the conversion fails the container simply stays a bitset
+            slotBitsetToArray(container);
+        }
+    }
+
+    if (container->cardinality == 0)
+    {
+        slotBitmapRemoveContainer(bitmap, position);
+    }
+    return true;
+}
+
+/*
+This function reports whether slot is in the bitmap.
+*/
+bool slotBitmapContains(const struct SlotBitmap *bitmap, uint32_t slot)
+{
+    uint16_t value = (uint16_t)(slot & 0xffff);
+    size_t position;
+    if (!slotBitmapFindContainer(bitmap, (uint16_t)(slot >> 16), &position))
+    {
+        return false;
+    }
+
+    const struct SlotContainer *container = &bitmap->containers[position];
+    if (container->kind == SLOT_ARRAY)
+    {
+        size_t index;
+        return slotArrayFind(container, value, &index);
+    }
+    return (container->data.words[value >> 6] >> (value & 63)) & 1;
+}
+
+/*
+This function returns the number of slots in the bitmap by summing the per-container counts.
+*/
+size_t slotBitmapCardinality(const struct SlotBitmap *bitmap)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < bitmap->count; i++)
+    {
+        total += bitmap->containers[i].cardinality;
+    }
+    return total;
+}
+
+/*
+This function stores the intersection of a and b in out, which must be a different bitmap from both and is
+cleared first. Containers are only compared when their keys match; two bitsets are intersected 64 slots at a
+time and an array is probed against a bitset one bit test per value. It returns 0 on success and -1 on
+allocation failure, leaving out partially filled.
+*/
+int slotBitmapAnd(const struct SlotBitmap *a, const struct SlotBitmap *b, struct SlotBitmap *out)
+{
+    slotBitmapClear(out);
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a->count && j < b->count)
+    {
+        const struct SlotContainer *left = &a->containers[i];
+        const struct SlotContainer *right = &b->containers[j];
+        if (left->key < right->key)
+        {
+            i++;
+            continue;
+        }
+        if (right->key < left->key)
+        {
+            j++;
+            continue;
+        }
+        i++;
+        j++;
+
+        // put an array container on the left whenever there is one
+        if (left->kind == SLOT_BITSET && right->kind == SLOT_ARRAY)
+        {
+            const struct SlotContainer *swap = left;
+            left = right;
+            right = swap;
+        }
+
+        struct SlotContainer *result = slotBitmapInsertContainer(out, out->count, left->key);
+        if (result == NULL)
+        {
+            return -1;
+        }
+
+        if (left->kind == SLOT_BITSET)
+        {
+            uint64_t *words = (uint64_t *)malloc(SLOT_BITSET_WORDS * sizeof(uint64_t));
+            if (words == NULL)
+            {
+                out->count--;
+                return -1;
+            }
+            uint32_t cardinality = 0;
+            for (size_t w = 0; w < SLOT_BITSET_WORDS; w++)
+            {
+                words[w] = left->data.words[w] & right->data.words[w];
+                cardinality += (uint32_t)__builtin_popcountll(words[w]);
+            }
+            result->kind = SLOT_BITSET;
+            result->data.words = words;
+            result->capacity = SLOT_BITSET_WORDS;
+            result->cardinality = cardinality;
+            if (cardinality <= SLOT_ARRAY_MAX && slotBitsetToArray(result) != 0)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            uint32_t capacity = left->cardinality;
+            uint16_t *values = (uint16_t *)malloc((capacity == 0 ? 1 : capacity) * sizeof(uint16_t));
+            if (values == NULL)
+            {
+                out->count--;
+                return -1;
+            }
+            uint32_t n = 0;
+            if (right->kind == SLOT_BITSET)
+            {
+                for (uint32_t k = 0; k < left->cardinality; k++)
+                {
+                    uint16_t value = left->data.values[k];
+                    if ((right->data.words[value >> 6] >> (value & 63)) & 1)
+                    {
+                        values[n++] = value;
+                    }
+                }
+            }
+            else
+            {
+                uint32_t p = 0;
+                uint32_t q = 0;
+                while (p < left->cardinality && q < right->cardinality)
+                {
+                    uint16_t x = left->data.values[p];
+                    uint16_t y = right->data.values[q];
+                    if (x < y)
+                    {
+                        p++;
+                    }
+                    else if (y < x)
+                    {
+                        q++;
+                    }
+                    else
+                    {
+                        values[n++] = x;
+                        p++;
+                        q++;
+                    }
+                }
+            }
+            result->data.values = values;
+            result->capacity = capacity;
+            result->cardinality = n;
+        }
+
+        if (result->cardinality == 0)
+        {
+            slotBitmapRemoveContainer(out, out->count - 1);
+        }
+    }
+    return 0;
+}
+
+/*
+This function stores the union of a and b in out, which must be a different bitmap from both and is cleared
+first. Containers present on one side only are copied; matching containers are merged, with the result kept
+as an array while it has at most SLOT_ARRAY_MAX values. It returns 0 on success and -1 on allocation failure.
+*/
+int slotBitmapOr(const struct SlotBitmap *a, const struct SlotBitmap *b, struct SlotBitmap *out)
+{
+    slotBitmapClear(out);
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a->count || j < b->count)
+    {
+        if (j == b->count || (i < a->count && a->containers[i].key < b->containers[j].key))
+        {
+            if (slotBitmapAppendCopy(out, &a->containers[i++]) != 0)
+            {
+                return -1;
+            }
+            continue;
+        }
+        if (i == a->count || b->containers[j].key < a->containers[i].key)
+        {
+            if (slotBitmapAppendCopy(out, &b->containers[j++]) != 0)
+            {
+                return -1;
+            }
+            continue;
+        }
+
+        const struct SlotContainer *left = &a->containers[i++];
+        const struct SlotContainer *right = &b->containers[j++];
+
+        if (left->kind == SLOT_ARRAY && right->kind == SLOT_ARRAY && left->cardinality + right->cardinality <= SLOT_ARRAY_MAX)
+        {
+            struct SlotContainer *result = slotBitmapInsertContainer(out, out->count, left->key);
+            if (result == NULL)
+            {
+                return -1;
+            }
+            uint32_t capacity = left->cardinality + right->cardinality;
+            uint16_t *values = (uint16_t *)malloc((capacity == 0 ? 1 : capacity) * sizeof(uint16_t));
+            if (values == NULL)
+            {
+                out->count--;
+                return -1;
+            }
+            uint32_t n = 0;
+            uint32_t p = 0;
+            uint32_t q = 0;
+            while (p < left->cardinality || q < right->cardinality)
+            {
+                if (q == right->cardinality || (p < left->cardinality && left->data.values[p] < right->data.values[q]))
+                {
+                    values[n++] = left->data.values[p++];
+                }
+                else if (p == left->cardinality || right->data.values[q] < left->data.values[p])
+                {
+                    values[n++] = right->data.values[q++];
+                }
+                else
+                {
+                    values[n++] = left->data.values[p++];
+                    q++;
+                }
+            }
+            result->data.values = values;
+            result->capacity = capacity;
+            result->cardinality = n;
+            continue;
+        }
+
+        // at least one side is dense or the merged array could overflow: build a bitset
+        if (left->kind == SLOT_ARRAY)
+        {
+            const struct SlotContainer *swap = left;
+            left = right;
+            right = swap;
+        }
+        struct SlotContainer *result = slotBitmapInsertContainer(out, out->count, left->key);
+        if (result == NULL)
+        {
+            return -1;
+        }
+        uint64_t *words = (uint64_t *)calloc(SLOT_BITSET_WORDS, sizeof(uint64_t));
+        if (words == NULL)
+        {
+            out->count--;
+            return -1;
+        }
+        if (left->kind == SLOT_BITSET)
+        {
+            memcpy(words, left->data.words, SLOT_BITSET_WORDS * sizeof(uint64_t));
+        }
+        else
+        {
+            for (uint32_t k = 0; k < left->cardinality; k++)
+            {
+                words[left->data.values[k] >> 6] |= (uint64_t)1 << (left->data.values[k] & 63);
+            }
+        }
+        if (right->kind == SLOT_BITSET)
+        {
+            for (size_t w = 0; w < SLOT_BITSET_WORDS; w++)
+            {
+                words[w] |= right->data.words[w];
+            }
+        }
+        else
+        {
+            for (uint32_t k = 0; k < right->cardinality; k++)
+            {
+                words[right->data.values[k] >> 6] |= (uint64_t)1 << (right->data.values[k] & 63);
+            }
+        }
+        uint32_t cardinality = 0;
+        for (size_t w = 0; w < SLOT_BITSET_WORDS; w++)
+        {
+            cardinality += (uint32_t)__builtin_popcountll(words[w]);
+        }
+        result->kind = SLOT_BITSET;
+        result->data.words = words;
+        result->capacity = SLOT_BITSET_WORDS;
+        result->cardinality = cardinality;
+        if (cardinality <= SLOT_ARRAY_MAX && slotBitsetToArray(result) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+This function replaces the contents of out with a copy of source. It returns 0 on success and -1 on
+allocation failure.
+*/
+int slotBitmapCopy(const struct SlotBitmap *source, struct SlotBitmap *out)
+{
+    slotBitmapClear(out);
+    for (size_t i = 0; i < source->count; i++)
+    {
+        if (slotBitmapAppendCopy(out, &source->containers[i]) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+This function writes up to capacity slots of the bitmap, in ascending order, into slots. It returns the number
+of slots written; use slotBitmapCardinality to size the buffer for the whole set.
+*/
+size_t slotBitmapToArray(const struct SlotBitmap *bitmap, uint32_t *slots, size_t capacity)
+{
+    struct SlotBitmapIterator iterator;
+    size_t n = 0;
+    slotBitmapIterate(bitmap, &iterator);
+    while (n < capacity && slotBitmapNext(&iterator, &slots[n]))
+    {
+        n++;
+    }
+    return n;
+}
+
+/*
+This function positions an iterator before the first slot of the bitmap. The bitmap must not be modified while
+it is being iterated.
+*/
+void slotBitmapIterate(const struct SlotBitmap *bitmap, struct SlotBitmapIterator *iterator)
+{
+    iterator->bitmap = bitmap;
+    iterator->container = 0;
+    iterator->position = 0;
+    iterator->word = 0;
+}
+
+/*
+This function advances the iterator. It stores the next slot and returns true, or returns false once every
+slot has been visited. Bitset containers are walked a word at a time, skipping empty words.
+*/
+bool slotBitmapNext(struct SlotBitmapIterator *iterator, uint32_t *slot)
+{
+    const struct SlotBitmap *bitmap = iterator->bitmap;
+    while (iterator->container < bitmap->count)
+    {
+        const struct SlotContainer *container = &bitmap->containers[iterator->container];
+        uint32_t base = (uint32_t)container->key << 16;
+
+        if (container->kind == SLOT_ARRAY)
+        {
+            if (iterator->position < container->cardinality)
+            {
+                *slot = base | container->data.values[iterator->position++];
+                return true;
+            }
+        }
+        else
+        {
+            while (iterator->word == 0 && iterator->position < SLOT_BITSET_WORDS)
+            {
+                iterator->word = container->data.words[iterator->position++];
+            }
+            if (iterator->word != 0)
+            {
+                *slot = base | ((iterator->position - 1) * 64 + (uint32_t)__builtin_ctzll(iterator->word));
+                iterator->word &= iterator->word - 1;
+                return true;
+            }
+        }
+
+        iterator->container++;
+        iterator->position = 0;
+        iterator->word = 0;
+    }
+    return false;
+}
+
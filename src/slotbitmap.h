@@ -0,0 +1,88 @@
+#ifndef SLOTBITMAP_H
+#define SLOTBITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Limits
+#define SLOT_ARRAY_MAX 4096
+#define SLOT_BITSET_WORDS 1024
+
+// Enums
+enum SlotContainerKind
+{
+    SLOT_ARRAY,
+    SLOT_BITSET
+};
+
+// Structs
+
+/*
+The slots of one 65536-slot block that share the same upper 16 bits. A sparse block is a sorted array of
+the lower 16 bits; once it holds more than SLOT_ARRAY_MAX slots it becomes a fixed 8 KB bitset.
+*/
+struct SlotContainer
+{
+    uint16_t key;
+    uint16_t kind;
+    uint32_t cardinality;
+    uint32_t capacity;
+    union
+    {
+        uint16_t *values;
+        uint64_t *words;
+    } data;
+};
+
+/*
+A compressed set of slots in the style of a roaring bitmap: containers sorted by key, each either a sorted
+array or a bitset, so both sparse and dense sets stay small and set operations work a word at a time.
+*/
+struct SlotBitmap
+{
+    struct SlotContainer *containers;
+    size_t count;
+    size_t capacity;
+};
+
+/*
+Iterates the slots of a bitmap in ascending order. Initialise it with slotBitmapIterate.
+*/
+struct SlotBitmapIterator
+{
+    const struct SlotBitmap *bitmap;
+    size_t container;
+    uint32_t position;
+    uint64_t word;
+};
+
+// Functions
+
+void slotBitmapInit(struct SlotBitmap *bitmap);
+
+void slotBitmapFree(struct SlotBitmap *bitmap);
+
+void slotBitmapClear(struct SlotBitmap *bitmap);
+
+int slotBitmapAdd(struct SlotBitmap *bitmap, uint32_t slot);
+
+bool slotBitmapRemove(struct SlotBitmap *bitmap, uint32_t slot);
+
+bool slotBitmapContains(const struct SlotBitmap *bitmap, uint32_t slot);
+
+size_t slotBitmapCardinality(const struct SlotBitmap *bitmap);
+
+int slotBitmapAnd(const struct SlotBitmap *a, const struct SlotBitmap *b, struct SlotBitmap *out);
+
+int slotBitmapOr(const struct SlotBitmap *a, const struct SlotBitmap *b, struct SlotBitmap *out);
+
+int slotBitmapCopy(const struct SlotBitmap *source, struct SlotBitmap *out);
+
+size_t slotBitmapToArray(const struct SlotBitmap *bitmap, uint32_t *slots, size_t capacity);
+
+void slotBitmapIterate(const struct SlotBitmap *bitmap, struct SlotBitmapIterator *iterator);
+
+bool slotBitmapNext(struct SlotBitmapIterator *iterator, uint32_t *slot);
+
+#endif
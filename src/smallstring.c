@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include "smallstring.h"
+
+/*
+This function initializes an empty arena.
+*/
+void stringArenaInit(struct StringArena *arena)
+{
+    arena->chunks = NULL;
+    arena->bytes = 0;
+}
+
+/*
+This function releases every chunk of the arena, invalidating all strings allocated from it.
+*/
+void stringArenaFree(struct StringArena *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+    while (arena->chunks != NULL)
+    {
+        struct StringArenaChunk *next = arena->chunks->next;
+        free(arena->chunks);
+        arena->chunks = next;
+    }
+    arena->bytes = 0;
+}
+
+/*
+This function returns size bytes from the current chunk, starting a new chunk when it is full. Only the newest
+chunk is bumped, so the tail of a previous chunk too small for one allocation is not reused. It returns NULL if
+memory could not be allocated.
+*/
+char *stringArenaAlloc(struct StringArena *arena, size_t size)
+{
+    struct StringArenaChunk *chunk = arena->chunks;
+    if (chunk == NULL || chunk->size - chunk->used < size)
+    {
+        size_t capacity = size > STRING_ARENA_CHUNK ? size : STRING_ARENA_CHUNK;
+        chunk = (struct StringArenaChunk *)malloc(sizeof(struct StringArenaChunk) + capacity);
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+        chunk->used = 0;
+        chunk->size = capacity;
+        // an oversized chunk goes behind the current one, which still has room for small strings
+        if (size > STRING_ARENA_CHUNK && arena->chunks != NULL)
+        {
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        }
+        else
+        {
+            chunk->next = arena->chunks;
+            arena->chunks = chunk;
+        }
+        arena->bytes += sizeof(struct StringArenaChunk) + capacity;
+    }
+    char *bytes = (char *)(chunk + 1) + chunk->used;
+    chunk->used += size;
+    return bytes;
+}
+
+/*
+This function stores the length bytes at data, which need not be NUL-terminated, in string: inline when they
+fit, otherwise NUL-terminated in arena. It returns 0 on success and -1 if arena could not grow, in which case
+string is unchanged.
+*/
+int smallStringSet(struct SmallString *string, struct StringArena *arena, const char *data, size_t length)
+{
+    if (length <= SMALL_STRING_INLINE)
+    {
+        memcpy(string->value.bytes, data, length);
+        memset(string->value.bytes + length, 0, SMALL_STRING_SIZE - 1 - length);
+        string->value.bytes[SMALL_STRING_SIZE - 1] = (char)length;
+        return 0;
+    }
+
+    char *copy = stringArenaAlloc(arena, length + 1);
+    if (copy == NULL)
+    {
+        return -1;
+    }
+    memcpy(copy, data, length);
+    copy[length] = '\0';
+    string->value.overflow.data = copy;
+    string->value.overflow.length = length;
+    string->value.bytes[SMALL_STRING_SIZE - 1] = (char)SMALL_STRING_OVERFLOW;
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef SMALLSTRING_H
+#define SMALLSTRING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Constants
+#define SMALL_STRING_SIZE 24
+#define SMALL_STRING_INLINE (SMALL_STRING_SIZE - 2)
+#define SMALL_STRING_OVERFLOW 0xff
+#define STRING_ARENA_CHUNK 65536
+
+// Structs
+
+/*
+One block of a StringArena; its bytes follow the header.
+*/
+struct StringArenaChunk
+{
+    struct StringArenaChunk *next;
+    size_t used;
+    size_t size;
+};
+
+/*
+A bump allocator for string bytes. Allocations are carved out of STRING_ARENA_CHUNK-byte chunks, larger ones
+get a chunk of their own, and nothing is freed before the whole arena is.
+*/
+struct StringArena
+{
+    struct StringArenaChunk *chunks;
+    size_t bytes;
+};
+
+/*
+A string of any length in 24 bytes. Up to SMALL_STRING_INLINE bytes are stored inline, NUL-terminated, with
+the length in the last byte; a longer string lives in a StringArena and the last byte is
+SMALL_STRING_OVERFLOW. The length is always known, so comparisons check it before looking at any byte.
+*/
+struct SmallString
+{
+    union
+    {
+        char bytes[SMALL_STRING_SIZE];
+        struct
+        {
+            const char *data;
+            size_t length;
+        } overflow;
+    } value;
+};
+
+// Functions
+
+void stringArenaInit(struct StringArena *arena);
+
+void stringArenaFree(struct StringArena *arena);
+
+char *stringArenaAlloc(struct StringArena *arena, size_t size);
+
+int smallStringSet(struct SmallString *string, struct StringArena *arena, const char *data, size_t length);
+
+static inline bool smallStringIsInline(const struct SmallString *string)
+{
+    return (uint8_t)string->value.bytes[SMALL_STRING_SIZE - 1] != SMALL_STRING_OVERFLOW;
+}
+
+static inline size_t smallStringLength(const struct SmallString *string)
+{
+    return smallStringIsInline(string) ? (uint8_t)string->value.bytes[SMALL_STRING_SIZE - 1] : string->value.overflow.length;
+}
+
+/*
+This function returns the bytes of a string, which are NUL-terminated in both representations.
+*/
+static inline const char *smallStringData(const struct SmallString *string)
+{
+    return smallStringIsInline(string) ? string->value.bytes : string->value.overflow.data;
+}
+
+static inline bool smallStringEquals(const struct SmallString *string, const char *data, size_t length)
+{
+    return smallStringLength(string) == length && memcmp(smallStringData(string), data, length) == 0;
+}
+
+#endif
@@ -0,0 +1,456 @@
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "snapshot.h"
+
+/*
+This function rounds offset up to the next multiple of SNAPSHOT_ALIGN.
+*/
+static uint64_t snapshotAlign(uint64_t offset)
+{
+    return (offset + SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SNAPSHOT_ALIGN - 1);
+}
+
+/*
+This function returns the position of the slot list for a type (subtype -1) or for a subtype of a type.
+*/
+static size_t snapshotList(int type, int subtype)
+{
+    return subtype < 0 ? (size_t)type : STORE_TYPES + (size_t)type * STORE_SUBTYPES + (size_t)subtype;
+}
+
+/*
+This function computes the checksum stored in a snapshot. It mixes four independent 64-bit lanes so that a
+multi-gigabyte body is hashed at several bytes per cycle, then folds in the tail bytes and the length. It is
+meant to detect torn writes and bit rot, not tampering.
+*/
+uint64_t snapshotChecksum(const void *data, size_t size)
+{
+    const uint64_t prime = 0x9e3779b97f4a7c15ULL;
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint64_t lanes[4] = {prime, prime * 3, prime * 5, prime * 7};
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int lane = 0; lane < 4; lane++)
+        {
+            uint64_t word;
+            memcpy(&word, &bytes[i + 8 * lane], sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * prime;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+
+    uint64_t hash = (uint64_t)size * prime;
+    for (int lane = 0; lane < 4; lane++)
+    {
+        hash = (hash ^ lanes[lane]) * 1099511628211ULL;
+        hash ^= hash >> 31;
+    }
+    for (; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash ^ (hash >> 32);
+}
+
+/*
+This function writes the live materials of a store, in slot order, to a snapshot file at path. Slots are
+renumbered densely, so the snapshot never contains dead slots. The title and type indexes are built directly
+in a mapping of the new file, which is written under a temporary name, flushed to disk and then renamed over
+path, so readers never see a partly written snapshot. The file's blocks are allocated before it is mapped. It
+returns 0 on success, -1 if an argument is NULL or the store holds too many materials, and -2 if the file could
+not be created, allocated, mapped, flushed or renamed.
+*/
+int snapshotWrite(const struct ArchiveStore *store, const char *path)
+{
+    return snapshotWriteSequence(store, path, 0);
+}
+
+/*
+This function writes a snapshot like snapshotWrite and records in it the sequence number of the last
+write-ahead log record applied to the store, so that replay after a checkpoint skips the records it already
+contains.
+*/
+int snapshotWriteSequence(const struct ArchiveStore *store, const char *path, uint64_t sequence)
+{
+    if (store == NULL || path == NULL || store->count >= TITLE_INDEX_NONE)
+    {
+        return -1;
+    }
+
+    struct SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.recordSize = sizeof(struct Material);
+    header.count = store->count;
+    header.sequence = sequence;
+
+    uint64_t buckets = 16;
+    while (buckets < header.count * 2)
+    {
+        buckets *= 2;
+    }
+
+    // size the slot lists first so that each one can be filled in place
+    uint64_t listed = 0;
+    for (size_t slot = 0; slot < store->slots; slot++)
+    {
+        const struct Material *material = storeAt(store, slot);
+        if (!storeIsLive(store, slot) || material->type < BOOK || material->type > NEWSPAPER)
+        {
+            continue;
+        }
+        header.listCount[snapshotList(material->type, -1)]++;
+        int subtype = materialSubtype(material);
+        if (subtype >= 0)
+        {
+            header.listCount[snapshotList(material->type, subtype)]++;
+        }
+    }
+    for (size_t list = 0; list < SNAPSHOT_LISTS; list++)
+    {
+        header.listStart[list] = listed;
+        listed += header.listCount[list];
+    }
+
+    header.materialsOffset = snapshotAlign(sizeof(header));
+    header.titlesOffset = snapshotAlign(header.materialsOffset + header.count * sizeof(struct Material));
+    header.titleBuckets = buckets;
+    header.listsOffset = snapshotAlign(header.titlesOffset + buckets * sizeof(struct TitleIndexEntry));
+    header.fileSize = header.listsOffset + listed * sizeof(uint32_t);
+
+    size_t length = strlen(path);
+    char *temporary = (char *)malloc(length + 5);
+    if (temporary == NULL)
+    {
+        return -2;
+    }
+    memcpy(temporary, path, length);
+    memcpy(&temporary[length], ".tmp", 5);
+
+    int fd = open(temporary, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        free(temporary);
+        return -2;
+    }
+    // allocate every block before mapping, so a full disk fails here instead of raising SIGBUS on a store into a
+    // hole of a sparse file
+    if (posix_fallocate(fd, 0, (off_t)header.fileSize) != 0)
+    {
+        close(fd);
+        unlink(temporary);
+        free(temporary);
+        return -2;
+    }
+    uint8_t *base = (uint8_t *)mmap(NULL, header.fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        unlink(temporary);
+        free(temporary);
+        return -2;
+    }
+
+    struct Material *materials = (struct Material *)&base[header.materialsOffset];
+    struct TitleIndexEntry *titles = (struct TitleIndexEntry *)&base[header.titlesOffset];
+    uint32_t *lists = (uint32_t *)&base[header.listsOffset];
+    uint32_t filled[SNAPSHOT_LISTS] = {0};
+    memset(titles, 0xff, buckets * sizeof(struct TitleIndexEntry));
+
+    uint32_t dense = 0;
+    for (size_t slot = 0; slot < store->slots; slot++)
+    {
+        if (!storeIsLive(store, slot))
+        {
+            continue;
+        }
+        const struct Material *material = storeAt(store, slot);
+        materials[dense] = *material;
+
+        uint32_t hash = titleHash(material->title);
+        size_t pos = hash & (buckets - 1);
+        while (titles[pos].slot != TITLE_INDEX_NONE)
+        {
+            pos = (pos + 1) & (buckets - 1);
+        }
+        titles[pos].hash = hash;
+        titles[pos].slot = dense;
+
+        if (material->type >= BOOK && material->type <= NEWSPAPER)
+        {
+            size_t list = snapshotList(material->type, -1);
+            lists[header.listStart[list] + filled[list]++] = dense;
+            int subtype = materialSubtype(material);
+            if (subtype >= 0)
+            {
+                list = snapshotList(material->type, subtype);
+                lists[header.listStart[list] + filled[list]++] = dense;
+            }
+        }
+        dense++;
+    }
+
+    header.bodyChecksum = snapshotChecksum(&base[sizeof(header)], header.fileSize - sizeof(header));
+    header.headerChecksum = snapshotChecksum(&header, offsetof(struct SnapshotHeader, headerChecksum));
+    memcpy(base, &header, sizeof(header));
+
+    int status = msync(base, header.fileSize, MS_SYNC) == 0 ? 0 : -2;
+    munmap(base, header.fileSize);
+    if (close(fd) != 0)
+    {
+        status = -2;
+    }
+    if (status == 0 && rename(temporary, path) != 0)
+    {
+        status = -2;
+    }
+    if (status != 0)
+    {
+        unlink(temporary);
+    }
+    free(temporary);
+    return status;
+}
+
+/*
+This function checks that the header of a mapped file describes a snapshot this build can read and that every
+section it points to lies inside the file. It returns 0 if so, -2 if the file is not a snapshot of this
+version, byte order and record layout or its header checksum does not match, and -4 if the sections do not
+fit the file.
+*/
+static int snapshotCheckHeader(const struct SnapshotHeader *header, size_t size)
+{
+    if (size < sizeof(*header) || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+    {
+        return -2;
+    }
+    if (header->version != SNAPSHOT_VERSION || header->byteOrder != SNAPSHOT_BYTE_ORDER || header->recordSize != sizeof(struct Material))
+    {
+        return -2;
+    }
+    if (header->headerChecksum != snapshotChecksum(header, offsetof(struct SnapshotHeader, headerChecksum)))
+    {
+        return -2;
+    }
+
+    uint64_t buckets = header->titleBuckets;
+    if (header->fileSize != size || header->count >= TITLE_INDEX_NONE || buckets <= header->count || (buckets & (buckets - 1)) != 0)
+    {
+        return -4;
+    }
+    if (header->materialsOffset < sizeof(*header) || header->materialsOffset % SNAPSHOT_ALIGN != 0 ||
+        header->titlesOffset % SNAPSHOT_ALIGN != 0 || header->listsOffset % SNAPSHOT_ALIGN != 0)
+    {
+        return -4;
+    }
+    if (header->titlesOffset > size || header->listsOffset > size ||
+        header->count > (header->titlesOffset - header->materialsOffset) / sizeof(struct Material) ||
+        header->titlesOffset < header->materialsOffset || header->listsOffset < header->titlesOffset ||
+        buckets > (header->listsOffset - header->titlesOffset) / sizeof(struct TitleIndexEntry))
+    {
+        return -4;
+    }
+
+    uint64_t listed = (size - header->listsOffset) / sizeof(uint32_t);
+    for (size_t list = 0; list < SNAPSHOT_LISTS; list++)
+    {
+        if (header->listStart[list] > listed || header->listCount[list] > listed - header->listStart[list])
+        {
+            return -4;
+        }
+    }
+    return 0;
+}
+
+/*
+This function maps the snapshot file at path read-only and points snapshot at its sections. Only the header is
+read and checked, so opening takes the same time for any size of archive. With SNAPSHOT_VERIFY in flags the
+whole file is also checked with snapshotVerify before it is used. It returns 0 on success, -1 if an argument is
+NULL or the file cannot be opened or mapped, -2 if it is not a snapshot this build can read, -3 if
+verification fails and -4 if it is truncated or its sections are inconsistent. On failure nothing stays
+mapped.
+*/
+int snapshotOpen(struct Snapshot *snapshot, const char *path, unsigned flags)
+{
+    if (snapshot == NULL || path == NULL)
+    {
+        return -1;
+    }
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    if ((size_t)info.st_size < sizeof(struct SnapshotHeader))
+    {
+        close(fd);
+        return -2;
+    }
+    size_t size = (size_t)info.st_size;
+    void *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    const struct SnapshotHeader *header = (const struct SnapshotHeader *)base;
+    int status = snapshotCheckHeader(header, size);
+    if (status != 0)
+    {
+        munmap(base, size);
+        return status;
+    }
+
+    snapshot->base = (const uint8_t *)base;
+    snapshot->size = size;
+    snapshot->header = header;
+    snapshot->materials = (const struct Material *)&snapshot->base[header->materialsOffset];
+    snapshot->count = header->count;
+    snapshot->titles = (const struct TitleIndexEntry *)&snapshot->base[header->titlesOffset];
+    snapshot->titleMask = header->titleBuckets - 1;
+    snapshot->lists = (const uint32_t *)&snapshot->base[header->listsOffset];
+
+    if ((flags & SNAPSHOT_VERIFY) != 0 && snapshotVerify(snapshot) != 0)
+    {
+        snapshotClose(snapshot);
+        return -3;
+    }
+    return 0;
+}
+
+/*
+This function unmaps the snapshot. Pointers obtained from it become invalid.
+*/
+void snapshotClose(struct Snapshot *snapshot)
+{
+    if (snapshot == NULL || snapshot->base == NULL)
+    {
+        return;
+    }
+    munmap((void *)snapshot->base, snapshot->size);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+/*
+This function reads the whole snapshot and checks the body checksum and that every slot in the title index
+and slot lists refers to a stored material. It touches every page, so it costs a full read of the file. It
+returns 0 if the snapshot is intact and -3 otherwise.
+*/
+int snapshotVerify(const struct Snapshot *snapshot)
+{
+    const struct SnapshotHeader *header = snapshot->header;
+    if (header->bodyChecksum != snapshotChecksum(&snapshot->base[sizeof(*header)], snapshot->size - sizeof(*header)))
+    {
+        return -3;
+    }
+    for (size_t pos = 0; pos <= snapshot->titleMask; pos++)
+    {
+        uint32_t slot = snapshot->titles[pos].slot;
+        if (slot != TITLE_INDEX_NONE && slot >= snapshot->count)
+        {
+            return -3;
+        }
+    }
+    for (size_t list = 0; list < SNAPSHOT_LISTS; list++)
+    {
+        for (uint64_t i = 0; i < header->listCount[list]; i++)
+        {
+            if (snapshot->lists[header->listStart[list] + i] >= snapshot->count)
+            {
+                return -3;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+This function searches the snapshot for a material with the given title using its title index, with the same
+case-sensitive semantics as findMaterial. It returns a pointer into the mapping, valid until the snapshot is
+closed, or NULL if no material has that title. Probes are bounded by the table size, so a damaged index cannot
+make the lookup loop forever.
+*/
+const struct Material *snapshotFindMaterial(const struct Snapshot *snapshot, const char *title)
+{
+    if (snapshot == NULL || snapshot->base == NULL || title == NULL)
+    {
+        return NULL;
+    }
+
+    uint32_t hash = titleHash(title);
+    size_t pos = hash & snapshot->titleMask;
+    for (size_t probes = 0; probes <= snapshot->titleMask; probes++)
+    {
+        const struct TitleIndexEntry *entry = &snapshot->titles[pos];
+        if (entry->slot == TITLE_INDEX_NONE)
+        {
+            return NULL;
+        }
+        if (entry->hash == hash && entry->slot < snapshot->count)
+        {
+            const struct Material *material = &snapshot->materials[entry->slot];
+            if (strncmp(material->title, title, sizeof(material->title)) == 0)
+            {
+                return material;
+            }
+        }
+        pos = (pos + 1) & snapshot->titleMask;
+    }
+    return NULL;
+}
+
+/*
+This function returns the ascending slots of every material of the given type, stored in the snapshot by the
+writer, and sets count to their number. Slots index snapshot->materials. It returns NULL and sets count to 0 for
+an invalid type.
+*/
+const uint32_t *snapshotFilterMaterials(const struct Snapshot *snapshot, enum MaterialType type, size_t *count)
+{
+    return snapshotFilterMaterialsBySubtype(snapshot, type, -1, count);
+}
+
+/*
+This function returns the ascending slots of every material of the given type and subtype, or of the type
+alone if subtype is -1, and sets count to their number. It returns NULL and sets count to 0 if the type or
+subtype is out of range.
+*/
+const uint32_t *snapshotFilterMaterialsBySubtype(const struct Snapshot *snapshot, enum MaterialType type, int subtype, size_t *count)
+{
+    *count = 0;
+    if (snapshot == NULL || snapshot->base == NULL || type < BOOK || type > NEWSPAPER || subtype < -1 || subtype >= STORE_SUBTYPES)
+    {
+        return NULL;
+    }
+    size_t list = snapshotList(type, subtype);
+    *count = snapshot->header->listCount[list];
+    return &snapshot->lists[snapshot->header->listStart[list]];
+}
+
+/*
+This function copies every material of the snapshot into a store with storeAddMaterials, for callers that need
+to modify an archive loaded from disk. It returns the number of materials added.
+*/
+size_t snapshotLoadStore(const struct Snapshot *snapshot, struct ArchiveStore *store)
+{
+    if (snapshot == NULL || snapshot->base == NULL)
+    {
+        return 0;
+    }
+    return storeAddMaterials(store, snapshot->materials, snapshot->count, STORE_BULK_DEFAULT, NULL);
+}
@@ -0,0 +1,88 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "store.h"
+
+// Format
+#define SNAPSHOT_MAGIC "MATSNAP"
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+#define SNAPSHOT_ALIGN 64
+#define SNAPSHOT_LISTS (STORE_TYPES + STORE_TYPES * STORE_SUBTYPES)
+
+// Open flags
+#define SNAPSHOT_VERIFY 1u
+
+// Structs
+
+/*
+The first bytes of a snapshot file. All offsets are from the start of the file and aligned to SNAPSHOT_ALIGN.
+The file holds count material records, a title index of titleBuckets entries laid out like a TitleIndex, and
+the slot lists of the type and subtype indexes in one uint32_t array: list i covers listStart[i] to
+listStart[i] + listCount[i], with the three types first and then the subtypes of each type. sequence is the
+last write-ahead log record the snapshot includes, or 0 if it was not written by a checkpoint. Values are stored
+in the byte order of the machine that wrote the file, which byteOrder records. bodyChecksum covers everything
+after the header and headerChecksum every header byte before it.
+*/
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t recordSize;
+    uint32_t reserved;
+    uint64_t fileSize;
+    uint64_t count;
+    uint64_t materialsOffset;
+    uint64_t titlesOffset;
+    uint64_t titleBuckets;
+    uint64_t listsOffset;
+    uint64_t sequence;
+    uint64_t listStart[SNAPSHOT_LISTS];
+    uint64_t listCount[SNAPSHOT_LISTS];
+    uint64_t bodyChecksum;
+    uint64_t headerChecksum;
+};
+
+/*
+A read-only archive mapped from a snapshot file. Nothing is parsed or copied when it is opened: materials,
+titles and slot lists all point into the mapping, so the pages are read from disk on first use and shared
+with every other process mapping the same file.
+*/
+struct Snapshot
+{
+    const uint8_t *base;
+    size_t size;
+    const struct SnapshotHeader *header;
+    const struct Material *materials;
+    size_t count;
+    const struct TitleIndexEntry *titles;
+    size_t titleMask;
+    const uint32_t *lists;
+};
+
+// Functions
+
+uint64_t snapshotChecksum(const void *data, size_t size);
+
+int snapshotWrite(const struct ArchiveStore *store, const char *path);
+
+int snapshotWriteSequence(const struct ArchiveStore *store, const char *path, uint64_t sequence);
+
+int snapshotOpen(struct Snapshot *snapshot, const char *path, unsigned flags);
+
+void snapshotClose(struct Snapshot *snapshot);
+
+int snapshotVerify(const struct Snapshot *snapshot);
+
+const struct Material *snapshotFindMaterial(const struct Snapshot *snapshot, const char *title);
+
+const uint32_t *snapshotFilterMaterials(const struct Snapshot *snapshot, enum MaterialType type, size_t *count);
+
+const uint32_t *snapshotFilterMaterialsBySubtype(const struct Snapshot *snapshot, enum MaterialType type, int subtype, size_t *count);
+
+size_t snapshotLoadStore(const struct Snapshot *snapshot, struct ArchiveStore *store);
+
+#endif
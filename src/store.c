@@ -0,0 +1,2081 @@
+#include <pthread.h>
+#include <unistd.h>
+#include "metrics.h"
+#include "store.h"
+
+// the store whose slots qsort is ordering by title
+static __thread const struct ArchiveStore *sortStore = NULL;
+
+/*
+This function is the key function handed to the title index: it returns the title stored at a slot.
+*/
+static const char *storeTitleKey(const void *context, uint32_t slot)
+{
+    return storeAt((const struct ArchiveStore *)context, slot)->title;
+}
+
+/*
+This function adds slot to the type and subtype bitmaps matching the material. Materials with an invalid type
+or subtype are left out of the bitmaps they do not belong to. It returns 0 on success and -1 on allocation
+failure.
+*/
+static int storeIndexType(struct ArchiveStore *store, const struct Material *material, uint32_t slot)
+{
+    if (material->type < BOOK || material->type > NEWSPAPER)
+    {
+        return 0;
+    }
+    if (slotBitmapAdd(&store->typeSlots[material->type], slot) != 0)
+    {
+        return -1;
+    }
+    int subtype = materialSubtype(material);
+    if (subtype >= 0 && slotBitmapAdd(&store->subtypeSlots[material->type][subtype], slot) != 0)
+    {
+        slotBitmapRemove(&store->typeSlots[material->type], slot);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+This function removes slot from the type and subtype bitmaps matching the material.
+*/
+static void storeUnindexType(struct ArchiveStore *store, const struct Material *material, uint32_t slot)
+{
+    if (material->type < BOOK || material->type > NEWSPAPER)
+    {
+        return;
+    }
+    slotBitmapRemove(&store->typeSlots[material->type], slot);
+    int subtype = materialSubtype(material);
+    if (subtype >= 0)
+    {
+        slotBitmapRemove(&store->subtypeSlots[material->type][subtype], slot);
+    }
+}
+
+/*
+This function adds delta, 1 or -1, to the type and subtype counters and the page total matching the material.
+*/
+static void storeCountMaterial(struct ArchiveStore *store, const struct Material *material, int delta)
+{
+    if (material->type < BOOK || material->type > NEWSPAPER)
+    {
+        return;
+    }
+    store->stats.types[material->type] += (size_t)(ptrdiff_t)delta;
+    int subtype = materialSubtype(material);
+    if (subtype >= 0)
+    {
+        store->stats.subtypes[material->type][subtype] += (size_t)(ptrdiff_t)delta;
+    }
+    if (material->type == BOOK)
+    {
+        store->stats.pages += (int64_t)delta * material->details.book.pages;
+    }
+}
+
+/*
+This function returns the pages of a book or the issue of a journal, the value held in the number column.
+*/
+static int32_t storeMaterialNumber(const struct Material *material)
+{
+    switch (material->type)
+    {
+    case BOOK:
+        return material->details.book.pages;
+    case JOURNAL:
+        return material->details.journal.issue;
+    default:
+        return 0;
+    }
+}
+
+/*
+This function adds slot to the number index of the material's type. Newspapers and materials with an invalid
+type have no number and are left out. It returns 0 on success and -1 on allocation failure.
+*/
+static int storeIndexNumber(struct ArchiveStore *store, const struct Material *material, uint32_t slot)
+{
+    if (material->type != BOOK && material->type != JOURNAL)
+    {
+        return 0;
+    }
+    return numberIndexAdd(&store->numbers[material->type], storeMaterialNumber(material), slot);
+}
+
+/*
+This function removes slot from the number index of the material's type.
+*/
+static void storeUnindexNumber(struct ArchiveStore *store, const struct Material *material, uint32_t slot)
+{
+    if (material->type == BOOK || material->type == JOURNAL)
+    {
+        numberIndexRemove(&store->numbers[material->type], storeMaterialNumber(material), slot);
+    }
+}
+
+/*
+This function adds slot to the posting list of every trigram of the folded title. It returns 0 on success and -1
+on allocation failure, in which case the postings already added are removed again.
+*/
+static int storeIndexTrigrams(struct ArchiveStore *store, const char *title, uint32_t slot)
+{
+    uint32_t key[FUZZY_KEY_MAX];
+    char trigrams[FUZZY_TRIGRAMS_MAX][FUZZY_TRIGRAM_BYTES];
+    size_t count = fuzzyTrigrams(key, fuzzyNormalize(title, key, FUZZY_KEY_MAX), trigrams, FUZZY_TRIGRAMS_MAX);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (personIndexAdd(&store->trigrams, trigrams[i], slot) != 0)
+        {
+            while (i-- > 0)
+            {
+                personIndexRemove(&store->trigrams, trigrams[i], slot);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+This function removes slot from the posting lists of the trigrams of title, or moves it to slot to if to is
+not TITLE_INDEX_NONE.
+*/
+static void storeUnindexTrigrams(struct ArchiveStore *store, const char *title, uint32_t slot, uint32_t to)
+{
+    uint32_t key[FUZZY_KEY_MAX];
+    char trigrams[FUZZY_TRIGRAMS_MAX][FUZZY_TRIGRAM_BYTES];
+    size_t count = fuzzyTrigrams(key, fuzzyNormalize(title, key, FUZZY_KEY_MAX), trigrams, FUZZY_TRIGRAMS_MAX);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (to == TITLE_INDEX_NONE)
+        {
+            personIndexRemove(&store->trigrams, trigrams[i], slot);
+        }
+        else
+        {
+            personIndexRelocate(&store->trigrams, trigrams[i], slot, to);
+        }
+    }
+}
+
+/*
+This function records a material stored at slot in every index and in the aggregate counts. If any index cannot
+be updated the entries already made are undone, so the indexes never disagree. It returns 0 on success and -1 on
+allocation failure.
+*/
+static int storeIndexMaterial(struct ArchiveStore *store, const struct Material *material, uint32_t hash, uint32_t slot)
+{
+    if (titleIndexInsert(&store->titles, hash, slot) != 0)
+    {
+        return -1;
+    }
+    const char *contributor = materialContributor(material);
+    if (contributor != NULL && personIndexAdd(&store->people, contributor, slot) != 0)
+    {
+        titleIndexRemove(&store->titles, hash, slot);
+        return -1;
+    }
+    if (storeIndexType(store, material, slot) != 0)
+    {
+        if (contributor != NULL)
+        {
+            personIndexRemove(&store->people, contributor, slot);
+        }
+        titleIndexRemove(&store->titles, hash, slot);
+        return -1;
+    }
+    if (store->columnar && columnsSet(&store->columns, slot, material) != 0)
+    {
+        storeUnindexType(store, material, slot);
+        if (contributor != NULL)
+        {
+            personIndexRemove(&store->people, contributor, slot);
+        }
+        titleIndexRemove(&store->titles, hash, slot);
+        return -1;
+    }
+    if (store->fuzzy && storeIndexTrigrams(store, material->title, slot) != 0)
+    {
+        if (store->columnar)
+        {
+            columnsClear(&store->columns, slot);
+        }
+        storeUnindexType(store, material, slot);
+        if (contributor != NULL)
+        {
+            personIndexRemove(&store->people, contributor, slot);
+        }
+        titleIndexRemove(&store->titles, hash, slot);
+        return -1;
+    }
+    if (store->searchable && titleSearchAdd(&store->search, material->title, strlen(material->title), slot) != 0)
+    {
+        if (store->fuzzy)
+        {
+            storeUnindexTrigrams(store, material->title, slot, TITLE_INDEX_NONE);
+        }
+        if (store->columnar)
+        {
+            columnsClear(&store->columns, slot);
+        }
+        storeUnindexType(store, material, slot);
+        if (contributor != NULL)
+        {
+            personIndexRemove(&store->people, contributor, slot);
+        }
+        titleIndexRemove(&store->titles, hash, slot);
+        return -1;
+    }
+    if (store->ordered && storeIndexNumber(store, material, slot) != 0)
+    {
+        if (store->searchable)
+        {
+            titleSearchRemove(&store->search, slot);
+        }
+        if (store->fuzzy)
+        {
+            storeUnindexTrigrams(store, material->title, slot, TITLE_INDEX_NONE);
+        }
+        if (store->columnar)
+        {
+            columnsClear(&store->columns, slot);
+        }
+        storeUnindexType(store, material, slot);
+        if (contributor != NULL)
+        {
+            personIndexRemove(&store->people, contributor, slot);
+        }
+        titleIndexRemove(&store->titles, hash, slot);
+        return -1;
+    }
+    storeCountMaterial(store, material, 1);
+    return 0;
+}
+
+/*
+This function removes a material stored at slot from every index and from the aggregate counts.
+*/
+static void storeUnindexMaterial(struct ArchiveStore *store, const struct Material *material, uint32_t hash, uint32_t slot)
+{
+    titleIndexRemove(&store->titles, hash, slot);
+    const char *contributor = materialContributor(material);
+    if (contributor != NULL)
+    {
+        personIndexRemove(&store->people, contributor, slot);
+    }
+    storeUnindexType(store, material, slot);
+    if (store->columnar)
+    {
+        columnsClear(&store->columns, slot);
+    }
+    if (store->searchable)
+    {
+        titleSearchRemove(&store->search, slot);
+    }
+    if (store->fuzzy)
+    {
+        storeUnindexTrigrams(store, material->title, slot, TITLE_INDEX_NONE);
+    }
+    if (store->ordered)
+    {
+        storeUnindexNumber(store, material, slot);
+    }
+    storeCountMaterial(store, material, -1);
+}
+
+/*
+This function fills a StoreConfig with the default settings: chunks of STORE_DEFAULT_CHUNK_SIZE materials
+and no upper limit on the number of materials.
+*/
+void storeDefaultConfig(struct StoreConfig *config)
+{
+    config->chunkSize = STORE_DEFAULT_CHUNK_SIZE;
+    config->maxCapacity = 0;
+    config->removeMode = STORE_REMOVE_TOMBSTONE;
+    config->compactionBudget = 0;
+    config->columnar = false;
+    config->searchable = false;
+    config->fuzzy = false;
+    config->ordered = false;
+}
+
+/*
+This function initializes an empty ArchiveStore. If config is NULL the defaults are used. The chunk size is
+rounded up to the next power of two so that a slot number can be split into a chunk index and an offset with
+a shift and a mask. No memory is allocated until the first material is added. It returns 0 on success and
+-1 if store is NULL.
+*/
+int storeInit(struct ArchiveStore *store, const struct StoreConfig *config)
+{
+    struct StoreConfig defaults;
+
+    if (store == NULL)
+    {
+        return -1;
+    }
+    if (config == NULL)
+    {
+        storeDefaultConfig(&defaults);
+        config = &defaults;
+    }
+
+    size_t chunkSize = config->chunkSize == 0 ? STORE_DEFAULT_CHUNK_SIZE : config->chunkSize;
+    size_t shift = 0;
+    while (((size_t)1 << shift) < chunkSize)
+    {
+        shift++;
+    }
+
+    memset(store, 0, sizeof(*store));
+    store->chunkShift = shift;
+    store->chunkMask = ((size_t)1 << shift) - 1;
+    store->maxCapacity = config->maxCapacity;
+    store->removeMode = config->removeMode;
+    store->compactionBudget = config->compactionBudget;
+    store->columnar = config->columnar;
+    columnsInit(&store->columns);
+    store->searchable = config->searchable;
+    titleSearchInit(&store->search);
+    store->fuzzy = config->fuzzy;
+    personIndexInit(&store->trigrams);
+    store->ordered = config->ordered;
+    for (int type = 0; type < STORE_TYPES; type++)
+    {
+        numberIndexInit(&store->numbers[type]);
+    }
+    titleIndexInit(&store->titles);
+    personIndexInit(&store->people);
+    for (int type = BOOK; type <= NEWSPAPER; type++)
+    {
+        slotBitmapInit(&store->typeSlots[type]);
+        for (int subtype = 0; subtype < STORE_SUBTYPES; subtype++)
+        {
+            slotBitmapInit(&store->subtypeSlots[type][subtype]);
+        }
+    }
+    return 0;
+}
+
+/*
+This function releases every chunk owned by the store and leaves it empty. Pointers previously returned by
+the store become invalid. The store may be reused after calling storeInit again.
+*/
+void storeFree(struct ArchiveStore *store)
+{
+    if (store == NULL)
+    {
+        return;
+    }
+    for (size_t i = 0; i < store->chunkCount; i++)
+    {
+        free(store->chunks[i]);
+    }
+    free(store->chunks);
+    free(store->generations);
+    titleIndexFree(&store->titles);
+    personIndexFree(&store->people);
+    columnsFree(&store->columns);
+    titleSearchFree(&store->search);
+    personIndexFree(&store->trigrams);
+    for (int type = BOOK; type <= NEWSPAPER; type++)
+    {
+        numberIndexFree(&store->numbers[type]);
+        slotBitmapFree(&store->typeSlots[type]);
+        for (int subtype = 0; subtype < STORE_SUBTYPES; subtype++)
+        {
+            slotBitmapFree(&store->subtypeSlots[type][subtype]);
+        }
+    }
+    store->chunks = NULL;
+    store->chunkCount = 0;
+    store->chunkTableSize = 0;
+    store->count = 0;
+    store->slots = 0;
+    store->generations = NULL;
+    store->generationCapacity = 0;
+    store->compacting = false;
+}
+
+/*
+This function makes sure the store has room for at least capacity slots by allocating new chunks. Existing
+chunks are never moved, only the chunk pointer table and the slot generations are grown, so pointers to stored
+materials stay valid. It returns 0 on success and -1 if the allocation fails or capacity exceeds the configured
+maximum.
+*/
+int storeReserve(struct ArchiveStore *store, size_t capacity)
+{
+    if (store->maxCapacity != 0 && capacity > store->maxCapacity)
+    {
+        return -1;
+    }
+
+    size_t chunkSize = store->chunkMask + 1;
+    size_t needed = (capacity + chunkSize - 1) >> store->chunkShift;
+    if (needed <= store->chunkCount)
+    {
+        return 0;
+    }
+
+    if (needed > store->chunkTableSize)
+    {
+        size_t tableSize = store->chunkTableSize == 0 ? 8 : store->chunkTableSize;
+        while (tableSize < needed)
+        {
+            tableSize *= 2;
+        }
+        struct Material **chunks = (struct Material **)realloc(store->chunks, tableSize * sizeof(struct Material *));
+        if (chunks == NULL)
+        {
+            return -1;
+        }
+        store->chunks = chunks;
+        store->chunkTableSize = tableSize;
+    }
+
+    while (store->chunkCount < needed)
+    {
+        struct Material *chunk = (struct Material *)calloc(chunkSize, sizeof(struct Material));
+        if (chunk == NULL)
+        {
+            return -1;
+        }
+        store->chunks[store->chunkCount++] = chunk;
+    }
+
+    size_t slots = store->chunkCount << store->chunkShift;
+    uint32_t *generations = (uint32_t *)realloc(store->generations, slots * sizeof(uint32_t));
+    if (generations == NULL)
+    {
+        return -1;
+    }
+    memset(&generations[store->generationCapacity], 0, (slots - store->generationCapacity) * sizeof(uint32_t));
+    store->generations = generations;
+    store->generationCapacity = slots;
+    return 0;
+}
+
+/*
+This function does the work of storeAddMaterial, which times it.
+*/
+static int storeAddOne(struct ArchiveStore *store, const struct Material *material)
+{
+    if (store == NULL || material == NULL)
+    {
+        return -1;
+    }
+    if (store->maxCapacity != 0 && store->count >= store->maxCapacity)
+    {
+        return -1;
+    }
+    if (store->slots >= TITLE_INDEX_NONE)
+    {
+        return -1;
+    }
+
+    uint32_t hash = titleHash(material->title);
+    if (titleIndexFind(&store->titles, hash, material->title, storeTitleKey, store) != TITLE_INDEX_NONE)
+    {
+        return -1;
+    }
+    if (store->maxCapacity != 0 && store->slots >= store->maxCapacity)
+    {
+        storeCompact(store, 0);
+    }
+    if (storeReserve(store, store->slots + 1) != 0)
+    {
+        return -2;
+    }
+    uint32_t slot = (uint32_t)store->slots;
+    if (storeIndexMaterial(store, material, hash, slot) != 0)
+    {
+        return -2;
+    }
+
+    *storeAt(store, slot) = *material;
+    store->generations[slot]++;
+    store->slots++;
+    store->count++;
+    return 0;
+}
+
+/*
+This function adds a copy of a material to the store. It rejects the material if its title is already
+present or if the store has reached its configured maximum capacity, returning -1 in both cases just like
+addMaterial does for the fixed-size Archive. The duplicate check is a single title index probe. The material
+goes into the next free slot at the end; if the slots are exhausted by tombstones while the store is at its
+maximum capacity, a full compaction runs first. It returns -2 if memory for a new chunk or index bucket could
+not be allocated and 0 on success.
+*/
+int storeAddMaterial(struct ArchiveStore *store, const struct Material *material)
+{
+    struct MetricsSpan span = metricsBegin(METRIC_ADD);
+    int result = storeAddOne(store, material);
+    metricsEnd(&span, result == 0, result != 0);
+    return result;
+}
+
+/*
+The work of one bulk-ingest thread. During hashing it covers items [begin, end); during deduplication it
+owns every item whose hash falls into partition, so each item's code is written by exactly one thread.
+*/
+struct StoreBulkJob
+{
+    const struct ArchiveStore *store;
+    const struct Material *items;
+    uint32_t *hashes;
+    int *codes;
+    size_t n;
+    size_t begin;
+    size_t end;
+    size_t partition;
+    size_t partitions;
+    bool failed;
+};
+
+/*
+This function returns the partition of a title hash. It uses the high bits, leaving the low bits that pick a
+bucket evenly spread within each partition.
+*/
+static size_t storeBulkPartition(uint32_t hash, size_t partitions)
+{
+    return (size_t)(((uint64_t)hash * partitions) >> 32);
+}
+
+/*
+This function hashes the titles of the items in the job's range.
+*/
+static void *storeBulkHash(void *argument)
+{
+    struct StoreBulkJob *job = (struct StoreBulkJob *)argument;
+    for (size_t i = job->begin; i < job->end; i++)
+    {
+        job->hashes[i] = titleHash(job->items[i].title);
+    }
+    return NULL;
+}
+
+/*
+This function deduplicates the items of the job's partition. An item is rejected with -1 if its title is
+already in the store or appeared earlier in the batch, so the first occurrence wins as it would with one
+storeAddMaterial call per item. Earlier titles of the partition are kept in a private open-addressing table of
+item numbers; the store is only read.
+*/
+static void *storeBulkDedup(void *argument)
+{
+    struct StoreBulkJob *job = (struct StoreBulkJob *)argument;
+    size_t members = 0;
+    for (size_t i = 0; i < job->n; i++)
+    {
+        members += storeBulkPartition(job->hashes[i], job->partitions) == job->partition;
+    }
+
+    size_t buckets = 16;
+    while (buckets < members * 2)
+    {
+        buckets *= 2;
+    }
+    size_t mask = buckets - 1;
+    size_t *table = (size_t *)malloc(buckets * sizeof(size_t));
+    if (table == NULL)
+    {
+        job->failed = true;
+        return NULL;
+    }
+    memset(table, 0xff, buckets * sizeof(size_t));
+
+    for (size_t i = 0; i < job->n; i++)
+    {
+        uint32_t hash = job->hashes[i];
+        if (storeBulkPartition(hash, job->partitions) != job->partition)
+        {
+            continue;
+        }
+        const char *title = job->items[i].title;
+        if (titleIndexFind(&job->store->titles, hash, title, storeTitleKey, job->store) != TITLE_INDEX_NONE)
+        {
+            job->codes[i] = -1;
+            continue;
+        }
+
+        size_t pos = hash & mask;
+        while (table[pos] != SIZE_MAX && (job->hashes[table[pos]] != hash || strcmp(job->items[table[pos]].title, title) != 0))
+        {
+            pos = (pos + 1) & mask;
+        }
+        if (table[pos] != SIZE_MAX)
+        {
+            job->codes[i] = -1;
+            continue;
+        }
+        table[pos] = i;
+        job->codes[i] = 0;
+    }
+
+    free(table);
+    return NULL;
+}
+
+/*
+This function runs fn on every job, one thread per job with the first job on the calling thread. A job whose
+thread cannot be started runs on the calling thread instead.
+*/
+static void storeBulkRun(void *(*fn)(void *), struct StoreBulkJob *jobs, size_t count)
+{
+    pthread_t threads[STORE_BULK_MAX_THREADS];
+    bool started[STORE_BULK_MAX_THREADS];
+
+    for (size_t t = 1; t < count; t++)
+    {
+        started[t] = pthread_create(&threads[t], NULL, fn, &jobs[t]) == 0;
+        if (!started[t])
+        {
+            fn(&jobs[t]);
+        }
+    }
+    fn(&jobs[0]);
+    for (size_t t = 1; t < count; t++)
+    {
+        if (started[t])
+        {
+            pthread_join(threads[t], NULL);
+        }
+    }
+}
+
+/*
+This function chooses how many threads a batch of n items is split across: one for small batches or when
+STORE_BULK_SERIAL is set, otherwise one per online CPU up to STORE_BULK_MAX_THREADS.
+*/
+static size_t storeBulkThreads(size_t n, unsigned flags)
+{
+    if ((flags & STORE_BULK_SERIAL) != 0 || n < STORE_BULK_PARALLEL_MIN)
+    {
+        return 1;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1)
+    {
+        return 1;
+    }
+    return (size_t)cpus < STORE_BULK_MAX_THREADS ? (size_t)cpus : STORE_BULK_MAX_THREADS;
+}
+
+/*
+This function does the work of storeAddMaterials, which times it.
+*/
+static size_t storeAddBatch(struct ArchiveStore *store, const struct Material *items, size_t n, unsigned flags, int *codes)
+{
+    if (store == NULL || items == NULL || n == 0)
+    {
+        for (size_t i = 0; codes != NULL && i < n; i++)
+        {
+            codes[i] = -1;
+        }
+        return 0;
+    }
+
+    int *status = codes != NULL ? codes : (int *)malloc(n * sizeof(int));
+    uint32_t *hashes = (uint32_t *)malloc(n * sizeof(uint32_t));
+    if (status == NULL || hashes == NULL)
+    {
+        for (size_t i = 0; codes != NULL && i < n; i++)
+        {
+            codes[i] = -2;
+        }
+        if (status != codes)
+        {
+            free(status);
+        }
+        free(hashes);
+        return 0;
+    }
+
+    struct StoreBulkJob jobs[STORE_BULK_MAX_THREADS];
+    size_t threads = storeBulkThreads(n, flags);
+    for (size_t t = 0; t < threads; t++)
+    {
+        jobs[t].store = store;
+        jobs[t].items = items;
+        jobs[t].hashes = hashes;
+        jobs[t].codes = status;
+        jobs[t].n = n;
+        jobs[t].begin = n * t / threads;
+        jobs[t].end = n * (t + 1) / threads;
+        jobs[t].partition = t;
+        jobs[t].partitions = threads;
+        jobs[t].failed = false;
+    }
+    storeBulkRun(storeBulkHash, jobs, threads);
+    storeBulkRun(storeBulkDedup, jobs, threads);
+
+    bool partitionFailed = false;
+    for (size_t t = 0; t < threads; t++)
+    {
+        partitionFailed = partitionFailed || jobs[t].failed;
+    }
+    bool failed = partitionFailed;
+
+    size_t accepted = 0;
+    for (size_t i = 0; i < n && !failed; i++)
+    {
+        if (status[i] != 0)
+        {
+            continue;
+        }
+        if ((store->maxCapacity != 0 && store->count + accepted >= store->maxCapacity) || store->count + accepted >= TITLE_INDEX_NONE)
+        {
+            status[i] = -1;
+            continue;
+        }
+        accepted++;
+    }
+
+    if (!failed && accepted != 0)
+    {
+        if ((store->maxCapacity != 0 && store->slots + accepted > store->maxCapacity) || store->slots + accepted >= TITLE_INDEX_NONE)
+        {
+            storeCompact(store, 0);
+        }
+        failed = storeReserve(store, store->slots + accepted) != 0 || titleIndexReserve(&store->titles, store->titles.size + accepted) != 0;
+    }
+
+    size_t first = store->slots;
+    for (size_t i = 0; i < n && !failed; i++)
+    {
+        if (status[i] != 0)
+        {
+            continue;
+        }
+        uint32_t slot = (uint32_t)store->slots;
+        struct Material *material = storeAt(store, slot);
+        *material = items[i];
+        if (storeIndexMaterial(store, material, hashes[i], slot) != 0)
+        {
+            memset(material, 0, sizeof(struct Material));
+            failed = true;
+            break;
+        }
+        store->generations[slot]++;
+        store->slots++;
+        store->count++;
+    }
+
+    if (failed)
+    {
+        // undo the part of the batch already stored
+        for (size_t slot = first; slot < store->slots; slot++)
+        {
+            struct Material *material = storeAt(store, slot);
+            storeUnindexMaterial(store, material, titleHash(material->title), (uint32_t)slot);
+            memset(material, 0, sizeof(struct Material));
+            store->generations[slot]++;
+        }
+        store->count -= store->slots - first;
+        store->slots = first;
+        for (size_t i = 0; i < n; i++)
+        {
+            // a failed partition leaves its items without a code
+            if (status[i] == 0 || partitionFailed)
+            {
+                status[i] = -2;
+            }
+        }
+        accepted = 0;
+    }
+
+    if (status != codes)
+    {
+        free(status);
+    }
+    free(hashes);
+    return accepted;
+}
+
+/*
+This function adds a batch of materials to the store. Titles are hashed and deduplicated in parallel, with
+the batch split into hash partitions so that no two threads ever compare the same title, and the accepted
+materials are then stored and indexed in one pass, with the title index sized once for the whole batch.
+codes, if not NULL, receives one code per item with the meaning storeAddMaterial gives its return value: 0 if
+the item was added, -1 if its title duplicates a stored material or an earlier item or the store reached its
+maximum capacity, and -2 if memory ran out. Items are accepted in order, so the result equals adding them one
+by one. If memory runs out nothing from the batch is kept. It returns the number of materials added.
+*/
+size_t storeAddMaterials(struct ArchiveStore *store, const struct Material *items, size_t n, unsigned flags, int *codes)
+{
+    struct MetricsSpan span = metricsBegin(METRIC_ADD_BATCH);
+    size_t added = storeAddBatch(store, items, n, flags, codes);
+    metricsEnd(&span, added, added != n);
+    return added;
+}
+
+/*
+This function searches the store for a material with the given title using the title index. The comparison
+is case-sensitive. It returns a pointer to the stored material, which stays valid until the material is
+removed or the store is freed, or NULL if no material has that title. A miss and a NULL argument both count
+as failed finds.
+*/
+struct Material *storeFindMaterial(const struct ArchiveStore *store, const char *title)
+{
+    struct MetricsSpan span = metricsBegin(METRIC_FIND);
+    if (store == NULL || title == NULL)
+    {
+        metricsEnd(&span, 0, true);
+        return NULL;
+    }
+
+    uint32_t slot = titleIndexFind(&store->titles, titleHash(title), title, storeTitleKey, store);
+    metricsEnd(&span, slot != TITLE_INDEX_NONE, slot == TITLE_INDEX_NONE);
+    if (slot == TITLE_INDEX_NONE)
+    {
+        return NULL;
+    }
+    return storeAt(store, slot);
+}
+
+/*
+This function does the work of storeUpdateMaterial, which times it.
+*/
+static int storeUpdateOne(struct ArchiveStore *store, const char *title, union MaterialDetails details)
+{
+    if (store == NULL || title == NULL)
+    {
+        return -1;
+    }
+
+    uint32_t hash = titleHash(title);
+    uint32_t slot = titleIndexFind(&store->titles, hash, title, storeTitleKey, store);
+    if (slot == TITLE_INDEX_NONE)
+    {
+        return -2;
+    }
+    struct Material *material = storeAt(store, slot);
+    struct Material updated = *material;
+
+    switch (material->type)
+    {
+    case BOOK:
+        if (details.book.type < NOVEL || details.book.type > HISTORY)
+        {
+            return -3;
+        }
+        updated.details.book = details.book;
+        break;
+    case JOURNAL:
+        if (details.journal.type < SCIENCE || details.journal.type > ART)
+        {
+            return -4;
+        }
+        updated.details.journal = details.journal;
+        break;
+    case NEWSPAPER:
+        if (details.newspaper.type < DAILY || details.newspaper.type > MONTHLY)
+        {
+            return -5;
+        }
+        updated.details.newspaper = details.newspaper;
+        break;
+    default:
+        return -6;
+    }
+
+    // every new index entry is added before any old one is removed or the record changes, so a failure can undo
+    // the additions and leave the material exactly as it was
+    const char *contributor = materialContributor(&updated);
+    bool contributorChanged = strcmp(materialContributor(material), contributor) != 0;
+    int subtype = materialSubtype(&updated);
+    bool subtypeChanged = materialSubtype(material) != subtype;
+    bool numberChanged = store->ordered && storeMaterialNumber(material) != storeMaterialNumber(&updated);
+    if (contributorChanged && personIndexAdd(&store->people, contributor, slot) != 0)
+    {
+        return -7;
+    }
+    if (subtypeChanged && slotBitmapAdd(&store->subtypeSlots[updated.type][subtype], slot) != 0)
+    {
+        if (contributorChanged)
+        {
+            personIndexRemove(&store->people, contributor, slot);
+        }
+        return -7;
+    }
+    if (numberChanged && storeIndexNumber(store, &updated, slot) != 0)
+    {
+        if (subtypeChanged)
+        {
+            slotBitmapRemove(&store->subtypeSlots[updated.type][subtype], slot);
+        }
+        if (contributorChanged)
+        {
+            personIndexRemove(&store->people, contributor, slot);
+        }
+        return -7;
+    }
+
+    if (contributorChanged)
+    {
+        personIndexRemove(&store->people, materialContributor(material), slot);
+    }
+    if (subtypeChanged && materialSubtype(material) >= 0)
+    {
+        slotBitmapRemove(&store->subtypeSlots[material->type][materialSubtype(material)], slot);
+    }
+    if (numberChanged)
+    {
+        storeUnindexNumber(store, material, slot);
+    }
+    storeCountMaterial(store, material, -1);
+    storeCountMaterial(store, &updated, 1);
+    *material = updated;
+    if (store->columnar)
+    {
+        // the slot already has a column entry, so this cannot fail
+        columnsSet(&store->columns, slot, material);
+    }
+    return 0;
+}
+
+/*
+This function replaces the details of the material with the given title. The error codes match
+updateMaterial: -1 for a NULL store or title, -2 if the title is not found, -3, -4 and -5 for an invalid
+book, journal or newspaper subtype and -6 if the stored material has an invalid type. The contributor and
+subtype indexes, and the number index of an ordered store, are updated when those fields change; if that fails
+-7 is returned and the material and every index are left as they were. The columns of a columnar store are
+rewritten. It returns 0 on success.
+*/
+int storeUpdateMaterial(struct ArchiveStore *store, const char *title, union MaterialDetails details)
+{
+    struct MetricsSpan span = metricsBegin(METRIC_UPDATE);
+    int result = storeUpdateOne(store, title, details);
+    metricsEnd(&span, result == 0, result != 0);
+    return result;
+}
+
+/*
+This function moves the live material at slot from to the dead slot to, updating every index and the
+generations of both slots. Pointers to the material at from become stale.
+*/
+static void storeMoveMaterial(struct ArchiveStore *store, uint32_t from, uint32_t to)
+{
+    metricsMove(1);
+    struct Material *source = storeAt(store, from);
+    const char *contributor = materialContributor(source);
+
+    titleIndexRelocate(&store->titles, titleHash(source->title), from, to);
+    if (contributor != NULL)
+    {
+        personIndexRelocate(&store->people, contributor, from, to);
+    }
+    storeUnindexType(store, source, from);
+    // the bitmaps only grow a container here, and on failure the material is still found through the other indexes
+    storeIndexType(store, source, to);
+
+    if (store->columnar)
+    {
+        columnsMove(&store->columns, from, to);
+    }
+    if (store->searchable)
+    {
+        titleSearchRelocate(&store->search, from, to);
+    }
+    if (store->fuzzy)
+    {
+        storeUnindexTrigrams(store, source->title, from, to);
+    }
+    if (store->ordered)
+    {
+        // on failure the material is still found through the other indexes, as with the bitmaps
+        storeUnindexNumber(store, source, from);
+        storeIndexNumber(store, source, to);
+    }
+
+    *storeAt(store, to) = *source;
+    memset(source, 0, sizeof(struct Material));
+    store->generations[to]++;
+    store->generations[from]++;
+}
+
+/*
+This function does the work of storeRemoveMaterial, which times it.
+*/
+static bool storeRemoveOne(struct ArchiveStore *store, const char *title)
+{
+    if (store == NULL || title == NULL)
+    {
+        return false;
+    }
+
+    uint32_t hash = titleHash(title);
+    uint32_t slot = titleIndexFind(&store->titles, hash, title, storeTitleKey, store);
+    if (slot == TITLE_INDEX_NONE)
+    {
+        return false;
+    }
+
+    storeUnindexMaterial(store, storeAt(store, slot), hash, slot);
+    memset(storeAt(store, slot), 0, sizeof(struct Material));
+    store->generations[slot]++;
+    store->count--;
+
+    if (store->removeMode == STORE_REMOVE_SWAP)
+    {
+        uint32_t last = (uint32_t)store->slots - 1;
+        if (slot != last)
+        {
+            storeMoveMaterial(store, last, slot);
+        }
+        store->slots--;
+        return true;
+    }
+
+    if (store->compactionBudget != 0 && (store->compacting || (store->slots - store->count) * 4 > store->slots))
+    {
+        storeCompact(store, store->compactionBudget);
+    }
+    return true;
+}
+
+/*
+This function removes the material with the given title from the store. With STORE_REMOVE_TOMBSTONE the slot
+is cleared and marked dead, so every other material keeps its slot and order; the dead slots are reclaimed by
+storeCompact. With STORE_REMOVE_SWAP the last material is moved into the hole, which keeps the slots dense but
+changes the order and invalidates pointers to the moved material. Either way the generation of each affected
+slot changes so that old handles no longer resolve. If the title is not found the function does nothing. No
+other record is shifted, but the contributor's posting list is kept sorted, so a removal takes time
+proportional to the materials of that contributor, and in a fuzzy store to those of each title trigram.
+*/
+void storeRemoveMaterial(struct ArchiveStore *store, const char *title)
+{
+    struct MetricsSpan span = metricsBegin(METRIC_REMOVE);
+    bool removed = storeRemoveOne(store, title);
+    metricsEnd(&span, removed, !removed);
+}
+
+/*
+This function does the work of storeCompact, which times it.
+*/
+static size_t storeCompactStep(struct ArchiveStore *store, size_t budget)
+{
+    if (store == NULL)
+    {
+        return 0;
+    }
+    if (!store->compacting)
+    {
+        if (store->count == store->slots)
+        {
+            return 0;
+        }
+        store->compacting = true;
+        store->compactRead = 0;
+        store->compactWrite = 0;
+    }
+
+    size_t examined = 0;
+    while (store->compactRead < store->slots && (budget == 0 || examined < budget))
+    {
+        size_t read = store->compactRead++;
+        examined++;
+        if (!storeIsLive(store, read))
+        {
+            continue;
+        }
+        if (read != store->compactWrite)
+        {
+            storeMoveMaterial(store, (uint32_t)read, (uint32_t)store->compactWrite);
+        }
+        store->compactWrite++;
+    }
+
+    if (store->compactRead < store->slots)
+    {
+        return store->slots - store->compactRead;
+    }
+
+    // everything from compactWrite on is dead now
+    store->slots = store->compactWrite;
+    store->compacting = false;
+    return 0;
+}
+
+/*
+This function reclaims the dead slots left by tombstone removal. It slides live materials down over the dead
+slots, preserving their order, and updates the indexes for every material it moves. The work is incremental:
+each call examines at most budget slots, or runs the pass to completion if budget is 0, and a pass interrupted
+by adds and removes resumes where it stopped. When a pass finishes the slots beyond the last live material are
+released for reuse. Moved materials get new slots, so pointers to them become stale; handles detect this.
+It returns the number of slots still to be examined in the current pass, which is 0 once compaction is done.
+*/
+size_t storeCompact(struct ArchiveStore *store, size_t budget)
+{
+    struct MetricsSpan span = metricsBegin(METRIC_COMPACT);
+    size_t remaining = storeCompactStep(store, budget);
+    metricsEnd(&span, 0, false);
+    return remaining;
+}
+
+/*
+This function looks up a title and stores a handle for it: the slot together with the slot's current
+generation. It returns 0 on success and -1 if no material has that title.
+*/
+int storeFindHandle(const struct ArchiveStore *store, const char *title, struct MaterialHandle *handle)
+{
+    if (store == NULL || title == NULL)
+    {
+        return -1;
+    }
+
+    uint32_t slot = titleIndexFind(&store->titles, titleHash(title), title, storeTitleKey, store);
+    if (slot == TITLE_INDEX_NONE)
+    {
+        return -1;
+    }
+    handle->slot = slot;
+    handle->generation = store->generations[slot];
+    return 0;
+}
+
+/*
+This function turns a handle back into a pointer. It returns NULL if the material the handle was taken for has
+since been removed or moved by compaction or swap removal, even if another material now occupies the slot.
+*/
+struct Material *storeResolve(const struct ArchiveStore *store, struct MaterialHandle handle)
+{
+    if (store == NULL || handle.slot >= store->slots || store->generations[handle.slot] != handle.generation)
+    {
+        return NULL;
+    }
+    if ((handle.generation & 1) == 0)
+    {
+        return NULL;
+    }
+    return storeAt(store, handle.slot);
+}
+
+/*
+This function resolves the slots of the type bitmap into const pointers to the stored materials. Up to capacity
+pointers are written into the caller-supplied results array in slot order; results may be NULL with a capacity
+of 0 to only count. Nothing is allocated and no record is copied. It returns the total number of matches, which
+can exceed capacity, or 0 for an invalid type. The pointers are valid until the next mutation.
+*/
+size_t storeFilterMaterialsView(const struct ArchiveStore *store, enum MaterialType type, const struct Material **results, size_t capacity)
+{
+    struct MetricsSpan span = metricsBegin(METRIC_FILTER);
+    const struct SlotBitmap *slots = storeFilterMaterials(store, type);
+    if (slots == NULL)
+    {
+        metricsEnd(&span, 0, true);
+        return 0;
+    }
+
+    struct SlotBitmapIterator iterator;
+    uint32_t slot;
+    size_t n = 0;
+    slotBitmapIterate(slots, &iterator);
+    while (n < capacity && slotBitmapNext(&iterator, &slot))
+    {
+        results[n++] = storeAt(store, slot);
+    }
+    metricsEnd(&span, n, false);
+    return slotBitmapCardinality(slots);
+}
+
+/*
+This function resolves the contributor posting list for author into const pointers to the stored materials,
+filling results the same way storeFilterMaterialsView does. It returns the total number of matches, or 0 if the
+arguments are invalid, the author is empty or nothing matches.
+*/
+size_t storeFilterMaterialsByAuthorView(const struct ArchiveStore *store, const char *author, const struct Material **results, size_t capacity)
+{
+    struct MetricsSpan span = metricsBegin(METRIC_FILTER_BY_AUTHOR);
+    size_t matches;
+    const uint32_t *slots = storeContributorSlots(store, author, &matches);
+    for (size_t i = 0; i < matches && i < capacity; i++)
+    {
+        results[i] = storeAt(store, slots[i]);
+    }
+    metricsEnd(&span, matches < capacity ? matches : capacity, false);
+    return matches;
+}
+
+/*
+This function orders two slots by the titles of their materials, for sorting the matches of an unindexed title
+search.
+*/
+static int storeCompareTitles(const void *a, const void *b)
+{
+    return strcmp(storeAt(sortStore, *(const uint32_t *)a)->title, storeAt(sortStore, *(const uint32_t *)b)->title);
+}
+
+/*
+This function answers storeSearchPrefix and storeSearchTitles on a store without a TitleSearch by testing every
+live title. Prefix matches are collected and sorted by title before the page is cut; substring matches are
+listed in slot order. It returns the number of pointers stored, or 0 if memory for the sort runs out.
+*/
+static size_t storeSearchScan(const struct ArchiveStore *store, const char *pattern, bool prefix, size_t offset, const struct Material **results, size_t limit)
+{
+    size_t length = strlen(pattern);
+    size_t count = 0;
+    if (!prefix)
+    {
+        for (size_t slot = 0; slot < store->slots && count < limit; slot++)
+        {
+            if (storeIsLive(store, slot) && strstr(storeAt(store, slot)->title, pattern) != NULL)
+            {
+                if (offset > 0)
+                {
+                    offset--;
+                    continue;
+                }
+                results[count++] = storeAt(store, slot);
+            }
+        }
+        return count;
+    }
+
+    uint32_t *matches = (uint32_t *)malloc((store->count + 1) * sizeof(uint32_t));
+    if (matches == NULL)
+    {
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t slot = 0; slot < store->slots; slot++)
+    {
+        if (storeIsLive(store, slot) && strncmp(storeAt(store, slot)->title, pattern, length) == 0)
+        {
+            matches[total++] = (uint32_t)slot;
+        }
+    }
+    sortStore = store;
+    qsort(matches, total, sizeof(uint32_t), storeCompareTitles);
+    for (size_t i = offset; i < total && count < limit; i++)
+    {
+        results[count++] = storeAt(store, matches[i]);
+    }
+    free(matches);
+    return count;
+}
+
+/*
+This function runs a TitleSearch query and resolves the slots it returns to materials. It returns the number of
+pointers stored, or 0 if memory for the slots runs out.
+*/
+static size_t storeSearchIndexed(const struct ArchiveStore *store, const char *pattern, bool prefix, size_t offset, const struct Material **results, size_t limit)
+{
+    uint32_t *slots = (uint32_t *)malloc(limit * sizeof(uint32_t));
+    if (slots == NULL)
+    {
+        return 0;
+    }
+    size_t count = prefix ? titleSearchPrefix(&store->search, pattern, strlen(pattern), offset, slots, limit)
+                          : titleSearchSubstring(&store->search, pattern, strlen(pattern), offset, slots, limit);
+    for (size_t i = 0; i < count; i++)
+    {
+        results[i] = storeAt(store, slots[i]);
+    }
+    free(slots);
+    return count;
+}
+
+/*
+This function finds the materials whose title starts with prefix and stores pointers to up to limit of them in
+results, in title order, after skipping the first offset matches; successive pages are fetched by advancing
+offset by limit. A searchable store answers from its TitleSearch, which still walks past the skipped matches, so
+a page costs time proportional to offset + limit times the number of segments; otherwise every title is
+scanned. It returns the number of pointers stored, which is below limit only on the last page. The pointers are
+valid until the next mutation.
+*/
+size_t storeSearchPrefix(const struct ArchiveStore *store, const char *prefix, size_t offset, const struct Material **results, size_t limit)
+{
+    if (store == NULL || prefix == NULL || results == NULL || limit == 0)
+    {
+        return 0;
+    }
+    struct MetricsSpan span = metricsBegin(METRIC_SEARCH);
+    size_t n = store->searchable ? storeSearchIndexed(store, prefix, true, offset, results, limit)
+                                 : storeSearchScan(store, prefix, true, offset, results, limit);
+    metricsEnd(&span, n, false);
+    return n;
+}
+
+/*
+This function finds the materials whose title contains pattern and pages through them like storeSearchPrefix.
+The order of the matches is unspecified but does not change while the store is not modified, so pages fetched
+between two mutations do not overlap. As with storeSearchPrefix, the skipped matches are still found, so deep
+pages cost time proportional to their offset.
+*/
+size_t storeSearchTitles(const struct ArchiveStore *store, const char *pattern, size_t offset, const struct Material **results, size_t limit)
+{
+    if (store == NULL || pattern == NULL || results == NULL || limit == 0)
+    {
+        return 0;
+    }
+    struct MetricsSpan span = metricsBegin(METRIC_SEARCH);
+    size_t n = store->searchable ? storeSearchIndexed(store, pattern, false, offset, results, limit)
+                                 : storeSearchScan(store, pattern, false, offset, results, limit);
+    metricsEnd(&span, n, false);
+    return n;
+}
+
+/*
+This function orders matches by distance and then by title.
+*/
+static int storeCompareMatches(const void *a, const void *b)
+{
+    const struct MaterialMatch *x = (const struct MaterialMatch *)a;
+    const struct MaterialMatch *y = (const struct MaterialMatch *)b;
+    if (x->distance != y->distance)
+    {
+        return x->distance < y->distance ? -1 : 1;
+    }
+    return strcmp(x->material->title, y->material->title);
+}
+
+/*
+This function orders posting lists by length, so that candidates are drawn from the rarest trigrams.
+*/
+static int storeComparePostings(const void *a, const void *b)
+{
+    size_t x = (*(const struct PersonPostings *const *)a)->count;
+    size_t y = (*(const struct PersonPostings *const *)b)->count;
+    return x < y ? -1 : x > y;
+}
+
+static int storeCompareSlots(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/*
+This function appends slot to matches if the folded title of its material is within maxDistance of key. It
+returns -1 if matches could not grow and 0 otherwise.
+*/
+static int storeMatchSlot(const struct ArchiveStore *store, uint32_t slot, const uint32_t *key, size_t length, int maxDistance,
+                          struct MaterialMatch **matches, size_t *count, size_t *capacity)
+{
+    uint32_t title[FUZZY_KEY_MAX];
+    size_t titleLength = fuzzyNormalize(storeAt(store, slot)->title, title, FUZZY_KEY_MAX);
+    int distance = fuzzyDistance(key, length, title, titleLength, maxDistance);
+    if (distance > maxDistance)
+    {
+        return 0;
+    }
+    if (*count == *capacity)
+    {
+        size_t grown = *capacity == 0 ? 64 : *capacity * 2;
+        struct MaterialMatch *larger = (struct MaterialMatch *)realloc(*matches, grown * sizeof(struct MaterialMatch));
+        if (larger == NULL)
+        {
+            return -1;
+        }
+        *matches = larger;
+        *capacity = grown;
+    }
+    (*matches)[*count].material = storeAt(store, slot);
+    (*matches)[*count].distance = distance;
+    (*count)++;
+    return 0;
+}
+
+/*
+This function collects the candidates of a fuzzy lookup from the trigram index. A title within maxDistance
+edits of the query shares at least threshold of the query's trigrams, since one edit changes at most three of
+them, so it must appear in one of the count - threshold + 1 shortest posting lists; the candidates are drawn
+from those lists alone. The number of source lists holding a candidate falls out of sorting them, and the
+other lists are probed by binary search, rarest first, only until the candidate has missed too many to reach
+threshold; the edit distance is computed for the survivors alone. A query so short that threshold would drop
+below 1 still requires one shared trigram. It returns 0, or -1 if memory runs out.
+*/
+static int storeFuzzyCandidates(const struct ArchiveStore *store, const uint32_t *key, size_t length, int maxDistance,
+                                struct MaterialMatch **matches, size_t *count, size_t *capacity)
+{
+    char trigrams[FUZZY_TRIGRAMS_MAX][FUZZY_TRIGRAM_BYTES];
+    const struct PersonPostings *lists[FUZZY_TRIGRAMS_MAX];
+    size_t trigramCount = fuzzyTrigrams(key, length, trigrams, FUZZY_TRIGRAMS_MAX);
+    size_t listCount = 0;
+    for (size_t i = 0; i < trigramCount; i++)
+    {
+        const struct PersonPostings *postings = personIndexFind(&store->trigrams, trigrams[i]);
+        if (postings != NULL && postings->count != 0)
+        {
+            lists[listCount++] = postings;
+        }
+    }
+    long threshold = (long)trigramCount - 3 * (long)maxDistance;
+    if (threshold < 1)
+    {
+        threshold = 1;
+    }
+    if ((long)listCount < threshold)
+    {
+        return 0;
+    }
+    qsort(lists, listCount, sizeof(lists[0]), storeComparePostings);
+
+    size_t sources = listCount - (size_t)threshold + 1;
+    size_t total = 0;
+    for (size_t i = 0; i < sources; i++)
+    {
+        total += lists[i]->count;
+    }
+    uint32_t *candidates = (uint32_t *)malloc(total * sizeof(uint32_t));
+    if (candidates == NULL)
+    {
+        return -1;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < sources; i++)
+    {
+        memcpy(candidates + n, lists[i]->slots, lists[i]->count * sizeof(uint32_t));
+        n += lists[i]->count;
+    }
+    qsort(candidates, n, sizeof(uint32_t), storeCompareSlots);
+
+    int status = 0;
+    for (size_t i = 0; i < n && status == 0;)
+    {
+        // a candidate appears once for every source list holding it
+        size_t run = i;
+        while (run < n && candidates[run] == candidates[i])
+        {
+            run++;
+        }
+        long shared = (long)(run - i);
+        long misses = (long)(listCount - sources) - (threshold - shared);
+        for (size_t j = sources; j < listCount && shared < threshold && misses >= 0; j++)
+        {
+            if (bsearch(&candidates[i], lists[j]->slots, lists[j]->count, sizeof(uint32_t), storeCompareSlots) != NULL)
+            {
+                shared++;
+            }
+            else
+            {
+                misses--;
+            }
+        }
+        if (shared >= threshold)
+        {
+            status = storeMatchSlot(store, candidates[i], key, length, maxDistance, matches, count, capacity);
+        }
+        i = run;
+    }
+    free(candidates);
+    return status;
+}
+
+/*
+This function is the case-insensitive, typo-tolerant lookup. Titles and the query are compared by their folded
+keys, which ignore case, Latin-1 accents and punctuation, and a material matches if its key is within
+maxDistance edits of the query's; a maxDistance of 0 finds titles equal up to case and punctuation. A store
+configured as fuzzy narrows the candidates with its trigram index, otherwise every title is compared. Keys are
+at most FUZZY_KEY_MAX code points apart, so a larger maxDistance is treated as FUZZY_KEY_MAX. Up to capacity
+matches are stored in results, closest first and then by title. storeFindMaterial remains the exact lookup. It
+returns the total number of matches, or 0 if memory runs out.
+*/
+size_t storeFindFuzzy(const struct ArchiveStore *store, const char *title, int maxDistance, struct MaterialMatch *results, size_t capacity)
+{
+    if (store == NULL || title == NULL || maxDistance < 0)
+    {
+        return 0;
+    }
+    if (maxDistance > FUZZY_KEY_MAX)
+    {
+        maxDistance = FUZZY_KEY_MAX;
+    }
+    uint32_t key[FUZZY_KEY_MAX];
+    size_t length = fuzzyNormalize(title, key, FUZZY_KEY_MAX);
+    struct MaterialMatch *matches = NULL;
+    size_t count = 0;
+    size_t matchCapacity = 0;
+    int status = 0;
+
+    if (store->fuzzy)
+    {
+        status = storeFuzzyCandidates(store, key, length, maxDistance, &matches, &count, &matchCapacity);
+    }
+    else
+    {
+        for (size_t slot = 0; slot < store->slots && status == 0; slot++)
+        {
+            if (storeIsLive(store, slot))
+            {
+                status = storeMatchSlot(store, (uint32_t)slot, key, length, maxDistance, &matches, &count, &matchCapacity);
+            }
+        }
+    }
+    if (status != 0)
+    {
+        free(matches);
+        return 0;
+    }
+
+    if (count > 1)
+    {
+        qsort(matches, count, sizeof(struct MaterialMatch), storeCompareMatches);
+    }
+    for (size_t i = 0; i < count && i < capacity; i++)
+    {
+        results[i] = matches[i];
+    }
+    free(matches);
+    return count;
+}
+
+/*
+This function orders number index entries by number and then by slot, for qsort.
+*/
+static int storeCompareNumbers(const void *a, const void *b)
+{
+    const struct NumberEntry *x = (const struct NumberEntry *)a;
+    const struct NumberEntry *y = (const struct NumberEntry *)b;
+    if (x->key != y->key)
+    {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->slot < y->slot ? -1 : x->slot > y->slot;
+}
+
+/*
+This function collects the number and slot of every live material of the given type that has a number in [low,
+high], sorted by number and slot. It returns the number of entries stored in *entries, which the caller frees,
+or -1 on allocation failure.
+*/
+static long storeCollectNumbers(const struct ArchiveStore *store, enum MaterialType type, int32_t low, int32_t high, struct NumberEntry **entries)
+{
+    size_t capacity = slotBitmapCardinality(&store->typeSlots[type]);
+    *entries = (struct NumberEntry *)malloc((capacity == 0 ? 1 : capacity) * sizeof(struct NumberEntry));
+    if (*entries == NULL)
+    {
+        return -1;
+    }
+
+    size_t n = 0;
+    struct SlotBitmapIterator iterator;
+    uint32_t slot;
+    slotBitmapIterate(&store->typeSlots[type], &iterator);
+    while (slotBitmapNext(&iterator, &slot))
+    {
+        const struct Material *material = storeAt(store, slot);
+        int32_t number = storeMaterialNumber(material);
+        if (storeIsLive(store, slot) && material->type == type && number >= low && number <= high && n < capacity)
+        {
+            (*entries)[n].key = number;
+            (*entries)[n].slot = slot;
+            n++;
+        }
+    }
+    if (n > 1)
+    {
+        qsort(*entries, n, sizeof(struct NumberEntry), storeCompareNumbers);
+    }
+    return (long)n;
+}
+
+/*
+This function moves the entry at pos of a min-heap of count number index entries down until neither child is
+smaller.
+*/
+static void storeSiftNumbers(struct NumberEntry *heap, size_t count, size_t pos)
+{
+    for (;;)
+    {
+        size_t child = 2 * pos + 1;
+        if (child >= count)
+        {
+            return;
+        }
+        if (child + 1 < count && storeCompareNumbers(&heap[child + 1], &heap[child]) < 0)
+        {
+            child++;
+        }
+        if (storeCompareNumbers(&heap[child], &heap[pos]) >= 0)
+        {
+            return;
+        }
+        struct NumberEntry entry = heap[pos];
+        heap[pos] = heap[child];
+        heap[child] = entry;
+        pos = child;
+    }
+}
+
+/*
+This function turns count number index entries into a min-heap.
+*/
+static void storeHeapifyNumbers(struct NumberEntry *heap, size_t count)
+{
+    for (size_t pos = count / 2; pos > 0; pos--)
+    {
+        storeSiftNumbers(heap, count, pos - 1);
+    }
+}
+
+/*
+This function does the work of storeRangeMaterials, which times it.
+*/
+static size_t storeRangeScan(const struct ArchiveStore *store, enum MaterialType type, int32_t low, int32_t high, size_t offset, const struct Material **results, size_t limit)
+{
+    if (store == NULL || results == NULL || (type != BOOK && type != JOURNAL))
+    {
+        return 0;
+    }
+
+    size_t n = 0;
+    if (store->ordered)
+    {
+        struct NumberCursor cursor;
+        struct NumberEntry entry;
+        numberIndexSeek(&store->numbers[type], low, high, false, &cursor);
+        while (n < limit && numberIndexNext(&cursor, &entry))
+        {
+            if (offset > 0)
+            {
+                offset--;
+                continue;
+            }
+            results[n++] = storeAt(store, entry.slot);
+        }
+        return n;
+    }
+
+    struct NumberEntry *entries;
+    long count = storeCollectNumbers(store, type, low, high, &entries);
+    for (long i = (long)offset; count > 0 && i < count && n < limit; i++)
+    {
+        results[n++] = storeAt(store, entries[i].slot);
+    }
+    free(entries);
+    return n;
+}
+
+/*
+This function finds the books with pages, or the journals with an issue, from low to high inclusive, ordered by
+that number and then by slot. It skips the first offset matches and stores pointers to up to limit of the rest
+in results. An ordered store answers from its number index in O(log n + offset + limit); otherwise the materials
+of the type are collected and sorted. It returns the number of results stored, and 0 for a NULL argument, a
+newspaper or an invalid type.
+*/
+size_t storeRangeMaterials(const struct ArchiveStore *store, enum MaterialType type, int32_t low, int32_t high, size_t offset, const struct Material **results, size_t limit)
+{
+    struct MetricsSpan span = metricsBegin(METRIC_RANGE);
+    size_t n = storeRangeScan(store, type, low, high, offset, results, limit);
+    metricsEnd(&span, n, false);
+    return n;
+}
+
+/*
+This function does the work of storeTopMaterials, which times it.
+*/
+static size_t storeTopScan(const struct ArchiveStore *store, enum MaterialType type, const char *contributor, size_t k, const struct Material **results)
+{
+    if (store == NULL || results == NULL || (type != BOOK && type != JOURNAL))
+    {
+        return 0;
+    }
+
+    size_t n = 0;
+    if (contributor == NULL && store->ordered)
+    {
+        struct NumberCursor cursor;
+        struct NumberEntry entry;
+        numberIndexSeek(&store->numbers[type], INT32_MIN, INT32_MAX, true, &cursor);
+        while (n < k && numberIndexNext(&cursor, &entry))
+        {
+            results[n++] = storeAt(store, entry.slot);
+        }
+        return n;
+    }
+
+    const uint32_t *slots = NULL;
+    size_t candidates = 0;
+    if (contributor != NULL)
+    {
+        slots = storeContributorSlots(store, contributor, &candidates);
+        if (slots == NULL)
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        candidates = slotBitmapCardinality(&store->typeSlots[type]);
+    }
+    if (k > candidates)
+    {
+        k = candidates;
+    }
+    if (k == 0)
+    {
+        return 0;
+    }
+    struct NumberEntry *heap = (struct NumberEntry *)malloc(k * sizeof(struct NumberEntry));
+    if (heap == NULL)
+    {
+        return 0;
+    }
+
+    // the heap holds the k highest entries seen so far with the lowest of them on top
+    struct SlotBitmapIterator iterator;
+    uint32_t slot;
+    size_t i = 0;
+    if (slots == NULL)
+    {
+        slotBitmapIterate(&store->typeSlots[type], &iterator);
+    }
+    while (slots != NULL ? i < candidates : slotBitmapNext(&iterator, &slot))
+    {
+        if (slots != NULL)
+        {
+            slot = slots[i++];
+        }
+        const struct Material *material = storeAt(store, slot);
+        if (!storeIsLive(store, slot) || material->type != type)
+        {
+            continue;
+        }
+        struct NumberEntry entry = {storeMaterialNumber(material), slot};
+        if (n < k)
+        {
+            heap[n++] = entry;
+            if (n == k)
+            {
+                storeHeapifyNumbers(heap, n);
+            }
+        }
+        else if (storeCompareNumbers(&entry, &heap[0]) > 0)
+        {
+            heap[0] = entry;
+            storeSiftNumbers(heap, n, 0);
+        }
+    }
+    if (n < k)
+    {
+        storeHeapifyNumbers(heap, n);
+    }
+
+    // popping the lowest entry each time fills results from the back
+    for (size_t left = n; left > 0; left--)
+    {
+        results[left - 1] = storeAt(store, heap[0].slot);
+        heap[0] = heap[left - 1];
+        storeSiftNumbers(heap, left - 1, 0);
+    }
+    free(heap);
+    return n;
+}
+
+/*
+This function finds the k books with the most pages, or the k journals with the highest issue numbers, and
+stores pointers to them in results, highest first and, for equal numbers, highest slot first. If contributor is
+not NULL only the materials of that author or publisher are considered; their slots are read from the contributor
+index through a heap of the k best, so p postings cost O(p log k) time and O(k) memory. Otherwise an ordered
+store walks its number index down from the top in O(log n + k), and any other store passes the materials of the
+type through the same heap. It returns the number of results stored, and 0 for a NULL argument, a newspaper, an
+invalid type or when memory runs out.
+*/
+size_t storeTopMaterials(const struct ArchiveStore *store, enum MaterialType type, const char *contributor, size_t k, const struct Material **results)
+{
+    struct MetricsSpan span = metricsBegin(METRIC_TOP);
+    size_t n = storeTopScan(store, type, contributor, k, results);
+    metricsEnd(&span, n, false);
+    return n;
+}
+
+/*
+This function copies the aggregate counts of the store into stats in constant time. Materials with an invalid
+type only count towards the total and newspapers towards no page total.
+*/
+void storeStats(const struct ArchiveStore *store, struct StoreStats *stats)
+{
+    if (store == NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = store->stats;
+    stats->materials = store->count;
+    stats->contributors = store->people.active;
+}
+
+/*
+This function returns the number of live materials whose author, publisher or editor is contributor, in the
+expected constant time of one hash lookup.
+*/
+size_t storeContributorCount(const struct ArchiveStore *store, const char *contributor)
+{
+    size_t count;
+    storeContributorSlots(store, contributor, &count);
+    return count;
+}
+
+/*
+This function returns the slots of every material whose author, publisher or editor is exactly author, in
+ascending slot order, straight from the contributor index; the cost is independent of the archive size. The
+number of slots is stored in count. It returns NULL with count set to 0 if the store or author is NULL, the
+author is empty or nothing matches. The array is owned by the store and valid until the next mutation.
+*/
+const uint32_t *storeContributorSlots(const struct ArchiveStore *store, const char *author, size_t *count)
+{
+    *count = 0;
+    if (store == NULL || author == NULL || author[0] == '\0')
+    {
+        return NULL;
+    }
+
+    const struct PersonPostings *postings = personIndexFind(&store->people, author);
+    if (postings == NULL || postings->count == 0)
+    {
+        return NULL;
+    }
+    *count = postings->count;
+    return postings->slots;
+}
+
+/*
+This function filters the materials of the store by contributor like filterMaterialsByAuthor does for the
+fixed-size Archive, but the matches come from the contributor index instead of a scan and their number is
+stored in count. It returns a newly allocated array of copies that the caller must free, or NULL if nothing
+matches or the arguments are invalid. It is kept for callers that need owned copies; storeFilterMaterialsByAuthorView
+answers the same query without allocating.
+*/
+struct Material *storeFilterMaterialsByAuthor(struct ArchiveStore *store, const char *author, size_t *count)
+{
+    size_t matches;
+    const uint32_t *slots = storeContributorSlots(store, author, &matches);
+    *count = 0;
+    if (slots == NULL)
+    {
+        return NULL;
+    }
+
+    struct Material *result = (struct Material *)malloc(matches * sizeof(struct Material));
+    if (result == NULL)
+    {
+        return NULL;
+    }
+    for (size_t i = 0; i < matches; i++)
+    {
+        result[i] = *storeAt(store, slots[i]);
+    }
+    *count = matches;
+    return result;
+}
+
+/*
+This function returns the slots of every material of the given type as a bitmap maintained by the store, so no
+records are read or copied. Callers can iterate it or intersect it with other bitmaps using slotBitmapAnd. It
+returns NULL for an invalid type. The bitmap is owned by the store and valid until the next mutation.
+*/
+const struct SlotBitmap *storeFilterMaterials(const struct ArchiveStore *store, enum MaterialType type)
+{
+    if (store == NULL || type < BOOK || type > NEWSPAPER)
+    {
+        return NULL;
+    }
+    return &store->typeSlots[type];
+}
+
+/*
+This function returns the slots of every material of the given type whose BookType, JournalType or
+NewspaperType equals subtype, for example every HISTORY book or every WEEKLY newspaper. It returns NULL if the
+type or subtype is out of range. The bitmap is owned by the store and valid until the next mutation.
+*/
+const struct SlotBitmap *storeFilterMaterialsBySubtype(const struct ArchiveStore *store, enum MaterialType type, int subtype)
+{
+    if (store == NULL || type < BOOK || type > NEWSPAPER || subtype < 0 || subtype >= STORE_SUBTYPES)
+    {
+        return NULL;
+    }
+    return &store->subtypeSlots[type][subtype];
+}
+
+/*
+This function sets bit i of bits, which must hold columnWords(store->slots) words, for every live slot i whose
+material has the given type and, unless subtype is -1, the given subtype. On a columnar store the type and
+subtype columns are scanned with the SIMD kernels in blocks of STORE_SCAN_BLOCK slots, so the two bit vectors of
+a block are combined while still in cache; otherwise the bits are read off the type bitmaps. It returns the
+number of matches, or 0 with every bit cleared if the type or subtype is out of range.
+*/
+size_t storeScanType(const struct ArchiveStore *store, enum MaterialType type, int subtype, uint64_t *bits)
+{
+    size_t words = columnWords(store->slots);
+    if (type < BOOK || type > NEWSPAPER || subtype < -1 || subtype >= STORE_SUBTYPES)
+    {
+        memset(bits, 0, words * sizeof(uint64_t));
+        return 0;
+    }
+
+    if (!store->columnar)
+    {
+        const struct SlotBitmap *slots = subtype < 0 ? &store->typeSlots[type] : &store->subtypeSlots[type][subtype];
+        struct SlotBitmapIterator iterator;
+        uint32_t slot;
+        memset(bits, 0, words * sizeof(uint64_t));
+        slotBitmapIterate(slots, &iterator);
+        while (slotBitmapNext(&iterator, &slot))
+        {
+            bits[slot / 64] |= (uint64_t)1 << (slot % 64);
+        }
+        return slotBitmapCardinality(slots);
+    }
+
+    uint64_t block[STORE_SCAN_BLOCK / 64];
+    size_t count = 0;
+    for (size_t begin = 0; begin < store->slots; begin += STORE_SCAN_BLOCK)
+    {
+        size_t n = store->slots - begin < STORE_SCAN_BLOCK ? store->slots - begin : STORE_SCAN_BLOCK;
+        uint64_t *out = &bits[begin / 64];
+        size_t matches = columnScanEqualU8(&store->columns.types[begin], n, (uint8_t)type, out);
+        if (subtype >= 0 && matches != 0)
+        {
+            columnScanEqualU8(&store->columns.subtypes[begin], n, (uint8_t)subtype, block);
+            matches = columnBitsAnd(out, block, columnWords(n));
+        }
+        count += matches;
+    }
+    return count;
+}
+
+/*
+This function sets the bits of the live slots holding a material of the given type whose number (the pages of
+a book or the issue of a journal) lies in the inclusive range [low, high], in the same way as storeScanType.
+Newspapers have no number and never match. It returns the number of matches.
+*/
+size_t storeScanNumberRange(const struct ArchiveStore *store, enum MaterialType type, int32_t low, int32_t high, uint64_t *bits)
+{
+    size_t words = columnWords(store->slots);
+    if (type != BOOK && type != JOURNAL)
+    {
+        memset(bits, 0, words * sizeof(uint64_t));
+        return 0;
+    }
+
+    if (!store->columnar)
+    {
+        size_t count = 0;
+        memset(bits, 0, words * sizeof(uint64_t));
+        for (size_t slot = 0; slot < store->slots; slot++)
+        {
+            const struct Material *material = storeAt(store, slot);
+            int32_t number = storeMaterialNumber(material);
+            if (storeIsLive(store, slot) && material->type == type && number >= low && number <= high)
+            {
+                bits[slot / 64] |= (uint64_t)1 << (slot % 64);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    uint64_t block[STORE_SCAN_BLOCK / 64];
+    size_t count = 0;
+    for (size_t begin = 0; begin < store->slots; begin += STORE_SCAN_BLOCK)
+    {
+        size_t n = store->slots - begin < STORE_SCAN_BLOCK ? store->slots - begin : STORE_SCAN_BLOCK;
+        uint64_t *out = &bits[begin / 64];
+        if (columnScanRangeI32(&store->columns.numbers[begin], n, low, high, out) == 0)
+        {
+            continue;
+        }
+        columnScanEqualU8(&store->columns.types[begin], n, (uint8_t)type, block);
+        count += columnBitsAnd(out, block, columnWords(n));
+    }
+    return count;
+}
+
+/*
+This function returns the contributor of a material: the author of a book, the publisher of a journal or the
+editor of a newspaper. It returns NULL for a material with an invalid type.
+*/
+const char *materialContributor(const struct Material *material)
+{
+    switch (material->type)
+    {
+    case BOOK:
+        return material->details.book.author;
+    case JOURNAL:
+        return material->details.journal.publisher;
+    case NEWSPAPER:
+        return material->details.newspaper.editor;
+    default:
+        return NULL;
+    }
+}
+
+/*
+This function returns the subtype of a material as an int: its BookType, JournalType or NewspaperType. It
+returns -1 if the type or the subtype is out of range.
+*/
+int materialSubtype(const struct Material *material)
+{
+    int subtype;
+    switch (material->type)
+    {
+    case BOOK:
+        subtype = material->details.book.type;
+        break;
+    case JOURNAL:
+        subtype = material->details.journal.type;
+        break;
+    case NEWSPAPER:
+        subtype = material->details.newspaper.type;
+        break;
+    default:
+        return -1;
+    }
+    return subtype >= 0 && subtype < STORE_SUBTYPES ? subtype : -1;
+}
+
+/*
+This function copies every material of a fixed-size Archive into the store, which is the migration path for
+code that still builds struct Archive values. Materials whose titles are already present are skipped. It
+returns the number of materials that could not be added, so 0 means the whole archive was imported, or -1 if
+either argument is NULL.
+*/
+int storeImportArchive(struct ArchiveStore *store, const struct Archive *archive)
+{
+    if (store == NULL || archive == NULL)
+    {
+        return -1;
+    }
+
+    int rejected = 0;
+    for (int i = 0; i < archive->count; i++)
+    {
+        if (storeAddMaterial(store, &archive->materials[i]) != 0)
+        {
+            rejected++;
+        }
+    }
+    return rejected;
+}
+
+/*
+This function copies the live materials of the store, in slot order, into a fixed-size Archive so that it can
+be passed to the original API. The archive is overwritten. If the store holds more materials than an Archive
+can, only the first 100 are copied and the function returns -1; otherwise it returns 0.
+*/
+int storeExportArchive(const struct ArchiveStore *store, struct Archive *archive)
+{
+    if (store == NULL || archive == NULL)
+    {
+        return -1;
+    }
+
+    size_t limit = sizeof(archive->materials) / sizeof(archive->materials[0]);
+    size_t n = 0;
+
+    memset(archive, 0, sizeof(*archive));
+    for (size_t i = 0; i < store->slots && n < limit; i++)
+    {
+        if (storeIsLive(store, i))
+        {
+            archive->materials[n++] = *storeAt(store, i);
+        }
+    }
+    archive->count = (int)n;
+    return store->count > limit ? -1 : 0;
+}
@@ -0,0 +1,211 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bitmap.h"
+#include "titleindex.h"
+#include "personindex.h"
+#include "slotbitmap.h"
+#include "columns.h"
+#include "titlesearch.h"
+#include "fuzzy.h"
+#include "numberindex.h"
+
+// Defaults
+#define STORE_DEFAULT_CHUNK_SIZE 1024
+#define STORE_LEGACY_CAPACITY 100
+#define STORE_TYPES 3
+#define STORE_SUBTYPES 3
+#define STORE_SCAN_BLOCK 4096
+#define STORE_BULK_PARALLEL_MIN 8192
+#define STORE_BULK_MAX_THREADS 16
+
+// Enums
+enum StoreRemoveMode
+{
+    STORE_REMOVE_TOMBSTONE,
+    STORE_REMOVE_SWAP
+};
+enum StoreBulkFlags
+{
+    STORE_BULK_DEFAULT = 0,
+    STORE_BULK_SERIAL = 1
+};
+
+// Structs
+
+/*
+Tuning knobs for an ArchiveStore. A chunkSize of 0 selects STORE_DEFAULT_CHUNK_SIZE and is rounded up
+to a power of two. A maxCapacity of 0 means the store grows without limit; STORE_LEGACY_CAPACITY gives
+the behaviour of the fixed-size struct Archive. removeMode chooses between leaving a tombstone, which keeps
+every other material in its slot, and moving the last material into the hole. With tombstones, a
+compactionBudget above 0 makes every removal examine up to that many slots of an incremental compaction pass
+once a quarter of the slots are dead; with 0 compaction only runs when storeCompact is called. columnar keeps
+a struct-of-arrays copy of the type, subtype and pages/issue fields for the storeScan functions.
+searchable maintains a TitleSearch for the storeSearch functions. fuzzy maintains a trigram index of the folded
+titles for storeFindFuzzy. ordered maintains sorted indexes of book pages and journal issues for
+storeRangeMaterials and storeTopMaterials.
+*/
+struct StoreConfig
+{
+    size_t chunkSize;
+    size_t maxCapacity;
+    enum StoreRemoveMode removeMode;
+    size_t compactionBudget;
+    bool columnar;
+    bool searchable;
+    bool fuzzy;
+    bool ordered;
+};
+
+/*
+Identifies a stored material by slot together with the generation of that slot. The generation changes
+whenever the slot's occupant changes, so a handle kept across a removal or a compaction move resolves to NULL
+instead of to whatever material now occupies the slot.
+*/
+struct MaterialHandle
+{
+    uint32_t slot;
+    uint32_t generation;
+};
+
+/*
+Aggregate counts over the live materials of a store: the total, the number of each type and of each subtype
+within a type, the sum of the pages of all books and the number of distinct contributors. A store keeps them up
+to date on every mutation, so reading them costs the same whatever the size of the store.
+*/
+struct StoreStats
+{
+    size_t materials;
+    size_t types[STORE_TYPES];
+    size_t subtypes[STORE_TYPES][STORE_SUBTYPES];
+    int64_t pages;
+    size_t contributors;
+};
+
+/*
+A result of storeFindFuzzy: a material and the edit distance between its folded title and the folded query.
+*/
+struct MaterialMatch
+{
+    const struct Material *material;
+    int distance;
+};
+
+/*
+A growable archive. Materials live in fixed-size chunks that are never moved once allocated, so a
+struct Material * handed out by the store stays valid while the store grows. Only the table of chunk
+pointers is reallocated. Titles are indexed by a hash table, contributors by an inverted index and types and
+subtypes by slot bitmaps, all kept in sync by every mutating function.
+
+count is the number of live materials and slots the number of slots in use, including dead ones left by
+tombstone removal. Each slot has a generation whose lowest bit is set while the slot is live.
+*/
+struct ArchiveStore
+{
+    struct Material **chunks;
+    size_t chunkCount;
+    size_t chunkTableSize;
+    size_t chunkShift;
+    size_t chunkMask;
+    size_t count;
+    size_t slots;
+    size_t maxCapacity;
+    enum StoreRemoveMode removeMode;
+    size_t compactionBudget;
+    uint32_t *generations;
+    size_t generationCapacity;
+    bool compacting;
+    size_t compactRead;
+    size_t compactWrite;
+    bool columnar;
+    struct ColumnStore columns;
+    bool searchable;
+    struct TitleSearch search;
+    bool fuzzy;
+    struct PersonIndex trigrams;
+    bool ordered;
+    struct NumberIndex numbers[STORE_TYPES];
+    struct StoreStats stats;
+    struct TitleIndex titles;
+    struct PersonIndex people;
+    struct SlotBitmap typeSlots[STORE_TYPES];
+    struct SlotBitmap subtypeSlots[STORE_TYPES][STORE_SUBTYPES];
+};
+
+// Functions
+
+void storeDefaultConfig(struct StoreConfig *config);
+
+int storeInit(struct ArchiveStore *store, const struct StoreConfig *config);
+
+void storeFree(struct ArchiveStore *store);
+
+int storeReserve(struct ArchiveStore *store, size_t capacity);
+
+static inline struct Material *storeAt(const struct ArchiveStore *store, size_t slot)
+{
+    return &store->chunks[slot >> store->chunkShift][slot & store->chunkMask];
+}
+
+static inline bool storeIsLive(const struct ArchiveStore *store, size_t slot)
+{
+    return slot < store->slots && (store->generations[slot] & 1) != 0;
+}
+
+int storeAddMaterial(struct ArchiveStore *store, const struct Material *material);
+
+size_t storeAddMaterials(struct ArchiveStore *store, const struct Material *items, size_t n, unsigned flags, int *codes);
+
+struct Material *storeFindMaterial(const struct ArchiveStore *store, const char *title);
+
+int storeUpdateMaterial(struct ArchiveStore *store, const char *title, union MaterialDetails details);
+
+void storeRemoveMaterial(struct ArchiveStore *store, const char *title);
+
+size_t storeCompact(struct ArchiveStore *store, size_t budget);
+
+int storeFindHandle(const struct ArchiveStore *store, const char *title, struct MaterialHandle *handle);
+
+struct Material *storeResolve(const struct ArchiveStore *store, struct MaterialHandle handle);
+
+const struct SlotBitmap *storeFilterMaterials(const struct ArchiveStore *store, enum MaterialType type);
+
+const struct SlotBitmap *storeFilterMaterialsBySubtype(const struct ArchiveStore *store, enum MaterialType type, int subtype);
+
+size_t storeScanType(const struct ArchiveStore *store, enum MaterialType type, int subtype, uint64_t *bits);
+
+size_t storeScanNumberRange(const struct ArchiveStore *store, enum MaterialType type, int32_t low, int32_t high, uint64_t *bits);
+
+size_t storeFilterMaterialsView(const struct ArchiveStore *store, enum MaterialType type, const struct Material **results, size_t capacity);
+
+size_t storeFilterMaterialsByAuthorView(const struct ArchiveStore *store, const char *author, const struct Material **results, size_t capacity);
+
+size_t storeSearchPrefix(const struct ArchiveStore *store, const char *prefix, size_t offset, const struct Material **results, size_t limit);
+
+size_t storeSearchTitles(const struct ArchiveStore *store, const char *pattern, size_t offset, const struct Material **results, size_t limit);
+
+size_t storeFindFuzzy(const struct ArchiveStore *store, const char *title, int maxDistance, struct MaterialMatch *results, size_t capacity);
+
+size_t storeRangeMaterials(const struct ArchiveStore *store, enum MaterialType type, int32_t low, int32_t high, size_t offset, const struct Material **results, size_t limit);
+
+size_t storeTopMaterials(const struct ArchiveStore *store, enum MaterialType type, const char *contributor, size_t k, const struct Material **results);
+
+void storeStats(const struct ArchiveStore *store, struct StoreStats *stats);
+
+size_t storeContributorCount(const struct ArchiveStore *store, const char *contributor);
+
+const uint32_t *storeContributorSlots(const struct ArchiveStore *store, const char *author, size_t *count);
+
+struct Material *storeFilterMaterialsByAuthor(struct ArchiveStore *store, const char *author, size_t *count);
+
+const char *materialContributor(const struct Material *material);
+
+int materialSubtype(const struct Material *material);
+
+int storeImportArchive(struct ArchiveStore *store, const struct Archive *archive);
+
+int storeExportArchive(const struct ArchiveStore *store, struct Archive *archive);
+
+#endif
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <string.h>
+#include "stringpool.h"
+
+/*
+This function is the key function of the pool's index: the string with a given id.
+*/
+static const char *stringPoolKey(const void *context, uint32_t id)
+{
+    return stringPoolGet((const struct StringPool *)context, id);
+}
+
+/*
+This function initializes an empty pool. Nothing is allocated until the first string is interned.
+*/
+void stringPoolInit(struct StringPool *pool)
+{
+    memset(pool, 0, sizeof(*pool));
+    titleIndexInit(&pool->index);
+}
+
+/*
+This function releases every string of the pool.
+*/
+void stringPoolFree(struct StringPool *pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+    free(pool->bytes);
+    free(pool->offsets);
+    titleIndexFree(&pool->index);
+    stringPoolInit(pool);
+}
+
+/*
+This function returns the id of string, adding it to the pool if it is not there yet. It returns
+STRING_POOL_NONE if memory could not be allocated or the pool is full, in which case the pool is unchanged.
+*/
+uint32_t stringPoolIntern(struct StringPool *pool, const char *string)
+{
+    uint32_t hash = titleHash(string);
+    uint32_t id = titleIndexFind(&pool->index, hash, string, stringPoolKey, pool);
+    if (id != TITLE_INDEX_NONE)
+    {
+        return id;
+    }
+
+    size_t length = strlen(string) + 1;
+    if (pool->count >= STRING_POOL_NONE - 1 || pool->size + length > UINT32_MAX)
+    {
+        return STRING_POOL_NONE;
+    }
+    if (pool->size + length > pool->capacity)
+    {
+        size_t capacity = pool->capacity == 0 ? 4096 : pool->capacity * 2;
+        while (capacity < pool->size + length)
+        {
+            capacity *= 2;
+        }
+        char *bytes = (char *)realloc(pool->bytes, capacity);
+        if (bytes == NULL)
+        {
+            return STRING_POOL_NONE;
+        }
+        pool->bytes = bytes;
+        pool->capacity = capacity;
+    }
+    if (pool->count == pool->idCapacity)
+    {
+        size_t capacity = pool->idCapacity == 0 ? 256 : pool->idCapacity * 2;
+        uint32_t *offsets = (uint32_t *)realloc(pool->offsets, capacity * sizeof(uint32_t));
+        if (offsets == NULL)
+        {
+            return STRING_POOL_NONE;
+        }
+        pool->offsets = offsets;
+        pool->idCapacity = capacity;
+    }
+
+    id = (uint32_t)pool->count;
+    if (titleIndexInsert(&pool->index, hash, id) != 0)
+    {
+        return STRING_POOL_NONE;
+    }
+    memcpy(pool->bytes + pool->size, string, length);
+    pool->offsets[id] = (uint32_t)pool->size;
+    pool->size += length;
+    pool->count++;
+    return id;
+}
+
+/*
+This function returns the id of string without adding it, or STRING_POOL_NONE if it has never been interned.
+*/
+uint32_t stringPoolFind(const struct StringPool *pool, const char *string)
+{
+    uint32_t id = titleIndexFind(&pool->index, titleHash(string), string, stringPoolKey, pool);
+    return id == TITLE_INDEX_NONE ? STRING_POOL_NONE : id;
+}
+
+/*
+This function returns the bytes allocated by the pool: the arena, the id table and the index buckets.
+*/
+size_t stringPoolMemory(const struct StringPool *pool)
+{
+    size_t buckets = pool->index.entries == NULL ? 0 : pool->index.mask + 1;
+    return pool->capacity + pool->idCapacity * sizeof(uint32_t) + buckets * sizeof(struct TitleIndexEntry);
+}
@@ -0,0 +1,47 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "titleindex.h"
+
+#define STRING_POOL_NONE UINT32_MAX
+
+// Structs
+
+/*
+Interned strings. Every distinct string is stored once, NUL-terminated, in the bytes arena and named by a
+32-bit id, its position in offsets; ids are dense and never reused, so two strings of one pool are equal
+exactly when their ids are. The strings are found through a TitleIndex keyed by the pool itself. Strings are
+never removed. bytes moves when it grows, so a pointer from stringPoolGet is only valid until the next
+stringPoolIntern.
+*/
+struct StringPool
+{
+    char *bytes;
+    size_t size;
+    size_t capacity;
+    uint32_t *offsets;
+    size_t count;
+    size_t idCapacity;
+    struct TitleIndex index;
+};
+
+// Functions
+
+void stringPoolInit(struct StringPool *pool);
+
+void stringPoolFree(struct StringPool *pool);
+
+uint32_t stringPoolIntern(struct StringPool *pool, const char *string);
+
+uint32_t stringPoolFind(const struct StringPool *pool, const char *string);
+
+static inline const char *stringPoolGet(const struct StringPool *pool, uint32_t id)
+{
+    return pool->bytes + pool->offsets[id];
+}
+
+size_t stringPoolMemory(const struct StringPool *pool);
+
+#endif
@@ -264,4 +264,34 @@ public:
         struct Material *result = filterMaterialsByAuthor(&archive, author);
         TS_ASSERT(result == NULL);
     }
+    //////////////////////////////////////////////////////////////////////////////////////////
+
+    void testFilterMaterialsViewPointsIntoArchive()
+    {
+        struct Archive archive = {
+            {{"The Great Gatsby", BOOK, {.book = {180, "F. Scott Fitzgerald", NOVEL}}},
+             {"Nature", JOURNAL, {.journal = {5, "Springer", SCIENCE}}},
+             {"The Sun Also Rises", BOOK, {.book = {251, "Ernest Hemingway", NOVEL}}}},
+            3};
+        const struct Material *results[1];
+        TS_ASSERT_EQUALS(filterMaterialsView(&archive, BOOK, results, 1), 2);
+        TS_ASSERT(results[0] == &archive.materials[0]);
+        TS_ASSERT_EQUALS(filterMaterialsView(&archive, NEWSPAPER, NULL, 0), 0);
+        TS_ASSERT_EQUALS(filterMaterialsView(NULL, BOOK, NULL, 0), -1);
+    }
+
+    void testFilterMaterialsByAuthorViewCountsMatches()
+    {
+        struct Archive archive = {
+            {{"Material1", BOOK, {.book = {200, "Author1", NOVEL}}},
+             {"Material2", JOURNAL, {.journal = {1, "Author1", SCIENCE}}},
+             {"Material3", BOOK, {.book = {250, "Author2", BIOGRAPHY}}}},
+            3};
+        const struct Material *results[3];
+        TS_ASSERT_EQUALS(filterMaterialsByAuthorView(&archive, "Author1", results, 3), 2);
+        TS_ASSERT(results[0] == &archive.materials[0]);
+        TS_ASSERT(results[1] == &archive.materials[1]);
+        TS_ASSERT_EQUALS(filterMaterialsByAuthorView(&archive, "", results, 3), 0);
+        TS_ASSERT_EQUALS(filterMaterialsByAuthorView(&archive, NULL, results, 3), -1);
+    }
 };
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/store.h"
+
+class ColumnsTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testKernelsMatchReference()
+    {
+        // lengths around the 64-entry word and the 8- and 16-lane vectors
+        size_t lengths[] = {0, 1, 7, 31, 63, 64, 65, 127, 128, 200, 1000};
+        uint8_t small[1000];
+        int32_t numbers[1000];
+        uint64_t bits[16];
+        for (int i = 0; i < 1000; i++)
+        {
+            small[i] = (uint8_t)((i * 7) % 5);
+            numbers[i] = (i * 37) % 301 - 50;
+        }
+
+        bool agree = true;
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+        {
+            size_t n = lengths[l];
+            size_t expected = 0;
+            memset(bits, 0xaa, sizeof(bits));
+            size_t count = columnScanEqualU8(small, n, 3, bits);
+            for (size_t i = 0; i < n; i++)
+            {
+                expected += small[i] == 3;
+                agree = agree && ((bits[i / 64] >> (i % 64)) & 1) == (small[i] == 3);
+            }
+            agree = agree && count == expected;
+
+            expected = 0;
+            count = columnScanRangeI32(numbers, n, -10, 100, bits);
+            for (size_t i = 0; i < n; i++)
+            {
+                bool match = numbers[i] >= -10 && numbers[i] <= 100;
+                expected += match;
+                agree = agree && ((bits[i / 64] >> (i % 64)) & 1) == match;
+            }
+            agree = agree && count == expected;
+
+            // bits past n in the last word are cleared
+            if (n % 64 != 0)
+            {
+                agree = agree && (bits[n / 64] >> (n % 64)) == 0;
+            }
+        }
+        TS_ASSERT(agree);
+    }
+
+    void testScanAgreesWithBitmaps()
+    {
+        struct StoreConfig config;
+        struct ArchiveStore columnar;
+        struct ArchiveStore plain;
+        storeDefaultConfig(&config);
+        storeInit(&plain, &config);
+        config.columnar = true;
+        storeInit(&columnar, &config);
+
+        for (int i = 0; i < 5000; i++)
+        {
+            struct Material material = {"", BOOK, {.book = {i % 500, "Author", (enum BookType)(i % 3)}}};
+            if (i % 4 == 1)
+            {
+                struct Material journal = {"", JOURNAL, {.journal = {i % 40, "Publisher", (enum JournalType)(i % 3)}}};
+                material = journal;
+            }
+            else if (i % 4 == 2)
+            {
+                struct Material newspaper = {"", NEWSPAPER, {.newspaper = {"Editor", (enum NewspaperType)(i % 3)}}};
+                material = newspaper;
+            }
+            snprintf(material.title, sizeof(material.title), "Title %d", i);
+            storeAddMaterial(&columnar, &material);
+            storeAddMaterial(&plain, &material);
+        }
+        for (int i = 0; i < 5000; i += 7)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "Title %d", i);
+            storeRemoveMaterial(&columnar, title);
+            storeRemoveMaterial(&plain, title);
+        }
+        union MaterialDetails details = {.book = {450, "Author", HISTORY}};
+        storeUpdateMaterial(&columnar, "Title 4", details);
+        storeUpdateMaterial(&plain, "Title 4", details);
+
+        size_t words = columnWords(columnar.slots);
+        uint64_t *expected = (uint64_t *)calloc(words, sizeof(uint64_t));
+        uint64_t *actual = (uint64_t *)calloc(words, sizeof(uint64_t));
+        for (int type = BOOK; type <= NEWSPAPER; type++)
+        {
+            for (int subtype = -1; subtype < STORE_SUBTYPES; subtype++)
+            {
+                size_t count = storeScanType(&columnar, (enum MaterialType)type, subtype, actual);
+                TS_ASSERT_EQUALS(storeScanType(&plain, (enum MaterialType)type, subtype, expected), count);
+                TS_ASSERT_SAME_DATA(actual, expected, words * sizeof(uint64_t));
+            }
+        }
+        size_t pages = storeScanNumberRange(&columnar, BOOK, 100, 449, actual);
+        TS_ASSERT_EQUALS(storeScanNumberRange(&plain, BOOK, 100, 449, expected), pages);
+        TS_ASSERT_SAME_DATA(actual, expected, words * sizeof(uint64_t));
+        TS_ASSERT_EQUALS(storeScanNumberRange(&columnar, NEWSPAPER, 0, 0, actual), 0u);
+
+        storeCompact(&columnar, 0);
+        storeCompact(&plain, 0);
+        words = columnWords(columnar.slots);
+        TS_ASSERT_EQUALS(storeScanNumberRange(&columnar, JOURNAL, 0, 9, actual), storeScanNumberRange(&plain, JOURNAL, 0, 9, expected));
+        TS_ASSERT_SAME_DATA(actual, expected, words * sizeof(uint64_t));
+        TS_ASSERT_EQUALS(storeScanType(&columnar, BOOK, HISTORY, actual), storeScanType(&plain, BOOK, HISTORY, expected));
+        TS_ASSERT_SAME_DATA(actual, expected, words * sizeof(uint64_t));
+
+        free(expected);
+        free(actual);
+        storeFree(&columnar);
+        storeFree(&plain);
+    }
+
+};
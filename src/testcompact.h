@@ -0,0 +1,98 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/compact.h"
+
+class CompactTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testStringPoolInternsOnce()
+    {
+        struct StringPool pool;
+        stringPoolInit(&pool);
+        TS_ASSERT_EQUALS(stringPoolFind(&pool, "Editor"), STRING_POOL_NONE);
+        uint32_t editor = stringPoolIntern(&pool, "Editor");
+        uint32_t publisher = stringPoolIntern(&pool, "Publisher");
+        TS_ASSERT_DIFFERS(editor, publisher);
+        TS_ASSERT_EQUALS(stringPoolIntern(&pool, "Editor"), editor);
+        TS_ASSERT_EQUALS(stringPoolFind(&pool, "Publisher"), publisher);
+        for (int i = 0; i < 10000; i++)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "Name %d", i);
+            TS_ASSERT_EQUALS(stringPoolIntern(&pool, name), (uint32_t)i + 2);
+        }
+        // growing the arena must keep every string reachable by its id
+        TS_ASSERT_EQUALS(strcmp(stringPoolGet(&pool, editor), "Editor"), 0);
+        TS_ASSERT_EQUALS(strcmp(stringPoolGet(&pool, 5002), "Name 5000"), 0);
+        TS_ASSERT_EQUALS(pool.count, 10002u);
+        stringPoolFree(&pool);
+    }
+
+    void testCompactArchiveRoundTrips()
+    {
+        TS_ASSERT_EQUALS(sizeof(struct CompactRecord), 16u);
+        struct CompactArchive archive;
+        compactInit(&archive);
+        struct Material book = {"Book Title", BOOK, {.book = {200, "Author Name", NOVEL}}};
+        struct Material journal = {"Journal Title", JOURNAL, {.journal = {7, "Publisher", ART}}};
+        struct Material newspaper = {"Newspaper Title", NEWSPAPER, {.newspaper = {"Author Name", WEEKLY}}};
+        struct Material invalid = {"Invalid", BOOK, {.book = {1, "Author Name", (enum BookType)9}}};
+        TS_ASSERT_EQUALS(compactAddMaterial(&archive, &book), 0);
+        TS_ASSERT_EQUALS(compactAddMaterial(&archive, &journal), 0);
+        TS_ASSERT_EQUALS(compactAddMaterial(&archive, &newspaper), 0);
+        TS_ASSERT_EQUALS(compactAddMaterial(&archive, &book), -1);
+        TS_ASSERT_EQUALS(compactAddMaterial(&archive, &invalid), -1);
+        TS_ASSERT_EQUALS(archive.names.count, 2u);
+
+        struct Material found;
+        TS_ASSERT_EQUALS(compactFindMaterial(&archive, "Journal Title", &found), 0);
+        TS_ASSERT_SAME_DATA(&found, &journal, sizeof(found.title));
+        TS_ASSERT_EQUALS(found.details.journal.issue, 7);
+        TS_ASSERT_EQUALS(strcmp(found.details.journal.publisher, "Publisher"), 0);
+        TS_ASSERT_EQUALS(found.details.journal.type, ART);
+        TS_ASSERT_EQUALS(compactFindMaterial(&archive, "Missing", &found), -1);
+
+        struct Material results[4];
+        TS_ASSERT_EQUALS(compactFilterMaterialsByAuthor(&archive, "Author Name", results, 4), 2u);
+        TS_ASSERT_EQUALS(strcmp(results[1].details.newspaper.editor, "Author Name"), 0);
+        TS_ASSERT_EQUALS(results[1].details.newspaper.type, WEEKLY);
+        TS_ASSERT_EQUALS(compactFilterMaterialsByAuthor(&archive, "Nobody", results, 4), 0u);
+        TS_ASSERT_EQUALS(compactFilterMaterials(&archive, BOOK, NULL, 0), 1u);
+
+        union MaterialDetails details = {.book = {300, "Other Author", HISTORY}};
+        TS_ASSERT_EQUALS(compactUpdateMaterial(&archive, "Book Title", details), 0);
+        TS_ASSERT_EQUALS(compactFilterMaterialsByAuthor(&archive, "Author Name", results, 4), 1u);
+        TS_ASSERT_EQUALS(compactFindMaterial(&archive, "Book Title", &found), 0);
+        TS_ASSERT_EQUALS(found.details.book.pages, 300);
+        details.book.type = (enum BookType)9;
+        TS_ASSERT_EQUALS(compactUpdateMaterial(&archive, "Book Title", details), -3);
+        TS_ASSERT_EQUALS(compactUpdateMaterial(&archive, "Missing", details), -2);
+
+        // removal moves the last record into the hole
+        TS_ASSERT_EQUALS(compactRemoveMaterial(&archive, "Book Title"), 0);
+        TS_ASSERT_EQUALS(compactRemoveMaterial(&archive, "Book Title"), -1);
+        TS_ASSERT_EQUALS(archive.count, 2u);
+        TS_ASSERT_EQUALS(compactFindMaterial(&archive, "Newspaper Title", &found), 0);
+        TS_ASSERT_EQUALS(compactFindMaterial(&archive, "Book Title", &found), -1);
+        TS_ASSERT_EQUALS(compactAddMaterial(&archive, &book), 0);
+        TS_ASSERT_EQUALS(compactFindMaterial(&archive, "Book Title", &found), 0);
+        compactFree(&archive);
+    }
+
+    void testSharedNamesShrinkRecords()
+    {
+        struct CompactArchive archive;
+        compactInit(&archive);
+        for (int i = 0; i < 20000; i++)
+        {
+            struct Material issue = {"", JOURNAL, {.journal = {i, "", SCIENCE}}};
+            snprintf(issue.title, sizeof(issue.title), "Review %d", i);
+            snprintf(issue.details.journal.publisher, sizeof(issue.details.journal.publisher), "Publishing House %d", i % 50);
+            TS_ASSERT_EQUALS(compactAddMaterial(&archive, &issue), 0);
+        }
+        TS_ASSERT_EQUALS(archive.names.count, 50u);
+        TS_ASSERT_EQUALS(compactFilterMaterialsByAuthor(&archive, "Publishing House 7", NULL, 0), 400u);
+        TS_ASSERT_LESS_THAN(compactMemory(&archive), 20000 * sizeof(struct Material));
+        compactFree(&archive);
+    }
+
+};
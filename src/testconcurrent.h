@@ -0,0 +1,142 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/concurrent.h"
+
+class ConcurrentTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testWritesAreVisibleToReaders()
+    {
+        struct ConcurrentArchive archive;
+        concurrentInit(&archive, NULL);
+        struct Material material1 = {"Book Title", BOOK, {.book = {200, "Author Name", NOVEL}}};
+        struct Material material2 = {"Journal Title", JOURNAL, {.journal = {2, "Author Name", SCIENCE}}};
+        TS_ASSERT_EQUALS(concurrentAddMaterial(&archive, &material1), 0);
+        TS_ASSERT_EQUALS(concurrentAddMaterial(&archive, &material2), 0);
+        TS_ASSERT_EQUALS(concurrentAddMaterial(&archive, &material1), -1);
+
+        struct Material found;
+        TS_ASSERT_EQUALS(concurrentFindMaterial(&archive, "Book Title", &found), 0);
+        TS_ASSERT_EQUALS(found.details.book.pages, 200);
+        union MaterialDetails details = {.book = {300, "Other Author", HISTORY}};
+        TS_ASSERT_EQUALS(concurrentUpdateMaterial(&archive, "Book Title", details), 0);
+        TS_ASSERT_EQUALS(concurrentFindMaterial(&archive, "Book Title", &found), 0);
+        TS_ASSERT_EQUALS(found.details.book.pages, 300);
+
+        struct Material results[4];
+        TS_ASSERT_EQUALS(concurrentFilterMaterialsByAuthor(&archive, "Author Name", results, 4), 1u);
+        TS_ASSERT_SAME_DATA(results[0].title, "Journal Title", 14);
+        TS_ASSERT_EQUALS(concurrentRemoveMaterial(&archive, "Journal Title"), 0);
+        TS_ASSERT_EQUALS(concurrentRemoveMaterial(&archive, "Journal Title"), -1);
+        TS_ASSERT_EQUALS(concurrentFilterMaterials(&archive, JOURNAL, results, 4), 0u);
+        TS_ASSERT_EQUALS(concurrentFilterMaterials(&archive, BOOK, results, 4), 1u);
+
+        // both copies must hold the same materials
+        TS_ASSERT_EQUALS(archive.stores[0].count, archive.stores[1].count);
+        TS_ASSERT(storeFindMaterial(&archive.stores[0], "Journal Title") == NULL);
+        TS_ASSERT(storeFindMaterial(&archive.stores[1], "Journal Title") == NULL);
+        concurrentFree(&archive);
+    }
+
+    struct ReaderState
+    {
+        struct ConcurrentArchive *archive;
+        int *running;
+        bool consistent;
+        size_t reads;
+    };
+
+    static void *readCounter(void *argument)
+    {
+        struct ReaderState *state = (struct ReaderState *)argument;
+        int last = -1;
+        int64_t lastPages = 0;
+        struct Material results[2];
+        while (__atomic_load_n(state->running, __ATOMIC_ACQUIRE))
+        {
+            struct Material found;
+            if (concurrentFindMaterial(state->archive, "Counter", &found) != 0)
+            {
+                state->consistent = false;
+                continue;
+            }
+            // pages and author are written together, so a torn read would make them disagree
+            char expected[50];
+            snprintf(expected, sizeof(expected), "Author %d", found.details.book.pages);
+            state->consistent = state->consistent && strcmp(found.details.book.author, expected) == 0;
+            state->consistent = state->consistent && found.details.book.pages >= last;
+            last = found.details.book.pages;
+            state->consistent = state->consistent && concurrentFilterMaterialsByAuthor(state->archive, expected, results, 2) <= 1;
+            // the aggregates come from one store between writes, so they always add up
+            struct StoreStats stats;
+            concurrentStats(state->archive, &stats);
+            state->consistent = state->consistent && stats.types[BOOK] == 1 && stats.types[BOOK] + stats.types[JOURNAL] == stats.materials;
+            state->consistent = state->consistent && stats.pages >= lastPages && stats.subtypes[JOURNAL][ART] == stats.types[JOURNAL];
+            lastPages = stats.pages;
+            state->reads++;
+        }
+        return NULL;
+    }
+
+    void testReadersNeverSeeTornWrites()
+    {
+        struct ConcurrentArchive archive;
+        concurrentInit(&archive, NULL);
+        struct Material counter = {"Counter", BOOK, {.book = {0, "Author 0", NOVEL}}};
+        concurrentAddMaterial(&archive, &counter);
+
+        int running = 1;
+        struct ReaderState states[4];
+        pthread_t threads[4];
+        for (int t = 0; t < 4; t++)
+        {
+            states[t].archive = &archive;
+            states[t].running = &running;
+            states[t].consistent = true;
+            states[t].reads = 0;
+            pthread_create(&threads[t], NULL, readCounter, &states[t]);
+        }
+        for (int i = 1; i <= 2000; i++)
+        {
+            union MaterialDetails details = {.book = {i, "", NOVEL}};
+            snprintf(details.book.author, sizeof(details.book.author), "Author %d", i);
+            TS_ASSERT_EQUALS(concurrentUpdateMaterial(&archive, "Counter", details), 0);
+            struct Material noise = {"", JOURNAL, {.journal = {i, "Publisher", ART}}};
+            snprintf(noise.title, sizeof(noise.title), "Noise %d", i);
+            concurrentAddMaterial(&archive, &noise);
+            if (i % 3 == 0)
+            {
+                snprintf(noise.title, sizeof(noise.title), "Noise %d", i - 1);
+                concurrentRemoveMaterial(&archive, noise.title);
+            }
+        }
+        __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+        for (int t = 0; t < 4; t++)
+        {
+            pthread_join(threads[t], NULL);
+            TS_ASSERT(states[t].consistent);
+        }
+        TS_ASSERT_EQUALS(archive.stores[0].count, archive.stores[1].count);
+        concurrentFree(&archive);
+    }
+
+    void testBatchAddPublishesAtOnce()
+    {
+        struct ConcurrentArchive archive;
+        concurrentInit(&archive, NULL);
+        struct Material items[50];
+        int codes[50];
+        for (int i = 0; i < 50; i++)
+        {
+            struct Material material = {"", NEWSPAPER, {.newspaper = {"Editor", DAILY}}};
+            snprintf(material.title, sizeof(material.title), "Paper %d", i % 40);
+            items[i] = material;
+        }
+        TS_ASSERT_EQUALS(concurrentAddMaterials(&archive, items, 50, codes), 40u);
+        TS_ASSERT_EQUALS(codes[45], -1);
+        TS_ASSERT_EQUALS(concurrentFilterMaterials(&archive, NEWSPAPER, NULL, 0), 40u);
+        TS_ASSERT_EQUALS(archive.stores[0].count, archive.stores[1].count);
+        TS_ASSERT_EQUALS(concurrentAddMaterials(&archive, items, 10, codes), 0u);
+        concurrentFree(&archive);
+    }
+
+};
@@ -0,0 +1,278 @@
+#include <cxxtest/TestSuite.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/durable.h"
+
+class DurableTestSuite : public CxxTest::TestSuite
+{
+public:
+    char directory[64];
+    char walPath[96];
+    char snapshotPath[104];
+
+    void setUp()
+    {
+        strcpy(directory, "/tmp/durable-test-XXXXXX");
+        TS_ASSERT(mkdtemp(directory) != NULL);
+        snprintf(walPath, sizeof(walPath), "%s/archive.wal", directory);
+        snprintf(snapshotPath, sizeof(snapshotPath), "%s/archive.snapshot", directory);
+    }
+
+    void tearDown()
+    {
+        unlink(walPath);
+        unlink(snapshotPath);
+        // left behind if the writer was killed during a checkpoint
+        strcat(snapshotPath, ".tmp");
+        unlink(snapshotPath);
+        rmdir(directory);
+    }
+
+    static struct Material book(int i)
+    {
+        struct Material material = {"", BOOK, {.book = {i, "Author", NOVEL}}};
+        snprintf(material.title, sizeof(material.title), "Title %d", i);
+        return material;
+    }
+
+    void testReplayRestoresEveryMutation()
+    {
+        struct DurableArchive archive;
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        for (int i = 0; i < 3; i++)
+        {
+            struct Material material = book(i);
+            TS_ASSERT_EQUALS(durableAddMaterial(&archive, &material), 0);
+        }
+        struct Material duplicate = book(1);
+        TS_ASSERT_EQUALS(durableAddMaterial(&archive, &duplicate), -1);
+        union MaterialDetails details = {.book = {500, "New Author", HISTORY}};
+        TS_ASSERT_EQUALS(durableUpdateMaterial(&archive, "Title 2", details), 0);
+        TS_ASSERT_EQUALS(durableRemoveMaterial(&archive, "Title 0"), 0);
+        TS_ASSERT_EQUALS(durableRemoveMaterial(&archive, "Title 0"), -1);
+        durableClose(&archive);
+
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        struct Material material;
+        TS_ASSERT_EQUALS(archive.store.count, 2u);
+        TS_ASSERT_EQUALS(durableFindMaterial(&archive, "Title 0", &material), -1);
+        TS_ASSERT_EQUALS(durableFindMaterial(&archive, "Title 2", &material), 0);
+        TS_ASSERT_EQUALS(material.details.book.pages, 500);
+        TS_ASSERT_EQUALS(archive.wal.lastSequence, 5u);
+        durableClose(&archive);
+    }
+
+    void testLogFailureHasOneCode()
+    {
+        struct DurableArchive archive;
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        struct Material material = book(0);
+        TS_ASSERT_EQUALS(durableAddMaterial(&archive, &material), 0);
+        // as after a failed write or fdatasync
+        archive.wal.failed = true;
+        material = book(1);
+        TS_ASSERT_EQUALS(durableAddMaterial(&archive, &material), DURABLE_LOG_FAILED);
+        union MaterialDetails details = {.book = {500, "New Author", HISTORY}};
+        TS_ASSERT_EQUALS(durableUpdateMaterial(&archive, "Title 0", details), DURABLE_LOG_FAILED);
+        TS_ASSERT_EQUALS(durableRemoveMaterial(&archive, "Title 0"), DURABLE_LOG_FAILED);
+        durableClose(&archive);
+    }
+
+    void testCheckpointKeepsLogSmall()
+    {
+        struct DurableArchive archive;
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 4096), 0);
+        for (int i = 0; i < 200; i++)
+        {
+            struct Material material = book(i);
+            TS_ASSERT_EQUALS(durableAddMaterial(&archive, &material), 0);
+        }
+        TS_ASSERT_LESS_THAN(archive.wal.size, 4096u);
+        TS_ASSERT_EQUALS(durableRemoveMaterial(&archive, "Title 7"), 0);
+        durableClose(&archive);
+
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        TS_ASSERT_EQUALS(archive.store.count, 199u);
+        TS_ASSERT_EQUALS(archive.wal.lastSequence, 201u);
+        TS_ASSERT_EQUALS(durableCheckpoint(&archive), 0);
+        TS_ASSERT_EQUALS(archive.wal.size, 0u);
+        durableClose(&archive);
+
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        struct Material material;
+        TS_ASSERT_EQUALS(durableFindMaterial(&archive, "Title 199", &material), 0);
+        TS_ASSERT_EQUALS(durableFindMaterial(&archive, "Title 7", &material), -1);
+        durableClose(&archive);
+    }
+
+    void testTornTailIsDiscarded()
+    {
+        struct DurableArchive archive;
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        for (int i = 0; i < 10; i++)
+        {
+            struct Material material = book(i);
+            durableAddMaterial(&archive, &material);
+        }
+        durableClose(&archive);
+
+        // half a record, as left by a crash in the middle of an append
+        FILE *file = fopen(walPath, "ab");
+        fwrite("\x01\x02\x03\x04\x70\x00\x00\x00\x0b", 1, 9, file);
+        fclose(file);
+
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        TS_ASSERT_EQUALS(archive.store.count, 10u);
+        struct Material material = book(10);
+        TS_ASSERT_EQUALS(durableAddMaterial(&archive, &material), 0);
+        durableClose(&archive);
+
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        TS_ASSERT_EQUALS(archive.store.count, 11u);
+        durableClose(&archive);
+    }
+
+    static int failOnThird(void *context, enum WalOp, const void *, size_t)
+    {
+        int *calls = (int *)context;
+        return ++*calls == 3 ? -1 : 0;
+    }
+
+    off_t walFileSize()
+    {
+        struct stat info;
+        return stat(walPath, &info) == 0 ? info.st_size : -1;
+    }
+
+    void testRejectedRecordFailsOpenAndKeepsLog()
+    {
+        struct DurableArchive archive;
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        for (int i = 0; i < 5; i++)
+        {
+            struct Material material = book(i);
+            durableAddMaterial(&archive, &material);
+        }
+        durableClose(&archive);
+
+        struct Wal wal;
+        off_t size = walFileSize();
+        int calls = 0;
+        TS_ASSERT_EQUALS(walOpen(&wal, walPath), 0);
+        TS_ASSERT_EQUALS(walReplay(&wal, 0, failOnThird, &calls), -2);
+        TS_ASSERT_EQUALS(calls, 3);
+        walClose(&wal);
+        TS_ASSERT_EQUALS(walFileSize(), size);
+
+        // a record whose payload durableApply cannot decode
+        calls = 0;
+        uint64_t sequence;
+        TS_ASSERT_EQUALS(walOpen(&wal, walPath), 0);
+        TS_ASSERT_EQUALS(walReplay(&wal, 4, failOnThird, &calls), 1);
+        TS_ASSERT_EQUALS(walAppend(&wal, WAL_ADD, "short", 5, &sequence), 0);
+        TS_ASSERT_EQUALS(sequence, 6u);
+        walClose(&wal);
+        size = walFileSize();
+
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), -4);
+        TS_ASSERT_EQUALS(walFileSize(), size);
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), -4);
+    }
+
+    void testCrashMidBatchKeepsCommittedPrefix()
+    {
+        int acks[2];
+        TS_ASSERT_EQUALS(pipe(acks), 0);
+        pid_t child = fork();
+        if (child == 0)
+        {
+            // the writer: acknowledge every add once it is committed, until killed
+            struct DurableArchive archive;
+            close(acks[0]);
+            if (durableOpen(&archive, directory, NULL, 64 * 1024) != 0)
+            {
+                _exit(1);
+            }
+            for (int i = 0;; i++)
+            {
+                struct Material material = book(i);
+                if (durableAddMaterial(&archive, &material) != 0 || write(acks[1], &i, sizeof(i)) != sizeof(i))
+                {
+                    _exit(1);
+                }
+            }
+        }
+        close(acks[1]);
+        int acknowledged = -1;
+        int i;
+        while (acknowledged < 2000 && read(acks[0], &i, sizeof(i)) == sizeof(i))
+        {
+            acknowledged = i;
+        }
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+        close(acks[0]);
+        TS_ASSERT_LESS_THAN_EQUALS(2000, acknowledged);
+
+        struct DurableArchive archive;
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        size_t count = archive.store.count;
+        TS_ASSERT_LESS_THAN_EQUALS((size_t)acknowledged + 1, count);
+        bool prefix = true;
+        struct Material material;
+        for (size_t n = 0; n < count; n++)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "Title %zu", n);
+            prefix = prefix && durableFindMaterial(&archive, title, &material) == 0;
+        }
+        TS_ASSERT(prefix);
+        durableClose(&archive);
+    }
+
+    struct WriterRange
+    {
+        struct DurableArchive *archive;
+        int first;
+    };
+
+    static void *addRange(void *argument)
+    {
+        struct WriterRange *range = (struct WriterRange *)argument;
+        for (int i = range->first; i < range->first + 100; i++)
+        {
+            struct Material material = book(i);
+            durableAddMaterial(range->archive, &material);
+        }
+        return NULL;
+    }
+
+    void testConcurrentWritersShareCommits()
+    {
+        struct DurableArchive archive;
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        struct WriterRange ranges[8];
+        pthread_t threads[8];
+        for (int t = 0; t < 8; t++)
+        {
+            ranges[t].archive = &archive;
+            ranges[t].first = t * 100;
+            pthread_create(&threads[t], NULL, addRange, &ranges[t]);
+        }
+        for (int t = 0; t < 8; t++)
+        {
+            pthread_join(threads[t], NULL);
+        }
+        TS_ASSERT_EQUALS(archive.store.count, 800u);
+        TS_ASSERT_EQUALS(archive.wal.durableSequence, 800u);
+        TS_ASSERT_LESS_THAN_EQUALS(archive.wal.syncs, 800u);
+        durableClose(&archive);
+
+        TS_ASSERT_EQUALS(durableOpen(&archive, directory, NULL, 0), 0);
+        TS_ASSERT_EQUALS(archive.store.count, 800u);
+        durableClose(&archive);
+    }
+
+};
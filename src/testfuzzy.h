@@ -0,0 +1,117 @@
+#include <cxxtest/TestSuite.h>
+#include <climits>
+#include "../src/store.h"
+
+class FuzzyTestSuite : public CxxTest::TestSuite
+{
+public:
+    static bool sameKey(const char *a, const char *b)
+    {
+        uint32_t x[FUZZY_KEY_MAX];
+        uint32_t y[FUZZY_KEY_MAX];
+        size_t xLength = fuzzyNormalize(a, x, FUZZY_KEY_MAX);
+        size_t yLength = fuzzyNormalize(b, y, FUZZY_KEY_MAX);
+        return xLength == yLength && memcmp(x, y, xLength * sizeof(uint32_t)) == 0;
+    }
+
+    static int distance(const char *a, const char *b, int limit)
+    {
+        uint32_t x[FUZZY_KEY_MAX];
+        uint32_t y[FUZZY_KEY_MAX];
+        size_t xLength = fuzzyNormalize(a, x, FUZZY_KEY_MAX);
+        size_t yLength = fuzzyNormalize(b, y, FUZZY_KEY_MAX);
+        return fuzzyDistance(x, xLength, y, yLength, limit);
+    }
+
+    void testKeysFoldCaseAccentsAndPunctuation()
+    {
+        TS_ASSERT(sameKey("To Kill a Mockingbird", "to kill a mockingbird"));
+        TS_ASSERT(sameKey("  Café-Society!! ", "cafe society"));
+        TS_ASSERT(sameKey("ÀÉÎÕÜ Ñandú", "aeiou nandu"));
+        TS_ASSERT(sameKey("ΟΔΥΣΣΕΙΑ", "οδυσσεια"));
+        TS_ASSERT(sameKey("ВОЙНА И МИР", "война и мир"));
+        TS_ASSERT(sameKey("Łódź", "łódź"));
+        TS_ASSERT(!sameKey("Moby Dick", "Moby Dicks"));
+
+        uint32_t key[FUZZY_KEY_MAX];
+        char trigrams[FUZZY_TRIGRAMS_MAX][FUZZY_TRIGRAM_BYTES];
+        size_t length = fuzzyNormalize("Abab", key, FUZZY_KEY_MAX);
+        // "  a", " ab", "aba", "bab", "ab " with "ab" repeated only once
+        TS_ASSERT_EQUALS(fuzzyTrigrams(key, length, trigrams, FUZZY_TRIGRAMS_MAX), 5u);
+        TS_ASSERT_EQUALS(strcmp(trigrams[0], "  a"), 0);
+        TS_ASSERT_EQUALS(strcmp(trigrams[4], "ab "), 0);
+    }
+
+    void testBoundedEditDistance()
+    {
+        TS_ASSERT_EQUALS(distance("kitten", "sitting", 5), 3);
+        TS_ASSERT_EQUALS(distance("kitten", "sitting", 2), 3);
+        TS_ASSERT_EQUALS(distance("Mockingbird", "Mockngbird", 2), 1);
+        TS_ASSERT_EQUALS(distance("abc", "abcdefgh", 3), 4);
+        TS_ASSERT_EQUALS(distance("same", "SAME", 0), 0);
+        // the band ends near both edges of the table
+        TS_ASSERT_EQUALS(distance("abcdef", "badcfe", 1), 2);
+        TS_ASSERT_EQUALS(distance("abcdef", "badcfe", 3), 4);
+        TS_ASSERT_EQUALS(distance("abcdef", "badcfe", 4), 4);
+        TS_ASSERT_EQUALS(distance("abcdefgh", "xbcdefgx", 100), 2);
+    }
+
+    void testFuzzyLookupWithAndWithoutIndex()
+    {
+        struct StoreConfig config;
+        storeDefaultConfig(&config);
+        config.removeMode = STORE_REMOVE_SWAP;
+        struct ArchiveStore plain;
+        struct ArchiveStore indexed;
+        storeInit(&plain, &config);
+        config.fuzzy = true;
+        storeInit(&indexed, &config);
+        const char *words[] = {"History", "Garden", "Mockingbird", "Ocean", "Winter", "Journey", "Silence", "Harbour"};
+        for (int i = 0; i < 4000; i++)
+        {
+            struct Material material = {"", BOOK, {.book = {i, "Author", NOVEL}}};
+            snprintf(material.title, sizeof(material.title), "The %s of %s %d", words[i % 8], words[(i / 8) % 8], i / 64);
+            storeAddMaterial(&plain, &material);
+            TS_ASSERT_EQUALS(storeAddMaterial(&indexed, &material), 0);
+        }
+        struct Material material = {"To Kill a Mockingbird", BOOK, {.book = {281, "Harper Lee", NOVEL}}};
+        storeAddMaterial(&plain, &material);
+        storeAddMaterial(&indexed, &material);
+        for (int i = 0; i < 4000; i += 3)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "The %s of %s %d", words[i % 8], words[(i / 8) % 8], i / 64);
+            storeRemoveMaterial(&plain, title);
+            storeRemoveMaterial(&indexed, title);
+        }
+
+        // the exact lookup stays case-sensitive
+        TS_ASSERT(storeFindMaterial(&indexed, "to kill a mockingbird") == NULL);
+        struct MaterialMatch results[64];
+        TS_ASSERT_EQUALS(storeFindFuzzy(&indexed, "to kill a mockingbird", 0, results, 64), 1u);
+        TS_ASSERT_EQUALS(storeFindFuzzy(&indexed, "TO KIL A MOKINGBIRD", 2, results, 64), 1u);
+        TS_ASSERT_EQUALS(results[0].distance, 2);
+        TS_ASSERT_EQUALS(results[0].material->details.book.pages, 281);
+
+        const char *queries[] = {"the garden of ocean 3", "Teh Garden of Ocean 3", "the journey of silence", "harbour of winter 1", "xyz"};
+        for (const char *query : queries)
+        {
+            struct MaterialMatch expected[64];
+            size_t count = storeFindFuzzy(&plain, query, 2, expected, 64);
+            TS_ASSERT_EQUALS(storeFindFuzzy(&indexed, query, 2, results, 64), count);
+            for (size_t i = 0; i < count && i < 64; i++)
+            {
+                TS_ASSERT_EQUALS(strcmp(expected[i].material->title, results[i].material->title), 0);
+                TS_ASSERT_EQUALS(expected[i].distance, results[i].distance);
+            }
+        }
+        TS_ASSERT_LESS_THAN(0u, storeFindFuzzy(&indexed, "Teh Garden of Ocean 3", 2, results, 64));
+        // any distance beyond the longest key is the same as FUZZY_KEY_MAX
+        TS_ASSERT_EQUALS(storeFindFuzzy(&plain, "xyz", INT_MAX, results, 64), plain.count);
+        TS_ASSERT_EQUALS(storeFindFuzzy(&indexed, "xyz", INT_MAX, results, 64),
+                         storeFindFuzzy(&indexed, "xyz", FUZZY_KEY_MAX, results, 64));
+        storeFree(&plain);
+        storeFree(&indexed);
+    }
+
+};
@@ -0,0 +1,168 @@
+#include <cxxtest/TestSuite.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "../src/importer.h"
+
+class ImporterTestSuite : public CxxTest::TestSuite
+{
+public:
+    struct Failure
+    {
+        size_t line;
+        int code;
+    };
+
+    static void collect(void *context, size_t line, int code)
+    {
+        ((std::vector<Failure> *)context)->push_back({line, code});
+    }
+
+    void testCsvRowsAndErrors()
+    {
+        const char *csv =
+            "type,title,number,contributor,subtype\r\n"
+            "BOOK,\"Dune, Part One\",412,Frank Herbert,NOVEL\r\n"
+            "journal,Nature,615,\"The \"\"Nature\"\" Group\",science\n"
+            "\n"
+            "NEWSPAPER,The Times,,Editor,2\n"
+            "BOOK,Broken,12,Someone,POEM\n"
+            "MAGAZINE,Vogue,1,Editor,DAILY\n"
+            "BOOK,Pages,twelve,Someone,NOVEL\n"
+            "BOOK,\"Unterminated,1,Someone,NOVEL\n"
+            "BOOK,Dune, Part One,1,Someone,NOVEL\n"
+            "BOOK,This title is far too long to fit into the fifty bytes,1,Someone,NOVEL\n"
+            "JOURNAL,Nature,1,Other,ART\n"
+            "NEWSPAPER,,,Editor,DAILY\n"
+            "NEWSPAPER,Gazette,,Editor,HOURLY";
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        std::vector<Failure> failures;
+        struct ImportOptions options;
+        importDefaultOptions(&options);
+        options.onError = collect;
+        options.context = &failures;
+        struct ImportResult result;
+        TS_ASSERT_EQUALS(importBuffer(&store, csv, strlen(csv), &options, &result), 0);
+        TS_ASSERT_EQUALS(result.rows, 12u);
+        TS_ASSERT_EQUALS(result.added, 3u);
+        TS_ASSERT_EQUALS(result.failed, 9u);
+
+        const struct Material *dune = storeFindMaterial(&store, "Dune, Part One");
+        TS_ASSERT(dune != NULL && dune->type == BOOK && dune->details.book.pages == 412);
+        TS_ASSERT_EQUALS(strcmp(dune->details.book.author, "Frank Herbert"), 0);
+        const struct Material *nature = storeFindMaterial(&store, "Nature");
+        TS_ASSERT(nature != NULL && nature->details.journal.issue == 615 && nature->details.journal.type == SCIENCE);
+        TS_ASSERT_EQUALS(strcmp(nature->details.journal.publisher, "The \"Nature\" Group"), 0);
+        TS_ASSERT_EQUALS(storeFindMaterial(&store, "The Times")->details.newspaper.type, MONTHLY);
+
+        const Failure expected[] = {{6, IMPORT_ROW_BAD_BOOK_TYPE}, {7, IMPORT_ROW_BAD_TYPE}, {8, IMPORT_ROW_BAD_NUMBER},
+                                    {9, IMPORT_ROW_SYNTAX}, {10, IMPORT_ROW_SYNTAX}, {11, IMPORT_ROW_TOO_LONG},
+                                    {12, IMPORT_ROW_REJECTED}, {13, IMPORT_ROW_MISSING}, {14, IMPORT_ROW_BAD_NEWSPAPER_TYPE}};
+        TS_ASSERT_EQUALS(failures.size(), 9u);
+        for (size_t i = 0; i < failures.size() && i < 9; i++)
+        {
+            TS_ASSERT_EQUALS(failures[i].line, expected[i].line);
+            TS_ASSERT_EQUALS(failures[i].code, expected[i].code);
+        }
+        TS_ASSERT_EQUALS(strcmp(importErrorName(IMPORT_ROW_REJECTED), "duplicate title or archive full"), 0);
+        storeFree(&store);
+    }
+
+    void testJsonLines()
+    {
+        const char *jsonl =
+            "{\"type\": \"BOOK\", \"title\": \"Caf\\u00e9 \\\"Noir\\\"\", \"pages\": 200, \"author\": \"A \\ud83d\\ude00\", \"subtype\": \"HISTORY\"}\n"
+            "{\"title\":\"Science Weekly\",\"type\":\"JOURNAL\",\"issue\":\"42\",\"publisher\":\"Press\",\"subtype\":1,\"tags\":[\"a\",{\"b\":\"}\"}]}\n"
+            "  {\"type\":\"NEWSPAPER\",\"title\":\"Herald\",\"editor\":\"Ed\",\"subtype\":\"WEEKLY\",\"extra\":null}  \n"
+            "{\"type\":\"BOOK\",\"title\":\"No pages\",\"author\":\"X\",\"subtype\":\"NOVEL\"}\n"
+            "{\"type\":\"BOOK\",\"title\":\"Bad\" \"pages\":1}\n"
+            "{\"type\":\"BOOK\",\"title\":\"Escape \\q\",\"pages\":1,\"author\":\"X\",\"subtype\":\"NOVEL\"}\n"
+            "[1,2]\n";
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        std::vector<Failure> failures;
+        struct ImportOptions options;
+        importDefaultOptions(&options);
+        options.onError = collect;
+        options.context = &failures;
+        struct ImportResult result;
+        TS_ASSERT_EQUALS(importBuffer(&store, jsonl, strlen(jsonl), &options, &result), 0);
+        TS_ASSERT_EQUALS(result.added, 3u);
+        TS_ASSERT_EQUALS(result.failed, 4u);
+
+        const struct Material *cafe = storeFindMaterial(&store, "Caf\xc3\xa9 \"Noir\"");
+        TS_ASSERT(cafe != NULL && cafe->details.book.pages == 200 && cafe->details.book.type == HISTORY);
+        TS_ASSERT_EQUALS(strcmp(cafe->details.book.author, "A \xf0\x9f\x98\x80"), 0);
+        const struct Material *weekly = storeFindMaterial(&store, "Science Weekly");
+        TS_ASSERT(weekly != NULL && weekly->details.journal.issue == 42 && weekly->details.journal.type == LITERATURE);
+        TS_ASSERT_EQUALS(storeFindMaterial(&store, "Herald")->details.newspaper.type, WEEKLY);
+
+        TS_ASSERT_EQUALS(failures.size(), 4u);
+        TS_ASSERT_EQUALS(failures[0].line, 4u);
+        TS_ASSERT_EQUALS(failures[0].code, IMPORT_ROW_BAD_NUMBER);
+        TS_ASSERT_EQUALS(failures[1].code, IMPORT_ROW_SYNTAX);
+        TS_ASSERT_EQUALS(failures[2].code, IMPORT_ROW_SYNTAX);
+        TS_ASSERT_EQUALS(failures[3].line, 7u);
+        storeFree(&store);
+    }
+
+    void testParallelChunksMatchSerialImport()
+    {
+        std::string csv = "type,title,number,contributor,subtype\n";
+        char line[160];
+        for (int i = 0; i < 20000; i++)
+        {
+            // every 97th row repeats an earlier title and every 101st has a bad subtype
+            int title = i % 97 == 96 ? i / 2 : i;
+            snprintf(line, sizeof(line), "%s,Title %d,%d,Person %d,%s\n", i % 3 == 0 ? "BOOK" : i % 3 == 1 ? "JOURNAL" : "NEWSPAPER",
+                     title, i, i % 31, i % 101 == 0 ? "NONE" : i % 3 == 0 ? "BIOGRAPHY" : i % 3 == 1 ? "ART" : "DAILY");
+            csv += line;
+        }
+
+        struct ImportOptions options;
+        importDefaultOptions(&options);
+        std::vector<Failure> serialFailures;
+        std::vector<Failure> parallelFailures;
+        options.onError = collect;
+        options.threads = 1;
+        options.context = &serialFailures;
+        struct ArchiveStore serial;
+        storeInit(&serial, NULL);
+        struct ImportResult serialResult;
+        TS_ASSERT_EQUALS(importBuffer(&serial, csv.data(), csv.size(), &options, &serialResult), 0);
+
+        char path[] = "/tmp/importXXXXXX";
+        int fd = mkstemp(path);
+        TS_ASSERT(fd >= 0);
+        TS_ASSERT_EQUALS(write(fd, csv.data(), csv.size()), (ssize_t)csv.size());
+        close(fd);
+        options.threads = 4;
+        options.chunkSize = 4096;
+        options.context = &parallelFailures;
+        struct ArchiveStore parallel;
+        storeInit(&parallel, NULL);
+        struct ImportResult parallelResult;
+        TS_ASSERT_EQUALS(importFile(&parallel, path, &options, &parallelResult), 0);
+        unlink(path);
+        TS_ASSERT_EQUALS(importFile(&parallel, path, &options, &parallelResult), -2);
+
+        TS_ASSERT_EQUALS(serialResult.rows, 20000u);
+        TS_ASSERT_EQUALS(parallelResult.added, serialResult.added);
+        TS_ASSERT_EQUALS(parallelResult.bytes, csv.size());
+        TS_ASSERT_EQUALS(serial.count, parallel.count);
+        TS_ASSERT_EQUALS(serialFailures.size(), serialResult.failed);
+        TS_ASSERT_EQUALS(parallelFailures.size(), serialFailures.size());
+        for (size_t i = 0; i < serialFailures.size() && i < parallelFailures.size(); i++)
+        {
+            TS_ASSERT_EQUALS(parallelFailures[i].line, serialFailures[i].line);
+            TS_ASSERT_EQUALS(parallelFailures[i].code, serialFailures[i].code);
+        }
+        for (size_t slot = 0; slot < serial.slots; slot++)
+        {
+            TS_ASSERT_SAME_DATA(storeAt(&serial, slot), storeAt(&parallel, slot), sizeof(struct Material));
+        }
+        storeFree(&serial);
+        storeFree(&parallel);
+    }
+};
@@ -0,0 +1,173 @@
+#include <cxxtest/TestSuite.h>
+#include <pthread.h>
+#include <string>
+#include "../src/metrics.h"
+#include "../src/store.h"
+
+static void *metricsFindWorker(void *context)
+{
+    struct ArchiveStore *store = (struct ArchiveStore *)context;
+    for (int i = 0; i < 1000; i++)
+    {
+        storeFindMaterial(store, i % 2 == 0 ? "Title 1" : "Missing");
+    }
+    return NULL;
+}
+
+class MetricsTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testBucketsCoverEveryValue()
+    {
+        TS_ASSERT_EQUALS(metricsBucket(0), 0u);
+        TS_ASSERT_EQUALS(metricsBucket(15), 15u);
+        TS_ASSERT_EQUALS(metricsBucket(16), 16u);
+        TS_ASSERT_EQUALS(metricsBucket(UINT64_MAX), (size_t)METRICS_BUCKETS - 1);
+        for (size_t bucket = 0; bucket + 1 < METRICS_BUCKETS; bucket++)
+        {
+            uint64_t low = metricsBucketLow(bucket);
+            uint64_t high = metricsBucketHigh(bucket);
+            TS_ASSERT_EQUALS(metricsBucket(low), bucket);
+            TS_ASSERT_EQUALS(metricsBucket(high), bucket);
+            TS_ASSERT_EQUALS(metricsBucketLow(bucket + 1), high + 1);
+            // a bucket is never wider than a sixteenth of its values
+            TS_ASSERT(high - low <= low / METRICS_SUB_BUCKETS);
+        }
+
+        static uint64_t histogram[METRICS_BUCKETS];
+        memset(histogram, 0, sizeof(histogram));
+        TS_ASSERT_EQUALS(metricsPercentile(histogram, 0.5), 0u);
+        for (uint64_t value = 1; value <= 1000; value++)
+        {
+            histogram[metricsBucket(value * 1000)]++;
+        }
+        uint64_t p50 = metricsPercentile(histogram, 0.5);
+        uint64_t p99 = metricsPercentile(histogram, 0.99);
+        TS_ASSERT(p50 >= 500000 && p50 <= 500000 + 500000 / METRICS_SUB_BUCKETS);
+        TS_ASSERT(p99 >= 990000 && p99 <= 990000 + 990000 / METRICS_SUB_BUCKETS);
+        TS_ASSERT_EQUALS(metricsPercentile(histogram, 1), metricsBucketHigh(metricsBucket(1000000)));
+    }
+
+    void testStoreOperationsAreCounted()
+    {
+        struct StoreConfig config;
+        storeDefaultConfig(&config);
+        config.removeMode = STORE_REMOVE_SWAP;
+        struct ArchiveStore store;
+        storeInit(&store, &config);
+        static struct MetricsSnapshot snapshot;
+
+        metricsEnable(false);
+        metricsReset();
+        struct Material material = {"", BOOK, {.book = {100, "Ann", NOVEL}}};
+        for (int i = 0; i < 10; i++)
+        {
+            snprintf(material.title, sizeof(material.title), "Title %d", i);
+            storeAddMaterial(&store, &material);
+        }
+        metricsSnapshot(&snapshot);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_ADD].calls, 0u);
+
+        metricsEnable(true);
+        strcpy(material.title, "Title 10");
+        TS_ASSERT_EQUALS(storeAddMaterial(&store, &material), 0);
+        TS_ASSERT_EQUALS(storeAddMaterial(&store, &material), -1);
+        TS_ASSERT(storeFindMaterial(&store, "Title 3") != NULL);
+        TS_ASSERT(storeFindMaterial(&store, "Missing") == NULL);
+        TS_ASSERT(storeFindMaterial(&store, NULL) == NULL);
+        const struct Material *results[16];
+        TS_ASSERT_EQUALS(storeFilterMaterialsView(&store, BOOK, results, 16), 11u);
+        TS_ASSERT_EQUALS(storeFilterMaterialsByAuthorView(&store, "Ann", results, 4), 11u);
+        TS_ASSERT_EQUALS(storeTopMaterials(&store, BOOK, "Ann", 3, results), 3u);
+        union MaterialDetails details = material.details;
+        details.book.type = (enum BookType)7;
+        TS_ASSERT_EQUALS(storeUpdateMaterial(&store, "Title 2", details), -3);
+        // removing the first material shifts Ann's ten other slots down, then moves the last material into its
+        // slot, which slides its posting past the nine below it
+        storeRemoveMaterial(&store, "Title 0");
+        storeRemoveMaterial(&store, "Title 0");
+        metricsEnable(false);
+        storeFindMaterial(&store, "Title 4");
+
+        metricsSnapshot(&snapshot);
+        const struct MetricsCounters *add = &snapshot.ops[METRIC_ADD];
+        TS_ASSERT_EQUALS(add->calls, 2u);
+        TS_ASSERT_EQUALS(add->failures, 1u);
+        TS_ASSERT_EQUALS(add->results, 1u);
+        TS_ASSERT(add->comparisons >= 2);
+        TS_ASSERT_EQUALS(add->sizes[0], 1u);
+        TS_ASSERT_EQUALS(add->sizes[1], 1u);
+
+        const struct MetricsCounters *find = &snapshot.ops[METRIC_FIND];
+        TS_ASSERT_EQUALS(find->calls, 3u);
+        TS_ASSERT_EQUALS(find->results, 1u);
+        // the miss and the NULL title
+        TS_ASSERT_EQUALS(find->failures, 2u);
+        TS_ASSERT(find->comparisons >= 2);
+        uint64_t samples = 0;
+        for (size_t i = 0; i < METRICS_BUCKETS; i++)
+        {
+            samples += find->latency[i];
+        }
+        TS_ASSERT_EQUALS(samples, 3u);
+
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_FILTER].calls, 1u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_FILTER].results, 11u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_FILTER_BY_AUTHOR].results, 4u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_TOP].calls, 1u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_TOP].results, 3u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_UPDATE].failures, 1u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_REMOVE].calls, 2u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_REMOVE].failures, 1u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_REMOVE].moves, 20u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_COMPACT].calls, 0u);
+
+        static char text[1 << 16];
+        TS_ASSERT_EQUALS(metricsExport(&snapshot, text, sizeof(text)), 0);
+        std::string exported(text);
+        TS_ASSERT(exported.find("archive_calls_total{op=\"find\"} 3\n") != std::string::npos);
+        TS_ASSERT(exported.find("archive_moves_total{op=\"remove\"} 20\n") != std::string::npos);
+        TS_ASSERT(exported.find("archive_latency_seconds_count{op=\"add\"} 2\n") != std::string::npos);
+        TS_ASSERT(exported.find("archive_result_size_bucket{op=\"filter_by_author\",le=\"4\"} 1\n") != std::string::npos);
+        TS_ASSERT(exported.find("op=\"compact\"") == std::string::npos);
+        TS_ASSERT_EQUALS(metricsExport(&snapshot, text, 64), -2);
+
+        metricsReset();
+        metricsSnapshot(&snapshot);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_FIND].calls, 0u);
+        storeFree(&store);
+    }
+
+    void testThreadsAccumulateSeparately()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        struct Material material = {"Title 1", JOURNAL, {.journal = {5, "Press", SCIENCE}}};
+        storeAddMaterial(&store, &material);
+
+        metricsReset();
+        metricsEnable(true);
+        // the second round reuses the shards the first one's threads left behind
+        for (int round = 0; round < 2; round++)
+        {
+            pthread_t threads[4];
+            for (int t = 0; t < 4; t++)
+            {
+                pthread_create(&threads[t], NULL, metricsFindWorker, &store);
+            }
+            for (int t = 0; t < 4; t++)
+            {
+                pthread_join(threads[t], NULL);
+            }
+        }
+        metricsEnable(false);
+
+        static struct MetricsSnapshot snapshot;
+        metricsSnapshot(&snapshot);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_FIND].calls, 8000u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_FIND].results, 4000u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_FIND].failures, 4000u);
+        TS_ASSERT_EQUALS(snapshot.ops[METRIC_FIND].sizes[1], 4000u);
+        storeFree(&store);
+    }
+};
@@ -0,0 +1,162 @@
+#include <cxxtest/TestSuite.h>
+#include <vector>
+#include "../src/store.h"
+
+class NumberIndexTestSuite : public CxxTest::TestSuite
+{
+public:
+    static std::vector<struct NumberEntry> walk(const struct NumberIndex *index, int32_t low, int32_t high, bool descending)
+    {
+        std::vector<struct NumberEntry> entries;
+        struct NumberCursor cursor;
+        struct NumberEntry entry;
+        numberIndexSeek(index, low, high, descending, &cursor);
+        while (numberIndexNext(&cursor, &entry))
+        {
+            entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    void testWalksMergeRunAndDelta()
+    {
+        struct NumberIndex index;
+        numberIndexInit(&index);
+        for (uint32_t i = 0; i < 5000; i++)
+        {
+            TS_ASSERT_EQUALS(numberIndexAdd(&index, (int32_t)((i * 7919) % 1000), i), 0);
+        }
+        TS_ASSERT(index.runCount > 0);
+        for (uint32_t i = 0; i < 5000; i += 2)
+        {
+            TS_ASSERT_EQUALS(numberIndexRemove(&index, (int32_t)((i * 7919) % 1000), i), 0);
+        }
+        TS_ASSERT_EQUALS(numberIndexRemove(&index, 3, 0), -1);
+        TS_ASSERT_EQUALS(numberIndexCount(&index), 2500u);
+
+        std::vector<struct NumberEntry> up = walk(&index, 200, 400, false);
+        std::vector<struct NumberEntry> down = walk(&index, 200, 400, true);
+        size_t expected = 0;
+        for (uint32_t i = 1; i < 5000; i += 2)
+        {
+            int32_t key = (int32_t)((i * 7919) % 1000);
+            expected += key >= 200 && key <= 400;
+        }
+        TS_ASSERT_EQUALS(up.size(), expected);
+        TS_ASSERT_EQUALS(down.size(), expected);
+        for (size_t i = 0; i < up.size(); i++)
+        {
+            TS_ASSERT(up[i].key >= 200 && up[i].key <= 400 && up[i].slot % 2 == 1);
+            TS_ASSERT(i == 0 || up[i - 1].key < up[i].key || (up[i - 1].key == up[i].key && up[i - 1].slot < up[i].slot));
+            TS_ASSERT_EQUALS(down[up.size() - 1 - i].slot, up[i].slot);
+        }
+        TS_ASSERT(walk(&index, 400, 200, false).empty());
+        TS_ASSERT_EQUALS(walk(&index, INT32_MIN, INT32_MAX, true).size(), 2500u);
+        numberIndexFree(&index);
+    }
+
+    void testRangeQueriesWithAndWithoutIndex()
+    {
+        struct StoreConfig config;
+        storeDefaultConfig(&config);
+        config.removeMode = STORE_REMOVE_SWAP;
+        struct ArchiveStore plain;
+        struct ArchiveStore indexed;
+        storeInit(&plain, &config);
+        config.ordered = true;
+        storeInit(&indexed, &config);
+        for (int i = 0; i < 6000; i++)
+        {
+            struct Material material = {"", i % 3 == 0 ? JOURNAL : BOOK, {.book = {(i * 37) % 900, "Author", NOVEL}}};
+            if (material.type == JOURNAL)
+            {
+                material.details.journal.issue = (i * 37) % 900;
+                strcpy(material.details.journal.publisher, i % 2 ? "Press" : "Other");
+                material.details.journal.type = SCIENCE;
+            }
+            snprintf(material.title, sizeof(material.title), "Title %d", i);
+            storeAddMaterial(&plain, &material);
+            TS_ASSERT_EQUALS(storeAddMaterial(&indexed, &material), 0);
+        }
+        for (int i = 0; i < 6000; i += 5)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "Title %d", i);
+            storeRemoveMaterial(&plain, title);
+            storeRemoveMaterial(&indexed, title);
+        }
+        union MaterialDetails details;
+        details.book.pages = 333;
+        strcpy(details.book.author, "Author");
+        details.book.type = HISTORY;
+        TS_ASSERT_EQUALS(storeUpdateMaterial(&indexed, "Title 1", details), 0);
+        storeUpdateMaterial(&plain, "Title 1", details);
+
+        const struct Material *a[6000];
+        const struct Material *b[6000];
+        size_t n = storeRangeMaterials(&plain, BOOK, 200, 400, 0, a, 6000);
+        TS_ASSERT(n > 0);
+        TS_ASSERT_EQUALS(storeRangeMaterials(&indexed, BOOK, 200, 400, 0, b, 6000), n);
+        for (size_t i = 0; i < n; i++)
+        {
+            TS_ASSERT_EQUALS(strcmp(a[i]->title, b[i]->title), 0);
+            TS_ASSERT(b[i]->details.book.pages >= 200 && b[i]->details.book.pages <= 400);
+            TS_ASSERT(i == 0 || b[i - 1]->details.book.pages <= b[i]->details.book.pages);
+        }
+        TS_ASSERT_EQUALS(storeRangeMaterials(&indexed, BOOK, 200, 400, n - 3, b, 10), 3u);
+        TS_ASSERT_EQUALS(storeRangeMaterials(&indexed, NEWSPAPER, 0, 1000, 0, b, 10), 0u);
+        TS_ASSERT_EQUALS(storeRangeMaterials(&indexed, BOOK, 333, 333, 0, b, 6000), storeRangeMaterials(&plain, BOOK, 333, 333, 0, a, 6000));
+
+        n = storeTopMaterials(&plain, JOURNAL, NULL, 50, a);
+        TS_ASSERT_EQUALS(n, 50u);
+        TS_ASSERT_EQUALS(storeTopMaterials(&indexed, JOURNAL, NULL, 50, b), 50u);
+        for (size_t i = 0; i < n; i++)
+        {
+            TS_ASSERT_EQUALS(strcmp(a[i]->title, b[i]->title), 0);
+            TS_ASSERT(i == 0 || b[i - 1]->details.journal.issue >= b[i]->details.journal.issue);
+        }
+        n = storeTopMaterials(&indexed, JOURNAL, "Press", 50, b);
+        TS_ASSERT_EQUALS(n, 50u);
+        for (size_t i = 0; i < n; i++)
+        {
+            TS_ASSERT_EQUALS(strcmp(b[i]->details.journal.publisher, "Press"), 0);
+            TS_ASSERT(i == 0 || b[i - 1]->details.journal.issue >= b[i]->details.journal.issue);
+        }
+        TS_ASSERT_EQUALS(storeTopMaterials(&indexed, JOURNAL, "Nobody", 50, b), 0u);
+        storeFree(&plain);
+        storeFree(&indexed);
+    }
+
+    void testTombstonesAndCompactionKeepIndexInSync()
+    {
+        struct StoreConfig config;
+        storeDefaultConfig(&config);
+        config.ordered = true;
+        struct ArchiveStore store;
+        storeInit(&store, &config);
+        for (int i = 0; i < 3000; i++)
+        {
+            struct Material material = {"", BOOK, {.book = {i, "Author", NOVEL}}};
+            snprintf(material.title, sizeof(material.title), "Book %d", i);
+            storeAddMaterial(&store, &material);
+        }
+        for (int i = 0; i < 3000; i += 2)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "Book %d", i);
+            storeRemoveMaterial(&store, title);
+        }
+        storeCompact(&store, 0);
+        TS_ASSERT_EQUALS(numberIndexCount(&store.numbers[BOOK]), 1500u);
+
+        const struct Material *results[100];
+        TS_ASSERT_EQUALS(storeRangeMaterials(&store, BOOK, 1000, 1009, 0, results, 100), 5u);
+        TS_ASSERT_EQUALS(results[0]->details.book.pages, 1001);
+        TS_ASSERT_EQUALS(storeTopMaterials(&store, BOOK, NULL, 3, results), 3u);
+        TS_ASSERT_EQUALS(results[0]->details.book.pages, 2999);
+        TS_ASSERT_EQUALS(results[2]->details.book.pages, 2995);
+        TS_ASSERT_EQUALS(storeTopMaterials(&store, BOOK, "Author", 1, results), 1u);
+        TS_ASSERT_EQUALS(strcmp(results[0]->title, "Book 2999"), 0);
+        storeFree(&store);
+    }
+};
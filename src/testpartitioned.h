@@ -0,0 +1,139 @@
+#include <cxxtest/TestSuite.h>
+#include <map>
+#include <string>
+#include "../src/partitioned.h"
+
+class PartitionedTestSuite : public CxxTest::TestSuite
+{
+    static struct Material makeMaterial(int i)
+    {
+        struct Material material;
+        memset(&material, 0, sizeof(material));
+        snprintf(material.title, sizeof(material.title), "Title %d", i);
+        material.type = (enum MaterialType)(i % 3);
+        switch (material.type)
+        {
+        case BOOK:
+            material.details.book.pages = i;
+            snprintf(material.details.book.author, 50, "Person %d", i % 7);
+            material.details.book.type = (enum BookType)(i % 3);
+            break;
+        case JOURNAL:
+            material.details.journal.issue = i;
+            snprintf(material.details.journal.publisher, 50, "Person %d", i % 7);
+            material.details.journal.type = (enum JournalType)(i % 3);
+            break;
+        default:
+            snprintf(material.details.newspaper.editor, 50, "Person %d", i % 7);
+            material.details.newspaper.type = (enum NewspaperType)(i % 3);
+            break;
+        }
+        return material;
+    }
+
+    static bool sameMaterial(const struct Material &a, const struct Material &b)
+    {
+        return memcmp(&a, &b, sizeof(struct Material)) == 0;
+    }
+
+public:
+    void testRecordsHoldOnlyTheirArm()
+    {
+        TS_ASSERT(sizeof(struct NewspaperRecord) < sizeof(struct BookRecord));
+        TS_ASSERT(sizeof(struct BookRecord) < sizeof(struct Material));
+    }
+
+    void testMatchesModelThroughMutations()
+    {
+        struct PartitionedArchive archive;
+        partitionedInit(&archive);
+        std::map<std::string, struct Material> model;
+        for (int i = 0; i < 3000; i++)
+        {
+            struct Material material = makeMaterial(i);
+            TS_ASSERT_EQUALS(partitionedAddMaterial(&archive, &material), 0);
+            model[material.title] = material;
+        }
+        struct Material duplicate = makeMaterial(5);
+        TS_ASSERT_EQUALS(partitionedAddMaterial(&archive, &duplicate), -1);
+        duplicate.type = (enum MaterialType)3;
+        strcpy(duplicate.title, "Bad type");
+        TS_ASSERT_EQUALS(partitionedAddMaterial(&archive, &duplicate), -1);
+
+        for (int i = 0; i < 3000; i += 4)
+        {
+            struct Material material = makeMaterial(i);
+            TS_ASSERT_EQUALS(partitionedRemoveMaterial(&archive, material.title), 0);
+            TS_ASSERT_EQUALS(partitionedRemoveMaterial(&archive, material.title), -1);
+            model.erase(material.title);
+        }
+        for (int i = 1; i < 3000; i += 10)
+        {
+            // material i + 3 has the same type with other details
+            struct Material material = makeMaterial(i + 3);
+            strcpy(material.title, makeMaterial(i).title);
+            TS_ASSERT_EQUALS(partitionedUpdateMaterial(&archive, material.title, material.details), 0);
+            model[material.title] = material;
+        }
+        struct Material bad = makeMaterial(1);
+        bad.details.journal.type = (enum JournalType)9;
+        TS_ASSERT_EQUALS(partitionedUpdateMaterial(&archive, bad.title, bad.details), -4);
+        TS_ASSERT_EQUALS(partitionedUpdateMaterial(&archive, "Missing", bad.details), -2);
+
+        TS_ASSERT_EQUALS(partitionedCount(&archive), model.size());
+        for (std::map<std::string, struct Material>::iterator it = model.begin(); it != model.end(); ++it)
+        {
+            struct Material found;
+            TS_ASSERT_EQUALS(partitionedFindMaterial(&archive, it->first.c_str(), &found), 0);
+            TS_ASSERT(sameMaterial(found, it->second));
+        }
+
+        size_t books;
+        const struct BookRecord *slice = partitionedBooks(&archive, &books);
+        size_t expectedBooks = 0;
+        for (std::map<std::string, struct Material>::iterator it = model.begin(); it != model.end(); ++it)
+        {
+            expectedBooks += it->second.type == BOOK;
+        }
+        TS_ASSERT_EQUALS(books, expectedBooks);
+        for (size_t i = 0; i < books; i++)
+        {
+            TS_ASSERT_EQUALS(model[slice[i].title].type, BOOK);
+            TS_ASSERT_EQUALS(model[slice[i].title].details.book.pages, slice[i].pages);
+        }
+
+        static struct Material results[3000];
+        TS_ASSERT_EQUALS(partitionedFilterMaterials(&archive, BOOK, results, 3000), books);
+        TS_ASSERT(sameMaterial(results[0], model[slice[0].title]));
+        TS_ASSERT_EQUALS(partitionedFilterMaterials(&archive, (enum MaterialType)3, results, 3000), 0u);
+
+        size_t byAuthor = 0;
+        for (std::map<std::string, struct Material>::iterator it = model.begin(); it != model.end(); ++it)
+        {
+            byAuthor += strcmp(materialContributorName(it->second), "Person 3") == 0;
+        }
+        size_t total = partitionedFilterMaterialsByAuthor(&archive, "Person 3", results, 3000);
+        TS_ASSERT_EQUALS(total, byAuthor);
+        for (size_t i = 0; i < total; i++)
+        {
+            TS_ASSERT(sameMaterial(results[i], model[results[i].title]));
+            // books come first, then journals, then newspapers
+            TS_ASSERT(i == 0 || results[i - 1].type <= results[i].type);
+        }
+        TS_ASSERT_EQUALS(partitionedFilterMaterialsByAuthor(&archive, "Person 3", results, 2), byAuthor);
+        partitionedFree(&archive);
+    }
+
+    static const char *materialContributorName(const struct Material &material)
+    {
+        switch (material.type)
+        {
+        case BOOK:
+            return material.details.book.author;
+        case JOURNAL:
+            return material.details.journal.publisher;
+        default:
+            return material.details.newspaper.editor;
+        }
+    }
+};
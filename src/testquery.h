@@ -0,0 +1,187 @@
+#include <cxxtest/TestSuite.h>
+#include <vector>
+#include "../src/query.h"
+
+class QueryTestSuite : public CxxTest::TestSuite
+{
+public:
+    static void fill(struct ArchiveStore *store)
+    {
+        const char *words[] = {"Alpha", "Beta", "Gamma", "Delta"};
+        for (int i = 0; i < 5000; i++)
+        {
+            struct Material material;
+            memset(&material, 0, sizeof(material));
+            snprintf(material.title, sizeof(material.title), "%s %d", words[i % 4], i);
+            material.type = (enum MaterialType)(i % 3);
+            if (material.type == BOOK)
+            {
+                material.details.book.pages = (i * 13) % 800;
+                snprintf(material.details.book.author, 50, "Author %d", i % 50);
+                material.details.book.type = (enum BookType)(i % 5 % 3);
+            }
+            else if (material.type == JOURNAL)
+            {
+                material.details.journal.issue = i % 120;
+                snprintf(material.details.journal.publisher, 50, "Author %d", i % 50);
+                material.details.journal.type = SCIENCE;
+            }
+            else
+            {
+                snprintf(material.details.newspaper.editor, 50, "Editor %d", i % 7);
+                material.details.newspaper.type = DAILY;
+            }
+            storeAddMaterial(store, &material);
+        }
+        for (int i = 0; i < 5000; i += 7)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "%s %d", words[i % 4], i);
+            storeRemoveMaterial(store, title);
+        }
+    }
+
+    // (books of 100 to 300 pages by Author 7) OR (science journals titled "Gamma 1...")
+    static void build(struct Query *query)
+    {
+        queryInit(query);
+        int range = queryRange(query, BOOK, 100, 300);
+        int author = queryContributor(query, "Author 7");
+        int books = queryAnd(query, range, author);
+        int prefix = queryPrefix(query, "Gamma 1");
+        int journals = querySubtype(query, JOURNAL, SCIENCE);
+        int gamma = queryAnd(query, prefix, journals);
+        queryOr(query, books, gamma);
+    }
+
+    static bool expected(const struct Material *m)
+    {
+        bool books = m->type == BOOK && m->details.book.pages >= 100 && m->details.book.pages <= 300 &&
+                     strcmp(m->details.book.author, "Author 7") == 0;
+        bool gamma = strncmp(m->title, "Gamma 1", 7) == 0 && m->type == JOURNAL && m->details.journal.type == SCIENCE;
+        return books || gamma;
+    }
+
+    void testQueriesMatchBruteForceOnEveryStoreKind()
+    {
+        for (int kind = 0; kind < 4; kind++)
+        {
+            struct StoreConfig config;
+            storeDefaultConfig(&config);
+            config.columnar = kind == 1;
+            config.searchable = kind >= 2;
+            config.ordered = kind >= 2;
+            config.removeMode = kind == 3 ? STORE_REMOVE_SWAP : STORE_REMOVE_TOMBSTONE;
+            struct ArchiveStore store;
+            storeInit(&store, &config);
+            fill(&store);
+
+            size_t want = 0;
+            for (size_t slot = 0; slot < store.slots; slot++)
+            {
+                want += storeIsLive(&store, slot) && expected(storeAt(&store, slot));
+            }
+            TS_ASSERT(want > 0);
+
+            struct Query query;
+            build(&query);
+            std::vector<const struct Material *> results(want + 1);
+            TS_ASSERT_EQUALS(queryMaterials(&store, &query, results.data(), results.size()), want);
+            for (size_t i = 0; i < want; i++)
+            {
+                TS_ASSERT(expected(results[i]));
+            }
+
+            queryInit(&query);
+            queryAnd(&query, queryType(&query, NEWSPAPER), queryContributor(&query, "Editor 3"));
+            size_t editors = 0;
+            for (size_t slot = 0; slot < store.slots; slot++)
+            {
+                const struct Material *m = storeAt(&store, slot);
+                editors += storeIsLive(&store, slot) && m->type == NEWSPAPER && strcmp(m->details.newspaper.editor, "Editor 3") == 0;
+            }
+            TS_ASSERT_EQUALS(queryMaterials(&store, &query, results.data(), 0), editors);
+            storeFree(&store);
+        }
+    }
+
+    void testPlannerPicksSelectiveIndexes()
+    {
+        struct StoreConfig config;
+        storeDefaultConfig(&config);
+        struct ArchiveStore plain;
+        storeInit(&plain, &config);
+        fill(&plain);
+        config.searchable = true;
+        config.ordered = true;
+        struct ArchiveStore indexed;
+        storeInit(&indexed, &config);
+        fill(&indexed);
+
+        struct Query query;
+        char plan[1024];
+        queryInit(&query);
+        queryAnd(&query, queryType(&query, BOOK), queryRange(&query, BOOK, 10, 12));
+        TS_ASSERT_EQUALS(queryExplain(&indexed, &query, plan, sizeof(plan)), 0);
+        TS_ASSERT(strstr(plan, "AND: probe") == plan);
+        TS_ASSERT(strstr(plan, "\n  RANGE BOOK 10..12: number index") != NULL);
+        TS_ASSERT(strstr(plan, "\n  TYPE BOOK: filter") != NULL);
+        // probing a third of the records at random costs more than reading them all in order
+        TS_ASSERT_EQUALS(queryExplain(&plain, &query, plan, sizeof(plan)), 0);
+        TS_ASSERT(strstr(plan, "AND: scan") == plan);
+        TS_ASSERT(strstr(plan, "\n  TYPE BOOK: filter") != NULL);
+
+        queryInit(&query);
+        queryAnd(&query, queryRange(&query, BOOK, 10, 12), queryContributor(&query, "Author 7"));
+        TS_ASSERT_EQUALS(queryExplain(&plain, &query, plan, sizeof(plan)), 0);
+        TS_ASSERT(strstr(plan, "AND: probe") == plan);
+        TS_ASSERT(strstr(plan, "\n  CONTRIBUTOR \"Author 7\": postings") != NULL);
+
+        queryInit(&query);
+        queryAnd(&query, queryType(&query, BOOK), querySubtype(&query, BOOK, NOVEL));
+        TS_ASSERT_EQUALS(queryExplain(&plain, &query, plan, sizeof(plan)), 0);
+        TS_ASSERT(strstr(plan, "AND: intersect") == plan);
+
+        queryInit(&query);
+        queryOr(&query, queryPrefix(&query, "Alpha 12"), queryContributor(&query, "Author 3"));
+        TS_ASSERT_EQUALS(queryExplain(&indexed, &query, plan, sizeof(plan)), 0);
+        TS_ASSERT(strstr(plan, "OR: union") == plan);
+        TS_ASSERT(strstr(plan, "PREFIX \"Alpha 12\": title search") != NULL);
+        TS_ASSERT_EQUALS(queryExplain(&plain, &query, plan, sizeof(plan)), 0);
+        TS_ASSERT(strstr(plan, "OR: scan") == plan);
+        TS_ASSERT_EQUALS(queryExplain(&plain, &query, plan, 10), -2);
+        TS_ASSERT_EQUALS(strlen(plan), 9u);
+
+        storeFree(&plain);
+        storeFree(&indexed);
+    }
+
+    void testInvalidQueriesAreRejected()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        struct Query query;
+        struct SlotBitmap result;
+        slotBitmapInit(&result);
+        queryInit(&query);
+        TS_ASSERT_EQUALS(queryExecute(&store, &query, &result), -1);
+        TS_ASSERT_EQUALS(queryRange(&query, NEWSPAPER, 0, 1), -1);
+        TS_ASSERT_EQUALS(queryExecute(&store, &query, &result), -1);
+
+        queryInit(&query);
+        TS_ASSERT_EQUALS(queryAnd(&query, 0, 1), -1);
+        queryInit(&query);
+        for (int i = 0; i < QUERY_MAX_NODES; i++)
+        {
+            TS_ASSERT_EQUALS(queryType(&query, BOOK), i);
+        }
+        TS_ASSERT_EQUALS(queryType(&query, BOOK), -1);
+
+        queryInit(&query);
+        queryType(&query, JOURNAL);
+        TS_ASSERT_EQUALS(queryExecute(&store, &query, &result), 0);
+        TS_ASSERT_EQUALS(slotBitmapCardinality(&result), 0u);
+        slotBitmapFree(&result);
+        storeFree(&store);
+    }
+};
@@ -0,0 +1,100 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/querycontext.h"
+
+class QueryContextTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testResetReusesChunks()
+    {
+        struct QueryContext context;
+        queryContextInit(&context);
+        for (int request = 0; request < 3; request++)
+        {
+            queryContextReset(&context);
+            char *small = (char *)queryContextAlloc(&context, 3);
+            char *next = (char *)queryContextAlloc(&context, 1);
+            TS_ASSERT(small != NULL && next != NULL);
+            TS_ASSERT_EQUALS((uintptr_t)next % QUERY_CONTEXT_ALIGN, 0u);
+            TS_ASSERT_EQUALS(next - small, QUERY_CONTEXT_ALIGN);
+            for (int i = 0; i < 100; i++)
+            {
+                memset(queryContextAlloc(&context, 1000), request, 1000);
+            }
+            char *large = (char *)queryContextAlloc(&context, 3 * QUERY_CONTEXT_CHUNK);
+            TS_ASSERT(large != NULL);
+            memset(large, 1, 3 * QUERY_CONTEXT_CHUNK);
+        }
+        // every request after the first fits in the chunks the first one left behind
+        size_t bytes = context.bytes;
+        queryContextReset(&context);
+        for (int i = 0; i < 100; i++)
+        {
+            queryContextAlloc(&context, 1000);
+        }
+        queryContextAlloc(&context, 3 * QUERY_CONTEXT_CHUNK);
+        TS_ASSERT_EQUALS(context.bytes, bytes);
+        queryContextFree(&context);
+        TS_ASSERT(context.chunks == NULL);
+    }
+
+    void testSpansMatchStoreViews()
+    {
+        struct StoreConfig config;
+        storeDefaultConfig(&config);
+        config.searchable = true;
+        struct ArchiveStore store;
+        storeInit(&store, &config);
+        for (int i = 0; i < 3000; i++)
+        {
+            struct Material material = {"", (enum MaterialType)(i % 3), {.book = {i, "", NOVEL}}};
+            snprintf(material.title, sizeof(material.title), "Title %d", i);
+            snprintf(material.details.book.author, 50, "Author %d", i % 9);
+            if (material.type == NEWSPAPER)
+            {
+                snprintf(material.details.newspaper.editor, 50, "Author %d", i % 9);
+                material.details.newspaper.type = DAILY;
+            }
+            storeAddMaterial(&store, &material);
+        }
+
+        struct QueryContext context;
+        queryContextInit(&context);
+        struct MaterialSpan span;
+        const struct Material *view[3000];
+        TS_ASSERT_EQUALS(queryContextFilterMaterials(&context, &store, JOURNAL, &span), 0);
+        TS_ASSERT_EQUALS(span.count, storeFilterMaterialsView(&store, JOURNAL, view, 3000));
+        TS_ASSERT_SAME_DATA(span.items, view, span.count * sizeof(view[0]));
+        TS_ASSERT_EQUALS(queryContextFilterMaterials(&context, &store, (enum MaterialType)7, &span), -1);
+
+        TS_ASSERT_EQUALS(queryContextFilterMaterialsByAuthor(&context, &store, "Author 4", &span), 0);
+        TS_ASSERT_EQUALS(span.count, storeFilterMaterialsByAuthorView(&store, "Author 4", view, 3000));
+        TS_ASSERT_SAME_DATA(span.items, view, span.count * sizeof(view[0]));
+        TS_ASSERT_EQUALS(queryContextFilterMaterialsByAuthor(&context, &store, "Nobody", &span), 0);
+        TS_ASSERT_EQUALS(span.count, 0u);
+
+        TS_ASSERT_EQUALS(queryContextSearchPrefix(&context, &store, "Title 12", 5, &span), 0);
+        TS_ASSERT_EQUALS(span.count, 5u);
+        TS_ASSERT_EQUALS(strcmp(span.items[0]->title, "Title 12"), 0);
+
+        struct Query query;
+        queryInit(&query);
+        queryAnd(&query, queryType(&query, BOOK), queryContributor(&query, "Author 3"));
+        TS_ASSERT_EQUALS(queryContextRun(&context, &store, &query, &span), 0);
+        TS_ASSERT_EQUALS(span.count, 3000u / 9);
+        for (size_t i = 0; i < span.count; i++)
+        {
+            TS_ASSERT(span.items[i]->type == BOOK && strcmp(span.items[i]->details.book.author, "Author 3") == 0);
+        }
+
+        struct Archive archive;
+        archive.count = 0;
+        struct Material book = {"Legacy", BOOK, {.book = {10, "Author 3", NOVEL}}};
+        addMaterial(&archive, book);
+        TS_ASSERT_EQUALS(queryContextFilterArchiveByAuthor(&context, &archive, "Author 3", &span), 0);
+        TS_ASSERT_EQUALS(span.count, 1u);
+        TS_ASSERT_EQUALS(span.items[0], &archive.materials[0]);
+
+        queryContextFree(&context);
+        storeFree(&store);
+    }
+};
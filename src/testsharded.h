@@ -0,0 +1,127 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/sharded.h"
+
+class ShardedTestSuite : public CxxTest::TestSuite
+{
+public:
+    static void addIndex(void *context, size_t index)
+    {
+        __atomic_fetch_add((size_t *)context, index + 1, __ATOMIC_RELAXED);
+    }
+
+    static void nestedLoop(void *context, size_t index)
+    {
+        struct ThreadPool *pool = *(struct ThreadPool **)context;
+        size_t *sum = *((size_t **)context + 1);
+        (void)index;
+        threadPoolFor(pool, 100, addIndex, sum);
+    }
+
+    void testThreadPoolRunsEveryIndexOnce()
+    {
+        struct ThreadPool pool;
+        TS_ASSERT_EQUALS(threadPoolInit(&pool, 3), 0);
+        size_t sum = 0;
+        TS_ASSERT_EQUALS(threadPoolFor(&pool, 1000, addIndex, &sum), 0);
+        TS_ASSERT_EQUALS(sum, 1000u * 1001u / 2);
+
+        // loops started from inside a task must not deadlock the workers
+        sum = 0;
+        void *context[2] = {&pool, &sum};
+        TS_ASSERT_EQUALS(threadPoolFor(&pool, 20, nestedLoop, context), 0);
+        TS_ASSERT_EQUALS(sum, 20u * (100u * 101u / 2));
+        threadPoolFree(&pool);
+    }
+
+    void testPointOperationsRouteToOneShard()
+    {
+        struct ShardedArchive archive;
+        TS_ASSERT_EQUALS(shardedInit(&archive, 0, 2, NULL), -1);
+        TS_ASSERT_EQUALS(shardedInit(&archive, 4, 2, NULL), 0);
+        struct Material material = {"Book Title", BOOK, {.book = {200, "Author Name", NOVEL}}};
+        TS_ASSERT_EQUALS(shardedAddMaterial(&archive, &material), 0);
+        TS_ASSERT_EQUALS(shardedAddMaterial(&archive, &material), -1);
+        TS_ASSERT_EQUALS(archive.shards[shardedShardOf(&archive, "Book Title")].store.count, 1u);
+        TS_ASSERT_EQUALS(shardedCount(&archive), 1u);
+
+        struct Material found;
+        union MaterialDetails details = {.book = {300, "Other Author", HISTORY}};
+        TS_ASSERT_EQUALS(shardedUpdateMaterial(&archive, "Book Title", details), 0);
+        TS_ASSERT_EQUALS(shardedFindMaterial(&archive, "Book Title", &found), 0);
+        TS_ASSERT_EQUALS(found.details.book.pages, 300);
+        TS_ASSERT_EQUALS(shardedRemoveMaterial(&archive, "Book Title"), 0);
+        TS_ASSERT_EQUALS(shardedRemoveMaterial(&archive, "Book Title"), -1);
+        TS_ASSERT_EQUALS(shardedFindMaterial(&archive, "Book Title", &found), -1);
+        TS_ASSERT_EQUALS(shardedCount(&archive), 0u);
+        shardedFree(&archive);
+    }
+
+    static bool longBook(const struct Material *material, void *context)
+    {
+        return material->type == BOOK && material->details.book.pages >= *(int *)context;
+    }
+
+    void testQueriesMatchASingleStore()
+    {
+        struct ShardedArchive archive;
+        struct ArchiveStore store;
+        TS_ASSERT_EQUALS(shardedInit(&archive, 5, 3, NULL), 0);
+        storeInit(&store, NULL);
+        for (int i = 0; i < 3000; i++)
+        {
+            struct Material material = {"", BOOK, {.book = {i, "", NOVEL}}};
+            if (i % 3 == 1)
+            {
+                struct Material journal = {"", JOURNAL, {.journal = {i, "", SCIENCE}}};
+                material = journal;
+            }
+            snprintf(material.title, sizeof(material.title), "Title %d", i);
+            snprintf(material.details.book.author, sizeof(material.details.book.author), "Author %d", i % 7);
+            if (material.type == JOURNAL)
+            {
+                snprintf(material.details.journal.publisher, sizeof(material.details.journal.publisher), "Author %d", i % 7);
+            }
+            TS_ASSERT_EQUALS(shardedAddMaterial(&archive, &material), 0);
+            storeAddMaterial(&store, &material);
+        }
+        for (int i = 0; i < 3000; i += 5)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "Title %d", i);
+            shardedRemoveMaterial(&archive, title);
+            storeRemoveMaterial(&store, title);
+        }
+
+        struct Material *results = new struct Material[3000];
+        TS_ASSERT_EQUALS(shardedFilterMaterials(&archive, BOOK, results, 3000), slotBitmapCardinality(storeFilterMaterials(&store, BOOK)));
+        size_t count;
+        storeContributorSlots(&store, "Author 3", &count);
+        TS_ASSERT_EQUALS(shardedFilterMaterialsByAuthor(&archive, "Author 3", results, 3000), count);
+        for (size_t i = 0; i < count; i++)
+        {
+            TS_ASSERT_SAME_DATA(materialContributor(&results[i]), "Author 3", 9);
+        }
+
+        int pages = 1000;
+        size_t expected = 0;
+        for (size_t slot = 0; slot < store.slots; slot++)
+        {
+            expected += storeIsLive(&store, slot) && longBook(storeAt(&store, slot), &pages);
+        }
+        size_t total = shardedScan(&archive, longBook, &pages, results, 3000);
+        TS_ASSERT_EQUALS(total, expected);
+        for (size_t i = 0; i < total; i++)
+        {
+            TS_ASSERT(longBook(&results[i], &pages));
+            TS_ASSERT(storeFindMaterial(&store, results[i].title) != NULL);
+        }
+        // a small capacity still reports every match
+        TS_ASSERT_EQUALS(shardedScan(&archive, longBook, &pages, results, 10), expected);
+        TS_ASSERT_EQUALS(shardedScan(&archive, longBook, &pages, NULL, 0), expected);
+
+        delete[] results;
+        storeFree(&store);
+        shardedFree(&archive);
+    }
+
+};
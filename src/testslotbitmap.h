@@ -0,0 +1,109 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/slotbitmap.h"
+
+class SlotBitmapTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testAddContainsRemove()
+    {
+        struct SlotBitmap bitmap;
+        slotBitmapInit(&bitmap);
+        TS_ASSERT_EQUALS(slotBitmapAdd(&bitmap, 7), 0);
+        TS_ASSERT_EQUALS(slotBitmapAdd(&bitmap, 70000), 0);
+        TS_ASSERT_EQUALS(slotBitmapAdd(&bitmap, 7), 0);
+        TS_ASSERT(slotBitmapContains(&bitmap, 7));
+        TS_ASSERT(slotBitmapContains(&bitmap, 70000));
+        TS_ASSERT(!slotBitmapContains(&bitmap, 8));
+        TS_ASSERT_EQUALS(slotBitmapCardinality(&bitmap), 2u);
+        TS_ASSERT(slotBitmapRemove(&bitmap, 7));
+        TS_ASSERT(!slotBitmapRemove(&bitmap, 7));
+        TS_ASSERT_EQUALS(bitmap.count, 1u);
+        slotBitmapFree(&bitmap);
+    }
+
+    void testDenseContainerConvertsBothWays()
+    {
+        struct SlotBitmap bitmap;
+        slotBitmapInit(&bitmap);
+        for (uint32_t slot = 0; slot < 10000; slot++)
+        {
+            slotBitmapAdd(&bitmap, slot);
+        }
+        TS_ASSERT_EQUALS(bitmap.containers[0].kind, SLOT_BITSET);
+        TS_ASSERT_EQUALS(slotBitmapCardinality(&bitmap), 10000u);
+        for (uint32_t slot = 0; slot < 9000; slot++)
+        {
+            slotBitmapRemove(&bitmap, slot);
+        }
+        TS_ASSERT_EQUALS(bitmap.containers[0].kind, SLOT_ARRAY);
+        TS_ASSERT_EQUALS(slotBitmapCardinality(&bitmap), 1000u);
+        TS_ASSERT(slotBitmapContains(&bitmap, 9999));
+        TS_ASSERT(!slotBitmapContains(&bitmap, 8999));
+        slotBitmapFree(&bitmap);
+    }
+
+    void testAndOrMatchReference()
+    {
+        struct SlotBitmap a, b, both, either;
+        slotBitmapInit(&a);
+        slotBitmapInit(&b);
+        slotBitmapInit(&both);
+        slotBitmapInit(&either);
+        static bool inA[200000], inB[200000];
+        uint32_t seed = 12345;
+        for (int i = 0; i < 60000; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            uint32_t slot = (seed >> 8) % 200000;
+            // a is dense in the first block and sparse elsewhere
+            if (slot < 65536 || i % 8 == 0)
+            {
+                slotBitmapAdd(&a, slot);
+                inA[slot] = true;
+            }
+            seed = seed * 1103515245 + 12345;
+            slot = (seed >> 8) % 200000;
+            if (i % 3 == 0)
+            {
+                slotBitmapAdd(&b, slot);
+                inB[slot] = true;
+            }
+        }
+        TS_ASSERT_EQUALS(slotBitmapAnd(&a, &b, &both), 0);
+        TS_ASSERT_EQUALS(slotBitmapOr(&a, &b, &either), 0);
+
+        size_t expectBoth = 0, expectEither = 0;
+        bool agree = true;
+        for (uint32_t slot = 0; slot < 200000; slot++)
+        {
+            expectBoth += inA[slot] && inB[slot];
+            expectEither += inA[slot] || inB[slot];
+            agree = agree && slotBitmapContains(&both, slot) == (inA[slot] && inB[slot]);
+            agree = agree && slotBitmapContains(&either, slot) == (inA[slot] || inB[slot]);
+        }
+        TS_ASSERT(agree);
+        TS_ASSERT_EQUALS(slotBitmapCardinality(&both), expectBoth);
+        TS_ASSERT_EQUALS(slotBitmapCardinality(&either), expectEither);
+
+        slotBitmapFree(&a);
+        slotBitmapFree(&b);
+        slotBitmapFree(&both);
+        slotBitmapFree(&either);
+    }
+
+    void testIterateInOrder()
+    {
+        struct SlotBitmap bitmap;
+        slotBitmapInit(&bitmap);
+        uint32_t expected[] = {3, 64, 65535, 65536, 131071, 4000000};
+        for (int i = 5; i >= 0; i--)
+        {
+            slotBitmapAdd(&bitmap, expected[i]);
+        }
+        uint32_t slots[6];
+        TS_ASSERT_EQUALS(slotBitmapToArray(&bitmap, slots, 6), 6u);
+        TS_ASSERT_SAME_DATA(slots, expected, sizeof(expected));
+        slotBitmapFree(&bitmap);
+    }
+
+};
@@ -0,0 +1,120 @@
+#include <cxxtest/TestSuite.h>
+#include <unistd.h>
+#include "../src/snapshot.h"
+
+class SnapshotTestSuite : public CxxTest::TestSuite
+{
+public:
+    char path[64];
+
+    void setUp()
+    {
+        snprintf(path, sizeof(path), "/tmp/snapshot-test-%d.bin", (int)getpid());
+    }
+
+    void tearDown()
+    {
+        unlink(path);
+    }
+
+    void fillStore(struct ArchiveStore *store)
+    {
+        storeInit(store, NULL);
+        for (int i = 0; i < 3000; i++)
+        {
+            struct Material material = {"", BOOK, {.book = {i, "Author", (enum BookType)(i % 3)}}};
+            if (i % 3 == 1)
+            {
+                struct Material newspaper = {"", NEWSPAPER, {.newspaper = {"Editor", WEEKLY}}};
+                material = newspaper;
+            }
+            snprintf(material.title, sizeof(material.title), "Title %d", i);
+            storeAddMaterial(store, &material);
+        }
+        storeRemoveMaterial(store, "Title 0");
+        storeRemoveMaterial(store, "Title 1");
+    }
+
+    void testWriteAndQueryInPlace()
+    {
+        struct ArchiveStore store;
+        struct Snapshot snapshot;
+        fillStore(&store);
+        TS_ASSERT_EQUALS(snapshotWrite(&store, path), 0);
+        TS_ASSERT_EQUALS(snapshotOpen(&snapshot, path, SNAPSHOT_VERIFY), 0);
+
+        TS_ASSERT_EQUALS(snapshot.count, 2998u);
+        const struct Material *material = snapshotFindMaterial(&snapshot, "Title 2999");
+        TS_ASSERT(material != NULL);
+        TS_ASSERT_EQUALS(material->details.book.pages, 2999);
+        TS_ASSERT(snapshotFindMaterial(&snapshot, "Title 0") == NULL);
+        TS_ASSERT(snapshotFindMaterial(&snapshot, "Missing") == NULL);
+
+        size_t count;
+        const uint32_t *slots = snapshotFilterMaterials(&snapshot, NEWSPAPER, &count);
+        TS_ASSERT_EQUALS(count, slotBitmapCardinality(storeFilterMaterials(&store, NEWSPAPER)));
+        bool agree = true;
+        for (size_t i = 0; i < count; i++)
+        {
+            agree = agree && snapshot.materials[slots[i]].type == NEWSPAPER && (i == 0 || slots[i - 1] < slots[i]);
+        }
+        TS_ASSERT(agree);
+        snapshotFilterMaterialsBySubtype(&snapshot, BOOK, HISTORY, &count);
+        TS_ASSERT_EQUALS(count, slotBitmapCardinality(storeFilterMaterialsBySubtype(&store, BOOK, HISTORY)));
+        TS_ASSERT(snapshotFilterMaterials(&snapshot, (enum MaterialType)7, &count) == NULL);
+
+        struct ArchiveStore loaded;
+        storeInit(&loaded, NULL);
+        TS_ASSERT_EQUALS(snapshotLoadStore(&snapshot, &loaded), 2998u);
+        TS_ASSERT_EQUALS(storeFindMaterial(&loaded, "Title 5")->details.book.pages, 5);
+
+        snapshotClose(&snapshot);
+        storeFree(&loaded);
+        storeFree(&store);
+    }
+
+    void testRejectsDamagedFiles()
+    {
+        struct ArchiveStore store;
+        struct Snapshot snapshot;
+        fillStore(&store);
+        TS_ASSERT_EQUALS(snapshotWrite(&store, path), 0);
+        storeFree(&store);
+
+        // a flipped byte in a record is only found by verification
+        FILE *file = fopen(path, "r+b");
+        fseek(file, 4096, SEEK_SET);
+        fputc('#', file);
+        fclose(file);
+        TS_ASSERT_EQUALS(snapshotOpen(&snapshot, path, 0), 0);
+        snapshotClose(&snapshot);
+        TS_ASSERT_EQUALS(snapshotOpen(&snapshot, path, SNAPSHOT_VERIFY), -3);
+
+        // a damaged header is always rejected
+        file = fopen(path, "r+b");
+        fseek(file, 16, SEEK_SET);
+        fputc(0x7f, file);
+        fclose(file);
+        TS_ASSERT_EQUALS(snapshotOpen(&snapshot, path, 0), -2);
+
+        TS_ASSERT_EQUALS(truncate(path, 100), 0);
+        TS_ASSERT_EQUALS(snapshotOpen(&snapshot, path, 0), -2);
+        TS_ASSERT_EQUALS(snapshotOpen(&snapshot, "/nonexistent/snapshot.bin", 0), -1);
+    }
+
+    void testTruncatedFileIsRejected()
+    {
+        struct ArchiveStore store;
+        struct Snapshot snapshot;
+        fillStore(&store);
+        TS_ASSERT_EQUALS(snapshotWrite(&store, path), 0);
+        storeFree(&store);
+        FILE *file = fopen(path, "rb");
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fclose(file);
+        TS_ASSERT_EQUALS(truncate(path, size - 64), 0);
+        TS_ASSERT_EQUALS(snapshotOpen(&snapshot, path, 0), -4);
+    }
+
+};
@@ -0,0 +1,533 @@
+#include <cxxtest/TestSuite.h>
+#include <set>
+#include <string>
+#include "../src/store.h"
+
+class StoreTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testAddMaterialPastLegacyLimit()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        for (int i = 0; i < 1000; i++)
+        {
+            struct Material material = {"", BOOK, {.book = {i, "Author Name", NOVEL}}};
+            snprintf(material.title, sizeof(material.title), "Title %d", i);
+            TS_ASSERT_EQUALS(storeAddMaterial(&store, &material), 0);
+        }
+        TS_ASSERT_EQUALS(store.count, 1000u);
+        TS_ASSERT_EQUALS(storeFindMaterial(&store, "Title 999")->details.book.pages, 999);
+        storeFree(&store);
+    }
+
+    void testAddMaterialDuplicateTitle()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        struct Material material1 = {"Book Title", BOOK, {.book = {200, "Author Name", NOVEL}}};
+        struct Material material2 = {"Book Title", JOURNAL, {.journal = {2, "Publisher", LITERATURE}}};
+        TS_ASSERT_EQUALS(storeAddMaterial(&store, &material1), 0);
+        TS_ASSERT_EQUALS(storeAddMaterial(&store, &material2), -1);
+        TS_ASSERT_EQUALS(store.count, 1u);
+        storeFree(&store);
+    }
+
+    void testMaxCapacity()
+    {
+        struct StoreConfig config = {4, 2};
+        struct ArchiveStore store;
+        storeInit(&store, &config);
+        struct Material book = {"Book Title", BOOK, {.book = {200, "Author Name", NOVEL}}};
+        struct Material journal = {"Journal Title", JOURNAL, {.journal = {2, "Publisher", LITERATURE}}};
+        struct Material newspaper = {"Newspaper Title", NEWSPAPER, {.newspaper = {"Editor", MONTHLY}}};
+        TS_ASSERT_EQUALS(storeAddMaterial(&store, &book), 0);
+        TS_ASSERT_EQUALS(storeAddMaterial(&store, &journal), 0);
+        TS_ASSERT_EQUALS(storeAddMaterial(&store, &newspaper), -1);
+        TS_ASSERT_EQUALS(store.count, 2u);
+        storeFree(&store);
+    }
+
+    void testPointersStableAcrossGrowth()
+    {
+        struct StoreConfig config = {2, 0};
+        struct ArchiveStore store;
+        storeInit(&store, &config);
+        struct Material first = {"First", BOOK, {.book = {10, "Author", NOVEL}}};
+        storeAddMaterial(&store, &first);
+        struct Material *found = storeFindMaterial(&store, "First");
+        for (int i = 0; i < 100; i++)
+        {
+            struct Material material = {"", NEWSPAPER, {.newspaper = {"Editor", DAILY}}};
+            snprintf(material.title, sizeof(material.title), "Issue %d", i);
+            storeAddMaterial(&store, &material);
+        }
+        TS_ASSERT(found == storeFindMaterial(&store, "First"));
+        TS_ASSERT_EQUALS(strcmp(found->title, "First"), 0);
+        storeFree(&store);
+    }
+
+    void testFindMaterialCaseSensitive()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        struct Material material = {"To Kill a Mockingbird", BOOK, {.book = {281, "Harper Lee", NOVEL}}};
+        storeAddMaterial(&store, &material);
+        TS_ASSERT(storeFindMaterial(&store, "to kill a mockingbird") == NULL);
+        TS_ASSERT(storeFindMaterial(&store, "To Kill a Mockingbird") != NULL);
+        storeFree(&store);
+    }
+
+    void testUpdateMaterialInvalidSubtype()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        struct Material material = {"Nature", JOURNAL, {.journal = {5, "Springer", SCIENCE}}};
+        storeAddMaterial(&store, &material);
+        union MaterialDetails details;
+        details.journal.issue = 6;
+        strcpy(details.journal.publisher, "Springer");
+        details.journal.type = (enum JournalType)7;
+        TS_ASSERT_EQUALS(storeUpdateMaterial(&store, "Nature", details), -4);
+        details.journal.type = ART;
+        TS_ASSERT_EQUALS(storeUpdateMaterial(&store, "Nature", details), 0);
+        TS_ASSERT_EQUALS(storeFindMaterial(&store, "Nature")->details.journal.issue, 6);
+        TS_ASSERT_EQUALS(storeUpdateMaterial(&store, "Science", details), -2);
+        storeFree(&store);
+    }
+
+    void testRemoveMaterialKeepsOrder()
+    {
+        struct StoreConfig config = {2, 0};
+        struct ArchiveStore store;
+        storeInit(&store, &config);
+        struct Material material1 = {"The Great Gatsby", BOOK, {.book = {180, "F. Scott Fitzgerald", NOVEL}}};
+        struct Material material2 = {"To Kill a Mockingbird", BOOK, {.book = {281, "Harper Lee", NOVEL}}};
+        struct Material material3 = {"The Sun Also Rises", BOOK, {.book = {251, "Ernest Hemingway", NOVEL}}};
+        storeAddMaterial(&store, &material1);
+        storeAddMaterial(&store, &material2);
+        storeAddMaterial(&store, &material3);
+        storeRemoveMaterial(&store, "The Great Gatsby");
+        TS_ASSERT_EQUALS(store.count, 2u);
+        TS_ASSERT(!storeIsLive(&store, 0));
+        TS_ASSERT_EQUALS(strcmp(storeAt(&store, 1)->title, "To Kill a Mockingbird"), 0);
+        storeRemoveMaterial(&store, "The Catcher in the Rye");
+        TS_ASSERT_EQUALS(store.count, 2u);
+
+        TS_ASSERT_EQUALS(storeCompact(&store, 0), 0u);
+        TS_ASSERT_EQUALS(store.slots, 2u);
+        TS_ASSERT_EQUALS(strcmp(storeAt(&store, 0)->title, "To Kill a Mockingbird"), 0);
+        TS_ASSERT_EQUALS(strcmp(storeAt(&store, 1)->title, "The Sun Also Rises"), 0);
+        TS_ASSERT(storeFindMaterial(&store, "The Sun Also Rises") == storeAt(&store, 1));
+        storeFree(&store);
+    }
+
+    void testImportExportArchive()
+    {
+        struct Archive archive = {
+            {{"The Great Gatsby", BOOK, {.book = {180, "F. Scott Fitzgerald", NOVEL}}},
+             {"Nature", JOURNAL, {.journal = {5, "Springer", SCIENCE}}}},
+            2};
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        TS_ASSERT_EQUALS(storeImportArchive(&store, &archive), 0);
+        TS_ASSERT_EQUALS(storeImportArchive(&store, &archive), 2);
+        struct Archive exported;
+        TS_ASSERT_EQUALS(storeExportArchive(&store, &exported), 0);
+        TS_ASSERT_EQUALS(exported.count, 2);
+        TS_ASSERT_EQUALS(strcmp(exported.materials[1].title, "Nature"), 0);
+        TS_ASSERT_EQUALS(findMaterial(&exported, (char *)"Nature"), &exported.materials[1]);
+        storeFree(&store);
+    }
+
+    void testFindAfterRemove()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        for (int i = 0; i < 200; i++)
+        {
+            struct Material material = {"", BOOK, {.book = {i, "Author", NOVEL}}};
+            snprintf(material.title, sizeof(material.title), "Title %d", i);
+            storeAddMaterial(&store, &material);
+        }
+        for (int i = 0; i < 200; i += 3)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "Title %d", i);
+            storeRemoveMaterial(&store, title);
+        }
+        for (int i = 0; i < 200; i++)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "Title %d", i);
+            struct Material *found = storeFindMaterial(&store, title);
+            if (i % 3 == 0)
+            {
+                TS_ASSERT(found == NULL);
+            }
+            else
+            {
+                TS_ASSERT(found != NULL);
+                TS_ASSERT_EQUALS(found->details.book.pages, i);
+            }
+        }
+        struct Material again = {"Title 0", BOOK, {.book = {1, "Author", NOVEL}}};
+        TS_ASSERT_EQUALS(storeAddMaterial(&store, &again), 0);
+        TS_ASSERT_EQUALS(storeAddMaterial(&store, &again), -1);
+        storeFree(&store);
+    }
+
+    void testFilterMaterialsByAuthorUsesIndex()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        struct Material material1 = {"Material1", BOOK, {.book = {200, "Author1", NOVEL}}};
+        struct Material material2 = {"Material2", JOURNAL, {.journal = {1, "Author1", SCIENCE}}};
+        struct Material material3 = {"Material3", BOOK, {.book = {250, "Author2", BIOGRAPHY}}};
+        struct Material material4 = {"Material4", NEWSPAPER, {.newspaper = {"Author1", WEEKLY}}};
+        storeAddMaterial(&store, &material1);
+        storeAddMaterial(&store, &material2);
+        storeAddMaterial(&store, &material3);
+        storeAddMaterial(&store, &material4);
+
+        size_t count;
+        struct Material *result = storeFilterMaterialsByAuthor(&store, "Author1", &count);
+        TS_ASSERT_EQUALS(count, 3u);
+        TS_ASSERT_EQUALS(strcmp(result[0].title, "Material1"), 0);
+        TS_ASSERT_EQUALS(strcmp(result[1].title, "Material2"), 0);
+        TS_ASSERT_EQUALS(strcmp(result[2].title, "Material4"), 0);
+        free(result);
+
+        TS_ASSERT(storeFilterMaterialsByAuthor(&store, "author1", &count) == NULL);
+        TS_ASSERT(storeFilterMaterialsByAuthor(&store, "", &count) == NULL);
+        TS_ASSERT_EQUALS(count, 0u);
+        storeFree(&store);
+    }
+
+    void testContributorIndexFollowsUpdateAndRemove()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        struct Material material1 = {"The Great Gatsby", BOOK, {.book = {180, "F. Scott Fitzgerald", NOVEL}}};
+        struct Material material2 = {"Tender Is the Night", BOOK, {.book = {317, "F. Scott Fitzgerald", NOVEL}}};
+        struct Material material3 = {"This Side of Paradise", BOOK, {.book = {305, "F. Scott Fitzgerald", NOVEL}}};
+        storeAddMaterial(&store, &material1);
+        storeAddMaterial(&store, &material2);
+        storeAddMaterial(&store, &material3);
+
+        union MaterialDetails details = material1.details;
+        strcpy(details.book.author, "Francis Scott Fitzgerald");
+        TS_ASSERT_EQUALS(storeUpdateMaterial(&store, "The Great Gatsby", details), 0);
+        storeRemoveMaterial(&store, "Tender Is the Night");
+
+        size_t count;
+        const uint32_t *slots = storeContributorSlots(&store, "F. Scott Fitzgerald", &count);
+        TS_ASSERT_EQUALS(count, 1u);
+        TS_ASSERT_EQUALS(strcmp(storeAt(&store, slots[0])->title, "This Side of Paradise"), 0);
+        slots = storeContributorSlots(&store, "Francis Scott Fitzgerald", &count);
+        TS_ASSERT_EQUALS(count, 1u);
+        TS_ASSERT_EQUALS(slots[0], 0u);
+        storeFree(&store);
+    }
+
+    void testFilterMaterialsBitmaps()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        struct Material material1 = {"The Guns of August", BOOK, {.book = {511, "Barbara Tuchman", HISTORY}}};
+        struct Material material2 = {"Emma", BOOK, {.book = {474, "Jane Austen", NOVEL}}};
+        struct Material material3 = {"The Economist", NEWSPAPER, {.newspaper = {"Zanny Minton Beddoes", WEEKLY}}};
+        struct Material material4 = {"SPQR", BOOK, {.book = {608, "Mary Beard", HISTORY}}};
+        storeAddMaterial(&store, &material1);
+        storeAddMaterial(&store, &material2);
+        storeAddMaterial(&store, &material3);
+        storeAddMaterial(&store, &material4);
+
+        TS_ASSERT_EQUALS(slotBitmapCardinality(storeFilterMaterials(&store, BOOK)), 3u);
+        TS_ASSERT_EQUALS(slotBitmapCardinality(storeFilterMaterials(&store, JOURNAL)), 0u);
+        TS_ASSERT(storeFilterMaterials(&store, (enum MaterialType)3) == NULL);
+
+        uint32_t slots[4];
+        const struct SlotBitmap *history = storeFilterMaterialsBySubtype(&store, BOOK, HISTORY);
+        TS_ASSERT_EQUALS(slotBitmapToArray(history, slots, 4), 2u);
+        TS_ASSERT_EQUALS(strcmp(storeAt(&store, slots[1])->title, "SPQR"), 0);
+
+        union MaterialDetails details = material2.details;
+        details.book.type = HISTORY;
+        storeUpdateMaterial(&store, "Emma", details);
+        storeRemoveMaterial(&store, "The Guns of August");
+        TS_ASSERT_EQUALS(slotBitmapToArray(history, slots, 4), 2u);
+        TS_ASSERT_EQUALS(slots[0], 1u);
+        TS_ASSERT_EQUALS(slots[1], 3u);
+        TS_ASSERT_EQUALS(slotBitmapCardinality(storeFilterMaterialsBySubtype(&store, BOOK, NOVEL)), 0u);
+
+        struct SlotBitmap weekly;
+        slotBitmapInit(&weekly);
+        slotBitmapAnd(storeFilterMaterials(&store, NEWSPAPER), storeFilterMaterialsBySubtype(&store, NEWSPAPER, WEEKLY), &weekly);
+        TS_ASSERT_EQUALS(slotBitmapToArray(&weekly, slots, 4), 1u);
+        TS_ASSERT_EQUALS(slots[0], 2u);
+        slotBitmapFree(&weekly);
+        storeFree(&store);
+    }
+
+    void testStoreViewsDoNotCopy()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        struct Material material1 = {"Material1", BOOK, {.book = {200, "Author1", NOVEL}}};
+        struct Material material2 = {"Material2", JOURNAL, {.journal = {1, "Author1", SCIENCE}}};
+        struct Material material3 = {"Material3", BOOK, {.book = {250, "Author2", BIOGRAPHY}}};
+        storeAddMaterial(&store, &material1);
+        storeAddMaterial(&store, &material2);
+        storeAddMaterial(&store, &material3);
+
+        const struct Material *results[2];
+        TS_ASSERT_EQUALS(storeFilterMaterialsView(&store, BOOK, results, 1), 2u);
+        TS_ASSERT(results[0] == storeFindMaterial(&store, "Material1"));
+        TS_ASSERT_EQUALS(storeFilterMaterialsByAuthorView(&store, "Author1", results, 2), 2u);
+        TS_ASSERT(results[1] == storeFindMaterial(&store, "Material2"));
+        TS_ASSERT_EQUALS(storeFilterMaterialsByAuthorView(&store, "Nobody", NULL, 0), 0u);
+        storeFree(&store);
+    }
+
+    void testSwapRemoveKeepsSlotsDense()
+    {
+        struct StoreConfig config = {4, 0, STORE_REMOVE_SWAP, 0};
+        struct ArchiveStore store;
+        storeInit(&store, &config);
+        struct Material material1 = {"The Great Gatsby", BOOK, {.book = {180, "F. Scott Fitzgerald", NOVEL}}};
+        struct Material material2 = {"To Kill a Mockingbird", BOOK, {.book = {281, "Harper Lee", NOVEL}}};
+        struct Material material3 = {"The Sun Also Rises", BOOK, {.book = {251, "Ernest Hemingway", NOVEL}}};
+        storeAddMaterial(&store, &material1);
+        storeAddMaterial(&store, &material2);
+        storeAddMaterial(&store, &material3);
+        struct MaterialHandle moved;
+        TS_ASSERT_EQUALS(storeFindHandle(&store, "The Sun Also Rises", &moved), 0);
+
+        storeRemoveMaterial(&store, "The Great Gatsby");
+        TS_ASSERT_EQUALS(store.count, 2u);
+        TS_ASSERT_EQUALS(store.slots, 2u);
+        TS_ASSERT_EQUALS(strcmp(storeAt(&store, 0)->title, "The Sun Also Rises"), 0);
+        TS_ASSERT(storeFindMaterial(&store, "The Sun Also Rises") == storeAt(&store, 0));
+        TS_ASSERT(storeResolve(&store, moved) == NULL);
+
+        size_t count;
+        const uint32_t *slots = storeContributorSlots(&store, "Ernest Hemingway", &count);
+        TS_ASSERT_EQUALS(count, 1u);
+        TS_ASSERT_EQUALS(slots[0], 0u);
+        TS_ASSERT(slotBitmapContains(storeFilterMaterials(&store, BOOK), 0));
+        TS_ASSERT(!slotBitmapContains(storeFilterMaterials(&store, BOOK), 2));
+        storeFree(&store);
+    }
+
+    void testHandlesDetectStaleSlots()
+    {
+        struct ArchiveStore store;
+        storeInit(&store, NULL);
+        struct Material material1 = {"Emma", BOOK, {.book = {474, "Jane Austen", NOVEL}}};
+        struct Material material2 = {"Persuasion", BOOK, {.book = {249, "Jane Austen", NOVEL}}};
+        storeAddMaterial(&store, &material1);
+        storeAddMaterial(&store, &material2);
+
+        struct MaterialHandle emma, persuasion;
+        storeFindHandle(&store, "Emma", &emma);
+        storeFindHandle(&store, "Persuasion", &persuasion);
+        TS_ASSERT(storeResolve(&store, emma) == storeFindMaterial(&store, "Emma"));
+        TS_ASSERT_EQUALS(storeFindHandle(&store, "Mansfield Park", &emma), -1);
+
+        storeRemoveMaterial(&store, "Emma");
+        TS_ASSERT(storeResolve(&store, emma) == NULL);
+        TS_ASSERT(storeResolve(&store, persuasion) != NULL);
+
+        storeCompact(&store, 0);
+        TS_ASSERT(storeResolve(&store, persuasion) == NULL);
+        storeFindHandle(&store, "Persuasion", &persuasion);
+        TS_ASSERT_EQUALS(persuasion.slot, 0u);
+        TS_ASSERT(storeResolve(&store, persuasion) == storeAt(&store, 0));
+        storeFree(&store);
+    }
+
+    void testIncrementalCompactionKeepsIndexesConsistent()
+    {
+        struct StoreConfig config = {16, 0, STORE_REMOVE_TOMBSTONE, 3};
+        struct ArchiveStore store;
+        storeInit(&store, &config);
+        char title[50];
+        for (int round = 0; round < 5; round++)
+        {
+            for (int i = 0; i < 100; i++)
+            {
+                struct Material material = {"", (i % 2) ? BOOK : NEWSPAPER, {.book = {i, "Author", NOVEL}}};
+                if (material.type == NEWSPAPER)
+                {
+                    material.details.newspaper.type = WEEKLY;
+                    strcpy(material.details.newspaper.editor, "Editor");
+                }
+                snprintf(material.title, sizeof(material.title), "R%d-%d", round, i);
+                storeAddMaterial(&store, &material);
+            }
+            for (int i = 0; i < 100; i += 2)
+            {
+                snprintf(title, sizeof(title), "R%d-%d", round, i + (round % 2));
+                storeRemoveMaterial(&store, title);
+            }
+        }
+        storeCompact(&store, 0);
+        TS_ASSERT_EQUALS(store.slots, store.count);
+        TS_ASSERT_EQUALS(store.count, 250u);
+
+        size_t books = 0;
+        for (size_t slot = 0; slot < store.slots; slot++)
+        {
+            struct Material *material = storeAt(&store, slot);
+            TS_ASSERT(storeFindMaterial(&store, material->title) == material);
+            TS_ASSERT(slotBitmapContains(storeFilterMaterials(&store, material->type), (uint32_t)slot));
+            books += material->type == BOOK;
+        }
+        size_t count;
+        storeContributorSlots(&store, "Author", &count);
+        TS_ASSERT_EQUALS(count, books);
+        TS_ASSERT_EQUALS(slotBitmapCardinality(storeFilterMaterials(&store, BOOK)), books);
+        TS_ASSERT_EQUALS(slotBitmapCardinality(storeFilterMaterialsBySubtype(&store, NEWSPAPER, WEEKLY)), 250u - books);
+        storeFree(&store);
+    }
+
+    void testAddMaterialsMatchesSequentialAdds()
+    {
+        struct StoreConfig config;
+        storeDefaultConfig(&config);
+        config.maxCapacity = 8;
+        struct ArchiveStore bulk;
+        struct ArchiveStore single;
+        storeInit(&bulk, &config);
+        storeInit(&single, &config);
+        struct Material existing = {"Title 1", BOOK, {.book = {1, "Author", NOVEL}}};
+        storeAddMaterial(&bulk, &existing);
+        storeAddMaterial(&single, &existing);
+
+        // a title already stored, a repeat within the batch and more items than fit
+        int numbers[] = {0, 1, 2, 2, 3, 4, 5, 0, 6, 7, 8, 9};
+        struct Material items[12];
+        int expected[12];
+        for (int i = 0; i < 12; i++)
+        {
+            struct Material material = {"", BOOK, {.book = {i, "Author", HISTORY}}};
+            snprintf(material.title, sizeof(material.title), "Title %d", numbers[i]);
+            items[i] = material;
+            expected[i] = storeAddMaterial(&single, &items[i]);
+        }
+        int codes[12];
+        TS_ASSERT_EQUALS(storeAddMaterials(&bulk, items, 12, STORE_BULK_DEFAULT, codes), 7u);
+        TS_ASSERT_SAME_DATA(codes, expected, sizeof(expected));
+        TS_ASSERT_EQUALS(bulk.count, 8u);
+        TS_ASSERT_EQUALS(storeFindMaterial(&bulk, "Title 2")->details.book.pages, 2);
+        TS_ASSERT_EQUALS(slotBitmapCardinality(storeFilterMaterialsBySubtype(&bulk, BOOK, HISTORY)), 7u);
+        storeFree(&bulk);
+        storeFree(&single);
+    }
+
+    void testAddMaterialsParallelAgreesWithSerial()
+    {
+        const size_t n = 50000;
+        struct Material *items = (struct Material *)calloc(n, sizeof(struct Material));
+        for (size_t i = 0; i < n; i++)
+        {
+            items[i].type = JOURNAL;
+            items[i].details.journal.issue = (int)i;
+            snprintf(items[i].details.journal.publisher, 50, "Publisher %zu", i % 13);
+            // every third title repeats one seen earlier
+            snprintf(items[i].title, sizeof(items[i].title), "Title %zu", i % 3 == 2 ? i / 3 : i);
+        }
+        int *parallel = (int *)malloc(n * sizeof(int));
+        int *serial = (int *)malloc(n * sizeof(int));
+        struct ArchiveStore a;
+        struct ArchiveStore b;
+        storeInit(&a, NULL);
+        storeInit(&b, NULL);
+        size_t added = storeAddMaterials(&a, items, n, STORE_BULK_DEFAULT, parallel);
+        TS_ASSERT_EQUALS(storeAddMaterials(&b, items, n, STORE_BULK_SERIAL, serial), added);
+        TS_ASSERT_SAME_DATA(parallel, serial, n * sizeof(int));
+        TS_ASSERT_EQUALS(a.count, added);
+        TS_ASSERT_EQUALS(storeFindMaterial(&a, "Title 30")->details.journal.issue, 30);
+        size_t count;
+        storeContributorSlots(&a, "Publisher 5", &count);
+        size_t expected;
+        storeContributorSlots(&b, "Publisher 5", &expected);
+        TS_ASSERT_EQUALS(count, expected);
+        TS_ASSERT_EQUALS(storeAddMaterials(&a, items, 100, STORE_BULK_DEFAULT, parallel), 0u);
+        free(items);
+        free(parallel);
+        free(serial);
+        storeFree(&a);
+        storeFree(&b);
+    }
+
+    void testStatsFollowEveryMutation()
+    {
+        struct StoreConfig config;
+        storeDefaultConfig(&config);
+        config.compactionBudget = 16;
+        for (int mode = 0; mode < 2; mode++)
+        {
+            config.removeMode = mode == 0 ? STORE_REMOVE_TOMBSTONE : STORE_REMOVE_SWAP;
+            struct ArchiveStore store;
+            storeInit(&store, &config);
+            for (int i = 0; i < 3000; i++)
+            {
+                struct Material material = {"", (enum MaterialType)(i % 3), {.book = {i % 500, "", NOVEL}}};
+                snprintf(material.title, sizeof(material.title), "Title %d", i);
+                snprintf(material.details.book.author, sizeof(material.details.book.author), "Person %d", i % 40);
+                if (material.type == NEWSPAPER)
+                {
+                    material.details.newspaper.type = (enum NewspaperType)(i % 2 ? WEEKLY : DAILY);
+                }
+                storeAddMaterial(&store, &material);
+            }
+            for (int i = 0; i < 3000; i += 4)
+            {
+                char title[50];
+                snprintf(title, sizeof(title), "Title %d", i);
+                storeRemoveMaterial(&store, title);
+            }
+            for (int i = 1; i < 3000; i += 12)
+            {
+                char title[50];
+                snprintf(title, sizeof(title), "Title %d", i);
+                union MaterialDetails details = {.book = {1000, "Person 99", HISTORY}};
+                if (storeFindMaterial(&store, title)->type == BOOK)
+                {
+                    TS_ASSERT_EQUALS(storeUpdateMaterial(&store, title, details), 0);
+                }
+            }
+
+            struct StoreStats expected;
+            memset(&expected, 0, sizeof(expected));
+            size_t person99 = 0;
+            std::set<std::string> contributors;
+            for (size_t slot = 0; slot < store.slots; slot++)
+            {
+                if (!storeIsLive(&store, slot))
+                {
+                    continue;
+                }
+                const struct Material *material = storeAt(&store, slot);
+                expected.materials++;
+                expected.types[material->type]++;
+                expected.subtypes[material->type][materialSubtype(material)]++;
+                expected.pages += material->type == BOOK ? material->details.book.pages : 0;
+                person99 += strcmp(materialContributor(material), "Person 99") == 0;
+                contributors.insert(materialContributor(material));
+            }
+            struct StoreStats stats;
+            storeStats(&store, &stats);
+            TS_ASSERT_EQUALS(stats.materials, expected.materials);
+            TS_ASSERT_SAME_DATA(stats.types, expected.types, sizeof(stats.types));
+            TS_ASSERT_SAME_DATA(stats.subtypes, expected.subtypes, sizeof(stats.subtypes));
+            TS_ASSERT_EQUALS(stats.pages, expected.pages);
+            TS_ASSERT_EQUALS(stats.subtypes[NEWSPAPER][WEEKLY], slotBitmapCardinality(storeFilterMaterialsBySubtype(&store, NEWSPAPER, WEEKLY)));
+            TS_ASSERT_EQUALS(storeContributorCount(&store, "Person 99"), person99);
+            TS_ASSERT_EQUALS(stats.contributors, contributors.size());
+            storeFree(&store);
+        }
+    }
+};
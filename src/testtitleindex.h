@@ -0,0 +1,54 @@
+#include <cxxtest/TestSuite.h>
+#include <string>
+#include <vector>
+#include "../src/titleindex.h"
+
+struct TitleIndexKeys
+{
+    std::vector<std::string> titles;
+    size_t reads;
+};
+
+static const char *titleIndexTestKey(const void *context, uint32_t slot)
+{
+    struct TitleIndexKeys *keys = (struct TitleIndexKeys *)context;
+    keys->reads++;
+    return keys->titles[slot].c_str();
+}
+
+class TitleIndexTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testLookupsReadAStoredTitleOnlyOnAHashMatch()
+    {
+        struct TitleIndexKeys keys;
+        struct TitleIndex index;
+        titleIndexInit(&index);
+        for (uint32_t i = 0; i < 100000; i++)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "Stored title %u", i);
+            keys.titles.push_back(title);
+            TS_ASSERT_EQUALS(titleIndexInsert(&index, titleHash(title), i), 0);
+        }
+
+        // a miss probes only the buckets, a hit reads the one title it returns
+        keys.reads = 0;
+        for (uint32_t i = 0; i < 100000; i++)
+        {
+            char title[50];
+            snprintf(title, sizeof(title), "Absent title %u", i);
+            TS_ASSERT_EQUALS(titleIndexFind(&index, titleHash(title), title, titleIndexTestKey, &keys), TITLE_INDEX_NONE);
+        }
+        // only a full 32-bit hash collision within a probe sequence reads a title
+        TS_ASSERT_LESS_THAN(keys.reads, 5u);
+
+        keys.reads = 0;
+        for (uint32_t i = 0; i < 100000; i++)
+        {
+            TS_ASSERT_EQUALS(titleIndexFind(&index, titleHash(keys.titles[i].c_str()), keys.titles[i].c_str(), titleIndexTestKey, &keys), i);
+        }
+        TS_ASSERT_LESS_THAN(keys.reads, 100005u);
+        titleIndexFree(&index);
+    }
+};
@@ -0,0 +1,169 @@
+#include <cxxtest/TestSuite.h>
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+#include "../src/store.h"
+
+class TitleSearchTestSuite : public CxxTest::TestSuite
+{
+public:
+    static std::string titleOf(int i)
+    {
+        static const char *words[] = {"History", "Science", "Art", "Harbour", "Sci-Fi", "Hist"};
+        char title[50];
+        snprintf(title, sizeof(title), "%s of %s %d", words[i % 6], words[(i / 6) % 6], i);
+        return title;
+    }
+
+    static std::vector<std::string> pageAll(const struct TitleSearch *search, const std::vector<std::string> &titles, const char *key, bool prefix, size_t page)
+    {
+        std::vector<std::string> found;
+        std::vector<uint32_t> slots(page);
+        for (size_t offset = 0;; offset += page)
+        {
+            size_t count = prefix ? titleSearchPrefix(search, key, strlen(key), offset, slots.data(), page)
+                                  : titleSearchSubstring(search, key, strlen(key), offset, slots.data(), page);
+            for (size_t i = 0; i < count; i++)
+            {
+                found.push_back(titles[slots[i]]);
+            }
+            if (count < page)
+            {
+                return found;
+            }
+        }
+    }
+
+    void testPrefixAndSubstringMatchAScan()
+    {
+        struct TitleSearch search;
+        titleSearchInit(&search);
+        std::vector<std::string> titles;
+        for (int i = 0; i < 20000; i++)
+        {
+            titles.push_back(titleOf(i));
+            TS_ASSERT_EQUALS(titleSearchAdd(&search, titles[i].data(), titles[i].size(), (uint32_t)i), 0);
+        }
+        TS_ASSERT_LESS_THAN(0u, search.segmentCount);
+        // every third title goes, which kills docs in segments and in the delta
+        for (int i = 0; i < 20000; i += 3)
+        {
+            titleSearchRemove(&search, (uint32_t)i);
+        }
+
+        const char *keys[] = {"Hist", "History of Art", "Sci", "of Harbour 1", "Zebra", "9"};
+        for (const char *key : keys)
+        {
+            std::vector<std::string> prefix;
+            std::multiset<std::string> substring;
+            for (int i = 0; i < 20000; i++)
+            {
+                if (i % 3 != 0 && titles[i].compare(0, strlen(key), key) == 0)
+                {
+                    prefix.push_back(titles[i]);
+                }
+                if (i % 3 != 0 && titles[i].find(key) != std::string::npos)
+                {
+                    substring.insert(titles[i]);
+                }
+            }
+            std::sort(prefix.begin(), prefix.end());
+            TS_ASSERT(pageAll(&search, titles, key, true, 37) == prefix);
+            std::vector<std::string> found = pageAll(&search, titles, key, false, 50);
+            TS_ASSERT(std::multiset<std::string>(found.begin(), found.end()) == substring);
+        }
+        titleSearchFree(&search);
+    }
+
+    void testRelocationAndRebuild()
+    {
+        struct TitleSearch search;
+        titleSearchInit(&search);
+        std::vector<std::string> titles;
+        for (int i = 0; i < 10000; i++)
+        {
+            titles.push_back(titleOf(i));
+            titleSearchAdd(&search, titles[i].data(), titles[i].size(), (uint32_t)i);
+        }
+        // remove 6000 titles and move the last 4000 down into the holes, as swap removal does
+        for (int i = 0; i < 6000; i++)
+        {
+            titleSearchRemove(&search, (uint32_t)i);
+            if (i < 4000)
+            {
+                titleSearchRelocate(&search, (uint32_t)(i + 6000), (uint32_t)i);
+                titles[i] = titles[i + 6000];
+            }
+        }
+        titles.resize(4000);
+        // the index was rebuilt once most docs were dead
+        TS_ASSERT_LESS_THAN(search.docCount, 10000u);
+
+        std::vector<std::string> prefix;
+        for (const std::string &title : titles)
+        {
+            if (title.compare(0, 4, "Hist") == 0)
+            {
+                prefix.push_back(title);
+            }
+        }
+        std::sort(prefix.begin(), prefix.end());
+        TS_ASSERT(pageAll(&search, titles, "Hist", true, 100) == prefix);
+        uint32_t slots[8];
+        TS_ASSERT_EQUALS(titleSearchSubstring(&search, titles[17].c_str(), titles[17].size(), 0, slots, 8), 1u);
+        TS_ASSERT_EQUALS(slots[0], 17u);
+        TS_ASSERT_EQUALS(titleSearchPrefix(&search, titleOf(17).c_str(), titleOf(17).size(), 0, slots, 8), 0u);
+        titleSearchFree(&search);
+    }
+
+    void testStoreSearchWithAndWithoutIndex()
+    {
+        struct StoreConfig config;
+        storeDefaultConfig(&config);
+        config.removeMode = STORE_REMOVE_SWAP;
+        struct ArchiveStore plain;
+        struct ArchiveStore indexed;
+        storeInit(&plain, &config);
+        config.searchable = true;
+        storeInit(&indexed, &config);
+        for (int i = 0; i < 6000; i++)
+        {
+            struct Material material = {"", BOOK, {.book = {i, "Author", NOVEL}}};
+            snprintf(material.title, sizeof(material.title), "%s", titleOf(i).c_str());
+            storeAddMaterial(&plain, &material);
+            TS_ASSERT_EQUALS(storeAddMaterial(&indexed, &material), 0);
+        }
+        for (int i = 0; i < 6000; i += 4)
+        {
+            storeRemoveMaterial(&plain, titleOf(i).c_str());
+            storeRemoveMaterial(&indexed, titleOf(i).c_str());
+        }
+
+        const struct Material *expected[1000];
+        const struct Material *actual[1000];
+        for (size_t offset = 0; offset < 400; offset += 100)
+        {
+            size_t count = storeSearchPrefix(&plain, "Harbour of S", offset, expected, 100);
+            TS_ASSERT_EQUALS(storeSearchPrefix(&indexed, "Harbour of S", offset, actual, 100), count);
+            for (size_t i = 0; i < count; i++)
+            {
+                TS_ASSERT_EQUALS(strcmp(expected[i]->title, actual[i]->title), 0);
+            }
+        }
+        std::set<std::string> plainTitles;
+        std::set<std::string> indexedTitles;
+        size_t count = storeSearchTitles(&plain, "of Art 5", 0, expected, 1000);
+        TS_ASSERT_EQUALS(storeSearchTitles(&indexed, "of Art 5", 0, actual, 1000), count);
+        for (size_t i = 0; i < count; i++)
+        {
+            plainTitles.insert(expected[i]->title);
+            indexedTitles.insert(actual[i]->title);
+        }
+        TS_ASSERT(plainTitles == indexedTitles);
+        TS_ASSERT_LESS_THAN(0u, count);
+        storeFree(&plain);
+        storeFree(&indexed);
+    }
+
+};
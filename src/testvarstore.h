@@ -0,0 +1,107 @@
+#include <cxxtest/TestSuite.h>
+#include "../src/varstore.h"
+
+class VarStoreTestSuite : public CxxTest::TestSuite
+{
+public:
+    void testSmallStringsInlineShortValues()
+    {
+        TS_ASSERT_EQUALS(sizeof(struct SmallString), 24u);
+        struct StringArena arena;
+        stringArenaInit(&arena);
+        struct SmallString string;
+        TS_ASSERT_EQUALS(smallStringSet(&string, &arena, "Time", 4), 0);
+        TS_ASSERT(smallStringIsInline(&string));
+        TS_ASSERT_EQUALS(smallStringLength(&string), 4u);
+        TS_ASSERT_EQUALS(strcmp(smallStringData(&string), "Time"), 0);
+        TS_ASSERT_EQUALS(arena.bytes, 0u);
+
+        const char *exact = "Twenty-two characters!";
+        TS_ASSERT_EQUALS(smallStringSet(&string, &arena, exact, 22), 0);
+        TS_ASSERT(smallStringIsInline(&string));
+        TS_ASSERT(smallStringEquals(&string, exact, 22));
+        TS_ASSERT(!smallStringEquals(&string, exact, 21));
+
+        const char *longer = "A title well beyond the inline capacity of a small string";
+        TS_ASSERT_EQUALS(smallStringSet(&string, &arena, longer, strlen(longer)), 0);
+        TS_ASSERT(!smallStringIsInline(&string));
+        TS_ASSERT_EQUALS(strcmp(smallStringData(&string), longer), 0);
+        TS_ASSERT_DIFFERS(arena.bytes, 0u);
+        stringArenaFree(&arena);
+    }
+
+    void testTitlesAreNotLimitedTo50Bytes()
+    {
+        TS_ASSERT_EQUALS(titleHashLength("Book Title, Volume 2", 10), titleHash("Book Title"));
+        struct VarArchive archive;
+        varInit(&archive);
+        char title[300];
+        memset(title, 'x', sizeof(title));
+        TS_ASSERT_EQUALS(varAddMaterial(&archive, title, 300, BOOK, NOVEL, 120, "Author", 6), 0);
+        TS_ASSERT_EQUALS(varAddMaterial(&archive, title, 299, BOOK, NOVEL, 121, "Author", 6), 0);
+        TS_ASSERT_EQUALS(varAddMaterial(&archive, title, 300, BOOK, NOVEL, 122, "Author", 6), -1);
+        TS_ASSERT_EQUALS(varAddMaterial(&archive, "Bad", 3, BOOK, 7, 1, "Author", 6), -1);
+        TS_ASSERT_EQUALS(varAddMaterial(&archive, "Time", 4, NEWSPAPER, WEEKLY, 0, "Editor", 6), 0);
+
+        const struct VarMaterial *found = varFindMaterial(&archive, title, 299);
+        TS_ASSERT(found != NULL);
+        TS_ASSERT_EQUALS(found->number, 121);
+        TS_ASSERT_EQUALS(smallStringLength(&found->title), 299u);
+        // embedded NULs are part of the title
+        TS_ASSERT_EQUALS(varAddMaterial(&archive, "Time\0Two", 8, JOURNAL, ART, 3, "Publisher", 9), 0);
+        TS_ASSERT(varFindMaterial(&archive, "Time\0Two", 8) != NULL);
+        TS_ASSERT(varFindMaterial(&archive, "Time", 4) != NULL);
+
+        struct Material material = {"Book Title", BOOK, {.book = {200, "Author", HISTORY}}};
+        TS_ASSERT_EQUALS(varAddFromMaterial(&archive, &material), 0);
+        const struct VarMaterial *results[8];
+        TS_ASSERT_EQUALS(varFilterMaterialsByAuthor(&archive, "Author", 6, results, 8), 3u);
+        TS_ASSERT_EQUALS(varFilterMaterialsByAuthor(&archive, "Author Name", 11, results, 8), 0u);
+        TS_ASSERT_EQUALS(varFilterMaterials(&archive, BOOK, NULL, 0), 3u);
+        varFree(&archive);
+    }
+
+    void testUpdateAndRemoveKeepTheIndexConsistent()
+    {
+        struct VarArchive archive;
+        varInit(&archive);
+        char title[64];
+        for (int i = 0; i < 500; i++)
+        {
+            int length = snprintf(title, sizeof(title), "A considerably long title number %d", i);
+            TS_ASSERT_EQUALS(varAddMaterial(&archive, title, length, JOURNAL, SCIENCE, i, "Publisher", 9), 0);
+        }
+        const char *publisher = "A publishing house with a name longer than the inline bytes";
+        TS_ASSERT_EQUALS(varUpdateMaterial(&archive, "A considerably long title number 7", 34, LITERATURE, 70, publisher, strlen(publisher)), 0);
+        TS_ASSERT_EQUALS(varUpdateMaterial(&archive, "A considerably long title number 7", 34, 9, 70, "P", 1), -4);
+        TS_ASSERT_EQUALS(varUpdateMaterial(&archive, "Missing", 7, ART, 1, "P", 1), -2);
+        const struct VarMaterial *results[4];
+        TS_ASSERT_EQUALS(varFilterMaterialsByAuthor(&archive, publisher, strlen(publisher), results, 4), 1u);
+        TS_ASSERT_EQUALS(results[0]->number, 70);
+        TS_ASSERT_EQUALS(results[0]->subtype, LITERATURE);
+
+        for (int i = 0; i < 500; i += 2)
+        {
+            int length = snprintf(title, sizeof(title), "A considerably long title number %d", i);
+            TS_ASSERT_EQUALS(varRemoveMaterial(&archive, title, length), 0);
+            TS_ASSERT_EQUALS(varRemoveMaterial(&archive, title, length), -1);
+        }
+        TS_ASSERT_EQUALS(archive.count, 250u);
+        for (int i = 0; i < 500; i++)
+        {
+            int length = snprintf(title, sizeof(title), "A considerably long title number %d", i);
+            const struct VarMaterial *found = varFindMaterial(&archive, title, length);
+            if (i % 2 == 0)
+            {
+                TS_ASSERT(found == NULL);
+            }
+            else
+            {
+                TS_ASSERT(found != NULL);
+                TS_ASSERT_EQUALS(found->number, i == 7 ? 70 : i);
+            }
+        }
+        varFree(&archive);
+    }
+
+};
@@ -0,0 +1,305 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "threadpool.h"
+
+// the pool and deque of the calling thread, if it is a worker
+static __thread struct ThreadPool *currentPool = NULL;
+static __thread size_t currentQueue = 0;
+
+/*
+The argument of a worker thread.
+*/
+struct ThreadPoolWorker
+{
+    struct ThreadPool *pool;
+    size_t index;
+};
+
+/*
+This function appends a task at the tail of a deque, doubling the ring buffer when it is full. It returns 0 on
+success and -1 if the buffer could not grow.
+*/
+static int threadPoolPush(struct ThreadPoolQueue *queue, struct ThreadPoolTask task)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->capacity)
+    {
+        size_t capacity = queue->capacity == 0 ? 64 : queue->capacity * 2;
+        struct ThreadPoolTask *tasks = (struct ThreadPoolTask *)malloc(capacity * sizeof(struct ThreadPoolTask));
+        if (tasks == NULL)
+        {
+            pthread_mutex_unlock(&queue->lock);
+            return -1;
+        }
+        for (size_t i = 0; i < queue->count; i++)
+        {
+            tasks[i] = queue->tasks[(queue->head + i) % queue->capacity];
+        }
+        free(queue->tasks);
+        queue->tasks = tasks;
+        queue->head = 0;
+        queue->capacity = capacity;
+    }
+    queue->tasks[(queue->head + queue->count) % queue->capacity] = task;
+    queue->count++;
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+/*
+This function removes a task from the tail of a deque if tail is true, as its owner does, and from the head
+otherwise, as a thief does. It returns false if the deque is empty.
+*/
+static bool threadPoolTake(struct ThreadPoolQueue *queue, bool tail, struct ThreadPoolTask *task)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == 0)
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return false;
+    }
+    if (tail)
+    {
+        *task = queue->tasks[(queue->head + queue->count - 1) % queue->capacity];
+    }
+    else
+    {
+        *task = queue->tasks[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+    }
+    queue->count--;
+    pthread_mutex_unlock(&queue->lock);
+    return true;
+}
+
+/*
+This function finds a task for the calling thread: the newest task of its own deque if it is a worker of this
+pool, otherwise the oldest task of the first non-empty deque after it. It returns false if every deque is empty.
+*/
+static bool threadPoolFind(struct ThreadPool *pool, struct ThreadPoolTask *task)
+{
+    size_t self = currentPool == pool ? currentQueue : 0;
+    if (currentPool == pool && threadPoolTake(&pool->queues[self], true, task))
+    {
+        __atomic_fetch_sub(&pool->pending, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+    for (size_t i = 0; i < pool->threadCount; i++)
+    {
+        size_t victim = (self + 1 + i) % pool->threadCount;
+        if (threadPoolTake(&pool->queues[victim], false, task))
+        {
+            __atomic_fetch_sub(&pool->pending, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+This function runs one task and signals its loop once the last task of the loop has finished. The job lives on
+the stack of the thread waiting in threadPoolFor, so it is not touched after the lock is released.
+*/
+static void threadPoolRun(struct ThreadPoolTask task)
+{
+    struct ThreadPoolJob *job = task.job;
+    job->fn(job->context, task.index);
+    pthread_mutex_lock(&job->lock);
+    if (--job->remaining == 0)
+    {
+        pthread_cond_broadcast(&job->done);
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+/*
+This function is the body of a worker thread: run tasks while there are any, sleep until more are queued, and
+exit once the pool stops and nothing is pending.
+*/
+static void *threadPoolWorker(void *argument)
+{
+    struct ThreadPoolWorker *worker = (struct ThreadPoolWorker *)argument;
+    struct ThreadPool *pool = worker->pool;
+    struct ThreadPoolTask task;
+    currentPool = pool;
+    currentQueue = worker->index;
+    free(worker);
+
+    for (;;)
+    {
+        if (threadPoolFind(pool, &task))
+        {
+            threadPoolRun(task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->lock);
+        while (__atomic_load_n(&pool->pending, __ATOMIC_RELAXED) == 0 && !pool->stopping)
+        {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        bool stop = pool->stopping && __atomic_load_n(&pool->pending, __ATOMIC_RELAXED) == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop)
+        {
+            return NULL;
+        }
+    }
+}
+
+/*
+This function starts a pool of threads workers, or one per online CPU if threads is 0. It returns 0 on success
+and -1 if memory or a thread could not be allocated, in which case nothing is left running.
+*/
+int threadPoolInit(struct ThreadPool *pool, size_t threads)
+{
+    if (pool == NULL)
+    {
+        return -1;
+    }
+    if (threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pool->threads = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    pool->queues = (struct ThreadPoolQueue *)calloc(threads, sizeof(struct ThreadPoolQueue));
+    if (pool->threads == NULL || pool->queues == NULL)
+    {
+        free(pool->threads);
+        free(pool->queues);
+        return -1;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    for (size_t i = 0; i < threads; i++)
+    {
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+    }
+    pool->threadCount = threads;
+
+    for (size_t i = 0; i < threads; i++)
+    {
+        struct ThreadPoolWorker *worker = (struct ThreadPoolWorker *)malloc(sizeof(struct ThreadPoolWorker));
+        if (worker != NULL)
+        {
+            worker->pool = pool;
+            worker->index = i;
+        }
+        if (worker == NULL || pthread_create(&pool->threads[i], NULL, threadPoolWorker, worker) != 0)
+        {
+            free(worker);
+            // only the first i workers exist
+            for (size_t j = i; j < threads; j++)
+            {
+                pthread_mutex_destroy(&pool->queues[j].lock);
+            }
+            pool->threadCount = i;
+            threadPoolFree(pool);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+This function lets the workers finish the queued tasks, joins them and releases the pool.
+*/
+void threadPoolFree(struct ThreadPool *pool)
+{
+    if (pool == NULL || pool->queues == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 0; i < pool->threadCount; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    for (size_t i = 0; i < pool->threadCount; i++)
+    {
+        pthread_mutex_destroy(&pool->queues[i].lock);
+        free(pool->queues[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    free(pool->threads);
+    free(pool->queues);
+    memset(pool, 0, sizeof(*pool));
+}
+
+/*
+This function calls fn(context, i) for every i below count on the pool and returns when all calls have
+finished. The calling thread runs tasks too while it waits, so the loop may be nested inside a task of the same
+pool without deadlocking. A worker queues the tasks on its own deque, another thread deals them round-robin
+onto all deques. Tasks that cannot be queued for lack of memory run on the calling thread. It returns 0, or -1
+if pool or fn is NULL.
+*/
+int threadPoolFor(struct ThreadPool *pool, size_t count, ThreadPoolFn fn, void *context)
+{
+    if (pool == NULL || fn == NULL)
+    {
+        return -1;
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    struct ThreadPoolJob job;
+    job.fn = fn;
+    job.context = context;
+    job.remaining = count;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.done, NULL);
+
+    // counted before queueing so that a task taken at once never drives pending below zero
+    __atomic_fetch_add(&pool->pending, count, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < count; i++)
+    {
+        struct ThreadPoolTask task = {&job, i};
+        size_t queue = currentPool == pool ? currentQueue : __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED) % pool->threadCount;
+        if (threadPoolPush(&pool->queues[queue], task) != 0)
+        {
+            __atomic_fetch_sub(&pool->pending, 1, __ATOMIC_RELAXED);
+            threadPoolRun(task);
+        }
+    }
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    struct ThreadPoolTask task;
+    for (;;)
+    {
+        pthread_mutex_lock(&job.lock);
+        bool finished = job.remaining == 0;
+        pthread_mutex_unlock(&job.lock);
+        if (finished)
+        {
+            break;
+        }
+        if (threadPoolFind(pool, &task))
+        {
+            threadPoolRun(task);
+            continue;
+        }
+        // every queued task of this loop has been taken, so wait for the threads running them
+        pthread_mutex_lock(&job.lock);
+        while (job.remaining != 0)
+        {
+            pthread_cond_wait(&job.done, &job.lock);
+        }
+        pthread_mutex_unlock(&job.lock);
+    }
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.done);
+    return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Structs
+
+typedef void (*ThreadPoolFn)(void *context, size_t index);
+
+/*
+A parallel loop being run by threadPoolFor. remaining counts the tasks not yet finished.
+*/
+struct ThreadPoolJob
+{
+    ThreadPoolFn fn;
+    void *context;
+    size_t remaining;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+};
+
+/*
+One iteration of a parallel loop.
+*/
+struct ThreadPoolTask
+{
+    struct ThreadPoolJob *job;
+    size_t index;
+};
+
+/*
+The task deque of one worker, a ring buffer. The owner pushes and pops at the tail, so it works on the tasks it
+queued most recently while they are still in cache; other threads steal from the head, taking the oldest tasks.
+*/
+struct ThreadPoolQueue
+{
+    pthread_mutex_t lock;
+    struct ThreadPoolTask *tasks;
+    size_t head;
+    size_t count;
+    size_t capacity;
+};
+
+/*
+A fixed set of worker threads with one deque each. Work is dealt round-robin onto the deques and an idle
+worker steals from the others, so uneven tasks still keep every thread busy. Idle workers sleep on work until
+pending becomes non-zero.
+*/
+struct ThreadPool
+{
+    pthread_t *threads;
+    struct ThreadPoolQueue *queues;
+    size_t threadCount;
+    size_t next;
+    size_t pending;
+    bool stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+};
+
+// Functions
+
+int threadPoolInit(struct ThreadPool *pool, size_t threads);
+
+void threadPoolFree(struct ThreadPool *pool);
+
+int threadPoolFor(struct ThreadPool *pool, size_t count, ThreadPoolFn fn, void *context);
+
+#endif
@@ -0,0 +1,237 @@
+#include <stdlib.h>
+#include <string.h>
+#include "metrics.h"
+#include "titleindex.h"
+
+/*
+This function hashes the length bytes at title, which need not be NUL-terminated, with 64-bit FNV-1a and folds
+the result to 32 bits. The hash is case-sensitive, so titles that differ only in case land in different buckets.
+*/
+uint32_t titleHashLength(const char *title, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)title[i];
+        hash *= 1099511628211ULL;
+    }
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/*
+This function hashes a NUL-terminated title like titleHashLength.
+*/
+uint32_t titleHash(const char *title)
+{
+    return titleHashLength(title, strlen(title));
+}
+
+/*
+This function initializes an empty index. The bucket array is allocated on the first insert.
+*/
+void titleIndexInit(struct TitleIndex *index)
+{
+    index->entries = NULL;
+    index->mask = 0;
+    index->size = 0;
+}
+
+/*
+This function releases the bucket array and leaves the index empty.
+*/
+void titleIndexFree(struct TitleIndex *index)
+{
+    free(index->entries);
+    titleIndexInit(index);
+}
+
+/*
+This function grows the bucket array so that count entries fit below a load factor of one half, rehashing the
+existing entries from their stored hashes. It returns 0 on success and -1 if the allocation fails, in which
+case the index is unchanged.
+*/
+int titleIndexReserve(struct TitleIndex *index, size_t count)
+{
+    size_t buckets = index->entries == NULL ? 0 : index->mask + 1;
+    if (count * 2 <= buckets)
+    {
+        return 0;
+    }
+
+    size_t newBuckets = buckets == 0 ? 16 : buckets;
+    while (count * 2 > newBuckets)
+    {
+        newBuckets *= 2;
+    }
+
+    struct TitleIndexEntry *entries = (struct TitleIndexEntry *)malloc(newBuckets * sizeof(struct TitleIndexEntry));
+    if (entries == NULL)
+    {
+        return -1;
+    }
+    // all bits set marks a bucket as empty
+    memset(entries, 0xff, newBuckets * sizeof(struct TitleIndexEntry));
+
+    size_t mask = newBuckets - 1;
+    for (size_t i = 0; i < buckets; i++)
+    {
+        struct TitleIndexEntry entry = index->entries[i];
+        if (entry.slot == TITLE_INDEX_NONE)
+        {
+            continue;
+        }
+        size_t pos = entry.hash & mask;
+        while (entries[pos].slot != TITLE_INDEX_NONE)
+        {
+            pos = (pos + 1) & mask;
+        }
+        entries[pos] = entry;
+    }
+
+    free(index->entries);
+    index->entries = entries;
+    index->mask = mask;
+    return 0;
+}
+
+/*
+This function looks up a title. Buckets whose stored hash differs are skipped without touching the title, and
+candidates are confirmed with strcmp against the title returned by the key function. It returns the slot of
+the matching title or TITLE_INDEX_NONE if the title is not indexed.
+*/
+uint32_t titleIndexFind(const struct TitleIndex *index, uint32_t hash, const char *title, TitleKeyFn key, const void *context)
+{
+    if (index->entries == NULL)
+    {
+        return TITLE_INDEX_NONE;
+    }
+
+    size_t pos = hash & index->mask;
+    uint64_t probes = 1;
+    while (index->entries[pos].slot != TITLE_INDEX_NONE)
+    {
+        const struct TitleIndexEntry *entry = &index->entries[pos];
+        if (entry->hash == hash && strcmp(key(context, entry->slot), title) == 0)
+        {
+            metricsCompare(probes);
+            return entry->slot;
+        }
+        pos = (pos + 1) & index->mask;
+        probes++;
+    }
+    metricsCompare(probes);
+    return TITLE_INDEX_NONE;
+}
+
+/*
+This function looks up a title like titleIndexFind but leaves confirming a candidate to match, for callers
+whose titles are not NUL-terminated strings. It returns the first slot with the given hash that match accepts,
+or TITLE_INDEX_NONE.
+*/
+uint32_t titleIndexFindMatch(const struct TitleIndex *index, uint32_t hash, TitleMatchFn match, const void *context)
+{
+    if (index->entries == NULL)
+    {
+        return TITLE_INDEX_NONE;
+    }
+
+    size_t pos = hash & index->mask;
+    while (index->entries[pos].slot != TITLE_INDEX_NONE)
+    {
+        const struct TitleIndexEntry *entry = &index->entries[pos];
+        if (entry->hash == hash && match(context, entry->slot))
+        {
+            return entry->slot;
+        }
+        pos = (pos + 1) & index->mask;
+    }
+    return TITLE_INDEX_NONE;
+}
+
+/*
+This function records that the title with the given hash is stored at slot. It does not check for duplicates;
+callers are expected to call titleIndexFind first. It returns 0 on success and -1 if the index could not grow.
+*/
+int titleIndexInsert(struct TitleIndex *index, uint32_t hash, uint32_t slot)
+{
+    if (titleIndexReserve(index, index->size + 1) != 0)
+    {
+        return -1;
+    }
+
+    size_t pos = hash & index->mask;
+    while (index->entries[pos].slot != TITLE_INDEX_NONE)
+    {
+        pos = (pos + 1) & index->mask;
+    }
+    index->entries[pos].hash = hash;
+    index->entries[pos].slot = slot;
+    index->size++;
+    return 0;
+}
+
+/*
+This function removes the entry for slot from the probe sequence of hash. Instead of leaving a tombstone it
+shifts later entries of the same cluster back into the hole, so lookups never have to skip deleted buckets.
+It returns 0 if the entry was removed and -1 if it was not found.
+*/
+int titleIndexRemove(struct TitleIndex *index, uint32_t hash, uint32_t slot)
+{
+    if (index->entries == NULL)
+    {
+        return -1;
+    }
+
+    size_t mask = index->mask;
+    size_t pos = hash & mask;
+    while (index->entries[pos].slot != slot)
+    {
+        if (index->entries[pos].slot == TITLE_INDEX_NONE)
+        {
+            return -1;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    size_t hole = pos;
+    size_t next = (hole + 1) & mask;
+    while (index->entries[next].slot != TITLE_INDEX_NONE)
+    {
+        size_t home = index->entries[next].hash & mask;
+        // move the entry back only if its home bucket does not lie between the hole and its position
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            index->entries[hole] = index->entries[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    index->entries[hole].slot = TITLE_INDEX_NONE;
+    index->entries[hole].hash = UINT32_MAX;
+    index->size--;
+    return 0;
+}
+
+/*
+This function records that the title with the given hash has moved from oldSlot to newSlot. The bucket keeps
+its position because the hash is unchanged. It returns 0 on success and -1 if oldSlot was not indexed.
+*/
+int titleIndexRelocate(struct TitleIndex *index, uint32_t hash, uint32_t oldSlot, uint32_t newSlot)
+{
+    if (index->entries == NULL)
+    {
+        return -1;
+    }
+
+    size_t pos = hash & index->mask;
+    while (index->entries[pos].slot != TITLE_INDEX_NONE)
+    {
+        if (index->entries[pos].slot == oldSlot)
+        {
+            index->entries[pos].slot = newSlot;
+            return 0;
+        }
+        pos = (pos + 1) & index->mask;
+    }
+    return -1;
+}
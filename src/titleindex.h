@@ -0,0 +1,61 @@
+#ifndef TITLEINDEX_H
+#define TITLEINDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TITLE_INDEX_NONE UINT32_MAX
+
+// Structs
+
+/*
+One bucket of the open-addressing table. The full hash is kept next to the slot so that probes and
+rehashing never need to look at the stored titles; a bucket with slot TITLE_INDEX_NONE is empty.
+*/
+struct TitleIndexEntry
+{
+    uint32_t hash;
+    uint32_t slot;
+};
+
+/*
+Maps titles to slots with linear probing. The index does not own any strings: callers pass a key function
+that returns the title stored at a slot, which is used to confirm a hash match. The 8-byte buckets are the hot
+part of a lookup; the record behind a slot is read only when its full hash matches, so a miss touches buckets
+alone and a hit one record.
+*/
+struct TitleIndex
+{
+    struct TitleIndexEntry *entries;
+    size_t mask;
+    size_t size;
+};
+
+typedef const char *(*TitleKeyFn)(const void *context, uint32_t slot);
+
+typedef bool (*TitleMatchFn)(const void *context, uint32_t slot);
+
+// Functions
+
+uint32_t titleHash(const char *title);
+
+uint32_t titleHashLength(const char *title, size_t length);
+
+void titleIndexInit(struct TitleIndex *index);
+
+void titleIndexFree(struct TitleIndex *index);
+
+int titleIndexReserve(struct TitleIndex *index, size_t count);
+
+uint32_t titleIndexFind(const struct TitleIndex *index, uint32_t hash, const char *title, TitleKeyFn key, const void *context);
+
+uint32_t titleIndexFindMatch(const struct TitleIndex *index, uint32_t hash, TitleMatchFn match, const void *context);
+
+int titleIndexInsert(struct TitleIndex *index, uint32_t hash, uint32_t slot);
+
+int titleIndexRemove(struct TitleIndex *index, uint32_t hash, uint32_t slot);
+
+int titleIndexRelocate(struct TitleIndex *index, uint32_t hash, uint32_t oldSlot, uint32_t newSlot);
+
+#endif
@@ -0,0 +1,636 @@
+#include <stdlib.h>
+#include "titlesearch.h"
+
+// a segment count no index can reach, since merged segments at least double in size
+#define TITLE_SEARCH_MAX_SEGMENTS 64
+
+// the index whose docs qsort is comparing
+static __thread const struct TitleSearch *sortSearch = NULL;
+
+/*
+This function orders two byte strings lexicographically, a proper prefix before the longer string.
+*/
+static int titleSearchCompare(const char *a, size_t aLength, const char *b, size_t bLength)
+{
+    int order = memcmp(a, b, aLength < bLength ? aLength : bLength);
+    if (order != 0)
+    {
+        return order;
+    }
+    return aLength < bLength ? -1 : aLength > bLength ? 1 : 0;
+}
+
+/*
+This function returns whether the length bytes at key start the title of doc at offset.
+*/
+static bool titleSearchStartsWith(const struct TitleSearchDoc *doc, size_t offset, const char *key, size_t length)
+{
+    return doc->length - offset >= length && memcmp(doc->title + offset, key, length) == 0;
+}
+
+/*
+This function returns the offset of the first occurrence of the length bytes at pattern in the title of doc, or
+-1 if there is none.
+*/
+static long titleSearchFind(const struct TitleSearchDoc *doc, const char *pattern, size_t length)
+{
+    for (size_t offset = 0; offset + length <= doc->length; offset++)
+    {
+        if (doc->title[offset] == pattern[0] && memcmp(doc->title + offset, pattern, length) == 0)
+        {
+            return (long)offset;
+        }
+    }
+    return -1;
+}
+
+static int titleSearchCompareDocs(const void *a, const void *b)
+{
+    const struct TitleSearchDoc *x = &sortSearch->docs[*(const uint32_t *)a];
+    const struct TitleSearchDoc *y = &sortSearch->docs[*(const uint32_t *)b];
+    return titleSearchCompare(x->title, x->length, y->title, y->length);
+}
+
+static int titleSearchCompareSuffixes(const struct TitleSearch *search, struct TitleSearchSuffix a, struct TitleSearchSuffix b)
+{
+    const struct TitleSearchDoc *x = &search->docs[a.doc];
+    const struct TitleSearchDoc *y = &search->docs[b.doc];
+    return titleSearchCompare(x->title + a.offset, x->length - a.offset, y->title + b.offset, y->length - b.offset);
+}
+
+static int titleSearchCompareSuffixEntries(const void *a, const void *b)
+{
+    return titleSearchCompareSuffixes(sortSearch, *(const struct TitleSearchSuffix *)a, *(const struct TitleSearchSuffix *)b);
+}
+
+/*
+This function returns the position of the first doc of segment whose title is not below key.
+*/
+static size_t titleSearchLowerDoc(const struct TitleSearch *search, const struct TitleSearchSegment *segment, const char *key, size_t length)
+{
+    size_t low = 0;
+    size_t high = segment->docCount;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        const struct TitleSearchDoc *doc = &search->docs[segment->docs[middle]];
+        if (titleSearchCompare(doc->title, doc->length, key, length) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/*
+This function returns the position of the first suffix of segment that is not below key.
+*/
+static size_t titleSearchLowerSuffix(const struct TitleSearch *search, const struct TitleSearchSegment *segment, const char *key, size_t length)
+{
+    size_t low = 0;
+    size_t high = segment->suffixCount;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        struct TitleSearchSuffix suffix = segment->suffixes[middle];
+        const struct TitleSearchDoc *doc = &search->docs[suffix.doc];
+        if (titleSearchCompare(doc->title + suffix.offset, doc->length - suffix.offset, key, length) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static void titleSearchFreeSegment(struct TitleSearchSegment *segment)
+{
+    free(segment->docs);
+    free(segment->suffixes);
+    memset(segment, 0, sizeof(*segment));
+}
+
+/*
+This function merges the last two segments into one, dropping the docs that died since they were built. It
+returns 0 on success and -1 if memory could not be allocated, in which case both segments are kept.
+*/
+static int titleSearchMergeLast(struct TitleSearch *search)
+{
+    struct TitleSearchSegment *a = &search->segments[search->segmentCount - 2];
+    struct TitleSearchSegment *b = &search->segments[search->segmentCount - 1];
+    struct TitleSearchSegment merged;
+    sortSearch = search;
+    merged.docs = (uint32_t *)malloc((a->docCount + b->docCount) * sizeof(uint32_t));
+    merged.suffixes = (struct TitleSearchSuffix *)malloc((a->suffixCount + b->suffixCount) * sizeof(struct TitleSearchSuffix));
+    if (merged.docs == NULL || merged.suffixes == NULL)
+    {
+        titleSearchFreeSegment(&merged);
+        return -1;
+    }
+
+    size_t i = 0;
+    size_t j = 0;
+    merged.docCount = 0;
+    while (i < a->docCount || j < b->docCount)
+    {
+        uint32_t doc;
+        if (j == b->docCount || (i < a->docCount && titleSearchCompareDocs(&a->docs[i], &b->docs[j]) <= 0))
+        {
+            doc = a->docs[i++];
+        }
+        else
+        {
+            doc = b->docs[j++];
+        }
+        if (search->docs[doc].slot != TITLE_SEARCH_NONE)
+        {
+            merged.docs[merged.docCount++] = doc;
+        }
+    }
+
+    i = 0;
+    j = 0;
+    merged.suffixCount = 0;
+    while (i < a->suffixCount || j < b->suffixCount)
+    {
+        struct TitleSearchSuffix suffix;
+        if (j == b->suffixCount || (i < a->suffixCount && titleSearchCompareSuffixes(search, a->suffixes[i], b->suffixes[j]) <= 0))
+        {
+            suffix = a->suffixes[i++];
+        }
+        else
+        {
+            suffix = b->suffixes[j++];
+        }
+        if (search->docs[suffix.doc].slot != TITLE_SEARCH_NONE)
+        {
+            merged.suffixes[merged.suffixCount++] = suffix;
+        }
+    }
+
+    titleSearchFreeSegment(a);
+    titleSearchFreeSegment(b);
+    *a = merged;
+    search->segmentCount--;
+    return 0;
+}
+
+/*
+This function sorts the live docs of the delta into a new segment and merges it with its predecessors while
+they are no larger, like carries in a binary counter. It returns 0 on success and -1 if memory could not be
+allocated, in which case the docs stay in the delta and the next add tries again.
+*/
+static int titleSearchFlush(struct TitleSearch *search)
+{
+    struct TitleSearchSegment segment;
+    size_t suffixes = 0;
+    size_t docs = 0;
+    for (size_t i = 0; i < search->deltaCount; i++)
+    {
+        const struct TitleSearchDoc *doc = &search->docs[search->delta[i]];
+        if (doc->slot != TITLE_SEARCH_NONE)
+        {
+            suffixes += doc->length;
+            docs++;
+        }
+    }
+    if (docs == 0)
+    {
+        search->deltaCount = 0;
+        return 0;
+    }
+    if (search->segments == NULL)
+    {
+        search->segments = (struct TitleSearchSegment *)calloc(TITLE_SEARCH_MAX_SEGMENTS, sizeof(struct TitleSearchSegment));
+        if (search->segments == NULL)
+        {
+            return -1;
+        }
+    }
+    segment.docs = (uint32_t *)malloc(docs * sizeof(uint32_t));
+    segment.suffixes = (struct TitleSearchSuffix *)malloc((suffixes == 0 ? 1 : suffixes) * sizeof(struct TitleSearchSuffix));
+    if (segment.docs == NULL || segment.suffixes == NULL)
+    {
+        titleSearchFreeSegment(&segment);
+        return -1;
+    }
+
+    segment.docCount = 0;
+    segment.suffixCount = 0;
+    for (size_t i = 0; i < search->deltaCount; i++)
+    {
+        uint32_t id = search->delta[i];
+        const struct TitleSearchDoc *doc = &search->docs[id];
+        if (doc->slot == TITLE_SEARCH_NONE)
+        {
+            continue;
+        }
+        segment.docs[segment.docCount++] = id;
+        for (uint32_t offset = 0; offset < doc->length; offset++)
+        {
+            struct TitleSearchSuffix suffix = {id, offset};
+            segment.suffixes[segment.suffixCount++] = suffix;
+        }
+    }
+    sortSearch = search;
+    qsort(segment.docs, segment.docCount, sizeof(uint32_t), titleSearchCompareDocs);
+    qsort(segment.suffixes, segment.suffixCount, sizeof(struct TitleSearchSuffix), titleSearchCompareSuffixEntries);
+
+    if (search->segmentCount == TITLE_SEARCH_MAX_SEGMENTS && titleSearchMergeLast(search) != 0)
+    {
+        titleSearchFreeSegment(&segment);
+        return -1;
+    }
+    search->segments[search->segmentCount++] = segment;
+    search->deltaCount = 0;
+    while (search->segmentCount >= 2 &&
+           search->segments[search->segmentCount - 2].docCount <= search->segments[search->segmentCount - 1].docCount)
+    {
+        // a failed merge leaves the segments valid, just more of them
+        if (titleSearchMergeLast(search) != 0)
+        {
+            break;
+        }
+    }
+    return 0;
+}
+
+/*
+This function appends doc to the delta. The delta holds TITLE_SEARCH_DELTA docs and only grows past that while
+flushes fail. It returns 0 on success and -1 if memory could not be allocated.
+*/
+static int titleSearchPushDelta(struct TitleSearch *search, uint32_t doc)
+{
+    if (search->deltaCount == search->deltaCapacity)
+    {
+        size_t capacity = search->deltaCapacity == 0 ? TITLE_SEARCH_DELTA : search->deltaCapacity * 2;
+        uint32_t *delta = (uint32_t *)realloc(search->delta, capacity * sizeof(uint32_t));
+        if (delta == NULL)
+        {
+            return -1;
+        }
+        search->delta = delta;
+        search->deltaCapacity = capacity;
+    }
+    search->delta[search->deltaCount++] = doc;
+    return 0;
+}
+
+/*
+This function rebuilds the index from its live docs once they are outnumbered by dead ones, copying the titles
+into a fresh arena and sorting them into a single segment. If memory runs out the old index is kept.
+*/
+static void titleSearchRebuild(struct TitleSearch *search)
+{
+    size_t live = search->docCount - search->deadCount;
+    struct StringArena arena;
+    stringArenaInit(&arena);
+    struct TitleSearchDoc *docs = (struct TitleSearchDoc *)malloc((live == 0 ? 1 : live) * sizeof(struct TitleSearchDoc));
+    size_t deltaCapacity = live < TITLE_SEARCH_DELTA ? TITLE_SEARCH_DELTA : live;
+    uint32_t *delta = (uint32_t *)malloc(deltaCapacity * sizeof(uint32_t));
+    if (docs == NULL || delta == NULL)
+    {
+        free(docs);
+        free(delta);
+        return;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < search->docCount; i++)
+    {
+        const struct TitleSearchDoc *doc = &search->docs[i];
+        if (doc->slot == TITLE_SEARCH_NONE)
+        {
+            continue;
+        }
+        char *title = stringArenaAlloc(&arena, doc->length);
+        if (title == NULL)
+        {
+            stringArenaFree(&arena);
+            free(docs);
+            free(delta);
+            return;
+        }
+        memcpy(title, doc->title, doc->length);
+        docs[count].title = title;
+        docs[count].length = doc->length;
+        docs[count].slot = doc->slot;
+        delta[count] = (uint32_t)count;
+        count++;
+    }
+
+    for (size_t i = 0; i < search->segmentCount; i++)
+    {
+        titleSearchFreeSegment(&search->segments[i]);
+    }
+    stringArenaFree(&search->arena);
+    free(search->docs);
+    free(search->delta);
+    search->arena = arena;
+    search->docs = docs;
+    search->docCount = count;
+    search->docCapacity = live == 0 ? 1 : live;
+    search->deadCount = 0;
+    search->segmentCount = 0;
+    search->delta = delta;
+    search->deltaCount = count;
+    search->deltaCapacity = deltaCapacity;
+    for (size_t i = 0; i < count; i++)
+    {
+        search->docOfSlot[docs[i].slot] = (uint32_t)i;
+    }
+    // if this fails the docs are found through the delta until the next add retries
+    titleSearchFlush(search);
+}
+
+/*
+This function initializes an empty index.
+*/
+void titleSearchInit(struct TitleSearch *search)
+{
+    memset(search, 0, sizeof(*search));
+    stringArenaInit(&search->arena);
+}
+
+/*
+This function releases the index.
+*/
+void titleSearchFree(struct TitleSearch *search)
+{
+    if (search == NULL)
+    {
+        return;
+    }
+    for (size_t i = 0; i < search->segmentCount; i++)
+    {
+        titleSearchFreeSegment(&search->segments[i]);
+    }
+    stringArenaFree(&search->arena);
+    free(search->segments);
+    free(search->docs);
+    free(search->docOfSlot);
+    free(search->delta);
+    titleSearchInit(search);
+}
+
+/*
+This function adds the length bytes at title as the title of the material at slot, which must not already
+have one. The title is searchable at once through the delta. It returns 0 on success and -1 if memory could not
+be allocated, in which case the index is unchanged.
+*/
+int titleSearchAdd(struct TitleSearch *search, const char *title, size_t length, uint32_t slot)
+{
+    if (slot == TITLE_SEARCH_NONE || length > UINT32_MAX || search->docCount >= TITLE_SEARCH_NONE)
+    {
+        return -1;
+    }
+    if (slot >= search->slotCapacity)
+    {
+        size_t capacity = search->slotCapacity == 0 ? 1024 : search->slotCapacity;
+        while (capacity <= slot)
+        {
+            capacity *= 2;
+        }
+        uint32_t *docOfSlot = (uint32_t *)realloc(search->docOfSlot, capacity * sizeof(uint32_t));
+        if (docOfSlot == NULL)
+        {
+            return -1;
+        }
+        memset(docOfSlot + search->slotCapacity, 0xff, (capacity - search->slotCapacity) * sizeof(uint32_t));
+        search->docOfSlot = docOfSlot;
+        search->slotCapacity = capacity;
+    }
+    if (search->docCount == search->docCapacity)
+    {
+        size_t capacity = search->docCapacity == 0 ? 1024 : search->docCapacity * 2;
+        struct TitleSearchDoc *docs = (struct TitleSearchDoc *)realloc(search->docs, capacity * sizeof(struct TitleSearchDoc));
+        if (docs == NULL)
+        {
+            return -1;
+        }
+        search->docs = docs;
+        search->docCapacity = capacity;
+    }
+    if (titleSearchPushDelta(search, (uint32_t)search->docCount) != 0)
+    {
+        return -1;
+    }
+    char *copy = stringArenaAlloc(&search->arena, length);
+    if (copy == NULL)
+    {
+        search->deltaCount--;
+        return -1;
+    }
+
+    memcpy(copy, title, length);
+    search->docs[search->docCount].title = copy;
+    search->docs[search->docCount].length = (uint32_t)length;
+    search->docs[search->docCount].slot = slot;
+    search->docOfSlot[slot] = (uint32_t)search->docCount;
+    search->docCount++;
+    if (search->deltaCount >= TITLE_SEARCH_DELTA)
+    {
+        titleSearchFlush(search);
+    }
+    return 0;
+}
+
+/*
+This function forgets the title of the material at slot, if it has one. Usually it only marks the doc dead, but
+the removal that leaves more than half the docs dead rebuilds the whole index in the same call, sorting every live
+title and all of its suffixes, so that one call takes O(n log n) time for n live suffixes. Averaged over the
+removals since the previous rebuild this is O(log n) per removal.
+*/
+void titleSearchRemove(struct TitleSearch *search, uint32_t slot)
+{
+    if (slot >= search->slotCapacity || search->docOfSlot[slot] == TITLE_SEARCH_NONE)
+    {
+        return;
+    }
+    search->docs[search->docOfSlot[slot]].slot = TITLE_SEARCH_NONE;
+    search->docOfSlot[slot] = TITLE_SEARCH_NONE;
+    search->deadCount++;
+    if (search->docCount >= TITLE_SEARCH_DELTA && search->deadCount * 2 > search->docCount)
+    {
+        titleSearchRebuild(search);
+    }
+}
+
+/*
+This function records that the material at slot from has moved to slot to, which must be free and below a slot
+that was added before, as every move of an ArchiveStore is.
+*/
+void titleSearchRelocate(struct TitleSearch *search, uint32_t from, uint32_t to)
+{
+    if (from >= search->slotCapacity || to >= search->slotCapacity || search->docOfSlot[from] == TITLE_SEARCH_NONE)
+    {
+        return;
+    }
+    uint32_t doc = search->docOfSlot[from];
+    search->docOfSlot[from] = TITLE_SEARCH_NONE;
+    search->docOfSlot[to] = doc;
+    search->docs[doc].slot = to;
+}
+
+/*
+This function finds the titles starting with the length bytes at prefix and stores the slots of up to limit of
+them in slots, skipping the first offset matches. Matches are reported in title order: each segment's sorted
+docs from the first title not below prefix are merged with the matching titles of the delta. The skipped matches
+go through the same merge as the returned ones, so with s segments a page costs O(s log n) for the searches plus
+O((offset + limit) s) for the merge, on top of a scan of the delta; fetching deep pages one by one is therefore
+quadratic in the depth. It returns the number of slots stored, which is below limit only on the last page, or 0
+if memory for sorting the delta could not be allocated.
+*/
+size_t titleSearchPrefix(const struct TitleSearch *search, const char *prefix, size_t length, size_t offset, uint32_t *slots, size_t limit)
+{
+    if (search == NULL || (prefix == NULL && length != 0) || limit == 0)
+    {
+        return 0;
+    }
+
+    uint32_t *delta = NULL;
+    size_t deltaMatches = 0;
+    if (search->deltaCount != 0)
+    {
+        delta = (uint32_t *)malloc(search->deltaCount * sizeof(uint32_t));
+        if (delta == NULL)
+        {
+            return 0;
+        }
+        for (size_t i = 0; i < search->deltaCount; i++)
+        {
+            const struct TitleSearchDoc *doc = &search->docs[search->delta[i]];
+            if (doc->slot != TITLE_SEARCH_NONE && titleSearchStartsWith(doc, 0, prefix, length))
+            {
+                delta[deltaMatches++] = search->delta[i];
+            }
+        }
+        sortSearch = search;
+        qsort(delta, deltaMatches, sizeof(uint32_t), titleSearchCompareDocs);
+    }
+
+    // one cursor per segment plus the delta's, which is the last
+    size_t cursors[TITLE_SEARCH_MAX_SEGMENTS + 1];
+    for (size_t s = 0; s < search->segmentCount; s++)
+    {
+        cursors[s] = titleSearchLowerDoc(search, &search->segments[s], prefix, length);
+    }
+    cursors[search->segmentCount] = 0;
+
+    size_t count = 0;
+    size_t skipped = 0;
+    while (count < limit)
+    {
+        const struct TitleSearchDoc *best = NULL;
+        size_t bestCursor = 0;
+        for (size_t s = 0; s <= search->segmentCount; s++)
+        {
+            const struct TitleSearchDoc *doc = NULL;
+            if (s == search->segmentCount)
+            {
+                doc = cursors[s] < deltaMatches ? &search->docs[delta[cursors[s]]] : NULL;
+            }
+            else
+            {
+                const struct TitleSearchSegment *segment = &search->segments[s];
+                while (cursors[s] < segment->docCount && search->docs[segment->docs[cursors[s]]].slot == TITLE_SEARCH_NONE)
+                {
+                    cursors[s]++;
+                }
+                if (cursors[s] < segment->docCount && titleSearchStartsWith(&search->docs[segment->docs[cursors[s]]], 0, prefix, length))
+                {
+                    doc = &search->docs[segment->docs[cursors[s]]];
+                }
+            }
+            if (doc != NULL && (best == NULL || titleSearchCompare(doc->title, doc->length, best->title, best->length) < 0))
+            {
+                best = doc;
+                bestCursor = s;
+            }
+        }
+        if (best == NULL)
+        {
+            break;
+        }
+        cursors[bestCursor]++;
+        if (skipped < offset)
+        {
+            skipped++;
+            continue;
+        }
+        slots[count++] = best->slot;
+    }
+    free(delta);
+    return count;
+}
+
+/*
+This function finds the titles containing the length bytes at pattern and stores the slots of up to limit of
+them in slots, skipping the first offset matches. Each segment's suffix array gives the contiguous range of
+suffixes starting with pattern after a binary search; a title is reported at its first occurrence only, so a
+title containing pattern twice is listed once, which takes a search of the title for every suffix in the range.
+The delta is scanned directly. Matches are listed segment by segment in suffix order, which is stable as long as
+the index is not modified; an empty pattern lists every title in title order. The skipped matches are found and
+checked like the returned ones, so a page costs time proportional to offset + limit occurrences, plus the
+binary searches and a scan of the delta. It returns the number of slots stored, which is below limit only on
+the last page.
+*/
+size_t titleSearchSubstring(const struct TitleSearch *search, const char *pattern, size_t length, size_t offset, uint32_t *slots, size_t limit)
+{
+    if (search == NULL || (pattern == NULL && length != 0) || limit == 0)
+    {
+        return 0;
+    }
+    if (length == 0)
+    {
+        return titleSearchPrefix(search, pattern, 0, offset, slots, limit);
+    }
+
+    size_t count = 0;
+    size_t skipped = 0;
+    for (size_t s = 0; s < search->segmentCount && count < limit; s++)
+    {
+        const struct TitleSearchSegment *segment = &search->segments[s];
+        for (size_t i = titleSearchLowerSuffix(search, segment, pattern, length); i < segment->suffixCount && count < limit; i++)
+        {
+            struct TitleSearchSuffix suffix = segment->suffixes[i];
+            const struct TitleSearchDoc *doc = &search->docs[suffix.doc];
+            if (!titleSearchStartsWith(doc, suffix.offset, pattern, length))
+            {
+                break;
+            }
+            if (doc->slot == TITLE_SEARCH_NONE || titleSearchFind(doc, pattern, length) != (long)suffix.offset)
+            {
+                continue;
+            }
+            if (skipped < offset)
+            {
+                skipped++;
+                continue;
+            }
+            slots[count++] = doc->slot;
+        }
+    }
+    for (size_t i = 0; i < search->deltaCount && count < limit; i++)
+    {
+        const struct TitleSearchDoc *doc = &search->docs[search->delta[i]];
+        if (doc->slot == TITLE_SEARCH_NONE || titleSearchFind(doc, pattern, length) < 0)
+        {
+            continue;
+        }
+        if (skipped < offset)
+        {
+            skipped++;
+            continue;
+        }
+        slots[count++] = doc->slot;
+    }
+    return count;
+}
@@ -0,0 +1,88 @@
+#ifndef TITLESEARCH_H
+#define TITLESEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "smallstring.h"
+
+// Tuning
+#define TITLE_SEARCH_DELTA 4096
+#define TITLE_SEARCH_NONE UINT32_MAX
+
+// Structs
+
+/*
+A title known to a TitleSearch. slot is the slot of the material it belongs to, or TITLE_SEARCH_NONE once the
+material has been removed; the text stays until the next rebuild because segments still point at it.
+*/
+struct TitleSearchDoc
+{
+    const char *title;
+    uint32_t length;
+    uint32_t slot;
+};
+
+/*
+One occurrence of a suffix: the suffix of doc's title starting at offset.
+*/
+struct TitleSearchSuffix
+{
+    uint32_t doc;
+    uint32_t offset;
+};
+
+/*
+An immutable run of docs: their ids sorted by title for prefix search, and the suffixes of all their titles
+sorted lexicographically, a suffix array, for substring search.
+*/
+struct TitleSearchSegment
+{
+    uint32_t *docs;
+    size_t docCount;
+    struct TitleSearchSuffix *suffixes;
+    size_t suffixCount;
+};
+
+/*
+A prefix and substring index over titles, maintained incrementally like a log-structured merge tree. New titles
+go to a small unsorted delta that queries scan directly; once the delta holds TITLE_SEARCH_DELTA titles it is
+sorted into a segment, and a segment is merged into its predecessor whenever that is no larger, so there are
+O(log n) segments and each title is merged O(log n) times. Removal only marks the doc dead: merges drop dead
+docs, and once half the docs are dead the whole index is rebuilt from the live titles. Titles are copied into
+arena, so results are reported by slot and the owner's materials may move freely as long as it calls
+titleSearchRelocate.
+*/
+struct TitleSearch
+{
+    struct StringArena arena;
+    struct TitleSearchDoc *docs;
+    size_t docCount;
+    size_t docCapacity;
+    size_t deadCount;
+    uint32_t *docOfSlot;
+    size_t slotCapacity;
+    struct TitleSearchSegment *segments;
+    size_t segmentCount;
+    uint32_t *delta;
+    size_t deltaCount;
+    size_t deltaCapacity;
+};
+
+// Functions
+
+void titleSearchInit(struct TitleSearch *search);
+
+void titleSearchFree(struct TitleSearch *search);
+
+int titleSearchAdd(struct TitleSearch *search, const char *title, size_t length, uint32_t slot);
+
+void titleSearchRemove(struct TitleSearch *search, uint32_t slot);
+
+void titleSearchRelocate(struct TitleSearch *search, uint32_t from, uint32_t to);
+
+size_t titleSearchPrefix(const struct TitleSearch *search, const char *prefix, size_t length, size_t offset, uint32_t *slots, size_t limit);
+
+size_t titleSearchSubstring(const struct TitleSearch *search, const char *pattern, size_t length, size_t offset, uint32_t *slots, size_t limit);
+
+#endif
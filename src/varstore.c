@@ -0,0 +1,285 @@
+#include "varstore.h"
+
+/*
+A title being looked up, the context of varTitleMatches.
+*/
+struct VarTitleQuery
+{
+    const struct VarArchive *archive;
+    const char *title;
+    size_t length;
+};
+
+/*
+This function confirms a title index candidate by length and then bytes.
+*/
+static bool varTitleMatches(const void *context, uint32_t slot)
+{
+    const struct VarTitleQuery *query = (const struct VarTitleQuery *)context;
+    return smallStringEquals(&query->archive->materials[slot].title, query->title, query->length);
+}
+
+/*
+This function returns the position of the material with the given title, or TITLE_INDEX_NONE.
+*/
+static uint32_t varLookup(const struct VarArchive *archive, const char *title, size_t length, uint32_t hash)
+{
+    struct VarTitleQuery query = {archive, title, length};
+    return titleIndexFindMatch(&archive->titles, hash, varTitleMatches, &query);
+}
+
+/*
+This function checks that subtype is valid for type. It returns 0 if it is and the error code of
+varUpdateMaterial for that type otherwise: -3 for a book, -4 for a journal and -5 for a newspaper.
+*/
+static int varCheckSubtype(enum MaterialType type, int subtype)
+{
+    switch (type)
+    {
+    case BOOK:
+        return subtype >= NOVEL && subtype <= HISTORY ? 0 : -3;
+    case JOURNAL:
+        return subtype >= SCIENCE && subtype <= ART ? 0 : -4;
+    default:
+        return subtype >= DAILY && subtype <= MONTHLY ? 0 : -5;
+    }
+}
+
+/*
+This function initializes an empty archive.
+*/
+void varInit(struct VarArchive *archive)
+{
+    archive->materials = NULL;
+    archive->count = 0;
+    archive->capacity = 0;
+    titleIndexInit(&archive->titles);
+    stringArenaInit(&archive->arena);
+}
+
+/*
+This function releases the materials, the title index and the arena.
+*/
+void varFree(struct VarArchive *archive)
+{
+    if (archive == NULL)
+    {
+        return;
+    }
+    free(archive->materials);
+    titleIndexFree(&archive->titles);
+    stringArenaFree(&archive->arena);
+    varInit(archive);
+}
+
+/*
+This function adds a material. The error codes follow storeAddMaterial: -1 for a NULL argument, a title that is
+already present or a type or subtype out of range, -2 if memory could not be allocated. It returns 0 on
+success.
+*/
+int varAddMaterial(struct VarArchive *archive, const char *title, size_t titleLength, enum MaterialType type, int subtype, int32_t number, const char *contributor, size_t contributorLength)
+{
+    if (archive == NULL || title == NULL || contributor == NULL || type < BOOK || type > NEWSPAPER || varCheckSubtype(type, subtype) != 0)
+    {
+        return -1;
+    }
+    if (archive->count >= TITLE_INDEX_NONE)
+    {
+        return -1;
+    }
+    uint32_t hash = titleHashLength(title, titleLength);
+    if (varLookup(archive, title, titleLength, hash) != TITLE_INDEX_NONE)
+    {
+        return -1;
+    }
+
+    if (archive->count == archive->capacity)
+    {
+        size_t capacity = archive->capacity == 0 ? 64 : archive->capacity * 2;
+        struct VarMaterial *materials = (struct VarMaterial *)realloc(archive->materials, capacity * sizeof(struct VarMaterial));
+        if (materials == NULL)
+        {
+            return -2;
+        }
+        archive->materials = materials;
+        archive->capacity = capacity;
+    }
+    struct VarMaterial *material = &archive->materials[archive->count];
+    if (smallStringSet(&material->title, &archive->arena, title, titleLength) != 0 ||
+        smallStringSet(&material->contributor, &archive->arena, contributor, contributorLength) != 0)
+    {
+        return -2;
+    }
+    material->number = type == NEWSPAPER ? 0 : number;
+    material->type = (uint8_t)type;
+    material->subtype = (uint8_t)subtype;
+    if (titleIndexInsert(&archive->titles, hash, (uint32_t)archive->count) != 0)
+    {
+        return -2;
+    }
+    archive->count++;
+    return 0;
+}
+
+/*
+This function adds a fixed-size struct Material, which is the migration path from Archive and ArchiveStore.
+It returns the result of varAddMaterial.
+*/
+int varAddFromMaterial(struct VarArchive *archive, const struct Material *material)
+{
+    if (material == NULL)
+    {
+        return -1;
+    }
+    const char *contributor;
+    int subtype;
+    int32_t number = 0;
+    switch (material->type)
+    {
+    case BOOK:
+        contributor = material->details.book.author;
+        subtype = material->details.book.type;
+        number = material->details.book.pages;
+        break;
+    case JOURNAL:
+        contributor = material->details.journal.publisher;
+        subtype = material->details.journal.type;
+        number = material->details.journal.issue;
+        break;
+    case NEWSPAPER:
+        contributor = material->details.newspaper.editor;
+        subtype = material->details.newspaper.type;
+        break;
+    default:
+        return -1;
+    }
+    return varAddMaterial(archive, material->title, strnlen(material->title, sizeof(material->title)), material->type, subtype,
+                          number, contributor, strnlen(contributor, sizeof(material->details.book.author)));
+}
+
+/*
+This function returns the material with the given title, or NULL if there is none. The pointer is valid until
+the archive is next modified.
+*/
+const struct VarMaterial *varFindMaterial(const struct VarArchive *archive, const char *title, size_t length)
+{
+    if (archive == NULL || title == NULL)
+    {
+        return NULL;
+    }
+    uint32_t slot = varLookup(archive, title, length, titleHashLength(title, length));
+    return slot == TITLE_INDEX_NONE ? NULL : &archive->materials[slot];
+}
+
+/*
+This function replaces the subtype, number and contributor of the material with the given title. The error
+codes match storeUpdateMaterial: -1 for a NULL argument, -2 if the title is not found, -3, -4 and -5 for an
+invalid book, journal or newspaper subtype and -7 if a long contributor could not be stored. It returns 0 on
+success.
+*/
+int varUpdateMaterial(struct VarArchive *archive, const char *title, size_t titleLength, int subtype, int32_t number, const char *contributor, size_t contributorLength)
+{
+    if (archive == NULL || title == NULL || contributor == NULL)
+    {
+        return -1;
+    }
+    uint32_t slot = varLookup(archive, title, titleLength, titleHashLength(title, titleLength));
+    if (slot == TITLE_INDEX_NONE)
+    {
+        return -2;
+    }
+
+    struct VarMaterial *material = &archive->materials[slot];
+    int status = varCheckSubtype((enum MaterialType)material->type, subtype);
+    if (status != 0)
+    {
+        return status;
+    }
+    if (!smallStringEquals(&material->contributor, contributor, contributorLength) &&
+        smallStringSet(&material->contributor, &archive->arena, contributor, contributorLength) != 0)
+    {
+        return -7;
+    }
+    material->number = material->type == NEWSPAPER ? 0 : number;
+    material->subtype = (uint8_t)subtype;
+    return 0;
+}
+
+/*
+This function removes the material with the given title, moving the last material into its place. It returns 0
+on success and -1 if the title is not found.
+*/
+int varRemoveMaterial(struct VarArchive *archive, const char *title, size_t length)
+{
+    if (archive == NULL || title == NULL)
+    {
+        return -1;
+    }
+    uint32_t hash = titleHashLength(title, length);
+    uint32_t slot = varLookup(archive, title, length, hash);
+    if (slot == TITLE_INDEX_NONE)
+    {
+        return -1;
+    }
+
+    titleIndexRemove(&archive->titles, hash, slot);
+    uint32_t last = (uint32_t)--archive->count;
+    if (slot != last)
+    {
+        const struct SmallString *moved = &archive->materials[last].title;
+        titleIndexRelocate(&archive->titles, titleHashLength(smallStringData(moved), smallStringLength(moved)), last, slot);
+        archive->materials[slot] = archive->materials[last];
+    }
+    return 0;
+}
+
+/*
+This function stores up to capacity pointers to materials of the given type in results. results may be NULL
+with a capacity of 0 to only count. It returns the total number of matches.
+*/
+size_t varFilterMaterials(const struct VarArchive *archive, enum MaterialType type, const struct VarMaterial **results, size_t capacity)
+{
+    if (archive == NULL)
+    {
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < archive->count; i++)
+    {
+        if (archive->materials[i].type == (uint8_t)type)
+        {
+            if (total < capacity)
+            {
+                results[total] = &archive->materials[i];
+            }
+            total++;
+        }
+    }
+    return total;
+}
+
+/*
+This function stores up to capacity pointers to materials whose contributor is the length bytes at author in
+results. A material whose contributor has a different length is rejected on its length byte alone. It returns
+the total number of matches.
+*/
+size_t varFilterMaterialsByAuthor(const struct VarArchive *archive, const char *author, size_t length, const struct VarMaterial **results, size_t capacity)
+{
+    if (archive == NULL || author == NULL)
+    {
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < archive->count; i++)
+    {
+        if (smallStringEquals(&archive->materials[i].contributor, author, length))
+        {
+            if (total < capacity)
+            {
+                results[total] = &archive->materials[i];
+            }
+            total++;
+        }
+    }
+    return total;
+}
@@ -0,0 +1,59 @@
+#ifndef VARSTORE_H
+#define VARSTORE_H
+
+#include "bitmap.h"
+#include "smallstring.h"
+#include "titleindex.h"
+
+// Structs
+
+/*
+A material whose title and contributor may be of any length. number is the page count of a book or the issue
+of a journal (0 for a newspaper) and subtype its BookType, JournalType or NewspaperType.
+*/
+struct VarMaterial
+{
+    struct SmallString title;
+    struct SmallString contributor;
+    int32_t number;
+    uint8_t type;
+    uint8_t subtype;
+};
+
+/*
+An archive of VarMaterials, which lifts the 50-byte limit on titles and names of struct Material. Short
+strings are stored inside the materials and long ones in arena. Every function takes strings with an explicit
+length, so titles and names may contain any byte and are compared by length before memcmp. Materials are kept
+dense: removing one moves the last material into its place. The arena bytes of a replaced or removed long
+string are only reclaimed when the archive is freed.
+*/
+struct VarArchive
+{
+    struct VarMaterial *materials;
+    size_t count;
+    size_t capacity;
+    struct TitleIndex titles;
+    struct StringArena arena;
+};
+
+// Functions
+
+void varInit(struct VarArchive *archive);
+
+void varFree(struct VarArchive *archive);
+
+int varAddMaterial(struct VarArchive *archive, const char *title, size_t titleLength, enum MaterialType type, int subtype, int32_t number, const char *contributor, size_t contributorLength);
+
+int varAddFromMaterial(struct VarArchive *archive, const struct Material *material);
+
+const struct VarMaterial *varFindMaterial(const struct VarArchive *archive, const char *title, size_t length);
+
+int varUpdateMaterial(struct VarArchive *archive, const char *title, size_t titleLength, int subtype, int32_t number, const char *contributor, size_t contributorLength);
+
+int varRemoveMaterial(struct VarArchive *archive, const char *title, size_t length);
+
+size_t varFilterMaterials(const struct VarArchive *archive, enum MaterialType type, const struct VarMaterial **results, size_t capacity);
+
+size_t varFilterMaterialsByAuthor(const struct VarArchive *archive, const char *author, size_t length, const struct VarMaterial **results, size_t capacity);
+
+#endif
@@ -0,0 +1,228 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include "wal.h"
+#include "snapshot.h"
+
+// the largest payload any record carries
+#define WAL_MAX_PAYLOAD (sizeof(struct Material) > sizeof(struct WalUpdate) ? sizeof(struct Material) : sizeof(struct WalUpdate))
+
+/*
+This function computes the checksum of a record laid out contiguously as header and payload. It covers every
+byte after the checksum field.
+*/
+static uint32_t walChecksum(const unsigned char *record, size_t length)
+{
+    uint64_t checksum = snapshotChecksum(&record[sizeof(uint32_t)], sizeof(struct WalRecordHeader) - sizeof(uint32_t) + length);
+    return (uint32_t)(checksum ^ (checksum >> 32));
+}
+
+/*
+This function opens the log at path for appending, creating it if it does not exist. Call walReplay next to
+apply the records already in it and learn the last sequence number. It returns 0 on success and -1 if the file
+cannot be opened.
+*/
+int walOpen(struct Wal *wal, const char *path)
+{
+    if (wal == NULL || path == NULL)
+    {
+        return -1;
+    }
+    memset(wal, 0, sizeof(*wal));
+    wal->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (wal->fd < 0)
+    {
+        return -1;
+    }
+    pthread_mutex_init(&wal->lock, NULL);
+    pthread_cond_init(&wal->synced, NULL);
+    return 0;
+}
+
+/*
+This function makes every appended record durable and closes the log.
+*/
+void walClose(struct Wal *wal)
+{
+    if (wal == NULL || wal->fd < 0)
+    {
+        return;
+    }
+    walCommit(wal, wal->lastSequence);
+    close(wal->fd);
+    wal->fd = -1;
+    pthread_mutex_destroy(&wal->lock);
+    pthread_cond_destroy(&wal->synced);
+}
+
+/*
+This function reads the log from the start and calls apply for every record whose sequence number is above
+after, which is the sequence a checkpoint snapshot already includes. Reading stops at the first record that is
+incomplete, fails its checksum or breaks the sequence; such a tail can only come from a crash during an append,
+so it is cut off and later appends continue from the last intact record. If apply returns nonzero for a record
+the replay stops there and the log is left untouched, so the record is not lost to a later truncation. It returns
+the number of records applied, -1 if the file cannot be read or truncated and -2 if apply rejected a record.
+*/
+int walReplay(struct Wal *wal, uint64_t after, WalApplyFn apply, void *context)
+{
+    int fd = dup(wal->fd);
+    FILE *file = fd < 0 ? NULL : fdopen(fd, "rb");
+    if (file == NULL)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    rewind(file);
+
+    unsigned char record[sizeof(struct WalRecordHeader) + WAL_MAX_PAYLOAD];
+    struct WalRecordHeader header;
+    uint64_t offset = 0;
+    uint64_t last = 0;
+    int applied = 0;
+    while (fread(record, sizeof(header), 1, file) == 1)
+    {
+        memcpy(&header, record, sizeof(header));
+        if (header.length > WAL_MAX_PAYLOAD || (last != 0 && header.sequence != last + 1))
+        {
+            break;
+        }
+        if (header.length != 0 && fread(&record[sizeof(header)], header.length, 1, file) != 1)
+        {
+            break;
+        }
+        if (header.checksum != walChecksum(record, header.length))
+        {
+            break;
+        }
+        if (header.sequence > after)
+        {
+            if (apply(context, (enum WalOp)header.op, &record[sizeof(header)], header.length) != 0)
+            {
+                fclose(file);
+                return -2;
+            }
+            applied++;
+        }
+        last = header.sequence;
+        offset += sizeof(header) + header.length;
+    }
+    fclose(file);
+
+    if (ftruncate(wal->fd, (off_t)offset) != 0)
+    {
+        return -1;
+    }
+    wal->size = offset;
+    wal->lastSequence = last > after ? last : after;
+    wal->durableSequence = wal->lastSequence;
+    return applied;
+}
+
+/*
+This function appends a record to the log with one write call and stores its sequence number in sequence. The
+record is not durable until walCommit returns for it. It returns 0 on success and -1 if the payload is too
+large or the write fails, after which the log refuses further appends.
+*/
+int walAppend(struct Wal *wal, enum WalOp op, const void *payload, size_t length, uint64_t *sequence)
+{
+    if (length > WAL_MAX_PAYLOAD)
+    {
+        return -1;
+    }
+
+    unsigned char record[sizeof(struct WalRecordHeader) + WAL_MAX_PAYLOAD];
+    struct WalRecordHeader header;
+    size_t size = sizeof(header) + length;
+
+    pthread_mutex_lock(&wal->lock);
+    if (wal->failed)
+    {
+        pthread_mutex_unlock(&wal->lock);
+        return -1;
+    }
+    header.checksum = 0;
+    header.length = (uint32_t)length;
+    header.sequence = wal->lastSequence + 1;
+    header.op = (uint32_t)op;
+    header.reserved = 0;
+    memcpy(record, &header, sizeof(header));
+    memcpy(&record[sizeof(header)], payload, length);
+    header.checksum = walChecksum(record, length);
+    memcpy(record, &header.checksum, sizeof(header.checksum));
+
+    if (write(wal->fd, record, size) != (ssize_t)size)
+    {
+        wal->failed = true;
+        pthread_mutex_unlock(&wal->lock);
+        return -1;
+    }
+    wal->lastSequence = header.sequence;
+    wal->size += size;
+    *sequence = header.sequence;
+    pthread_mutex_unlock(&wal->lock);
+    return 0;
+}
+
+/*
+This function returns once the record with the given sequence number, and every record before it, is on disk.
+If no sync is running the caller becomes the leader and syncs everything appended so far; otherwise it waits for
+the running sync and checks again. It returns 0 on success and -1 if a sync failed, after which the log refuses
+further appends because the state of the file is unknown.
+*/
+int walCommit(struct Wal *wal, uint64_t sequence)
+{
+    pthread_mutex_lock(&wal->lock);
+    while (!wal->failed && wal->durableSequence < sequence)
+    {
+        if (wal->syncing)
+        {
+            pthread_cond_wait(&wal->synced, &wal->lock);
+            continue;
+        }
+
+        wal->syncing = true;
+        uint64_t target = wal->lastSequence;
+        pthread_mutex_unlock(&wal->lock);
+        int status = fdatasync(wal->fd);
+        pthread_mutex_lock(&wal->lock);
+        wal->syncing = false;
+        wal->syncs++;
+        if (status != 0)
+        {
+            wal->failed = true;
+        }
+        else if (target > wal->durableSequence)
+        {
+            wal->durableSequence = target;
+        }
+        pthread_cond_broadcast(&wal->synced);
+    }
+    int result = wal->failed ? -1 : 0;
+    pthread_mutex_unlock(&wal->lock);
+    return result;
+}
+
+/*
+This function empties the log after a checkpoint has written every record to a snapshot. Sequence numbers keep
+counting from where they were. The caller must make sure no append runs concurrently. It returns 0 on success
+and -1 if the file could not be truncated.
+*/
+int walReset(struct Wal *wal)
+{
+    pthread_mutex_lock(&wal->lock);
+    while (wal->syncing)
+    {
+        pthread_cond_wait(&wal->synced, &wal->lock);
+    }
+    int status = ftruncate(wal->fd, 0) == 0 && fdatasync(wal->fd) == 0 ? 0 : -1;
+    if (status == 0)
+    {
+        wal->size = 0;
+        wal->durableSequence = wal->lastSequence;
+        pthread_cond_broadcast(&wal->synced);
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return status;
+}
@@ -0,0 +1,76 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bitmap.h"
+
+// Enums
+enum WalOp
+{
+    WAL_ADD = 1,
+    WAL_UPDATE,
+    WAL_REMOVE
+};
+
+// Structs
+
+/*
+The fixed header in front of every log record. checksum covers the rest of the header and the payload, so a
+record torn by a crash is detected on replay. Sequence numbers start at 1 and increase by one per record.
+*/
+struct WalRecordHeader
+{
+    uint32_t checksum;
+    uint32_t length;
+    uint64_t sequence;
+    uint32_t op;
+    uint32_t reserved;
+};
+
+/*
+The payload of a WAL_UPDATE record. WAL_ADD records carry a struct Material and WAL_REMOVE records a title.
+*/
+struct WalUpdate
+{
+    char title[50];
+    union MaterialDetails details;
+};
+
+/*
+An append-only write-ahead log. Appends are serialised by lock and written with one write call each. Commits
+use group commit: the first thread that needs durability becomes the leader and calls fdatasync for every
+record appended so far, while threads arriving during that sync wait for it and then either find their record
+covered or lead the next sync. Under load one sync therefore covers a whole batch of records.
+*/
+struct Wal
+{
+    int fd;
+    pthread_mutex_t lock;
+    pthread_cond_t synced;
+    uint64_t lastSequence;
+    uint64_t durableSequence;
+    uint64_t size;
+    uint64_t syncs;
+    bool syncing;
+    bool failed;
+};
+
+typedef int (*WalApplyFn)(void *context, enum WalOp op, const void *payload, size_t length);
+
+// Functions
+
+int walOpen(struct Wal *wal, const char *path);
+
+void walClose(struct Wal *wal);
+
+int walReplay(struct Wal *wal, uint64_t after, WalApplyFn apply, void *context);
+
+int walAppend(struct Wal *wal, enum WalOp op, const void *payload, size_t length, uint64_t *sequence);
+
+int walCommit(struct Wal *wal, uint64_t sequence);
+
+int walReset(struct Wal *wal);
+
+#endif